@@ -15,6 +15,11 @@ namespace tes_api_3 {
 #include "api_3/tes_atomic.h"
 #include "api_3/tes_array.h"
 #include "api_3/tes_map.h"
+#include "api_3/tes_counter_map.h"
+#include "api_3/tes_map_iterator.h"
+#include "api_3/tes_set.h"
+#include "api_3/tes_ring_buffer.h"
+#include "api_3/tes_priority_queue.h"
 #include "api_3/tes_db.h"
 #include "api_3/tes_jcontainers.h"
 #include "api_3/tes_string.h"
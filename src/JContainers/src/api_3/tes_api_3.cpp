@@ -8,6 +8,8 @@
 #include <set>
 #include <thread>
 #include <array>
+#include <map>
+#include <random>
 
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <boost/algorithm/string/trim.hpp>
+
 #include "collections/functions.h"
+#include "collections/packed_kernels.h"
+#include "collections/item_sort.h"
 
 namespace tes_api_3 {
 
@@ -157,7 +161,19 @@ NEGATIVE_IDX_COMMENT);
         {
             JC_LOG_API ("%p, %d, ...", (void*) obj, index);
 
+            constexpr bool packable = std::is_same<T, SInt32>::value || std::is_same<T, Float32>::value;
+            if constexpr (packable) {
+                if (obj) {
+                    if (auto value = obj->optimistic_read_number<T>(index)) {
+                        return *value;
+                    }
+                }
+            }
+
             doReadOp(obj, index, [=, &t](uint32_t idx) {
+                if constexpr (packable) {
+                    obj->u_packed_numbers(1); // counts the read, the next ones may take the lock-free path
+                }
                 t = obj->_array[idx].readAs<T>();
             });
 
@@ -181,7 +197,18 @@ NEGATIVE_IDX_COMMENT);
             if (!obj)
                 return v;
 
-            object_lock lck (obj);
+            object_shared_lock lck (obj);
+
+            if constexpr (std::is_same<T, SInt32>::value || std::is_same<T, Float32>::value) {
+                auto packed = obj->u_packed_numbers ();
+                const auto type = std::is_same<T, SInt32>::value ? item_type::integer : item_type::real;
+                if (packed && packed->type == type) {
+                    auto& values = packed->values<T> ();
+                    v.assign (values.begin (), values.end ());
+                    return v;
+                }
+            }
+
             v.reserve (obj->_array.size ());
 
             for (auto& i : obj->_array)
@@ -205,6 +232,22 @@ NEGATIVE_IDX_COMMENT);
             int result = -1;
 
             doReadOp(obj, pySearchStartIndex, [=, &result](uint32_t idx) {
+                if constexpr (std::is_same<T, SInt32>::value || std::is_same<T, Float32>::value) {
+                    auto packed = obj->u_packed_numbers();
+                    if (packed && packed->type != item_type::no_item) {
+                        auto& values = packed->values<T>(); // empty if there are no numbers of the T type
+                        size_t found = packed_kernels::npos;
+                        if (pySearchStartIndex >= 0) {
+                            found = idx < values.size() ? packed_kernels::find(values.data() + idx, values.size() - idx, value) : found;
+                            result = found != packed_kernels::npos ? int(found + idx) : -1;
+                        } else {
+                            found = idx < values.size() ? packed_kernels::find_last(values.data(), idx + 1, value) : found;
+                            result = found != packed_kernels::npos ? int(found + 1) : -1; // the same as the reverse search below returns
+                        }
+                        return;
+                    }
+                }
+
                 if (pySearchStartIndex >= 0) {
                     auto itr = std::find(obj->begin() + idx, obj->end(), item(value));
                     result = itr != obj->end() ? (itr - obj->begin()) : -1;
@@ -234,7 +277,16 @@ NEGATIVE_IDX_COMMENT);
             SInt32 result = 0;
             if (obj) 
             {
-                object_lock g (obj);
+                object_shared_lock g (obj);
+
+                if constexpr (std::is_same<T, SInt32>::value || std::is_same<T, Float32>::value) {
+                    auto packed = obj->u_packed_numbers ();
+                    if (packed && packed->type != item_type::no_item) {
+                        auto& values = packed->values<T> ();
+                        return static_cast<SInt32> (packed_kernels::count (values.data (), values.size (), value));
+                    }
+                }
+
                 auto n = std::count (obj->u_container ().begin (), obj->u_container ().end (), item (value));
                 result = static_cast<SInt32> (n);
             }
@@ -251,7 +303,7 @@ NEGATIVE_IDX_COMMENT);
         {
             JC_LOG_API ("%p, %d, ...", (void*) obj, index);
 
-            doReadOp(obj, index, [=](uint32_t idx) {
+            doModifyOp(obj, index, [=](uint32_t idx) {
                 obj->_array[idx] = item(val);
             });
         }
@@ -294,7 +346,7 @@ If @addToIndex >= 0 it inserts value at given index. " NEGATIVE_IDX_COMMENT);
         {
             JC_LOG_API ("%p, %d", (void*) obj, index);
 
-            doReadOp(obj, index, [=](uint32_t idx) {
+            doModifyOp(obj, index, [=](uint32_t idx) {
                 obj->_array.erase(obj->begin() + idx);
             });
         }
@@ -309,7 +361,7 @@ If @addToIndex >= 0 it inserts value at given index. " NEGATIVE_IDX_COMMENT);
             // -1 is 4th index
             // begin + 4 is last, valid iterator
             SInt32 pyIndexes[] { first, last };
-            doReadOp(obj, pyIndexes, [=](const std::array<uint32_t, 2>& indices) {
+            doModifyOp(obj, pyIndexes, [=](const std::array<uint32_t, 2>& indices) {
                 if (indices[0] <= indices[1]) {
                     obj->_array.erase(obj->begin() + indices[0], obj->begin() + indices[1] + 1);
                 }
@@ -357,7 +409,7 @@ If @addToIndex >= 0 it inserts value at given index. " NEGATIVE_IDX_COMMENT);
             JC_LOG_API ("%p, %d, %d", (void*) obj, idx, idx2);
 
             SInt32 pyIndexes[] = { idx, idx2 };
-            doReadOp(obj, pyIndexes, [=](const std::array<uint32_t, 2>& indices) {
+            doModifyOp(obj, pyIndexes, [=](const std::array<uint32_t, 2>& indices) {
 
                 if (indices[0] != indices[1]) {
                     std::swap(obj->u_container()[indices[0]], obj->u_container()[indices[1]]);
@@ -372,19 +424,118 @@ If @addToIndex >= 0 it inserts value at given index. " NEGATIVE_IDX_COMMENT);
 
             if (obj) {
                 object_lock g(obj);
-                std::sort(obj->u_container().begin(), obj->u_container().end());
+                sort_items(obj->begin(), obj->end());
             }
             return obj;
         }
         REGISTERF2(sort, "*", "Sorts the items into ascending order (none < int < float < form < object < string). Returns the array itself");
 
+        static ref sortByPath(tes_context& ctx, ref obj, const char* paths, bool descending = false)
+        {
+            JC_LOG_API ("%p, \"%s\", %d", (void*) obj, paths ? paths : "<nullptr>", (int) descending);
+            return sortByPath_(obj, paths, descending, 3);
+        }
+
+        // The keys are resolved on a copy of the items without holding the array lock: the paths lock the elements,
+        // the locks would get nested in the array -> element order otherwise (see tes_set::combine). An item may also refer to the array itself.
+        // Then the sorted copy replaces the items, unless the array has been modified meanwhile - the current items get sorted
+        // by the keys resolved for the same containers then. A container added meanwhile has no keys: the keys get resolved again,
+        // after the @attempts it sorts as if its values were missing
+        static ref sortByPath_(ref obj, const char* paths, bool descending, int attempts)
+        {
+            if (!obj || !paths)
+                return obj;
+
+            std::vector<std::string> keyPaths;
+            std::istringstream pathStream(paths);
+            for (std::string path; std::getline(pathStream, path, ','); ) {
+                boost::trim(path);
+                if (!path.empty()) {
+                    keyPaths.emplace_back(std::move(path));
+                }
+            }
+            if (keyPaths.empty())
+                return obj;
+
+            const size_t keyCount = keyPaths.size();
+            for (int attempt = 1; ; ++attempt) {
+                array::container_type items;
+                uint32_t sequence;
+                {
+                    object_shared_lock g(obj);
+                    sequence = obj->mutex().read_sequence_begin();
+                    items = obj->u_container();
+                }
+
+                std::vector<item> keys(items.size() * keyCount);
+                for_each_chunk(items.size(), [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i) {
+                        if (object_base *element = items[i].object()) {
+                            for (size_t k = 0; k < keyCount; ++k) {
+                                if (auto key = ca::get(*element, keyPaths[k].c_str())) {
+                                    keys[i * keyCount + k] = std::move(*key);
+                                }
+                            }
+                        }
+                    }
+                });
+
+                object_lock g(obj);
+                if (obj->mutex().read_sequence_begin() == sequence + 1) { // only this lock has been taken since the copy
+                    sort_items_by_keys(items.begin(), items.end(), keys, keyCount, descending);
+                    obj->u_container().swap(items);
+                    return obj;
+                }
+                if (u_sortByResolvedKeys(*obj, items, keys, keyCount, descending, attempt >= attempts)) {
+                    return obj;
+                }
+            }
+        }
+
+        // Sorts the items of the @arr by the @keys resolved for the same containers among the @resolved items.
+        // Returns false and leaves the array as it is if some container has no keys, unless @force-d.
+        // Touches neither the containers nor their locks, the exclusive lock of the @arr must be held
+        static bool u_sortByResolvedKeys(array& arr, const array::container_type& resolved, const std::vector<item>& keys,
+            size_t keyCount, bool descending, bool force)
+        {
+            std::unordered_map<const object_base*, size_t> resolvedIndex;
+            for (size_t i = 0; i < resolved.size(); ++i) {
+                if (const object_base *element = resolved[i].peek_object()) {
+                    resolvedIndex.emplace(element, i);
+                }
+            }
+
+            auto& items = arr.u_container();
+            std::vector<item> itemKeys(items.size() * keyCount);
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (const object_base *element = items[i].peek_object()) {
+                    auto found = resolvedIndex.find(element);
+                    if (found == resolvedIndex.end()) {
+                        if (!force) {
+                            return false;
+                        }
+                        continue;
+                    }
+                    std::copy_n(keys.begin() + found->second * keyCount, keyCount, itemKeys.begin() + i * keyCount);
+                }
+            }
+
+            sort_items_by_keys(items.begin(), items.end(), itemKeys, keyCount, descending);
+            return true;
+        }
+
+        REGISTERF2(sortByPath, "* paths descending=false",
+            "Sorts the containers of the array by the values at the comma-separated @paths, e.g. \".level,.name\":\n"
+            "by the first path, then by the next path for the equal ones and so on. The values are compared the same way as the sort function does,\n"
+            "the missing values and the items that aren't containers go first (last if @descending). Items with equal values keep their order. Returns the array itself");
+
         static ref unique(tes_context& ctx, ref obj)
         {
             JC_LOG_API ("%p", (void*) obj);
 
             if (obj) {
                 object_lock g(obj);
-                std::sort(obj->u_container().begin(), obj->u_container().end());
+                sort_items(obj->begin(), obj->end());
                 auto newEnd = std::unique(obj->u_container().begin(), obj->u_container().end());
                 obj->u_container().erase(newEnd, obj->u_container().end());
             }
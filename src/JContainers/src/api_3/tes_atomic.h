@@ -11,7 +11,8 @@ namespace tes_api_3 {
         void additionalSetup() {
             metaInfo.comment =
                 ""
-                "\nThis way you can even, probably, implement true locks and etc";
+                "\nThis way you can even, probably, implement true locks and etc"
+                "\nValues of JCounterMap are updated without locking the whole container";
         }
 
         template<class T, class F>
@@ -27,23 +28,66 @@ namespace tes_api_3 {
 
             using internal_item_type = typename item::user2variant_t<T>;
 
-            bool succeed = ca::visit_value(
-                *obj, path,
-                createMissingKeys ? ca::creative : ca::constant,
-                [&](item& item_value) {
-                    if (item_value.isNull()) {
-                        item_value = func(initialValue, inputValue);
-                    }
-                    else if (internal_item_type *asT = item_value.get<internal_item_type>()) {
-                        previousVal = const_cast<const internal_item_type&>(*asT);
-                        *asT = func(const_cast<const internal_item_type&>(*asT), inputValue);
-                    }
-                    else {
-                        assing_succeed = false;
-                    }
-                });
+            auto ac_info = createMissingKeys ? ca::access_creative(*obj, path) : ca::access_constant(*obj, path);
+            if (!ac_info) {
+                return onError;
+            }
+
+            if (counter_map* counters = ac_info->collection.as<counter_map>()) {
+                return performOnCounter_(*counters, ac_info->key, std::forward<F>(func), inputValue, initialValue, createMissingKeys, onError);
+            }
+
+            object_lock g(ac_info->collection);
+            item* item_value = ca::u_access_value(ac_info->collection, ac_info->key);
+            if (!item_value) {
+                return onError;
+            }
+
+            if (item_value->isNull()) {
+                *item_value = func(initialValue, inputValue);
+            }
+            else if (internal_item_type *asT = item_value->get<internal_item_type>()) {
+                previousVal = const_cast<const internal_item_type&>(*asT);
+                *asT = func(const_cast<const internal_item_type&>(*asT), inputValue);
+            }
+            else {
+                assing_succeed = false;
+            }
+
+            return assing_succeed ? previousVal : onError;
+        }
 
-            return (succeed && assing_succeed) ? previousVal : onError;
+        // the slot is found under the shared lock once, then modified with a lock-free read-modify-write operation
+        template<class T, class F>
+        static T performOnCounter_(
+            counter_map& counters, const ca::key_variant& key, F&& func, const T& inputValue,
+            const T& initialValue, bool createMissingKeys, const T& onError)
+        {
+            using internal_item_type = typename item::user2variant_t<T>;
+
+            if constexpr (std::is_same<internal_item_type, SInt32>::value || std::is_same<internal_item_type, item::Real>::value) {
+                auto counterKey = boost::get<std::string>(&key);
+                counter_map::slot_ref slot = counterKey ? counters.find_slot(*counterKey, createMissingKeys) : nullptr;
+                if (!slot) {
+                    return onError;
+                }
+
+                internal_item_type previousVal = default_value<internal_item_type>();
+                bool succeed = slot->fetch_modify<internal_item_type>(
+                    [&func](const internal_item_type& current, const internal_item_type& operand) {
+                        return func(current, operand);
+                    },
+                    internal_item_type(inputValue), internal_item_type(initialValue), previousVal);
+                if (!succeed) {
+                    return onError;
+                }
+
+                counters.mark_modified(); // the slot has changed without the lock
+                return T(previousVal);
+            }
+            else {
+                return onError; // counters store numbers only
+            }
         }
 
         struct ignore_first {
@@ -80,28 +124,61 @@ namespace tes_api_3 {
             if (!obj || !path)
                 return onError;
 
+            auto ac_info = createMissingKeys ? ca::access_creative(*obj, path) : ca::access_constant(*obj, path);
+            if (!ac_info) {
+                return onError;
+            }
+
+            if (counter_map* counters = ac_info->collection.as<counter_map>()) {
+                return compareExchangeOnCounter_(*counters, ac_info->key, newValue, comparer, createMissingKeys, onError);
+            }
+
+            object_lock g(ac_info->collection);
+            item* itemValue = ca::u_access_value(ac_info->collection, ac_info->key);
+            if (!itemValue) {
+                return onError;
+            }
+
             T previousVal = default_value<T>();
-            bool succeed = ca::visit_value(
-                *obj, path,
-                createMissingKeys ? ca::creative : ca::constant,
-                [&](item& itemValue) {
-                    if (itemValue == comparer) {
-
-                        if (auto* valuePtr = itemValue.get<T>()) {
-                            previousVal = std::move(*valuePtr);
-                        }
+            if (*itemValue == comparer) {
 
-                        itemValue = std::move(newValue);
-                    } else {
+                if (auto* valuePtr = itemValue->get<T>()) {
+                    previousVal = std::move(*valuePtr);
+                }
 
-                        if (const auto* valuePtr = itemValue.get<T>()) {
-                            previousVal = *valuePtr;
-                        }
+                *itemValue = std::move(newValue);
+            } else {
 
-                    }
-                });
+                if (const auto* valuePtr = itemValue->get<T>()) {
+                    previousVal = *valuePtr;
+                }
+
+            }
 
-            return succeed ? previousVal : onError;
+            return previousVal;
+        }
+
+        template<class T>
+        static T compareExchangeOnCounter_(
+            counter_map& counters, const ca::key_variant& key,
+            const T& newValue, const T& comparer, bool createMissingKeys, const T& onError)
+        {
+            if constexpr (std::is_same<T, SInt32>::value || std::is_same<T, Float32>::value) {
+                auto counterKey = boost::get<std::string>(&key);
+                counter_map::slot_ref slot = counterKey ? counters.find_slot(*counterKey, createMissingKeys) : nullptr;
+                if (!slot) {
+                    return onError;
+                }
+
+                T previousVal = default_value<T>();
+                if (slot->compare_exchange(newValue, comparer, previousVal)) {
+                    counters.mark_modified(); // the slot has changed without the lock
+                }
+                return previousVal;
+            }
+            else {
+                return onError;
+            }
         }
 
         template<class T, class F>
@@ -164,6 +241,413 @@ If @createMissingKeys is True, the function attemps to create missing @path elem
         REGISTERF(compareExchange<object_base*>, "compareExchangeObj", PARAMS_INT "0", nullptr);
 #   undef PARAMS_INT
 
+        //////////////////////////////////////////////////////////////////////////
+        // Multi-path transactions
+        //
+        // A transaction is an ordinary array of queued operations (each operation is an array too),
+        // so it is owned, collected and saved like any other container. @commit resolves all paths,
+        // locks every container the paths pass through in address order (to avoid deadlocks), resolves the paths
+        // once more under the locks, applies the operations and, if any of them fails, rolls the changes back
+        // before unlocking. If a path passes through other containers by then, the commit starts over.
+
+        enum class tx_op : SInt32 {
+            expect = 0,
+            set,
+            fetch_add,
+            move,
+        };
+
+        struct tx_statistics {
+            std::atomic<uint32_t> commits = 0;
+            std::atomic<uint32_t> aborts = 0;
+            std::atomic<uint32_t> contended_locks = 0;
+            std::atomic<uint32_t> retries = 0; // the paths have changed while the locks were being taken
+        };
+
+        static tx_statistics& tx_stats() {
+            static tx_statistics stats;
+            return stats;
+        }
+
+        static object_base* begin(tes_context& ctx) {
+            return &array::object(ctx);
+        }
+        REGISTERF2(begin, "",
+"Creates a new transaction - a queue of operations that @commit applies atomically, all at once or none of them.\n\
+Works across several containers and paths, e.g. to move a value from one container to another:\n\
+\n\
+    int tx = JAtomic.begin()\n\
+    JAtomic.queueExpectInt(tx, chest, \".gold\", 10)\n\
+    JAtomic.queueFetchAddInt(tx, chest, \".gold\", -10)\n\
+    JAtomic.queueFetchAddInt(tx, player, \".gold\", 10)\n\
+    bool done = JAtomic.commit(tx)\n\
+\n\
+The transaction is an array and should be retained like any other container if it lives longer than a few seconds.");
+
+        static bool queue_op(array* tx, tx_op op, object_base* obj, const char* path, item&& value, object_base* obj2 = nullptr, const char* path2 = nullptr) {
+            if (!tx || !obj || !path || (op == tx_op::move && (!obj2 || !path2))) {
+                return false;
+            }
+
+            auto& entry = array::objectWithInitializer([&](array& me) {
+                me.u_push(item((SInt32)op));
+                me.u_push(item(obj));
+                me.u_push(item(path));
+                me.u_push(std::move(value));
+                if (op == tx_op::move) {
+                    me.u_push(item(obj2));
+                    me.u_push(item(path2));
+                }
+            },
+                tx->context());
+
+            tx->push(item(entry));
+            return true;
+        }
+
+        template<class T>
+        static bool queueExpect(tes_context& ctx, array* tx, object_base* obj, const char* path, T value) {
+            return queue_op(tx, tx_op::expect, obj, path, item(value));
+        }
+
+        template<class T>
+        static bool queueSet(tes_context& ctx, array* tx, object_base* obj, const char* path, T value) {
+            return queue_op(tx, tx_op::set, obj, path, item(value));
+        }
+
+        template<class T>
+        static bool queueFetchAdd(tes_context& ctx, array* tx, object_base* obj, const char* path, T value) {
+            return queue_op(tx, tx_op::fetch_add, obj, path, item(value));
+        }
+
+        static bool queueMove(tes_context& ctx, array* tx, object_base* obj, const char* path, object_base* targetObj, const char* targetPath) {
+            return queue_op(tx, tx_op::move, obj, path, item(), targetObj, targetPath);
+        }
+
+#   define PARAMS_TX   "transaction object path value"
+        REGISTERF(queueExpect<SInt32>, "queueExpectInt", PARAMS_TX,
+"Queues a precondition: the transaction fails if the value at the @path is not equal to the @value at the moment of commit");
+        REGISTERF(queueExpect<Float32>, "queueExpectFlt", PARAMS_TX, nullptr);
+        REGISTERF(queueExpect<const char*>, "queueExpectStr", PARAMS_TX, nullptr);
+        REGISTERF(queueExpect<form_ref>, "queueExpectForm", PARAMS_TX, nullptr);
+        REGISTERF(queueExpect<object_base*>, "queueExpectObj", PARAMS_TX, nullptr);
+
+        REGISTERF(queueSet<SInt32>, "queueSetInt", PARAMS_TX,
+"Queues an assignment of the @value to the @path. Missing map keys are created, intermediate path elements must exist");
+        REGISTERF(queueSet<Float32>, "queueSetFlt", PARAMS_TX, nullptr);
+        REGISTERF(queueSet<const char*>, "queueSetStr", PARAMS_TX, nullptr);
+        REGISTERF(queueSet<form_ref>, "queueSetForm", PARAMS_TX, nullptr);
+        REGISTERF(queueSet<object_base*>, "queueSetObj", PARAMS_TX, nullptr);
+
+        REGISTERF(queueFetchAdd<SInt32>, "queueFetchAddInt", PARAMS_TX,
+"Queues x += value. None value at the @path is treated as zero, a value of another type fails the transaction");
+        REGISTERF(queueFetchAdd<Float32>, "queueFetchAddFlt", PARAMS_TX, nullptr);
+#   undef PARAMS_TX
+
+        REGISTERF(queueMove, "queueMove", "transaction object path targetObject targetPath",
+"Queues a move of the value at the @path into the @targetPath of the @targetObject. The source key gets removed\n\
+(array items are set to None to keep indices stable). Fails the transaction if there is no value at the @path");
+
+        // locks distinct containers in address order, counts the locks that were already taken by someone else
+        class tx_lock_set {
+            std::vector<object_stack_ref> _objects;
+        public:
+            explicit tx_lock_set(std::vector<object_stack_ref>&& objects) : _objects(std::move(objects)) {
+                std::sort(_objects.begin(), _objects.end(), [](const object_stack_ref& l, const object_stack_ref& r) {
+                    return l.get() < r.get();
+                });
+                _objects.erase(
+                    std::unique(_objects.begin(), _objects.end(), [](const object_stack_ref& l, const object_stack_ref& r) {
+                        return l.get() == r.get();
+                    }),
+                    _objects.end());
+
+                for (auto& obj : _objects) {
+                    if (!obj->mutex().try_lock()) {
+                        ++tx_stats().contended_locks;
+                        obj->mutex().lock();
+                    }
+                    obj->u_before_write();
+                }
+            }
+
+            ~tx_lock_set() {
+                for (auto itr = _objects.rbegin(); itr != _objects.rend(); ++itr) {
+                    (*itr)->mutex().unlock();
+                }
+            }
+
+            tx_lock_set(const tx_lock_set&) = delete;
+            tx_lock_set& operator=(const tx_lock_set&) = delete;
+        };
+
+        struct tx_slot {
+            object_stack_ref collection;
+            ca::key_variant key;
+        };
+
+        struct tx_undo_entry {
+            tx_slot slot;
+            boost::optional<item> previous; // none - key did not exist
+        };
+
+        struct tx_resolved_op {
+            tx_op op;
+            item value;
+            tx_slot target;
+            tx_slot destination;
+        };
+
+        // expects all involved containers being locked. Returns false and leaves the containers untouched on failure
+        static bool u_apply_ops(const std::vector<tx_resolved_op>& ops) {
+            std::vector<tx_undo_entry> undo;
+
+            auto touch = [&undo](const tx_slot& target, bool create) -> item* {
+                item* slot = ca::u_access_value(*target.collection, target.key);
+                if (slot) {
+                    undo.push_back(tx_undo_entry{ target, *slot });
+                }
+                else if (create) {
+                    slot = ca::u_assign_value(*target.collection, target.key, item());
+                    if (slot) {
+                        undo.push_back(tx_undo_entry{ target, boost::none });
+                    }
+                }
+                return slot;
+            };
+
+            auto apply = [&undo, &touch](const tx_resolved_op& op) -> bool {
+                const tx_slot& target = op.target;
+
+                switch (op.op) {
+                case tx_op::expect: {
+                    const item* slot = ca::u_access_value(*target.collection, target.key);
+                    return slot ? *slot == op.value : op.value.isNull();
+                }
+                case tx_op::set: {
+                    item* slot = touch(target, true);
+                    if (slot) {
+                        *slot = op.value;
+                    }
+                    return slot != nullptr;
+                }
+                case tx_op::fetch_add: {
+                    item* slot = touch(target, true);
+                    if (!slot) {
+                        return false;
+                    }
+
+                    if (slot->isNull()) {
+                        *slot = op.value;
+                        return true;
+                    }
+                    else if (auto* asInt = slot->get<SInt32>()) {
+                        auto* delta = op.value.get<SInt32>();
+                        if (delta) {
+                            *asInt += *delta;
+                        }
+                        return delta != nullptr;
+                    }
+                    else if (auto* asReal = slot->get<Float32>()) {
+                        auto* delta = op.value.get<Float32>();
+                        if (delta) {
+                            *asReal += *delta;
+                        }
+                        return delta != nullptr;
+                    }
+                    return false;
+                }
+                case tx_op::move: {
+                    const item* source = ca::u_access_value(*target.collection, target.key);
+                    if (!source || source->isNull()) {
+                        return false;
+                    }
+
+                    item value = *source;
+                    if (target.collection->as<array>()) {
+                        *touch(target, false) = boost::blank();
+                    }
+                    else {
+                        undo.push_back(tx_undo_entry{ target, value });
+                        ca::u_erase_key(*target.collection, target.key);
+                    }
+
+                    item* destination = touch(op.destination, true);
+                    if (destination) {
+                        *destination = std::move(value);
+                    }
+                    return destination != nullptr;
+                }
+                default:
+                    return false;
+                }
+            };
+
+            for (const auto& op : ops) {
+                if (!apply(op)) {
+                    for (auto itr = undo.rbegin(); itr != undo.rend(); ++itr) {
+                        if (itr->previous) {
+                            ca::u_assign_value(*itr->slot.collection, itr->slot.key, *itr->previous);
+                        }
+                        else {
+                            ca::u_erase_key(*itr->slot.collection, itr->slot.key);
+                        }
+                    }
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        struct tx_path {
+            object_stack_ref root;
+            std::string path;
+            std::vector<object_base*> chain; // the containers the path has passed through, the last one included
+        };
+
+        struct tx_queued_op {
+            tx_resolved_op op;
+            tx_path target;
+            tx_path destination; // the move only
+        };
+
+        enum { tx_commit_attempts = 4 };
+
+        static bool commit(tes_context& ctx, array* tx) {
+            if (!tx) {
+                return false;
+            }
+
+            array::container_type queued;
+            {
+                object_lock g(tx);
+                queued.swap(tx->u_container());
+            }
+
+            std::vector<tx_queued_op> ops;
+            ops.reserve(queued.size());
+
+            auto read_path = [](const array::container_type& entry, size_t objIdx, tx_path& path) -> bool {
+                object_base* obj = entry[objIdx].object();
+                const char* str = entry[objIdx + 1].strValue();
+                if (!obj || !str) {
+                    return false;
+                }
+
+                path.root = obj;
+                path.path = str;
+                return true;
+            };
+
+            bool resolved = true;
+            for (const auto& queuedItem : queued) {
+                array* entryObj = queuedItem.object()->as<array>();
+                if (!entryObj) {
+                    resolved = false;
+                    break;
+                }
+
+                auto entry = entryObj->container_copy();
+                if (entry.size() < 4) {
+                    resolved = false;
+                    break;
+                }
+
+                tx_queued_op op{ tx_resolved_op{ (tx_op)entry[0].intValue(), entry[3] } };
+                resolved = read_path(entry, 1, op.target);
+                if (resolved && op.op.op == tx_op::move) {
+                    resolved = entry.size() >= 6 && read_path(entry, 4, op.destination);
+                }
+
+                if (!resolved) {
+                    break;
+                }
+                ops.push_back(std::move(op));
+            }
+
+            // intermediate path elements must exist, only the last key can be created by an operation.
+            // Counter slots aren't modified in place, use JAtomic.fetch* functions instead
+            auto resolve = [](tx_path& path, std::vector<object_stack_ref>& involved) -> bool {
+                path.chain.clear();
+                auto info = ca::access_constant(*path.root, path.path.c_str(), path.chain);
+                if (!info || info->collection.as<counter_map>()) {
+                    return false;
+                }
+
+                involved.insert(involved.end(), path.chain.begin(), path.chain.end());
+                return true;
+            };
+
+            // the same walk, under the locks of the whole chain. Fails if the path passes through the other containers now
+            auto u_revalidate = [](const tx_path& path, tx_slot& slot) -> bool {
+                std::vector<object_base*> chain;
+                auto info = ca::u_access_constant(*path.root, path.path.c_str(), chain);
+                if (!info || chain != path.chain) {
+                    return false;
+                }
+
+                slot = tx_slot{ &info->collection, info->key };
+                return true;
+            };
+
+            bool succeed = false;
+            for (int attempt = 0; resolved && attempt < tx_commit_attempts; ++attempt) {
+                std::vector<object_stack_ref> involved;
+                for (auto& op : ops) {
+                    resolved = resolve(op.target, involved)
+                        && (op.op.op != tx_op::move || resolve(op.destination, involved));
+                    if (!resolved) {
+                        break;
+                    }
+                }
+
+                if (!resolved) {
+                    break;
+                }
+
+                tx_lock_set locks(std::move(involved));
+
+                std::vector<tx_resolved_op> resolvedOps;
+                resolvedOps.reserve(ops.size());
+                for (const auto& op : ops) {
+                    tx_resolved_op resolvedOp = op.op;
+                    if (!u_revalidate(op.target, resolvedOp.target)
+                        || (op.op.op == tx_op::move && !u_revalidate(op.destination, resolvedOp.destination))) {
+                        break;
+                    }
+                    resolvedOps.push_back(std::move(resolvedOp));
+                }
+
+                if (resolvedOps.size() == ops.size()) {
+                    succeed = u_apply_ops(resolvedOps);
+                    break;
+                }
+
+                ++tx_stats().retries;
+            }
+
+            ++(succeed ? tx_stats().commits : tx_stats().aborts);
+            return succeed;
+        }
+        REGISTERF2(commit, "transaction",
+"Applies all operations queued into the @transaction at once. Returns True if all of them succeed.\n\
+Otherwise nothing gets changed and False is returned. In both cases the transaction gets emptied and can be reused");
+
+        static object_base* transactionStats(tes_context& ctx) {
+            return &map::objectWithInitializer([](map& me) {
+                me.u_set("commits", item((SInt32)tx_stats().commits.load()));
+                me.u_set("aborts", item((SInt32)tx_stats().aborts.load()));
+                me.u_set("contendedLocks", item((SInt32)tx_stats().contended_locks.load()));
+                me.u_set("retries", item((SInt32)tx_stats().retries.load()));
+            },
+                ctx);
+        }
+        REGISTERF2(transactionStats, "",
+"Returns a new map with the number of succeed (commits) and failed (aborts) transactions, the number of\n\
+container locks a transaction had to wait for (contendedLocks) and the number of times a transaction had to start over\n\
+because its paths were changed meanwhile (retries) since the game start");
+
     };
 
     TES_META_INFO(tes_atomic);
@@ -239,5 +723,63 @@ If @createMissingKeys is True, the function attemps to create missing @path elem
     */
 
         }
+
+        TEST(tes_atomic, transaction)
+        {
+            tes_context_standalone context;
+            map& chest = map::object(context);
+            map& player = map::object(context);
+            array& slots = array::objectWithInitializer([](array& me) { me.u_container().resize(2); }, context);
+
+            chest.u_set("gold", item(10));
+            slots.u_set(0, item("sword"));
+
+            auto tx = tes_atomic::begin(context)->as<array>();
+            EXPECT_TRUE(tes_atomic::queueExpect<SInt32>(context, tx, &chest, ".gold", 10));
+            EXPECT_TRUE(tes_atomic::queueFetchAdd<SInt32>(context, tx, &chest, ".gold", -10));
+            EXPECT_TRUE(tes_atomic::queueFetchAdd<SInt32>(context, tx, &player, ".gold", 10));
+            EXPECT_TRUE(tes_atomic::queueMove(context, tx, &slots, "[0]", &player, ".weapon"));
+            EXPECT_EQ(4, tx->s_count());
+
+            EXPECT_TRUE(tes_atomic::commit(context, tx));
+            EXPECT_EQ(0, tx->s_count());
+            EXPECT_EQ(0, chest.findOrDef("gold").intValue());
+            EXPECT_EQ(10, player.findOrDef("gold").intValue());
+            EXPECT_EQ(std::string("sword"), player.findOrDef("weapon").strValue());
+            EXPECT_TRUE(slots.get_item(0)->isNull());
+
+            // the precondition fails - nothing should be changed, even the operations queued before it
+            const uint32_t aborts = tes_atomic::tx_stats().aborts.load();
+            tes_atomic::queueFetchAdd<SInt32>(context, tx, &player, ".gold", -10);
+            tes_atomic::queueSet<const char*>(context, tx, &player, ".newKey", "value");
+            tes_atomic::queueExpect<SInt32>(context, tx, &chest, ".gold", 10);
+            tes_atomic::queueFetchAdd<SInt32>(context, tx, &chest, ".gold", 10);
+
+            EXPECT_FALSE(tes_atomic::commit(context, tx));
+            EXPECT_EQ(aborts + 1, tes_atomic::tx_stats().aborts.load());
+            EXPECT_EQ(10, player.findOrDef("gold").intValue());
+            EXPECT_EQ(0, chest.findOrDef("gold").intValue());
+            EXPECT_TRUE(player.u_get("newKey") == nullptr);
+
+            // a type mismatch or an unresolvable path fails the transaction as well
+            tes_atomic::queueMove(context, tx, &player, ".weapon", &chest, ".weapon");
+            tes_atomic::queueFetchAdd<Float32>(context, tx, &player, ".gold", 1.f);
+            EXPECT_FALSE(tes_atomic::commit(context, tx));
+            EXPECT_EQ(std::string("sword"), player.findOrDef("weapon").strValue());
+            EXPECT_TRUE(chest.u_get("weapon") == nullptr);
+
+            tes_atomic::queueSet<SInt32>(context, tx, &player, ".missing.key", 1);
+            EXPECT_FALSE(tes_atomic::commit(context, tx));
+
+            // the nested containers get locked and re-resolved along with their parents
+            map& purse = map::object(context);
+            player.u_set("purse", item(&purse));
+            tes_atomic::queueFetchAdd<SInt32>(context, tx, &player, ".purse.gold", 5);
+            tes_atomic::queueMove(context, tx, &player, ".weapon", &player, ".purse.weapon");
+            EXPECT_TRUE(tes_atomic::commit(context, tx));
+            EXPECT_EQ(5, purse.findOrDef("gold").intValue());
+            EXPECT_EQ(std::string("sword"), purse.findOrDef("weapon").strValue());
+            EXPECT_TRUE(player.u_get("weapon") == nullptr);
+        }
     }
 }
@@ -0,0 +1,132 @@
+namespace tes_api_3 {
+
+/// Redefine in each logging module
+#undef  JC_LOG_API_SOURCE
+#define JC_LOG_API_SOURCE "JCounterMap"
+
+    using namespace collections;
+
+    class tes_counter_map : public class_meta< tes_counter_map > {
+    public:
+
+        typedef counter_map* ref;
+
+        REGISTER_TES_NAME("JCounterMap");
+
+        void additionalSetup() {
+            metaInfo.comment = "Associative container of numeric (integer or float) counters.\n"
+                "JAtomic.fetch* and JAtomic.exchange* functions update its values without locking the container,\n"
+                "so it suits counters shared by many threads better than JMap does. Other values can't be stored.\n"
+                "Inherits JValue functionality";
+        }
+
+        REGISTERF(tes_object::object<counter_map>, "object", "", kCommentObject);
+
+        template<class T>
+        static T getItem(tes_context& ctx, ref obj, const char* key, T def = default_value<T>()) {
+            JC_LOG_API ("%p, ..., ...", (void*) obj);
+            if (!obj || !key) {
+                return def;
+            }
+            counter_map::slot_ref slot = obj->find_slot(key, false);
+            return slot && !slot->empty() ? slot->load().readAs<T>() : def;
+        }
+        REGISTERF(getItem<SInt32>, "getInt", "object key default=0", "Returns the value associated with the @key. If not, returns @default value");
+        REGISTERF(getItem<Float32>, "getFlt", "object key default=0.0", "");
+
+        template<class T>
+        static void setItem(tes_context& ctx, ref obj, const char* key, T val) {
+            JC_LOG_API ("%p, ..., ...", (void*) obj);
+            if (obj && key) {
+                obj->find_slot(key, true)->store(item(val));
+                obj->mark_modified();
+            }
+        }
+        REGISTERF(setItem<SInt32>, "setInt", "* key value", "Inserts @key: @value pair. Replaces existing pair with the same @key");
+        REGISTERF(setItem<Float32>, "setFlt", "* key value", "");
+
+        static bool hasKey(tes_context& ctx, ref obj, const char* key) {
+            JC_LOG_API ("%p, ...", (void*) obj);
+            counter_map::slot_ref slot = (obj && key) ? obj->find_slot(key, false) : nullptr;
+            return slot && !slot->empty();
+        }
+        REGISTERF2(hasKey, "* key", "Returns true, if the container has @key: value pair");
+    };
+
+    TES_META_INFO(tes_counter_map);
+
+    JC_TEST(tes_counter_map, atomic_counters)
+    {
+        counter_map* counters = tes_object::object<counter_map>(context);
+
+        const int threadsCount = 8, iterations = 10000;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadsCount; ++i) {
+            threads.emplace_back([&]() {
+                for (int j = 0; j < iterations; ++j) {
+                    tes_atomic::performAtomicFunction<SInt32, std::plus<SInt32>>(context, counters, ".hits", 1, 0, true, -1);
+                    tes_atomic::performAtomicFunction<Float32, std::plus<Float32>>(context, counters, ".time", 0.5f, 0.f, true, -1.f);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        // readable as ordinary values
+        EXPECT_EQ(threadsCount * iterations, tes_counter_map::getItem<SInt32>(context, counters, "hits"));
+        EXPECT_EQ(threadsCount * iterations, tes_object::resolveGetter<SInt32>(context, counters, ".hits"));
+        EXPECT_EQ(threadsCount * iterations * 0.5f, tes_object::resolveGetter<Float32>(context, counters, ".time"));
+        EXPECT_EQ(2, counters->s_count());
+
+        // a number of another type or a non-number fails
+        EXPECT_EQ(-1.f, (tes_atomic::performAtomicFunction<Float32, std::plus<Float32>>(context, counters, ".hits", 1.f, 0.f, false, -1.f)));
+        EXPECT_EQ("", tes_atomic::exchange<std::string>(context, counters, ".hits", "str", false, ""));
+        EXPECT_FALSE(tes_object::solveSetter<const char*>(context, counters, ".name", "str", true));
+
+        EXPECT_EQ(threadsCount * iterations, tes_atomic::exchange<SInt32>(context, counters, ".hits", 5, false, -1));
+        EXPECT_EQ(5, tes_atomic::compareExchange<SInt32>(context, counters, ".hits", 7, 5, false, -1));
+        EXPECT_EQ(7, tes_atomic::compareExchange<SInt32>(context, counters, ".hits", 9, 5, false, -1));
+        EXPECT_TRUE(tes_object::solveSetter<SInt32>(context, counters, ".hits", 1));
+        EXPECT_EQ(1, tes_counter_map::getItem<SInt32>(context, counters, "hits"));
+
+        // an erased slot leaves the map, it lives as long as someone holds it
+        counter_map::slot_ref held = counters->find_slot("hits", false);
+        counters->s_clear();
+        EXPECT_FALSE(tes_counter_map::hasKey(context, counters, "hits"));
+        EXPECT_EQ(0, counters->s_count());
+        EXPECT_TRUE(counters->u_container().empty());
+        EXPECT_EQ(1, held.use_count());
+
+        tes_counter_map::setItem<SInt32>(context, counters, "hits", 3);
+        EXPECT_NE(held, counters->find_slot("hits", false));
+        EXPECT_TRUE(ca::u_erase_key(*counters, std::string("hits")));
+        EXPECT_TRUE(counters->u_container().empty());
+
+        // an existing slot changes without the exclusive lock, the delta saves still notice the change
+        tes_counter_map::setItem<SInt32>(context, counters, "hits", 3);
+        counters->_base_index = 1;
+        counters->_base_sequence = counters->mutex().read_sequence_begin();
+        counters->_modified = false;
+        EXPECT_EQ(3, (tes_atomic::performAtomicFunction<SInt32, std::plus<SInt32>>(context, counters, ".hits", 1, 0, false, -1)));
+        EXPECT_EQ(counters->_base_sequence, counters->mutex().read_sequence_begin());
+        EXPECT_TRUE(counters->u_is_modified_since_base());
+    }
+
+    JC_TEST(tes_counter_map, json_and_copying)
+    {
+        counter_map* counters = tes_object::object<counter_map>(context);
+        tes_counter_map::setItem<SInt32>(context, counters, "a", 1);
+        tes_counter_map::setItem<Float32>(context, counters, "b", 2.5f);
+
+        auto copy = json_deserializer::object_from_json_data(context,
+            json_serializer::create_json_data(*counters).get())->as<counter_map>();
+        EXPECT_NOT_NIL(copy);
+        EXPECT_EQ(1, tes_counter_map::getItem<SInt32>(context, copy, "a"));
+        EXPECT_EQ(2.5f, tes_counter_map::getItem<Float32>(context, copy, "b"));
+
+        auto deep = copying::deep_copy(context, *counters).as<counter_map>();
+        EXPECT_NOT_NIL(deep);
+        EXPECT_EQ(2, deep->s_count());
+    }
+}
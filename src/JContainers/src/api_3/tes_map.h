@@ -127,6 +127,19 @@ namespace tes_api_3 {
         }
         REGISTERF(allValues, "allValues", "*", "Returns a new array containing all values");
 
+        template<class T>
+        static T getNthValue(tes_context& ctx, ref obj, SInt32 keyIndex, T def = default_value<T>()) {
+            JC_LOG_API ("%p, %d, ...", (void*) obj, keyIndex);
+            map_functions::getNthValue(obj, keyIndex, [&](const item& itm) { def = itm.readAs<T>(); });
+            return def;
+        }
+        REGISTERF(getNthValue<SInt32>, "getNthInt", "* keyIndex default=0", "Returns the value of the N-th pair (in the key order). If not, returns @default value. "
+                                                                              NEGATIVE_IDX_COMMENT "\nComplexity is O(log n)");
+        REGISTERF(getNthValue<Float32>, "getNthFlt", "* keyIndex default=0.0", "");
+        REGISTERF(getNthValue<skse::string_ref>, "getNthStr", "* keyIndex default=\"\"", "");
+        REGISTERF(getNthValue<object_base*>, "getNthObj", "* keyIndex default=0", "");
+        REGISTERF(getNthValue<form_ref>, "getNthForm", "* keyIndex default=None", "");
+
         static bool removeKey(tes_context& ctx, ref obj, key_cref key)
         {
             JC_LOG_API ("%p, ...", (void*) obj);
@@ -184,6 +197,19 @@ namespace tes_api_3 {
         }
         REGISTERF2(addPairs, "* source overrideDuplicates", "Inserts key-value pairs from the source container");
 
+        static map_cursor* iterator(tes_context& ctx, ref obj)
+        {
+            JC_LOG_API ("%p", (void*) obj);
+
+            if (!obj) {
+                return nullptr;
+            }
+
+            return &map_cursor::objectWithInitializer([&](map_cursor& cursor) { cursor.reset(*obj); }, ctx);
+        }
+        REGISTERF2(iterator, "*", "Returns a new JMapIterator positioned before the first pair of the container.\n"
+            "Unlike nextKey, advancing the iterator doesn't search for the previous key, and the iterator stops if a key gets added or removed");
+
         void additionalSetup();
 
         //////////////////////////////////////////////////////////////////////////
@@ -249,7 +275,7 @@ Usage:
         }
         REGISTERF(nextKey<skse::string_ref>, "nextKey", STR(* previousKey="" endKey=""), tes_map_nextKey_comment);
 
-        static const char * getNthKey_comment() { return "Retrieves N-th key. " NEGATIVE_IDX_COMMENT "\nWorst complexity is O(n/2)"; }
+        static const char * getNthKey_comment() { return "Retrieves N-th key. " NEGATIVE_IDX_COMMENT "\nComplexity is O(log n)"; }
 
         template<class Key>
         static Key getNthKey(tes_context& ctx, map* obj, SInt32 keyIndex) {
@@ -280,12 +306,123 @@ Usage:
             // so that the function will not return unloaded (None) form keys at Papyrus level
             return map_functions_templ < form_map >::nextKey_forPapyrus(obj, previousKey, endKey, KeyCompareForNextKey{});
         }
+
+        // Papyrus has no unsigned ints: the FormIds of the FE/FF plugins come as negative numbers
+        static form_ref_lightweight rawKey(tes_context& ctx, SInt32 formId) {
+            return make_lightweight_form_ref(util::to_enum<FormId>(uint32_t(formId)), ctx);
+        }
+
+        // unloaded (None) form keys are skipped, as nextKey does
+        template<class FormRef>
+        static bool isLoaded(const FormRef& key) {
+            return skse::lookup_form(key.get()) != nullptr;
+        }
+
+        template<bool Strict>
+        static form_ref_lightweight bound(tes_context& ctx, form_map* obj, SInt32 formId) {
+            JC_LOG_API ("%p, %X", (void*) obj, formId);
+            form_ref_lightweight found;
+            formmap_functions::boundKey(obj, rawKey(ctx, formId), Strict, [&](const form_ref& key) {
+                if (isLoaded(key)) {
+                    found = key;
+                }
+                return !!found;
+            });
+            return found;
+        }
+        REGISTERF(bound<false>, "lowerBound", "* formId",
+            "Returns the form key with the smallest FormId greater than or equal to the @formId, None if there is no such key.\n"
+            "Complexity is O(log n)");
+        REGISTERF(bound<true>, "upperBound", "* formId", "Returns the form key with the smallest FormId greater than the @formId, None if there is no such key");
+
+        static object_base* keysInRange(tes_context& ctx, form_map* obj, SInt32 lowFormId, SInt32 highFormId) {
+            JC_LOG_API ("%p, %X, %X", (void*) obj, lowFormId, highFormId);
+            if (!obj) {
+                return nullptr;
+            }
+
+            return &array::objectWithInitializer([&](array &arr) {
+                formmap_functions::forEachInRange(obj, rawKey(ctx, lowFormId), rawKey(ctx, highFormId), [&](const form_map::value_type& pair) {
+                    if (isLoaded(pair.first)) {
+                        arr.u_container().emplace_back(pair.first);
+                    }
+                });
+            },
+                ctx);
+        }
+        REGISTERF2(keysInRange, "* lowFormId highFormId",
+            "Returns a new array of the form keys with FormIds in the [@lowFormId, @highFormId] range (inclusive), in FormId order.\n"
+            "FormIds are compared as unsigned numbers: the forms of the plugin with load order index 0x05 are in the [0x05000000, 0x05FFFFFF] range.\n"
+            "Complexity is O(log n + k) for k keys in the range");
+
+        static object_base* valuesInRange(tes_context& ctx, form_map* obj, SInt32 lowFormId, SInt32 highFormId) {
+            JC_LOG_API ("%p, %X, %X", (void*) obj, lowFormId, highFormId);
+            if (!obj) {
+                return nullptr;
+            }
+
+            return &array::objectWithInitializer([&](array &arr) {
+                formmap_functions::forEachInRange(obj, rawKey(ctx, lowFormId), rawKey(ctx, highFormId), [&](const form_map::value_type& pair) {
+                    if (isLoaded(pair.first)) {
+                        arr.u_container().push_back(pair.second);
+                    }
+                });
+            },
+                ctx);
+        }
+        REGISTERF2(valuesInRange, "* lowFormId highFormId", "Returns a new array of the values of the keys returned by keysInRange, in the same order");
     };
 
     struct tes_integer_map_ext : class_meta < tes_integer_map_ext > {
         REGISTER_TES_NAME("JIntMap");
         REGISTERF(tes_integer_map::nextKey, "nextKey", STR(* previousKey=0 endKey=0), tes_map_nextKey_comment);
         REGISTERF(tes_integer_map::getNthKey, "getNthKey", "* keyIndex", tes_map_ext::getNthKey_comment());
+
+        template<bool Strict>
+        static SInt32 bound(tes_context& ctx, integer_map* obj, SInt32 key, SInt32 notFoundKey = 0) {
+            JC_LOG_API ("%p, %d", (void*) obj, key);
+            integer_map_functions::boundKey(obj, key, Strict, [&](SInt32 found) {
+                notFoundKey = found;
+                return true;
+            });
+            return notFoundKey;
+        }
+        REGISTERF(bound<false>, "lowerBound", "* key notFoundKey=0",
+            "Returns the smallest key greater than or equal to the @key, @notFoundKey if there is no such key.\n"
+            "Complexity is O(log n)");
+        REGISTERF(bound<true>, "upperBound", "* key notFoundKey=0", "Returns the smallest key greater than the @key, @notFoundKey if there is no such key");
+
+        static object_base* keysInRange(tes_context& ctx, integer_map* obj, SInt32 lowKey, SInt32 highKey) {
+            JC_LOG_API ("%p, %d, %d", (void*) obj, lowKey, highKey);
+            if (!obj) {
+                return nullptr;
+            }
+
+            return &array::objectWithInitializer([&](array &arr) {
+                integer_map_functions::forEachInRange(obj, lowKey, highKey, [&](const integer_map::value_type& pair) {
+                    arr.u_container().emplace_back(pair.first);
+                });
+            },
+                ctx);
+        }
+        REGISTERF2(keysInRange, "* lowKey highKey",
+            "Returns a new array of the keys in the [@lowKey, @highKey] range (inclusive), in ascending order.\n"
+            "Complexity is O(log n + k) for k keys in the range");
+
+        static object_base* valuesInRange(tes_context& ctx, integer_map* obj, SInt32 lowKey, SInt32 highKey) {
+            JC_LOG_API ("%p, %d, %d", (void*) obj, lowKey, highKey);
+            if (!obj) {
+                return nullptr;
+            }
+
+            return &array::objectWithInitializer([&](array &arr) {
+                integer_map_functions::forEachInRange(obj, lowKey, highKey, [&](const integer_map::value_type& pair) {
+                    arr.u_container().push_back(pair.second);
+                });
+            },
+                ctx);
+        }
+        REGISTERF2(valuesInRange, "* lowKey highKey", "Returns a new array of the values of the keys in the [@lowKey, @highKey] range, in the key order");
     };
 
     TES_META_INFO(tes_map_ext);
@@ -321,4 +458,86 @@ Usage:
         EXPECT_EQ(countIterations(fmap), 2);
     }
 
+    JC_TEST(tes_integer_map, key_ranges)
+    {
+        integer_map* days = tes_object::object<integer_map>(context);
+        for (int32_t day = -100; day <= 100; day += 10) {
+            days->set(day, item(day * 2));
+        }
+
+        EXPECT_EQ(-100, tes_integer_map_ext::bound<false>(context, days, -1000));
+        EXPECT_EQ(20, tes_integer_map_ext::bound<false>(context, days, 20));
+        EXPECT_EQ(30, tes_integer_map_ext::bound<true>(context, days, 20));
+        EXPECT_EQ(30, tes_integer_map_ext::bound<true>(context, days, 21));
+        EXPECT_EQ(-1, tes_integer_map_ext::bound<true>(context, days, 100, -1));
+        EXPECT_EQ(0, tes_integer_map_ext::bound<false>(context, nullptr, 5));
+
+        auto keys = tes_integer_map_ext::keysInRange(context, days, -15, 25)->as<array>();
+        auto values = tes_integer_map_ext::valuesInRange(context, days, -15, 25)->as<array>();
+        EXPECT_EQ(4, keys->s_count());
+        EXPECT_EQ(4, values->s_count());
+        for (int32_t i = 0; i < 4; ++i) {
+            EXPECT_EQ(-10 + i * 10, keys->u_get(i)->readAs<SInt32>());
+            EXPECT_EQ(-20 + i * 20, values->u_get(i)->readAs<SInt32>());
+        }
+
+        EXPECT_EQ(2, tes_integer_map_ext::keysInRange(context, days, 90, 100)->s_count()); // the bounds are inclusive
+        EXPECT_EQ(1, tes_integer_map_ext::keysInRange(context, days, 0, 0)->s_count());
+        EXPECT_EQ(0, tes_integer_map_ext::keysInRange(context, days, 1, 9)->s_count());
+        EXPECT_EQ(0, tes_integer_map_ext::keysInRange(context, days, 50, -50)->s_count());
+        EXPECT_EQ(21, tes_integer_map_ext::valuesInRange(context, days, INT32_MIN, INT32_MAX)->s_count());
+        EXPECT_NIL(tes_integer_map_ext::keysInRange(context, nullptr, 0, 1));
+    }
+
+    JC_TEST(tes_form_map, key_ranges)
+    {
+        form_map* fmap = tes_object::object<form_map>(context);
+        for (uint32_t id : { 0x14u, 0x05000800u, 0x05000001u, 0x05FFFFFFu, 0x06000000u, 0xFF000010u }) {
+            fmap->u_container()[make_weak_form_id(util::to_enum<FormId>(id), context)] = item{ SInt32(id & 0xFFFF) };
+        }
+        fmap->u_container()[form_ref::make_expired(util::to_enum<FormId>(0x05000002))] = item{ "nill" };
+
+        auto keys = tes_form_map_ext::keysInRange(context, fmap, 0x05000000, 0x05FFFFFF)->as<array>();
+        auto values = tes_form_map_ext::valuesInRange(context, fmap, 0x05000000, 0x05FFFFFF)->as<array>();
+        EXPECT_EQ(3, keys->s_count()); // the expired key is skipped
+        EXPECT_EQ(3, values->s_count());
+        EXPECT_EQ(util::to_enum<FormId>(0x05000001), keys->u_get(0)->get<form_ref>()->get());
+        EXPECT_EQ(util::to_enum<FormId>(0x05FFFFFF), keys->u_get(2)->get<form_ref>()->get());
+        EXPECT_EQ(0x800, values->u_get(1)->readAs<SInt32>());
+
+        // the FormIds of the FF plugin are negative numbers in Papyrus
+        EXPECT_EQ(1, tes_form_map_ext::keysInRange(context, fmap, SInt32(0xFF000000), SInt32(0xFFFFFFFF))->s_count());
+        EXPECT_EQ(6, tes_form_map_ext::keysInRange(context, fmap, 0, SInt32(0xFFFFFFFF))->s_count());
+
+        EXPECT_EQ(util::to_enum<FormId>(0x05000001), tes_form_map_ext::bound<false>(context, fmap, 0x05000000).get());
+        EXPECT_EQ(util::to_enum<FormId>(0x05000800), tes_form_map_ext::bound<true>(context, fmap, 0x05000001).get());
+        EXPECT_EQ(util::to_enum<FormId>(0xFF000010), tes_form_map_ext::bound<true>(context, fmap, 0x06000000).get());
+        EXPECT_TRUE(tes_form_map_ext::bound<true>(context, fmap, SInt32(0xFF000010)).is_expired());
+    }
+
+    JC_TEST(tes_map, nth_key_and_value)
+    {
+        map* obj = tes_object::object<map>(context);
+        for (int32_t i = 0; i < 1000; ++i) {
+            char key[16];
+            sprintf_s(key, "key%04d", i);
+            obj->set(key, item(i));
+        }
+
+        EXPECT_EQ(std::string("key0000"), tes_map_ext::getNthKey<std::string>(context, obj, 0));
+        EXPECT_EQ(std::string("key0999"), tes_map_ext::getNthKey<std::string>(context, obj, -1));
+        EXPECT_EQ(500, tes_map::getNthValue<SInt32>(context, obj, 500));
+        EXPECT_EQ(998, tes_map::getNthValue<SInt32>(context, obj, -2));
+        EXPECT_EQ(-1, tes_map::getNthValue<SInt32>(context, obj, 1000, -1));
+        EXPECT_EQ(-1, tes_map::getNthValue<SInt32>(context, obj, -1001, -1));
+        EXPECT_TRUE(tes_map_ext::getNthKey<std::string>(context, obj, -5000).empty());
+
+        integer_map* imap = tes_object::object<integer_map>(context);
+        imap->set(30, item(3));
+        imap->set(10, item(1));
+        imap->set(20, item(2));
+        EXPECT_EQ(20, tes_integer_map::getNthKey(context, imap, 1));
+        EXPECT_EQ(3, tes_integer_map::getNthValue<SInt32>(context, imap, 2));
+    }
+
 }
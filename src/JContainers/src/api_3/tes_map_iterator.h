@@ -0,0 +1,178 @@
+namespace tes_api_3 {
+
+/// Redefine in each logging module
+#undef  JC_LOG_API_SOURCE
+#define JC_LOG_API_SOURCE "JMapIterator"
+
+    using namespace collections;
+
+    class tes_map_iterator : public class_meta< tes_map_iterator > {
+    public:
+
+        typedef map_cursor* ref;
+
+        REGISTER_TES_NAME("JMapIterator");
+
+        void additionalSetup() {
+            metaInfo.comment = "Iterator over the pairs of JMap, JFormMap or JIntMap, created by their 'iterator' function.\n"
+                "Each step is O(1) amortized. If a key gets added to or removed from the container during the iteration,\n"
+                "the iterator stops and becomes invalidated instead of skipping or repeating keys. Changing values is fine.\n"
+                "Usage:\n\n"
+                "    int it = JMap.iterator(map)\n"
+                "    while JMapIterator.next(it)\n"
+                "      string key = JMapIterator.keyStr(it)\n"
+                "      int value = JMapIterator.getInt(it)\n"
+                "    endwhile\n\n"
+                "Inherits JValue functionality";
+        }
+
+        static bool next(tes_context& ctx, ref obj) {
+            JC_LOG_API ("%p", (void*) obj);
+            return obj && obj->next();
+        }
+        REGISTERF2(next, "*", "Advances the iterator to the next pair. Returns false once there are no more pairs or the container has been modified");
+
+        static bool isInvalidated(tes_context& ctx, ref obj) {
+            JC_LOG_API ("%p", (void*) obj);
+            return obj && obj->get_state() == map_cursor::state::invalidated;
+        }
+        REGISTERF2(isInvalidated, "*", "Returns true if the iteration has been stopped because a key was added to or removed from the container");
+
+        static void restart(tes_context& ctx, ref obj, object_base* container) {
+            JC_LOG_API ("%p, %p", (void*) obj, (void*) container);
+            if (obj && container && map_cursor::is_iterable(*container)) {
+                obj->reset(*container);
+            }
+        }
+        REGISTERF2(restart, "* container", "Restarts the iteration over the @container (JMap, JFormMap or JIntMap)");
+
+    private:
+
+        // the key type may not match the requested one, the default value is kept then
+        static void read_key(const std::string& key, skse::string_ref& result) { result = key.c_str(); }
+        static void read_key(const std::string& key, std::string& result) { result = key; }
+        static void read_key(const int32_t& key, SInt32& result) { result = key; }
+        static void read_key(const form_ref& key, form_ref& result) { result = key; }
+        template<class K, class T>
+        static void read_key(const K&, T&) {}
+
+    public:
+
+        template<class T>
+        static T getKey(tes_context& ctx, ref obj, T def = default_value<T>()) {
+            JC_LOG_API ("%p, ...", (void*) obj);
+            if (obj) {
+                obj->visit_current([&](const auto& key, const item&) { read_key(key, def); });
+            }
+            return def;
+        }
+        REGISTERF(getKey<skse::string_ref>, "keyStr", "* default=\"\"", "Returns the key of the current pair. If the key isn't a string (not a JMap), returns @default value");
+        REGISTERF(getKey<SInt32>, "keyInt", "* default=0", "JIntMap keys");
+        REGISTERF(getKey<form_ref>, "keyForm", "* default=None", "JFormMap keys");
+
+        template<class T>
+        static T getValue(tes_context& ctx, ref obj, T def = default_value<T>()) {
+            JC_LOG_API ("%p, ...", (void*) obj);
+            if (obj) {
+                obj->visit_current([&](const auto&, const item& value) { def = value.readAs<T>(); });
+            }
+            return def;
+        }
+        REGISTERF(getValue<SInt32>, "getInt", "* default=0", "Returns the value of the current pair. If the iterator doesn't point to a pair, returns @default value");
+        REGISTERF(getValue<Float32>, "getFlt", "* default=0.0", "");
+        REGISTERF(getValue<skse::string_ref>, "getStr", "* default=\"\"", "");
+        REGISTERF(getValue<object_base*>, "getObj", "* default=0", "");
+        REGISTERF(getValue<form_ref>, "getForm", "* default=None", "");
+
+        static SInt32 valueType(tes_context& ctx, ref obj) {
+            JC_LOG_API ("%p", (void*) obj);
+            auto type = item_type::no_item;
+            if (obj) {
+                obj->visit_current([&](const auto&, const item& value) { type = value.type(); });
+            }
+            return (SInt32)type;
+        }
+        REGISTERF2(valueType, "*", "Returns type of the value of the current pair.\n" VALUE_TYPE_COMMENT);
+    };
+
+    TES_META_INFO(tes_map_iterator);
+
+    JC_TEST(tes_map_iterator, iteration)
+    {
+        map* obj = tes_object::object<map>(context);
+        obj->set("a", item(1));
+        obj->set("b", item(2));
+        obj->set("c", item(3));
+
+        map_cursor* it = tes_map::iterator(context, obj);
+        EXPECT_EQ(-1, tes_map_iterator::getValue<SInt32>(context, it, -1)); // not started yet
+
+        std::string keys;
+        SInt32 sum = 0;
+        while (tes_map_iterator::next(context, it)) {
+            keys += tes_map_iterator::getKey<std::string>(context, it);
+            sum += tes_map_iterator::getValue<SInt32>(context, it);
+            obj->set("b", item(20)); // changing the values doesn't stop the iteration
+        }
+        EXPECT_EQ("abc", keys);
+        EXPECT_EQ(1 + 20 + 3, sum);
+        EXPECT_FALSE(tes_map_iterator::isInvalidated(context, it));
+        EXPECT_FALSE(tes_map_iterator::next(context, it));
+    }
+
+    JC_TEST(tes_map_iterator, concurrent_modification)
+    {
+        integer_map* obj = tes_object::object<integer_map>(context);
+        for (int32_t i = 0; i < 10; ++i) {
+            obj->set(i, item(i));
+        }
+
+        map_cursor* it = tes_integer_map::iterator(context, obj);
+        EXPECT_TRUE(tes_map_iterator::next(context, it));
+        EXPECT_EQ(0, tes_map_iterator::getKey<SInt32>(context, it, -1));
+        EXPECT_EQ(std::string(), tes_map_iterator::getKey<std::string>(context, it)); // not a string key
+
+        obj->erase(5);
+        EXPECT_EQ(-1, tes_map_iterator::getKey<SInt32>(context, it, -1));
+        EXPECT_FALSE(tes_map_iterator::next(context, it));
+        EXPECT_TRUE(tes_map_iterator::isInvalidated(context, it));
+
+        tes_map_iterator::restart(context, it, obj);
+        int steps = 0;
+        while (tes_map_iterator::next(context, it)) {
+            ++steps;
+        }
+        EXPECT_EQ(9, steps);
+    }
+
+    JC_TEST(tes_map_iterator, save_and_load)
+    {
+        map* obj = tes_object::object<map>(context);
+        obj->set("a", item(1));
+        obj->set("b", item(2));
+        obj->set("c", item(3));
+        obj->tes_retain();
+
+        map_cursor* it = tes_map::iterator(context, obj);
+        it->tes_retain();
+        EXPECT_TRUE(tes_map_iterator::next(context, it));
+        EXPECT_TRUE(tes_map_iterator::next(context, it));
+        const Handle mapId = obj->uid(), cursorId = it->uid();
+
+        // the position is kept as the key
+        const std::string saved = context.write_to_string();
+        context.read_from_string(saved);
+        it = context.getObjectOfType<map_cursor>(cursorId);
+        ASSERT_TRUE(it != nullptr);
+        EXPECT_EQ("b", tes_map_iterator::getKey<std::string>(context, it));
+        EXPECT_TRUE(tes_map_iterator::next(context, it));
+        EXPECT_EQ("c", tes_map_iterator::getKey<std::string>(context, it));
+
+        // the key is looked up at the first use: if it's gone by then, the cursor is invalidated
+        context.read_from_string(saved);
+        it = context.getObjectOfType<map_cursor>(cursorId);
+        context.getObjectOfType<map>(mapId)->erase("b");
+        EXPECT_FALSE(tes_map_iterator::next(context, it));
+        EXPECT_TRUE(tes_map_iterator::isInvalidated(context, it));
+    }
+}
@@ -41,6 +41,18 @@ namespace tes_api_3 {
 "Most call entries made to JC will be logged. Heavy traffic, by default is disabled.\n"
 "Not thread safe for multiple users (though harmless).");
 
+        static void enable_lock_statistics (tes_context& ctx, bool next) {
+            util::adaptive_lock::enable_contention_tracking (next);
+        }
+        REGISTERF (enable_lock_statistics, "enableLockStatistics", "*",
+"Counts, per container, how often threads had to wait for each other to access it. By default is disabled.");
+
+        static void log_lock_statistics (tes_context& ctx, SInt32 count) {
+            ctx.print_lock_contention (count > 0 ? count : 0);
+        }
+        REGISTERF (log_lock_statistics, "logLockStatistics", "count=10",
+"Writes @count most contended containers (see enableLockStatistics) into the JContainers log file.");
+
         static object_base* retain (tes_context& ctx, ref obj, const char* tag = nullptr)
         {
             JC_LOG_API ("0x%p, \"%s\"", (void*) obj, tag ? tag : "<nullptr>");
@@ -212,6 +224,11 @@ JValue.cleanPool(\"uniquePoolName\")"
         REGISTERF(isCast<map>, "isMap", "*", nullptr);
         REGISTERF(isCast<form_map>, "isFormMap", "*", nullptr);
         REGISTERF(isCast<integer_map>, "isIntegerMap", "*", nullptr);
+        REGISTERF(isCast<counter_map>, "isCounterMap", "*", nullptr);
+        REGISTERF(isCast<map_cursor>, "isMapIterator", "*", nullptr);
+        REGISTERF(isCast<item_set>, "isSet", "*", nullptr);
+        REGISTERF(isCast<ring_buffer>, "isRingBuffer", "*", nullptr);
+        REGISTERF(isCast<priority_heap>, "isPriorityQueue", "*", nullptr);
 
         static bool empty (tes_context& ctx, ref obj)
         {
@@ -0,0 +1,249 @@
+namespace tes_api_3 {
+
+/// Redefine in each logging module
+#undef  JC_LOG_API_SOURCE
+#define JC_LOG_API_SOURCE "JPriorityQueue"
+
+    using namespace collections;
+
+    class tes_priority_queue : public class_meta< tes_priority_queue > {
+    public:
+
+        typedef priority_heap* ref;
+
+        REGISTER_TES_NAME("JPriorityQueue");
+
+        void additionalSetup() {
+            metaInfo.comment = "Queue of values (value is float, integer, string, form or another container) ordered by their priorities.\n"
+                "Pushing and popping take O(log n) time. Values of equal priority leave the queue in the order they were pushed.\n"
+                "Each pushed value gets a handle, valid until the value leaves the queue.\n"
+                "Inherits JValue functionality";
+        }
+
+        REGISTERF(tes_object::object<priority_heap>, "object", "", "Creates a new queue, the value with the lowest priority goes first");
+
+        static object_base* objectMaxFirst(tes_context& ctx) {
+            JC_LOG_API ("");
+            return &priority_heap::objectWithInitializer([](priority_heap& me) {
+                me.u_set_max_first(true);
+            },
+                ctx);
+        }
+        REGISTERF2(objectMaxFirst, "", "Creates a new queue, the value with the highest priority goes first");
+
+        template<class T>
+        static SInt32 push(tes_context& ctx, ref obj, T value, Float32 priority) {
+            JC_LOG_API ("%p, ..., %f", (void*) obj, priority);
+            if (!obj) {
+                return 0;
+            }
+            object_lock g(obj);
+            return (SInt32)obj->u_push(value, priority);
+        }
+        REGISTERF(push<SInt32>, "pushInt", "* value priority", "Adds the @value/@container with given @priority. Returns the handle of the value, 0 on failure");
+        REGISTERF(push<Float32>, "pushFlt", "* value priority", "");
+        REGISTERF(push<const char *>, "pushStr", "* value priority", "");
+        REGISTERF(push<object_base*>, "pushObj", "* container priority", "");
+        REGISTERF(push<form_ref>, "pushForm", "* value priority", "");
+
+        template<class T>
+        static T peek(tes_context& ctx, ref obj, T def = default_value<T>()) {
+            JC_LOG_API ("%p", (void*) obj);
+            if (!obj) {
+                return def;
+            }
+            object_shared_lock g(obj);
+            auto top = obj->u_top();
+            return top ? top->value.readAs<T>() : def;
+        }
+        REGISTERF(peek<SInt32>, "peekInt", "* default=0", "Returns the first value of the queue, leaving it in the queue. Returns @default if the queue is empty");
+        REGISTERF(peek<Float32>, "peekFlt", "* default=0.0", "");
+        REGISTERF(peek<skse::string_ref>, "peekStr", "* default=\"\"", "");
+        REGISTERF(peek<object_base*>, "peekObj", "* default=0", "");
+        REGISTERF(peek<form_ref>, "peekForm", "* default=None", "");
+
+        template<class T>
+        static T pop(tes_context& ctx, ref obj, T def = default_value<T>()) {
+            JC_LOG_API ("%p", (void*) obj);
+            if (!obj) {
+                return def;
+            }
+            object_lock g(obj);
+            auto top = obj->u_top();
+            if (!top) {
+                return def;
+            }
+            // keeps the popped container alive until it's returned
+            const item value = top->value;
+            obj->u_pop();
+            return value.readAs<T>();
+        }
+        REGISTERF(pop<SInt32>, "popInt", "* default=0", "Removes the first value of the queue and returns it. Returns @default if the queue is empty");
+        REGISTERF(pop<Float32>, "popFlt", "* default=0.0", "");
+        REGISTERF(pop<skse::string_ref>, "popStr", "* default=\"\"", "");
+        REGISTERF(pop<object_base*>, "popObj", "* default=0", "");
+        REGISTERF(pop<form_ref>, "popForm", "* default=None", "");
+
+        static Float32 peekPriority(tes_context& ctx, ref obj, Float32 def = 0.f) {
+            JC_LOG_API ("%p", (void*) obj);
+            if (!obj) {
+                return def;
+            }
+            object_shared_lock g(obj);
+            auto top = obj->u_top();
+            return top ? top->priority : def;
+        }
+        REGISTERF2(peekPriority, "* default=0.0", "Returns the priority of the first value");
+
+        static SInt32 peekHandle(tes_context& ctx, ref obj) {
+            JC_LOG_API ("%p", (void*) obj);
+            if (!obj) {
+                return 0;
+            }
+            object_shared_lock g(obj);
+            auto top = obj->u_top();
+            return top ? (SInt32)top->handle : 0;
+        }
+        REGISTERF2(peekHandle, "*", "Returns the handle of the first value, 0 if the queue is empty");
+
+        static SInt32 count(tes_context& ctx, ref obj) {
+            JC_LOG_API ("%p", (void*) obj);
+            return tes_object::count(ctx, obj);
+        }
+        REGISTERF2(count, "*", "Returns the number of the values in the queue");
+
+        static bool hasHandle(tes_context& ctx, ref obj, SInt32 handle) {
+            JC_LOG_API ("%p, %d", (void*) obj, handle);
+            if (!obj) {
+                return false;
+            }
+            object_shared_lock g(obj);
+            return obj->u_has_handle((uint32_t)handle);
+        }
+        REGISTERF2(hasHandle, "* handle", "Returns true if the value of the @handle is still in the queue");
+
+        static Float32 priorityOf(tes_context& ctx, ref obj, SInt32 handle, Float32 def = 0.f) {
+            JC_LOG_API ("%p, %d", (void*) obj, handle);
+            if (!obj) {
+                return def;
+            }
+            object_shared_lock g(obj);
+            return obj->u_priority((uint32_t)handle).value_or(def);
+        }
+        REGISTERF2(priorityOf, "* handle default=0.0", "Returns the priority of the value of the @handle");
+
+        // @towardsTopOnly: fails if the new priority would move the value away from the top
+        static bool updatePriority(ref obj, SInt32 handle, Float32 priority, bool towardsTopOnly) {
+            if (!obj) {
+                return false;
+            }
+            object_lock g(obj);
+            auto current = obj->u_priority((uint32_t)handle);
+            if (!current) {
+                return false;
+            }
+            if (towardsTopOnly && (obj->u_max_first() ? priority < *current : priority > *current)) {
+                return false;
+            }
+            return obj->u_change_priority((uint32_t)handle, priority);
+        }
+
+        static bool decreaseKey(tes_context& ctx, ref obj, SInt32 handle, Float32 priority) {
+            JC_LOG_API ("%p, %d, %f", (void*) obj, handle, priority);
+            return updatePriority(obj, handle, priority, true);
+        }
+        REGISTERF2(decreaseKey, "* handle priority",
+            "Moves the value of the @handle closer to the top: lowers its priority (raises, if the queue is created with objectMaxFirst).\n"
+            "Fails if the value isn't in the queue or the @priority would move it the other way");
+
+        static bool setPriority(tes_context& ctx, ref obj, SInt32 handle, Float32 priority) {
+            JC_LOG_API ("%p, %d, %f", (void*) obj, handle, priority);
+            return updatePriority(obj, handle, priority, false);
+        }
+        REGISTERF2(setPriority, "* handle priority", "Changes the priority of the value of the @handle. Returns false if the value isn't in the queue");
+
+        static bool removeHandle(tes_context& ctx, ref obj, SInt32 handle) {
+            JC_LOG_API ("%p, %d", (void*) obj, handle);
+            if (!obj) {
+                return false;
+            }
+            object_lock g(obj);
+            return obj->u_erase_handle((uint32_t)handle);
+        }
+        REGISTERF2(removeHandle, "* handle", "Removes the value of the @handle from the queue");
+    };
+
+    TES_META_INFO(tes_priority_queue);
+
+    JC_TEST(tes_priority_queue, order_and_handles)
+    {
+        priority_heap* queue = tes_object::object<priority_heap>(context);
+
+        std::mt19937 random(3);
+        std::vector<std::pair<Float32, SInt32>> expected;
+        for (SInt32 i = 0; i < 1000; ++i) {
+            const Float32 priority = Float32(random() % 100);
+            EXPECT_NE(0, tes_priority_queue::push(context, queue, i, priority));
+            expected.emplace_back(priority, i);
+        }
+        std::stable_sort(expected.begin(), expected.end(), [](auto& l, auto& r) { return l.first < r.first; });
+
+        EXPECT_EQ(1000, tes_priority_queue::count(context, queue));
+        EXPECT_EQ(expected.front().second, tes_priority_queue::peek<SInt32>(context, queue));
+        for (auto& pair : expected) {
+            EXPECT_EQ(pair.first, tes_priority_queue::peekPriority(context, queue));
+            EXPECT_EQ(pair.second, tes_priority_queue::pop<SInt32>(context, queue));
+        }
+        EXPECT_EQ(-1, tes_priority_queue::pop<SInt32>(context, queue, -1));
+
+        // max-first queue and the handles
+        priority_heap* tasks = tes_priority_queue::objectMaxFirst(context)->as<priority_heap>();
+        SInt32 low = tes_priority_queue::push<const char*>(context, tasks, "low", 1.f);
+        SInt32 mid = tes_priority_queue::push<const char*>(context, tasks, "mid", 5.f);
+        SInt32 high = tes_priority_queue::push<const char*>(context, tasks, "high", 10.f);
+        EXPECT_EQ(high, tes_priority_queue::peekHandle(context, tasks));
+
+        EXPECT_FALSE(tes_priority_queue::decreaseKey(context, tasks, low, 0.f)); // the wrong way
+        EXPECT_TRUE(tes_priority_queue::decreaseKey(context, tasks, low, 20.f));
+        EXPECT_EQ(low, tes_priority_queue::peekHandle(context, tasks));
+        EXPECT_TRUE(tes_priority_queue::setPriority(context, tasks, low, 0.f));
+        EXPECT_EQ(0.f, tes_priority_queue::priorityOf(context, tasks, low));
+
+        EXPECT_TRUE(tes_priority_queue::removeHandle(context, tasks, high));
+        EXPECT_FALSE(tes_priority_queue::hasHandle(context, tasks, high));
+        EXPECT_FALSE(tes_priority_queue::decreaseKey(context, tasks, high, 100.f));
+        EXPECT_EQ("mid", tes_priority_queue::pop<std::string>(context, tasks));
+        EXPECT_EQ("low", tes_priority_queue::pop<std::string>(context, tasks));
+        EXPECT_EQ(0, tes_priority_queue::count(context, tasks));
+        (void)mid;
+    }
+
+    JC_TEST(tes_priority_queue, json_and_copying)
+    {
+        priority_heap* queue = tes_priority_queue::objectMaxFirst(context)->as<priority_heap>();
+        map* shared = tes_object::object<map>(context);
+        for (SInt32 i = 0; i < 20; ++i) {
+            tes_priority_queue::push(context, queue, i, Float32(i % 7));
+        }
+        tes_priority_queue::push<object_base*>(context, queue, shared, 3.5f);
+        tes_priority_queue::push<object_base*>(context, queue, shared, 100.f); // one of them becomes a reference
+
+        auto check = [&](priority_heap* copy) {
+            EXPECT_NOT_NIL(copy);
+            EXPECT_EQ(22, tes_priority_queue::count(context, copy));
+            EXPECT_EQ(100.f, tes_priority_queue::peekPriority(context, copy));
+            object_base* first = tes_priority_queue::pop<object_base*>(context, copy);
+            EXPECT_NOT_NIL(first);
+            EXPECT_EQ(6, tes_priority_queue::pop<SInt32>(context, copy));
+            EXPECT_EQ(13, tes_priority_queue::pop<SInt32>(context, copy));
+            EXPECT_EQ(5, tes_priority_queue::pop<SInt32>(context, copy));
+            for (SInt32 expected : { 12, 19, 4, 11, 18 }) {
+                EXPECT_EQ(expected, tes_priority_queue::pop<SInt32>(context, copy));
+            }
+            EXPECT_EQ(first, tes_priority_queue::pop<object_base*>(context, copy));
+        };
+
+        check(json_deserializer::object_from_json_data(context, json_serializer::create_json_data(*queue).get())->as<priority_heap>());
+        check(copying::deep_copy(context, *queue).as<priority_heap>());
+    }
+}
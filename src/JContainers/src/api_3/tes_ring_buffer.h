@@ -0,0 +1,191 @@
+namespace tes_api_3 {
+
+/// Redefine in each logging module
+#undef  JC_LOG_API_SOURCE
+#define JC_LOG_API_SOURCE "JRingBuffer"
+
+    using namespace collections;
+
+    class tes_ring_buffer : public class_meta< tes_ring_buffer > {
+    public:
+
+        typedef ring_buffer* ref;
+
+        REGISTER_TES_NAME("JRingBuffer");
+
+        void additionalSetup() {
+            metaInfo.comment = "Fixed-capacity history of values (value is float, integer, string, form or another container).\n"
+                "Pushing a value to the full buffer overwrites the oldest one. The values are indexed from the newest one:\n"
+                "index 0 is the newest value, 1 the value pushed before it, -1 the oldest one.\n"
+                "Inherits JValue functionality";
+        }
+
+        static object_base* objectWithCapacity(tes_context& ctx, SInt32 capacity) {
+            JC_LOG_API ("%d", capacity);
+
+            if (capacity <= 0 || capacity > ring_buffer::max_capacity) {
+                return nullptr;
+            }
+
+            return &ring_buffer::objectWithInitializer([&](ring_buffer& me) {
+                me.u_reset(capacity);
+            },
+                ctx);
+        }
+        REGISTERF2(objectWithCapacity, "capacity", "Creates a new buffer able to keep @capacity values. The capacity can't be changed later");
+
+        static SInt32 capacity(tes_context& ctx, ref obj) {
+            JC_LOG_API ("%p", (void*) obj);
+            if (!obj) {
+                return 0;
+            }
+            object_shared_lock g(obj);
+            return obj->u_capacity();
+        }
+        REGISTERF2(capacity, "*", "Returns the max number of the values the buffer keeps");
+
+        template<class T>
+        static void push(tes_context& ctx, ref obj, T value) {
+            JC_LOG_API ("%p, ...", (void*) obj);
+            if (obj) {
+                object_lock g(obj);
+                obj->u_push(item(value));
+            }
+        }
+        REGISTERF(push<SInt32>, "pushInt", "* value", "Adds the newest @value/@container. Overwrites the oldest one if the buffer is full");
+        REGISTERF(push<Float32>, "pushFlt", "* value", "");
+        REGISTERF(push<const char *>, "pushStr", "* value", "");
+        REGISTERF(push<object_base*>, "pushObj", "* container", "");
+        REGISTERF(push<form_ref>, "pushForm", "* value", "");
+
+        template<class T>
+        static T getItem(tes_context& ctx, ref obj, SInt32 index, T def = default_value<T>()) {
+            JC_LOG_API ("%p, %d", (void*) obj, index);
+            if (!obj) {
+                return def;
+            }
+            object_shared_lock g(obj);
+            auto itm = obj->u_get(index);
+            return itm ? itm->readAs<T>() : def;
+        }
+        REGISTERF(getItem<SInt32>, "getInt", "* index default=0", "Returns the value at the @index, counting from the newest value (0).\n"
+            "Negative index counts from the oldest value (-1)");
+        REGISTERF(getItem<Float32>, "getFlt", "* index default=0.0", "");
+        REGISTERF(getItem<skse::string_ref>, "getStr", "* index default=\"\"", "");
+        REGISTERF(getItem<object_base*>, "getObj", "* index default=0", "");
+        REGISTERF(getItem<form_ref>, "getForm", "* index default=None", "");
+
+        static object_base* asArray(tes_context& ctx, ref obj) {
+            JC_LOG_API ("%p", (void*) obj);
+            if (!obj) {
+                return nullptr;
+            }
+
+            auto values = obj->container_copy();
+            return &array::objectWithInitializer([&](array& me) {
+                me.u_container().insert(me.end(), std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+            },
+                ctx);
+        }
+        REGISTERF2(asArray, "*", "Returns a new array of the values, from the newest one to the oldest one");
+
+        template<class Vector>
+        static Vector all_items(tes_context& ctx, ref obj) {
+            JC_LOG_API ("%p", (void*) obj);
+
+            Vector v;
+            typedef typename Vector::value_type T;
+            if (!obj) {
+                return v;
+            }
+
+            object_shared_lock g(obj);
+            v.reserve(obj->u_count());
+            for (int32_t i = 0; i < obj->u_count(); ++i) {
+                v.emplace_back(obj->u_get(i)->readAs<T>());
+            }
+            return v;
+        }
+        REGISTERF(all_items<VMResultArray<SInt32>>, "asIntArray", "*",
+            "Copies the values, from the newest one to the oldest one, to a new Papyrus array.\n"
+            "Values not matching the requested type will have default values");
+        REGISTERF(all_items<VMResultArray<Float32>>, "asFloatArray", "*", "");
+        REGISTERF(all_items<VMResultArray<skse::string_ref>>, "asStringArray", "*", "");
+        REGISTERF(all_items<VMResultArray<TESForm*>>, "asFormArray", "*", "");
+    };
+
+    TES_META_INFO(tes_ring_buffer);
+
+    JC_TEST(tes_ring_buffer, overwrites_the_oldest)
+    {
+        EXPECT_NIL(tes_ring_buffer::objectWithCapacity(context, 0));
+
+        ring_buffer* buffer = tes_ring_buffer::objectWithCapacity(context, 3)->as<ring_buffer>();
+        EXPECT_NOT_NIL(buffer);
+        EXPECT_EQ(3, tes_ring_buffer::capacity(context, buffer));
+
+        tes_ring_buffer::push(context, buffer, 1);
+        tes_ring_buffer::push(context, buffer, 2);
+        EXPECT_EQ(2, buffer->s_count());
+        EXPECT_EQ(2, tes_ring_buffer::getItem<SInt32>(context, buffer, 0));
+        EXPECT_EQ(1, tes_ring_buffer::getItem<SInt32>(context, buffer, -1));
+        EXPECT_EQ(-5, tes_ring_buffer::getItem<SInt32>(context, buffer, 2, -5));
+
+        for (int i = 3; i <= 10; ++i) {
+            tes_ring_buffer::push(context, buffer, i);
+        }
+        EXPECT_EQ(3, buffer->s_count());
+        EXPECT_EQ(10, tes_ring_buffer::getItem<SInt32>(context, buffer, 0));
+        EXPECT_EQ(9, tes_ring_buffer::getItem<SInt32>(context, buffer, 1));
+        EXPECT_EQ(8, tes_ring_buffer::getItem<SInt32>(context, buffer, -1));
+
+        auto values = tes_ring_buffer::all_items<VMResultArray<SInt32>>(context, buffer);
+        EXPECT_TRUE((std::vector<SInt32>(values.begin(), values.end()) == std::vector<SInt32>{ 10, 9, 8 }));
+        EXPECT_EQ(8, tes_ring_buffer::asArray(context, buffer)->as<array>()->u_get(-1)->readAs<SInt32>());
+
+        // paths and operators
+        EXPECT_EQ(9, tes_object::resolveGetter<SInt32>(context, buffer, "[1]"));
+        EXPECT_EQ(10, tes_object::resolveGetter<SInt32>(context, buffer, "@maxInt"));
+        EXPECT_TRUE(tes_object::solveSetter<SInt32>(context, buffer, "[1]", 0));
+        EXPECT_EQ(0, tes_ring_buffer::getItem<SInt32>(context, buffer, 1));
+
+        buffer->s_clear();
+        EXPECT_EQ(0, buffer->s_count());
+        EXPECT_EQ(3, tes_ring_buffer::capacity(context, buffer));
+        tes_ring_buffer::push<const char*>(context, buffer, "a");
+        EXPECT_EQ("a", tes_ring_buffer::getItem<std::string>(context, buffer, 0));
+    }
+
+    JC_TEST(tes_ring_buffer, json_and_copying)
+    {
+        ring_buffer* buffer = tes_ring_buffer::objectWithCapacity(context, 4)->as<ring_buffer>();
+        map* shared = tes_object::object<map>(context);
+        for (int i = 0; i < 6; ++i) {
+            tes_ring_buffer::push(context, buffer, i);
+        }
+        tes_ring_buffer::push<object_base*>(context, buffer, shared);
+        tes_ring_buffer::push<object_base*>(context, buffer, shared); // the second one becomes a reference
+
+        auto check = [&](ring_buffer* copy) {
+            EXPECT_NOT_NIL(copy);
+            EXPECT_EQ(4, tes_ring_buffer::capacity(context, copy));
+            EXPECT_EQ(4, copy->s_count());
+            EXPECT_EQ(5, tes_ring_buffer::getItem<SInt32>(context, copy, 2));
+            EXPECT_EQ(4, tes_ring_buffer::getItem<SInt32>(context, copy, 3));
+            EXPECT_NOT_NIL(tes_ring_buffer::getItem<object_base*>(context, copy, 0));
+            EXPECT_EQ(tes_ring_buffer::getItem<object_base*>(context, copy, 0), tes_ring_buffer::getItem<object_base*>(context, copy, 1));
+        };
+
+        check(json_deserializer::object_from_json_data(context, json_serializer::create_json_data(*buffer).get())->as<ring_buffer>());
+        check(copying::deep_copy(context, *buffer).as<ring_buffer>());
+        EXPECT_NE(shared, tes_ring_buffer::getItem<object_base*>(context, copying::deep_copy(context, *buffer).as<ring_buffer>(), 0));
+        // more items listed than the capacity: the references point to the listed items, the dropped ones included
+        auto trimmed = json_deserializer::object_from_json_data(context,
+            R"({"__metaInfo": {"typeName": "JRingBuffer"}, "capacity": 2, "items": ["__reference|[2]", 1, {"a": 5}]})")->as<ring_buffer>();
+        EXPECT_NOT_NIL(trimmed);
+        EXPECT_EQ(2, tes_ring_buffer::capacity(context, trimmed));
+        EXPECT_EQ(2, trimmed->s_count());
+        EXPECT_EQ(5, tes_object::resolveGetter<SInt32>(context, trimmed, "[0].a"));
+        EXPECT_EQ(1, tes_ring_buffer::getItem<SInt32>(context, trimmed, 1));
+    }
+}
@@ -0,0 +1,288 @@
+namespace tes_api_3 {
+
+/// Redefine in each logging module
+#undef  JC_LOG_API_SOURCE
+#define JC_LOG_API_SOURCE "JSet"
+
+    using namespace collections;
+
+    class tes_set : public class_meta< tes_set > {
+    public:
+
+        typedef item_set* ref;
+
+        REGISTER_TES_NAME("JSet");
+
+        void additionalSetup() {
+            metaInfo.comment = "Unordered collection of unique values (value is float, integer, string, form or another container).\n"
+                "Strings are compared case-insensitively. Adding, removing and lookups take constant time.\n"
+                "Inherits JValue functionality";
+        }
+
+        REGISTERF(tes_object::object<item_set>, "object", "", kCommentObject);
+
+        static object_base* objectWithArray(tes_context& ctx, array* source) {
+            JC_LOG_API ("%p", (void*) source);
+
+            if (!source) {
+                return nullptr;
+            }
+
+            auto values = source->container_copy();
+            return &item_set::objectWithInitializer([&](item_set& me) {
+                me.u_container().reserve(values.size());
+                for (auto& itm : values) {
+                    me.u_add(std::move(itm));
+                }
+            },
+                ctx);
+        }
+        REGISTERF2(objectWithArray, "array", "Creates a new set of the unique values of the @array");
+
+        template<class T>
+        static bool add(tes_context& ctx, ref obj, T value) {
+            JC_LOG_API ("%p, ...", (void*) obj);
+            if (!obj) {
+                return false;
+            }
+            object_lock g(obj);
+            return obj->u_add(item(value));
+        }
+        REGISTERF(add<SInt32>, "addInt", "* value", "Adds the @value/@container. Returns false if the set already contains it");
+        REGISTERF(add<Float32>, "addFlt", "* value", "");
+        REGISTERF(add<const char *>, "addStr", "* value", "");
+        REGISTERF(add<object_base*>, "addObj", "* container", "");
+        REGISTERF(add<form_ref>, "addForm", "* value", "");
+
+        template<class T>
+        static bool remove(tes_context& ctx, ref obj, T value) {
+            JC_LOG_API ("%p, ...", (void*) obj);
+            if (!obj) {
+                return false;
+            }
+            object_lock g(obj);
+            return obj->u_remove(item(value));
+        }
+        REGISTERF(remove<SInt32>, "removeInt", "* value", "Removes the @value/@container. Returns false if the set doesn't contain it");
+        REGISTERF(remove<Float32>, "removeFlt", "* value", "");
+        REGISTERF(remove<const char *>, "removeStr", "* value", "");
+        REGISTERF(remove<object_base*>, "removeObj", "* container", "");
+        REGISTERF(remove<form_ref>, "removeForm", "* value", "");
+
+        template<class T>
+        static bool contains(tes_context& ctx, ref obj, T value) {
+            JC_LOG_API ("%p, ...", (void*) obj);
+            if (!obj) {
+                return false;
+            }
+            object_shared_lock g(obj);
+            return obj->u_contains(item(value));
+        }
+        REGISTERF(contains<SInt32>, "containsInt", "* value", "Returns true if the set contains the @value/@container");
+        REGISTERF(contains<Float32>, "containsFlt", "* value", "");
+        REGISTERF(contains<const char *>, "containsStr", "* value", "");
+        REGISTERF(contains<object_base*>, "containsObj", "* container", "");
+        REGISTERF(contains<form_ref>, "containsForm", "* value", "");
+
+        // new set of the values of the @left (taken if @keep returns true for them) and the values of the @right (if @takeRight).
+        // The sets are never locked together, so the @left and the @right may be the same set
+        template<class Keep>
+        static item_set* combine(tes_context& ctx, ref left, ref right, Keep&& keep, bool takeRight) {
+            if (!left || !right) {
+                return nullptr;
+            }
+
+            auto values = left->container_copy();
+            {
+                object_shared_lock g(right);
+                values.erase(std::remove_if(values.begin(), values.end(), [&](const item& itm) {
+                    return !keep(right->u_contains(itm));
+                }), values.end());
+
+                if (takeRight) {
+                    values.insert(values.end(), right->u_container().begin(), right->u_container().end());
+                }
+            }
+
+            return &item_set::objectWithInitializer([&](item_set& me) {
+                me.u_container().assign(std::move(values));
+            },
+                ctx);
+        }
+
+        static object_base* setUnion(tes_context& ctx, ref left, ref right) {
+            JC_LOG_API ("%p, %p", (void*) left, (void*) right);
+            return combine(ctx, left, right, [](bool) { return true; }, true);
+        }
+        REGISTERF(setUnion, "union", "left right", "Returns a new set of the values contained in either set");
+
+        static object_base* intersection(tes_context& ctx, ref left, ref right) {
+            JC_LOG_API ("%p, %p", (void*) left, (void*) right);
+            return combine(ctx, left, right, [](bool inRight) { return inRight; }, false);
+        }
+        REGISTERF2(intersection, "left right", "Returns a new set of the values contained in both sets");
+
+        static object_base* difference(tes_context& ctx, ref left, ref right) {
+            JC_LOG_API ("%p, %p", (void*) left, (void*) right);
+            return combine(ctx, left, right, [](bool inRight) { return !inRight; }, false);
+        }
+        REGISTERF2(difference, "left right", "Returns a new set of the values of the @left set not contained in the @right one");
+
+        static object_base* asArray(tes_context& ctx, ref obj) {
+            JC_LOG_API ("%p", (void*) obj);
+            if (!obj) {
+                return nullptr;
+            }
+
+            auto values = obj->container_copy();
+            return &array::objectWithInitializer([&](array& me) {
+                me.u_container().insert(me.end(), std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+            },
+                ctx);
+        }
+        REGISTERF2(asArray, "*", "Returns a new array of the values of the set, in no particular order");
+    };
+
+    TES_META_INFO(tes_set);
+
+    JC_TEST(tes_set, membership)
+    {
+        item_set* set = tes_object::object<item_set>(context);
+        array* arr = tes_object::object<array>(context);
+
+        EXPECT_TRUE(tes_set::add(context, set, 1));
+        EXPECT_FALSE(tes_set::add(context, set, 1));
+        EXPECT_TRUE(tes_set::add(context, set, 1.f)); // numbers of different types aren't equal
+        EXPECT_TRUE(tes_set::add(context, set, 0.f));
+        EXPECT_FALSE(tes_set::add(context, set, -0.f));
+        EXPECT_TRUE(tes_set::add(context, set, "Apple"));
+        EXPECT_FALSE(tes_set::add<const char*>(context, set, "APPLE"));
+        EXPECT_TRUE(tes_set::add<object_base*>(context, set, arr));
+        EXPECT_FALSE(tes_set::add<object_base*>(context, set, arr));
+        EXPECT_EQ(5, set->s_count());
+
+        EXPECT_TRUE(tes_set::contains<const char*>(context, set, "apple"));
+        EXPECT_TRUE(tes_set::contains<object_base*>(context, set, arr));
+        EXPECT_FALSE(tes_set::contains(context, set, 2));
+
+        EXPECT_TRUE(tes_set::remove<const char*>(context, set, "apple"));
+        EXPECT_FALSE(tes_set::remove<const char*>(context, set, "apple"));
+        EXPECT_FALSE(tes_set::contains<const char*>(context, set, "Apple"));
+        EXPECT_EQ(4, set->s_count());
+
+        // a lot of values and removals
+        for (int i = 0; i < 10000; ++i) {
+            tes_set::add(context, set, i);
+        }
+        for (int i = 0; i < 10000; i += 2) {
+            EXPECT_TRUE(tes_set::remove(context, set, i));
+        }
+        for (int i = 0; i < 10000; ++i) {
+            EXPECT_EQ(i % 2 == 1, tes_set::contains(context, set, i));
+        }
+        EXPECT_TRUE(tes_set::contains<object_base*>(context, set, arr));
+    }
+
+    JC_TEST(tes_set, algebra)
+    {
+        item_set* left = tes_object::object<item_set>(context);
+        item_set* right = tes_object::object<item_set>(context);
+        for (int i = 0; i < 6; ++i) {
+            tes_set::add(context, left, i);
+            tes_set::add(context, right, i + 3);
+        }
+
+        auto united = tes_set::setUnion(context, left, right)->as<item_set>();
+        auto common = tes_set::intersection(context, left, right)->as<item_set>();
+        auto diff = tes_set::difference(context, left, right)->as<item_set>();
+
+        EXPECT_EQ(9, united->s_count());
+        EXPECT_EQ(3, common->s_count());
+        EXPECT_EQ(3, diff->s_count());
+        for (int i = 0; i < 9; ++i) {
+            EXPECT_TRUE(tes_set::contains(context, united, i));
+            EXPECT_EQ(i >= 3 && i < 6, tes_set::contains(context, common, i));
+            EXPECT_EQ(i < 3, tes_set::contains(context, diff, i));
+        }
+
+        EXPECT_EQ(6, tes_set::setUnion(context, left, left)->s_count());
+        EXPECT_EQ(0, tes_set::difference(context, left, left)->s_count());
+        EXPECT_NIL(tes_set::intersection(context, left, nullptr));
+
+        // operators and paths
+        EXPECT_EQ(8, tes_object::resolveGetter<SInt32>(context, united, "@maxInt"));
+        EXPECT_EQ(9, tes_set::asArray(context, united)->s_count());
+        EXPECT_FALSE(tes_object::solveSetter<SInt32>(context, united, "[0]", 100));
+    }
+
+    JC_TEST(tes_set, expired_forms)
+    {
+        const auto fid = util::to_enum<FormId>(0xff000014);
+        forms::form_observer watcher;
+        item_set* set = tes_object::object<item_set>(context);
+
+        EXPECT_TRUE(set->u_add(item(form_ref{ fid, watcher })));
+        EXPECT_TRUE(set->u_add(item(form_ref::make_expired(util::to_enum<FormId>(0xff000015)))));
+        // the expired forms are equal, whatever their ids were
+        EXPECT_TRUE(set->u_contains(item(form_ref::make_expired(util::to_enum<FormId>(0xff000016)))));
+        EXPECT_FALSE(set->u_contains(item(form_ref::make_expired(fid)))); // the form in the set is alive
+
+        // the form expires in the set: the table gets rebuilt at the load, the expired forms merge
+        watcher.on_form_deleted(forms::form_id_to_handle(fid));
+        set->u_onLoaded();
+        EXPECT_EQ(1, set->u_count());
+        EXPECT_TRUE(set->u_contains(item(form_ref::make_expired(fid))));
+    }
+
+    JC_TEST(tes_set, json_and_copying)
+    {
+        item_set* set = tes_object::object<item_set>(context);
+        map* shared = tes_object::object<map>(context);
+        array* root = tes_object::object<array>(context);
+
+        tes_set::add(context, set, 1);
+        tes_set::add(context, set, "str");
+        tes_set::add<object_base*>(context, set, shared);
+        tes_set::add<object_base*>(context, set, set); // written as a reference to the set itself
+
+        auto roundtrip = [&](object_base& root) {
+            return json_deserializer::object_from_json_data(context, json_serializer::create_json_data(root).get());
+        };
+
+        // the shared map is met first in the root array, the set refers to it
+        root->u_push(item(shared));
+        root->u_push(item(set));
+        auto copy = roundtrip(*root)->as<array>();
+        EXPECT_NOT_NIL(copy);
+
+        auto setCopy = copy->u_get(1)->object()->as<item_set>();
+        EXPECT_NOT_NIL(setCopy);
+        EXPECT_EQ(4, setCopy->s_count());
+        EXPECT_TRUE(tes_set::contains(context, setCopy, 1));
+        EXPECT_TRUE(tes_set::contains<const char*>(context, setCopy, "STR"));
+        EXPECT_TRUE(tes_set::contains<object_base*>(context, setCopy, setCopy));
+        EXPECT_TRUE(tes_set::contains<object_base*>(context, setCopy, copy->u_get(0)->object()));
+
+        // the shared map is met first in the set, the other map refers to it by its index in the set
+        map* holder = tes_object::object<map>(context);
+        holder->u_set("shared", item(shared));
+        array* root2 = tes_object::object<array>(context);
+        root2->u_push(item(set));
+        root2->u_push(item(holder));
+        auto copy2 = roundtrip(*root2)->as<array>();
+        EXPECT_NOT_NIL(copy2);
+
+        auto setCopy2 = copy2->u_get(0)->object()->as<item_set>();
+        auto sharedCopy2 = tes_object::resolveGetter<object_base*>(context, copy2, "[1].shared");
+        EXPECT_NOT_NIL(sharedCopy2);
+        EXPECT_EQ(4, setCopy2->s_count());
+        EXPECT_TRUE(tes_set::contains<object_base*>(context, setCopy2, sharedCopy2));
+        EXPECT_TRUE(tes_set::contains<object_base*>(context, setCopy2, setCopy2));
+
+        auto deep = copying::deep_copy(context, *set).as<item_set>();
+        EXPECT_NOT_NIL(deep);
+        EXPECT_EQ(4, deep->s_count());
+        EXPECT_TRUE(tes_set::contains<object_base*>(context, deep, deep));
+        EXPECT_FALSE(tes_set::contains<object_base*>(context, deep, shared));
+    }
+}
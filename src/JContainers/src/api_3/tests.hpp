@@ -84,6 +84,254 @@ namespace tes_api_3 {
         EXPECT_TRUE(tes_array::itemAtIndex<SInt32>(context, obj, 0) == 8 && tes_array::itemAtIndex<SInt32>(context, obj, -1) == 0);
     }
 
+    JC_TEST(array, concurrent_reads)
+    {
+        array::ref arr = array::object(context);
+        arr->push(item(5));
+        arr->push(item(2.5f));
+        arr->push(item("text"));
+
+        EXPECT_EQ(5, tes_array::itemAtIndex<SInt32>(context, arr.get(), 0));
+        EXPECT_EQ(2.5f, tes_array::itemAtIndex<Float32>(context, arr.get(), -2));
+        EXPECT_EQ(2, tes_array::itemAtIndex<SInt32>(context, arr.get(), 1));
+        EXPECT_EQ(-1, tes_array::itemAtIndex<SInt32>(context, arr.get(), 3, -1));
+        EXPECT_EQ(-1, tes_array::itemAtIndex<SInt32>(context, arr.get(), -4, -1));
+
+        // the writer grows the array (reallocates the storage) and increments the first item,
+        // the readers must never observe a torn or decreasing value
+        std::atomic<bool> done = false;
+        std::atomic<int> failures = 0;
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 4; ++i) {
+            readers.emplace_back([&]() {
+                SInt32 previous = 5;
+                while (!done.load()) {
+                    SInt32 value = tes_array::itemAtIndex<SInt32>(context, arr.get(), 0);
+                    if (value < previous || value > 5 + 20000) {
+                        ++failures;
+                    }
+                    previous = value;
+                }
+            });
+        }
+        for (SInt32 j = 1; j <= 20000; ++j) {
+            object_lock g(arr);
+            arr->u_set(0, item(5 + j));
+            arr->u_push(item(j));
+        }
+        done = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+
+        EXPECT_EQ(0, failures.load());
+        EXPECT_EQ(5 + 20000, tes_array::itemAtIndex<SInt32>(context, arr.get(), 0));
+    }
+
+    JC_TEST(array, optimistic_reads)
+    {
+        array::ref arr = array::object(context);
+        for (SInt32 i = 0; i < 64; ++i) {
+            arr->push(item(i));
+        }
+        EXPECT_FALSE(arr->optimistic_read_number<SInt32>(0));
+
+        // the single item reads get the numbers packed once they have visited as many items as there are
+        for (SInt32 i = 0; i <= 64; ++i) {
+            EXPECT_EQ(i % 64, tes_array::itemAtIndex<SInt32>(context, arr.get(), i % 64));
+        }
+        EXPECT_EQ(5, *arr->optimistic_read_number<SInt32>(5));
+        EXPECT_EQ(63, *arr->optimistic_read_number<SInt32>(-1));
+        EXPECT_FALSE(arr->optimistic_read_number<Float32>(5)); // the locked path converts the integer
+        EXPECT_EQ(5.0f, tes_array::itemAtIndex<Float32>(context, arr.get(), 5));
+        EXPECT_FALSE(arr->optimistic_read_number<SInt32>(64));
+        EXPECT_FALSE(arr->optimistic_read_number<SInt32>(-65));
+
+        tes_array::replaceItemAtIndex<SInt32>(context, arr.get(), 5, 50);
+        EXPECT_FALSE(arr->optimistic_read_number<SInt32>(5));
+        EXPECT_EQ(50, tes_array::itemAtIndex<SInt32>(context, arr.get(), 5));
+
+        // the writer keeps incrementing the first item, the readers must never observe a decreasing value
+        // or a value from the outdated packed numbers
+        std::atomic<bool> done = false;
+        std::atomic<int> failures = 0;
+        std::atomic<int> optimisticReads = 0;
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 4; ++i) {
+            readers.emplace_back([&]() {
+                SInt32 previous = 0;
+                while (!done.load()) {
+                    auto optimistic = arr->optimistic_read_number<SInt32>(0);
+                    SInt32 value = optimistic ? *optimistic : tes_array::itemAtIndex<SInt32>(context, arr.get(), 0);
+                    if (value < previous || value > 2000) {
+                        ++failures;
+                    }
+                    previous = value;
+                    optimisticReads += optimistic ? 1 : 0;
+                }
+            });
+        }
+        for (SInt32 j = 1; j <= 2000; ++j) {
+            {
+                object_lock g(arr);
+                arr->u_set(0, item(j));
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(50)); // let the readers pack the numbers
+        }
+        done = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+
+        EXPECT_EQ(0, failures.load());
+        EXPECT_TRUE(optimisticReads.load() > 0);
+        EXPECT_EQ(2000, tes_array::itemAtIndex<SInt32>(context, arr.get(), 0));
+    }
+
+    JC_TEST(array, packed_numbers)
+    {
+        array::ref arr = array::object(context);
+        for (SInt32 i = 0; i < 100; ++i) {
+            arr->push(item(i % 10));
+        }
+
+        EXPECT_EQ(3, tes_array::findVal<SInt32>(context, arr.get(), 3));
+        EXPECT_EQ(13, tes_array::findVal<SInt32>(context, arr.get(), 3, 4));
+        EXPECT_EQ(-1, tes_array::findVal<SInt32>(context, arr.get(), 3, 94));
+        EXPECT_EQ(84, tes_array::findVal<SInt32>(context, arr.get(), 3, -7)); // one more than the index, as the scalar search returns
+        EXPECT_EQ(-1, tes_array::findVal<SInt32>(context, arr.get(), 10));
+        EXPECT_EQ(-1, tes_array::findVal<Float32>(context, arr.get(), 3.0f)); // the strict comparison stays
+        EXPECT_EQ(10, tes_array::count_item<SInt32>(context, arr.get(), 7));
+        EXPECT_EQ(0, tes_array::count_item<Float32>(context, arr.get(), 7.0f));
+
+        auto ints = tes_array::all_items<VMResultArray<SInt32>>(context, arr.get());
+        EXPECT_EQ(100, ints.size());
+        EXPECT_EQ(9, ints[99]);
+
+        // the packed copy follows the modifications
+        {
+            object_shared_lock g(arr);
+            auto packed = arr->u_packed_numbers();
+            EXPECT_TRUE(packed && packed->type == item_type::integer);
+        }
+        tes_array::replaceItemAtIndex<SInt32>(context, arr.get(), 50, 77);
+        EXPECT_EQ(50, tes_array::findVal<SInt32>(context, arr.get(), 77));
+        tes_array::replaceItemAtIndex<Float32>(context, arr.get(), 51, 77.0f);
+        EXPECT_EQ(51, tes_array::findVal<Float32>(context, arr.get(), 77.0f));
+        EXPECT_EQ(1, tes_array::count_item<Float32>(context, arr.get(), 77.0f));
+        {
+            object_shared_lock g(arr);
+            EXPECT_EQ(item_type::no_item, arr->u_packed_numbers()->type);
+        }
+
+        path_resolving::resolve(context, arr.get(), "@maxInt", [&](item * item) {
+            EXPECT_TRUE(item && item->intValue() == 77);
+        });
+
+        // the first read after a modification scans the items, the second one packs them
+        tes_array::replaceItemAtIndex<SInt32>(context, arr.get(), 51, 7);
+        {
+            object_shared_lock g(arr);
+            EXPECT_FALSE(arr->u_packed_numbers());
+            auto packed = arr->u_packed_numbers();
+            EXPECT_TRUE(packed && packed->type == item_type::integer);
+        }
+        EXPECT_EQ(11, tes_array::count_item<SInt32>(context, arr.get(), 7));
+
+        SInt32 itemSum = 0;
+        for (auto& itm : arr->u_container()) {
+            itemSum += itm.intValue();
+        }
+        path_resolving::resolve(context, arr.get(), "@sumInt", [&](item * item) {
+            EXPECT_TRUE(item && item->intValue() == itemSum);
+        });
+
+        array::ref reals = array::object(context);
+        for (SInt32 i = 0; i < 100; ++i) {
+            reals->push(item(i * 0.5f));
+        }
+        EXPECT_EQ(21, tes_array::findVal<Float32>(context, reals.get(), 10.5f));
+        EXPECT_EQ(1, tes_array::count_item<Float32>(context, reals.get(), 49.5f));
+        path_resolving::resolve(context, reals.get(), "@maxNum", [&](item * item) {
+            EXPECT_TRUE(item && item->fltValue() == 49.5f);
+        });
+        path_resolving::resolve(context, reals.get(), "@minInt", [&](item * item) {
+            EXPECT_TRUE(item && item->isNull());
+        });
+        path_resolving::resolve(context, reals.get(), "@sumFlt", [&](item * item) {
+            EXPECT_TRUE(item && item->fltValue() == 2475.0f);
+        });
+        path_resolving::resolve(context, reals.get(), "@sumInt", [&](item * item) {
+            EXPECT_TRUE(item && item->isNull());
+        });
+    }
+
+    JC_TEST(array, packed_numbers_benchmark)
+    {
+        const SInt32 count = 1000000;
+        array::ref arr = array::object(context);
+        for (SInt32 i = 0; i < count; ++i) {
+            arr->push(item(i));
+        }
+
+        namespace chr = std::chrono;
+        auto measure = [&](const char *what) {
+            auto started = chr::steady_clock::now();
+            SInt32 found = 0;
+            for (int i = 0; i < 20; ++i) {
+                found += tes_array::findVal<SInt32>(context, arr.get(), count - 1);
+                found += tes_array::count_item<SInt32>(context, arr.get(), i);
+            }
+            auto elapsed = chr::duration_cast<chr::microseconds>(chr::steady_clock::now() - started).count();
+            JC_log("%s: 20 findInt & countInteger over %d items took %lld us", what, count, elapsed);
+            EXPECT_EQ(20 * count, found);
+        };
+
+        {
+            auto started = chr::steady_clock::now();
+            const auto& items = arr->u_container();
+            SInt32 found = 0;
+            for (int i = 0; i < 20; ++i) {
+                found += (SInt32)(std::find(items.begin(), items.end(), item(count - 1)) - items.begin());
+                found += (SInt32)std::count(items.begin(), items.end(), item(i));
+            }
+            auto elapsed = chr::duration_cast<chr::microseconds>(chr::steady_clock::now() - started).count();
+            JC_log("items: 20 findInt & countInteger over %d items took %lld us", count, elapsed);
+            EXPECT_EQ(20 * count, found);
+        }
+
+        packed_kernels::set_isa_limit(packed_kernels::isa::scalar);
+        measure("packed, scalar");
+        packed_kernels::set_isa_limit(packed_kernels::isa::sse2);
+        measure("packed, SSE2");
+        packed_kernels::set_isa_limit(packed_kernels::isa::avx2);
+        measure(packed_kernels::active_isa() == packed_kernels::isa::avx2 ? "packed, AVX2" : "packed, SSE2 (no AVX2)");
+    }
+
+    JC_TEST(array, queue_pattern)
+    {
+        namespace chr = std::chrono;
+        for (SInt32 count : { 10000, 100000 }) {
+            array::ref arr = array::object(context);
+            auto started = chr::steady_clock::now();
+
+            for (SInt32 i = 0; i < count; ++i) {
+                tes_array::addItemAt<SInt32>(context, arr.get(), i, 0);
+            }
+            for (SInt32 i = 0; i < count; ++i) {
+                tes_array::addItemAt<SInt32>(context, arr.get(), count + i, 0);
+                tes_array::eraseIndex(context, arr.get(), -1);
+            }
+
+            auto elapsed = chr::duration_cast<chr::milliseconds>(chr::steady_clock::now() - started).count();
+            JC_log("queue of %d items: %d pushes to the front & pops from the back took %lld ms", count, count, elapsed);
+
+            EXPECT_EQ(count, tes_array::count(context, arr.get()));
+            EXPECT_EQ(2 * count - 1, tes_array::itemAtIndex<SInt32>(context, arr.get(), 0));
+            EXPECT_EQ(count, tes_array::itemAtIndex<SInt32>(context, arr.get(), -1));
+        }
+    }
+
     TEST(array, sort_and_unique)
     {
         tes_context_standalone ctx;
@@ -100,6 +348,64 @@ namespace tes_api_3 {
         sort("[]");
     }
 
+    TEST(array, sort_by_path)
+    {
+        tes_context_standalone ctx;
+        auto& npcs = tes_object::objectFromPrototype(ctx, STR([
+            {"name": "Lydia", "level": 10},
+            {"name": "aela", "level": 20},
+            {"name": "Brynjolf", "level": 10},
+            {"name": "Cicero"},
+            5
+        ]))->as_link<array>();
+
+        auto names = [&]() {
+            std::string result;
+            for (auto& itm : npcs.u_container()) {
+                result += itm.object() ? tes_object::resolveGetter<std::string>(ctx, itm.object(), ".name", "?") : "5";
+                result += ' ';
+            }
+            return result;
+        };
+
+        tes_array::sortByPath(ctx, &npcs, ".level, .name");
+        EXPECT_EQ("5 Cicero Brynjolf Lydia aela ", names());
+
+        tes_array::sortByPath(ctx, &npcs, ".level", true);
+        EXPECT_EQ("aela Brynjolf Lydia 5 Cicero ", names()); // equal levels keep their order
+
+        tes_array::sortByPath(ctx, &npcs, ".name");
+        EXPECT_EQ("5 aela Brynjolf Cicero Lydia ", names());
+
+        // no lock is held while the keys are resolved - the array may be among its items
+        npcs.u_push(item(&npcs));
+        tes_array::sortByPath(ctx, &npcs, ".level, .name");
+        EXPECT_EQ("5 ? Cicero Brynjolf Lydia aela ", names());
+        npcs.u_container().pop_back();
+
+        // the array modified after its keys have been resolved: the current items take the keys of the same containers
+        array::container_type resolved = npcs.u_container(); // 5 Cicero Brynjolf Lydia aela
+        std::vector<item> keys(resolved.size());
+        for (size_t i = 0; i < resolved.size(); ++i) {
+            if (auto element = resolved[i].object()) {
+                keys[i] = item(tes_object::resolveGetter<std::string>(ctx, element, ".name", ""));
+            }
+        }
+        std::reverse(npcs.u_container().begin(), npcs.u_container().end());
+        npcs.u_container().erase(npcs.u_container().begin()); // aela
+        EXPECT_TRUE(tes_array::u_sortByResolvedKeys(npcs, resolved, keys, 1, true, false));
+        EXPECT_EQ("Lydia Cicero Brynjolf 5 ", names());
+
+        // a container added meanwhile has no keys
+        npcs.u_push(item(resolved[4].object()));
+        npcs.u_push(item(&npcs));
+        EXPECT_FALSE(tes_array::u_sortByResolvedKeys(npcs, resolved, keys, 1, false, false));
+        EXPECT_EQ("Lydia Cicero Brynjolf 5 aela ? ", names());
+        EXPECT_TRUE(tes_array::u_sortByResolvedKeys(npcs, resolved, keys, 1, false, true));
+        EXPECT_EQ("5 ? aela Brynjolf Cicero Lydia ", names());
+        npcs.u_container().erase(npcs.u_container().begin() + 1);
+    }
+
     TEST(tes_jcontainers, tes_jcontainers)
     {
         EXPECT_TRUE(tes_jcontainers::__isInstalled());
@@ -161,8 +161,18 @@ namespace collections
                     decltype(context)       context;
                     decltype(rightPath)     *rightPath;
                     decltype(itemVisitFunc) *visitFunc;
+                    decltype(opr)           opr;
+                    item                    *state;
 
                     void operator()(array& arr) {
+                        if (rightPath->empty()) {
+                            object_shared_lock g(arr);
+                            auto packed = arr.u_packed_numbers();
+                            if (packed && packed->type != item_type::no_item && operators::apply_packed(*opr, *packed, *state)) {
+                                return;
+                            }
+                        }
+
                         // have to copy array to prevent its modification during iteration
                         auto array_copy = arr.container_copy();
                         for (auto &itm : array_copy) {
@@ -178,8 +188,30 @@ namespace collections
                     void operator()(integer_map& cnt) {
                         _map_visit_helper(context, cnt, *rightPath, *visitFunc);
                     }
+                    void operator()(counter_map& cnt) {
+                        _map_visit_helper(context, cnt, *rightPath, *visitFunc);
+                    }
+                    void operator()(map_cursor&) {} // has no items
+                    void operator()(priority_heap& cnt) {
+                        auto items_copy = cnt.container_copy();
+                        for (auto &itm : items_copy) {
+                            resolve(context, itm, rightPath->begin(), *visitFunc);
+                        }
+                    }
+                    void operator()(ring_buffer& cnt) {
+                        auto items_copy = cnt.container_copy();
+                        for (auto &itm : items_copy) {
+                            resolve(context, itm, rightPath->begin(), *visitFunc);
+                        }
+                    }
+                    void operator()(item_set& cnt) {
+                        auto set_copy = cnt.container_copy();
+                        for (auto &itm : set_copy) {
+                            resolve(context, itm, rightPath->begin(), *visitFunc);
+                        }
+                    }
 
-                } helper{ context, &rightPath, &itemVisitFunc };
+                } helper{ context, &rightPath, &itemVisitFunc, opr, &sharedItem };
 
                 perform_on_object(*collection, helper);
 
@@ -218,7 +250,7 @@ namespace collections
                 }
 
                 return state(   true,
-                                    [=](object_base *container) {
+                                    [=, counterValue = item()](object_base *container) mutable {
                                         item *itemPtr = nullptr;
 
                                         if (auto obj = container->as<map>()) {
@@ -230,6 +262,11 @@ namespace collections
                                                 itemPtr = obj->u_get(key);
                                             }
                                         }
+                                        else if (auto obj = container->as<counter_map>()) {
+                                            // a copy of the counter, the changes made through it aren't stored
+                                            auto value = obj->u_get(ss::string(begin, end));
+                                            itemPtr = value ? &(counterValue = *value) : nullptr;
+                                        }
 
                                         return itemPtr;
                                 },
@@ -442,9 +479,21 @@ namespace collections
                 if (!key) {
                     return bs::none;
                 }
-                object_lock lock(collection);
-                auto itemPtr = u_access_value(collection, key->key);
-                return itemPtr ? bs::make_optional(itemPtr->object()) : bs::none;
+                object_shared_lock lock(collection);
+                auto itm = u_read_value(collection, key->key);
+                return itm ? bs::make_optional(itm->object()) : bs::none;
+            }
+        };
+
+        // for the callers holding the locks of the containers on the path already. The lazily loaded objects
+        // aren't decoded - that would take the locks of their own
+        struct unlocked_accessor {
+            static bs::optional<object_base*> access_value(object_base& collection, const bs::optional<key_and_rest>& key) {
+                if (!key) {
+                    return bs::none;
+                }
+                auto itm = u_read_value(collection, key->key);
+                return itm ? bs::make_optional(itm->peek_object()) : bs::none;
             }
         };
 
@@ -498,16 +547,23 @@ namespace collections
             
             */
 
-            static bs::optional<accesss_info> retrieve(object_base& collection, const cstring& path) {
+            // the @chain, if any, receives the containers the path passes through, the last one included
+            static bs::optional<accesss_info> retrieve(object_base& collection, const cstring& path, std::vector<object_base*>* chain = nullptr) {
                 auto key_opt = parse_path(HACK_get_tcontext(collection), path);
-                return recurs(access_value::access_value(collection, key_opt), key_opt, collection);
+                return recurs(access_value::access_value(collection, key_opt), key_opt, collection, chain);
             }
 
-            static bs::optional<accesss_info> recurs(bs::optional<object_base*>&& value, const bs::optional<key_and_rest>& k, object_base& source) {
+            static bs::optional<accesss_info> recurs(bs::optional<object_base*>&& value, const bs::optional<key_and_rest>& k, object_base& source,
+                std::vector<object_base*>* chain)
+            {
                 if (!k) {
                     return bs::none;
                 }
 
+                if (chain) {
+                    chain->push_back(&source);
+                }
+
                 object_base* as_object = value.get_value_or(nullptr);
 
                 if (k->rest_of_path.empty()) {
@@ -515,7 +571,7 @@ namespace collections
                 }
                 else if (as_object && !k->rest_of_path.empty()) {
                     auto next_key = parse_path(HACK_get_tcontext(source), k->rest_of_path);
-                    return recurs(access_value::access_value(*as_object, next_key), next_key, *as_object);
+                    return recurs(access_value::access_value(*as_object, next_key), next_key, *as_object, chain);
                 }
                 else {
                     return bs::none;
@@ -529,6 +585,16 @@ namespace collections
             return last_kv_pair_retriever<constant_accessor>::retrieve(collection, all_path);
         }
 
+        bs::optional<accesss_info> access_constant(object_base& collection, const char* cpath, std::vector<object_base*>& chain) {
+            auto all_path = util::make_cstring_safe(cpath, string_path_length_max);
+            return last_kv_pair_retriever<constant_accessor>::retrieve(collection, all_path, &chain);
+        }
+
+        bs::optional<accesss_info> u_access_constant(object_base& collection, const char* cpath, std::vector<object_base*>& chain) {
+            auto all_path = util::make_cstring_safe(cpath, string_path_length_max);
+            return last_kv_pair_retriever<unlocked_accessor>::retrieve(collection, all_path, &chain);
+        }
+
         bs::optional<accesss_info> access_creative(object_base& collection, const char* cpath) {
             auto all_path = util::make_cstring_safe(cpath, string_path_length_max);
             return last_kv_pair_retriever<creative_accessor>::retrieve(collection, all_path);
@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <type_traits>
+#include <vector>
 #include <boost/optional.hpp>
 #include <boost/variant/variant.hpp>
 
@@ -48,6 +49,11 @@ namespace collections
                 }
                 return nullptr;
             }
+
+            // the counters aren't stored as items, so there is nothing to modify in place
+            item* operator () (counter_map&, const key_variant&) {
+                return nullptr;
+            }
         };
 
         inline auto u_access_value(object_base& collection, const key_variant& key) -> item* {
@@ -55,6 +61,28 @@ namespace collections
         };
         // 
 
+        // read-only access, suitable for the shared lock
+        struct u_read_value_helper {
+            template<class Collection>
+            bs::optional<item> operator () (const Collection& collection, const key_variant& key) {
+                if (auto idx = bs::get<typename Collection::key_type>(&key)) {
+                    auto itemPtr = collection.u_get(*idx);
+                    return itemPtr ? bs::optional<item>(*itemPtr) : bs::none;
+                }
+                return bs::none;
+            }
+
+            bs::optional<item> operator () (const counter_map& collection, const key_variant& key) {
+                auto idx = bs::get<std::string>(&key);
+                return idx ? collection.u_get(*idx) : bs::none;
+            }
+        };
+
+        inline auto u_read_value(object_base& collection, const key_variant& key) -> bs::optional<item> {
+            return perform_on_object_and_return<bs::optional<item> >(collection, u_read_value_helper(), key);
+        };
+        //
+
         template<class Value>
         struct u_assign_value_helper {
             template<class T>
@@ -64,6 +92,11 @@ namespace collections
                 }
                 return nullptr;
             }
+
+            // see u_assign_counter
+            item* operator()(counter_map&, const key_variant&, Value&&) {
+                return nullptr;
+            }
         };
 
         template<class Value>
@@ -86,6 +119,25 @@ namespace collections
             return perform_on_object_and_return<bool >(collection, u_erase_key_helper(), key);
         }
 
+        // counter_map has no items to hand out: its values get read, modified and stored back as a whole.
+        // Fails if the @key is missing and not @createMissing or the @func has left a non-number
+        template<class Func>
+        inline bool u_modify_counter(counter_map& counters, const key_variant& key, bool createMissing, Func&& func) {
+            auto counterKey = bs::get<std::string>(&key);
+            if (!counterKey) {
+                return false;
+            }
+
+            auto value = counters.u_get(*counterKey);
+            if (!value && !createMissing) {
+                return false;
+            }
+
+            item modified = value.get_value_or(item());
+            func(modified);
+            return counters.u_set(*counterKey, std::move(modified));
+        }
+
         struct accesss_info {
             object_base& collection;
             key_variant key;
@@ -104,13 +156,17 @@ namespace collections
         bs::optional<accesss_info> access_constant(object_base& tree, const char* path);
         bs::optional<accesss_info> access_creative(object_base& tree, const char* path);
 
+        // The @chain receives the containers the @path passes through, the last one included.
+        // The u_access_constant takes no locks: the caller holds the locks of all the containers on the path
+        bs::optional<accesss_info> access_constant(object_base& tree, const char* path, std::vector<object_base*>& chain);
+        bs::optional<accesss_info> u_access_constant(object_base& tree, const char* path, std::vector<object_base*>& chain);
+
 
         inline bs::optional<item> get(object_base& target, const char *cpath) {
             auto ac_info = access_constant(target, cpath);
             if (ac_info) {
-                object_lock g(ac_info->collection);
-                auto itmPtr = u_access_value(ac_info->collection, ac_info->key);
-                return _opt_from_pointer(itmPtr);
+                object_shared_lock g(ac_info->collection);
+                return u_read_value(ac_info->collection, ac_info->key);
             }
             else {
                 return bs::none;
@@ -122,6 +178,10 @@ namespace collections
             auto ac_info = (way == constant ? access_constant(target, cpath) : access_creative(target, cpath));
             if (ac_info) {
                 object_lock g(ac_info->collection);
+                if (auto counters = ac_info->collection.as<counter_map>()) {
+                    return u_modify_counter(*counters, ac_info->key, false, [&](item& itm) { f(itm, std::forward<Args>(args)...); });
+                }
+
                 auto itmPtr = u_access_value(ac_info->collection, ac_info->key);
                 if (itmPtr) {
                     f(*itmPtr, std::forward<Args>(args)...);
@@ -137,9 +197,9 @@ namespace collections
         inline bs::optional<Value> get(object_base& target, const char *cpath) {
             auto ac_info = access_constant(target, cpath);
             if (ac_info) {
-                object_lock g(ac_info->collection);
-                auto itmPtr = u_access_value(ac_info->collection, ac_info->key);
-                return itmPtr ? _opt_from_pointer(itmPtr->get<Value>()) : bs::none;
+                object_shared_lock g(ac_info->collection);
+                auto itm = u_read_value(ac_info->collection, ac_info->key);
+                return itm ? _opt_from_pointer(itm->get<Value>()) : bs::none;
             }
             else {
                 return bs::none;
@@ -151,6 +211,10 @@ namespace collections
             auto ac_info = (way == constant ? access_constant(target, cpath) : access_creative(target, cpath));
             if (ac_info) {
                 object_lock g(ac_info->collection);
+                if (auto counters = ac_info->collection.as<counter_map>()) {
+                    return u_modify_counter(*counters, ac_info->key, way == creative, [&](item& itm) { itm = std::forward<Value>(value); });
+                }
+
                 if (way == constant) {
                     auto itmPtr = u_access_value(ac_info->collection, ac_info->key);
                     if (itmPtr) {
@@ -35,6 +35,11 @@ namespace reflection { namespace binding {
     template<> struct GetConv < map* > : ObjectConverter< map >{};
     template<> struct GetConv < form_map* > : ObjectConverter< form_map >{};
     template<> struct GetConv < integer_map* > : ObjectConverter < integer_map >{};
+    template<> struct GetConv < counter_map* > : ObjectConverter < counter_map >{};
+    template<> struct GetConv < map_cursor* > : ObjectConverter < map_cursor >{};
+    template<> struct GetConv < item_set* > : ObjectConverter < item_set >{};
+    template<> struct GetConv < ring_buffer* > : ObjectConverter < ring_buffer >{};
+    template<> struct GetConv < priority_heap* > : ObjectConverter < priority_heap >{};
 
     //////////////////////////////////////////////////////////////////////////
 
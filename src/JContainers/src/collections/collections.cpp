@@ -27,6 +27,8 @@
 #include "intrusive_ptr.hpp"
 #include "intrusive_ptr_serialization.hpp"
 #include "util/istring_serialization.h"
+#include "util/order_statistic_map_serialization.h"
+#include "util/devector_serialization.h"
 #include "iarchive_with_blob.h"
 
 #include "object/object_base_serialization.h"
@@ -43,6 +45,11 @@ BOOST_CLASS_EXPORT_GUID(collections::array, "kJArray");
 BOOST_CLASS_EXPORT_GUID(collections::map, "kJMap");
 BOOST_CLASS_EXPORT_GUID(collections::form_map, "kJFormMap");
 BOOST_CLASS_EXPORT_GUID(collections::integer_map, "kJIntegerMap");
+BOOST_CLASS_EXPORT_GUID(collections::counter_map, "kJCounterMap");
+BOOST_CLASS_EXPORT_GUID(collections::map_cursor, "kJMapCursor");
+BOOST_CLASS_EXPORT_GUID(collections::item_set, "kJSet");
+BOOST_CLASS_EXPORT_GUID(collections::ring_buffer, "kJRingBuffer");
+BOOST_CLASS_EXPORT_GUID(collections::priority_heap, "kJPriorityQueue");
 
 BOOST_CLASS_VERSION(collections::form_map, 1)
 BOOST_CLASS_VERSION(collections::item, 3)
@@ -147,8 +154,115 @@ namespace collections {
         ar & cnt;
     }
 
+    // counters are stored as ordinary integer or float items
+    template<class Archive>
+    void counter_map::save(Archive & ar, const unsigned int version) const {
+        ar & boost::serialization::base_object<object_base>(*this);
+        snapshot_type values = u_snapshot();
+        ar & values;
+    }
+
+    template<class Archive>
+    void counter_map::load(Archive & ar, const unsigned int version) {
+        ar & boost::serialization::base_object<object_base>(*this);
+        snapshot_type values;
+        ar & values;
+        for (auto& pair : values) {
+            u_find_slot(pair.first, true)->store(pair.second);
+        }
+    }
+
+    // iterators can't be stored, so is the index of the pair the cursor points to
+    template<class Archive>
+    void map_cursor::save(Archive & ar, const unsigned int version) const {
+        ar & boost::serialization::base_object<object_base>(*this);
+        ar & _target;
+
+        uint32_t stateValue = static_cast<uint32_t>(_state);
+        item key = u_position_key();
+        ar & stateValue;
+        ar & key;
+    }
+
+    template<class Archive>
+    void map_cursor::load(Archive & ar, const unsigned int version) {
+        ar & boost::serialization::base_object<object_base>(*this);
+        ar & _target;
+
+        uint32_t stateValue = 0;
+        ar & stateValue;
+        ar & _loaded_key;
+        _state = static_cast<state>(stateValue);
+    }
+
+    template<class Archive>
+    void item_set::save(Archive & ar, const unsigned int version) const {
+        ar & boost::serialization::base_object<object_base>(*this);
+        ar & _set.values();
+    }
+
+    // the table isn't stored, it gets rebuilt
+    template<class Archive>
+    void item_set::load(Archive & ar, const unsigned int version) {
+        ar & boost::serialization::base_object<object_base>(*this);
+        std::vector<item> values;
+        ar & values;
+        _set.assign(std::move(values));
+    }
+
+    // the items are stored from the newest to the oldest, the unused slots aren't stored
+    template<class Archive>
+    void ring_buffer::save(Archive & ar, const unsigned int version) const {
+        ar & boost::serialization::base_object<object_base>(*this);
+        uint32_t capacity = u_capacity();
+        const container_type items = u_items();
+        ar & capacity;
+        ar & items;
+    }
+
+    template<class Archive>
+    void ring_buffer::load(Archive & ar, const unsigned int version) {
+        ar & boost::serialization::base_object<object_base>(*this);
+        uint32_t capacity = 0;
+        container_type items;
+        ar & capacity;
+        ar & items;
+
+        u_reset((std::min)(capacity, uint32_t(max_capacity)));
+        for (auto itr = items.rbegin(); itr != items.rend(); ++itr) {
+            u_push(std::move(*itr));
+        }
+    }
+
+    // the entries are stored in the heap order, along with their handles
+    template<class Archive>
+    void priority_heap::save(Archive & ar, const unsigned int version) const {
+        ar & boost::serialization::base_object<object_base>(*this);
+        ar & _max_first;
+        ar & _next_handle;
+        ar & _heap;
+    }
+
+    template<class Archive>
+    void priority_heap::load(Archive & ar, const unsigned int version) {
+        ar & boost::serialization::base_object<object_base>(*this);
+        ar & _max_first;
+        ar & _next_handle;
+        ar & _heap;
+        rebuild_positions();
+    }
+
     //////////////////////////////////////////////////////////////////////////
 
+    // the maps may be not loaded yet (their expired keys not erased), the position is restored at the first use
+    void map_cursor::u_onLoaded() {
+        _position = boost::blank();
+        _restore_pending = _target && is_iterable(*_target);
+        if (!_restore_pending) {
+            _state = state::finished;
+        }
+    }
+
     void form_map::u_onLoaded() {
 
         util::tree_erase_if(cnt, [](const value_type& pair){
@@ -156,6 +270,17 @@ namespace collections {
         });
     }
 
+    // the expired forms hash as None now, the table is rebuilt (and they merge) as the form_map erases its expired keys
+    void item_set::u_onLoaded() {
+        const bool expired = std::any_of(_set.begin(), _set.end(), [](const item& itm) {
+            auto form = itm.get<form_ref>();
+            return form && form->is_expired();
+        });
+        if (expired) {
+            _set.modify_values([](item&) {});
+        }
+    }
+
     //////////////////////////////////////////////////////////////////////////
 
     void array::u_nullifyObjects() {
@@ -164,5 +289,112 @@ namespace collections {
         }
     }
 
+    const array::packed_numbers* array::u_packed_numbers(size_t readCost) const {
+        if (_array.size() < packed_numbers::min_count) {
+            return nullptr;
+        }
+
+        // the outdated copy may be freed meanwhile, unless it's checked under the guard
+        util::epoch::guard guard;
+        if (!guard.active()) {
+            return nullptr;
+        }
+
+        // stable while any lock is held, odd if it's the exclusive one - the owner may be modifying the array
+        const uint32_t sequence = mutex().read_sequence_begin();
+        if (sequence & 1) {
+            return nullptr;
+        }
+
+        const packed_numbers *cached = _packed.load(std::memory_order_acquire);
+        if (cached && cached->sequence == sequence) {
+            return cached;
+        }
+
+        // The outdated copy isn't kept. The other readers of this version may be checking its sequence
+        // and the lock-free ones may be reading it, so it's retired
+        if (cached && _packed.compare_exchange_strong(cached, nullptr, std::memory_order_relaxed)) {
+            util::epoch::retire(cached, sizeof(packed_numbers) + (cached->integers.capacity() + cached->reals.capacity()) * 4);
+        }
+
+        // The numbers get packed once the reads of this version have visited as many items as there are:
+        // at the second full scan, or after the as many single item reads.
+        // The concurrent readers may lose a count here and there, that only delays the packing
+        const uint32_t cost = (uint32_t)(std::min)(readCost, _array.size());
+        if (_unpacked_read_sequence.exchange(sequence, std::memory_order_relaxed) != sequence) {
+            _unpacked_read_cost.store(cost, std::memory_order_relaxed);
+            return nullptr;
+        }
+        if (_unpacked_read_cost.fetch_add(cost, std::memory_order_relaxed) < _array.size()) {
+            return nullptr;
+        }
+
+        auto packed = std::make_unique<packed_numbers>();
+        packed->sequence = sequence;
+
+        auto pack = [this](auto& values) {
+            using T = typename std::decay_t<decltype(values)>::value_type;
+            values.reserve(_array.size());
+            for (const item& itm : _array) {
+                const T *value = itm.get<T>();
+                if (!value) {
+                    return false;
+                }
+                values.push_back(*value);
+            }
+            return true;
+        };
+
+        const item_type type = _array.front().type();
+        if (type == item_type::integer && pack(packed->integers)) {
+            packed->type = type;
+        }
+        else if (type == item_type::real && pack(packed->reals)) {
+            packed->type = type;
+        }
+        else { // the negative result is cached too
+            packed->integers = {};
+            packed->reals = {};
+        }
+
+        // the copies published in this version stay until the next write, the loser takes the winner's one
+        const packed_numbers *published = nullptr;
+        if (_packed.compare_exchange_strong(published, packed.get(), std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return packed.release();
+        }
+        return published;
+    }
+
     //////////////////////////////////////////////////////////////////////////
+    // the saves made before the compact format are still read with the boost archive
+    TEST(tes_context, boost_archive_still_supported)
+    {
+        std::ostringstream stream;
+        Handle rootId = Handle::Null;
+        {
+            tes_context_standalone context;
+            auto& root = map::object(context);
+            root.u_set("name", "old save");
+            root.u_set("values", &array::object(context));
+            context.set_root(&root);
+            rootId = root.uid();
+
+            const char header[] = "{\"commonVersion\": 6}";
+            stream << (uint32_t)(sizeof header - 1);
+            stream.write(header, sizeof header - 1);
+
+            boost::archive::binary_oarchive archive{ stream };
+            archive << static_cast<const tes_context&>(context);
+        }
+
+        tes_context_standalone context;
+        context.read_from_string(stream.str());
+
+        auto root = context.getObjectOfType<map>(rootId);
+        EXPECT_NOT_NIL(root);
+        EXPECT_TRUE(&context.root() == root);
+        EXPECT_EQ("old save", root->u_get("name")->readAs<std::string>());
+        EXPECT_NOT_NIL(root->u_get("values")->object()->as<array>());
+    }
+
 }
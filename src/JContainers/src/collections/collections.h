@@ -2,11 +2,19 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <unordered_map>
 #include <assert.h>
+#include <string.h>
 
 #include <boost/serialization/split_member.hpp>
 #include <boost/optional.hpp>
 
+#include "util/order_statistic_map.h"
+#include "util/devector.h"
+#include "util/open_hash_set.h"
+#include "util/epoch.h"
+
 #include "common/ITypes.h"
 #include "common/IDebugLog.h"
 #include "skse64/GameForms.h"
@@ -19,6 +27,8 @@
 namespace collections {
 
 	class tes_context;
+    class compact_writer;
+    class compact_reader;
 
     template<class T>
     class collection_base : public object_base
@@ -78,6 +88,16 @@ namespace collections {
             return func(container.as_link<form_map>(), std::forward<Args>(args)...);
         case integer_map::TypeId:
             return func(container.as_link<integer_map>(), std::forward<Args>(args)...);
+        case counter_map::TypeId:
+            return func(container.as_link<counter_map>(), std::forward<Args>(args)...);
+        case map_cursor::TypeId:
+            return func(container.as_link<map_cursor>(), std::forward<Args>(args)...);
+        case item_set::TypeId:
+            return func(container.as_link<item_set>(), std::forward<Args>(args)...);
+        case ring_buffer::TypeId:
+            return func(container.as_link<ring_buffer>(), std::forward<Args>(args)...);
+        case priority_heap::TypeId:
+            return func(container.as_link<priority_heap>(), std::forward<Args>(args)...);
         default:
             assert(false);
             noreturn_func();
@@ -100,6 +120,21 @@ namespace collections {
         case integer_map::TypeId:
             func(container.as_link<integer_map>(), std::forward<Args>(args)...);
             break;
+        case counter_map::TypeId:
+            func(container.as_link<counter_map>(), std::forward<Args>(args)...);
+            break;
+        case map_cursor::TypeId:
+            func(container.as_link<map_cursor>(), std::forward<Args>(args)...);
+            break;
+        case item_set::TypeId:
+            func(container.as_link<item_set>(), std::forward<Args>(args)...);
+            break;
+        case ring_buffer::TypeId:
+            func(container.as_link<ring_buffer>(), std::forward<Args>(args)...);
+            break;
+        case priority_heap::TypeId:
+            func(container.as_link<priority_heap>(), std::forward<Args>(args)...);
+            break;
         default:
             assert(false);
             break;
@@ -125,7 +160,7 @@ namespace collections {
 
         typedef SInt32 Index;
 
-        typedef std::vector<item> container_type;
+        typedef util::devector<item> container_type;
         typedef int32_t key_type;
         typedef container_type::iterator iterator;
         typedef container_type::reverse_iterator reverse_iterator;
@@ -141,7 +176,7 @@ namespace collections {
         }
 
         container_type container_copy() const {
-            object_lock g(this);
+            object_shared_lock g(this);
             return _array;
         }
 
@@ -166,7 +201,7 @@ namespace collections {
 
         void u_visit_referenced_objects(const std::function<void(object_base&)>& visitor) override {
             for (auto& item : _array) {
-                if (auto obj = item.object()) {
+                if (auto obj = item.peek_object()) {
                     visitor(*obj);
                 }
             }
@@ -226,10 +261,65 @@ namespace collections {
         }
 
         boost::optional<item> get_item(int32_t index) const {
-            object_lock lock(this);
+            object_shared_lock lock(this);
             return _opt_from_pointer(u_get(index));
         }
 
+        // Contiguous copy of the numbers of the array for the SIMD kernels (see packed_kernels.h)
+        struct packed_numbers {
+            enum { min_count = 32 }; // smaller arrays aren't worth packing
+            static const size_t full_scan = size_t(-1); // the read cost of the operations that visit every item
+
+            uint32_t sequence = 0; // the write sequence of the object lock it matches
+            item_type type = item_type::no_item; // integer or real. no_item if the array isn't made of one kind of numbers
+            std::vector<SInt32> integers;
+            std::vector<Float32> reals;
+
+            // empty if the numbers are of the other kind
+            template<class T> const std::vector<T>& values() const;
+        };
+
+        // Returns the packed numbers, built on demand and reused until the array gets modified.
+        // Null if the array is too small, the exclusive lock is held or the reads since the last modification
+        // have cost less than the packing: the arrays modified between the reads aren't packed, a plain scan costs them less.
+        // @readCost is the number of the items the read visits, a full scan packs the numbers at the second read.
+        // The object lock must be held, the numbers stay valid until it gets released
+        const packed_numbers* u_packed_numbers(size_t readCost = packed_numbers::full_scan) const;
+
+        // Lock-free read of a number, never blocks the writers: the item is read from the packed numbers, validated
+        // against the write sequence of the object lock. Uncontended, it takes no atomic read-modify-write operations.
+        // None if the numbers aren't packed or aren't of the T type, or a writer interferes - use the locked path then
+        template<class T>
+        boost::optional<T> optimistic_read_number(int32_t index) const {
+            static_assert(std::is_same<T, SInt32>::value || std::is_same<T, Float32>::value, "packed numbers only");
+
+            util::epoch::guard guard; // the packed numbers can't be freed while they are read
+            if (!guard.active()) {
+                return boost::none;
+            }
+
+            const object_mutex& mutex = this->mutex();
+            const uint32_t sequence = mutex.read_sequence_begin();
+            if (sequence & 1) {
+                return boost::none; // the writer is active
+            }
+
+            const packed_numbers *packed = _packed.load(std::memory_order_acquire);
+            if (!packed || packed->sequence != sequence) {
+                return boost::none;
+            }
+
+            const auto& values = packed->values<T>(); // empty if the numbers are of the other kind
+            const int32_t count = (int32_t)values.size();
+            const int32_t idx = (index >= 0 ? index : (count + index));
+            if (idx < 0 || idx >= count) {
+                return boost::none;
+            }
+
+            const T value = values[idx];
+            return mutex.read_sequence_validate(sequence) ? boost::optional<T>(value) : boost::none;
+        }
+
         iterator begin() { return _array.begin();}
         iterator end() { return _array.end(); }
 
@@ -241,8 +331,25 @@ namespace collections {
 
         template<class Archive>
         void serialize(Archive & ar, const unsigned int version);
+
+        void save_compact(compact_writer& ar) const;
+        void load_compact(compact_reader& ar);
+
+        ~array() {
+            delete _packed.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // Published by the readers holding the shared lock, all of them see the same write sequence.
+        // The outdated copy is retired (see util::epoch), the lock-free readers may still be reading it
+        mutable std::atomic<const packed_numbers*> _packed = nullptr;
+        mutable std::atomic<uint32_t> _unpacked_read_sequence = 1; // the write sequence of the reads that haven't packed the numbers
+        mutable std::atomic<uint32_t> _unpacked_read_cost = 0; // the number of the items they have visited
     };
 
+    template<> inline const std::vector<SInt32>& array::packed_numbers::values<SInt32>() const { return integers; }
+    template<> inline const std::vector<Float32>& array::packed_numbers::values<Float32>() const { return reals; }
+
     template<class RealType, class ContainerType>
     class basic_map_collection : public collection_base< RealType > {
     public:
@@ -268,20 +375,20 @@ namespace collections {
         }
 
         container_type container_copy() const {
-            object_lock g(this);
+            object_shared_lock g(this);
             return cnt;
         }
 
         template<class Key>
         item findOrDef(const Key& key) const {
-            object_lock g(this);
+            object_shared_lock g(this);
             auto result = u_get(key);
             return result ? *result : item();
         }
 
         template<class Key>
         boost::optional<item> get_item(const Key& key) const {
-            object_lock g(this);
+            object_shared_lock g(this);
             auto result = u_get(key);
             return result ? *result : boost::optional<item>();
         }
@@ -347,7 +454,7 @@ namespace collections {
         
         void u_visit_referenced_objects(const std::function<void(object_base&)>& visitor) override {
             for (auto& pair : u_container()) {
-                if (auto obj = pair.second.object()) {
+                if (auto obj = pair.second.peek_object()) {
                     visitor(*obj);
                 }
             }
@@ -367,7 +474,7 @@ namespace collections {
     };
 
 
-    class map : public basic_map_collection< map, std::map<std::string, item, map_case_insensitive_comp > >
+    class map : public basic_map_collection< map, util::order_statistic_map<std::string, item, map_case_insensitive_comp > >
     {
     public:
         enum  {
@@ -378,12 +485,15 @@ namespace collections {
 
         template<class Archive>
         void serialize(Archive & ar, const unsigned int version);
+
+        void save_compact(compact_writer& ar) const;
+        void load_compact(compact_reader& ar);
     };
 
-    class form_map : public basic_map_collection< form_map, std::map<form_ref, item, form_ref::stable_less_comparer> >
+    class form_map : public basic_map_collection< form_map, util::order_statistic_map<form_ref, item, form_ref::stable_less_comparer> >
     {
     private:
-        using base = basic_map_collection< form_map, std::map<form_ref, item, form_ref::stable_less_comparer> >;
+        using base = basic_map_collection< form_map, util::order_statistic_map<form_ref, item, form_ref::stable_less_comparer> >;
 
     public:
 
@@ -423,9 +533,12 @@ namespace collections {
         void load(Archive & ar, const unsigned int version);
         template<class Archive>
         void save(Archive & ar, const unsigned int version) const;
+
+        void save_compact(compact_writer& ar) const;
+        void load_compact(compact_reader& ar);
     };
 
-    class integer_map : public basic_map_collection < integer_map, std::map<int32_t, item> >
+    class integer_map : public basic_map_collection < integer_map, util::order_statistic_map<int32_t, item> >
     {
     public:
         enum  {
@@ -434,5 +547,1089 @@ namespace collections {
 
         template<class Archive>
         void serialize(Archive & ar, const unsigned int version);
+
+        void save_compact(compact_writer& ar) const;
+        void load_compact(compact_reader& ar);
+    };
+
+    // Map of numeric counters. Every slot is a single atomic cell, so once a slot is found
+    // JAtomic updates it with lock-free read-modify-write operations - the object lock guards the set of keys only.
+    // Slots are shared: erase and clear drop them from the map, a slot gets freed once the last JAtomic operation
+    // holding it completes. Such an operation is ordered before the erase
+    class counter_map : public collection_base< counter_map >
+    {
+    public:
+        enum  {
+            TypeId = CollectionType::CounterMap,
+        };
+
+        class slot {
+            // the type tag is in the upper half, the value bits are in the lower half
+            std::atomic<uint64_t> _cell = 0;
+
+            enum : uint64_t {
+                tag_none = 0,
+                tag_integer,
+                tag_real,
+            };
+
+            static uint64_t encode(SInt32 value) {
+                return (uint64_t(tag_integer) << 32) | uint32_t(value);
+            }
+
+            static uint64_t encode(item::Real value) {
+                uint32_t bits = 0;
+                memcpy(&bits, &value, sizeof bits);
+                return (uint64_t(tag_real) << 32) | bits;
+            }
+
+            static bool decode(uint64_t cell, SInt32& value) {
+                if ((cell >> 32) != tag_integer) {
+                    return false;
+                }
+                value = SInt32(uint32_t(cell));
+                return true;
+            }
+
+            static bool decode(uint64_t cell, item::Real& value) {
+                if ((cell >> 32) != tag_real) {
+                    return false;
+                }
+                uint32_t bits = uint32_t(cell);
+                memcpy(&value, &bits, sizeof bits);
+                return true;
+            }
+
+        public:
+            slot() = default;
+            slot(const slot&) = delete;
+            slot& operator = (const slot&) = delete;
+
+            bool empty() const {
+                return _cell.load(std::memory_order_acquire) == tag_none;
+            }
+
+            item load() const {
+                const uint64_t cell = _cell.load(std::memory_order_acquire);
+                SInt32 asInt = 0;
+                item::Real asReal = 0;
+                if (decode(cell, asInt)) {
+                    return item(asInt);
+                }
+                else if (decode(cell, asReal)) {
+                    return item(asReal);
+                }
+                return item();
+            }
+
+            // accepts numbers and None only
+            bool store(const item& value) {
+                if (auto asInt = value.get<SInt32>()) {
+                    _cell.store(encode(*asInt), std::memory_order_release);
+                }
+                else if (auto asReal = value.get<item::Real>()) {
+                    _cell.store(encode(*asReal), std::memory_order_release);
+                }
+                else if (value.isNull()) {
+                    _cell.store(tag_none, std::memory_order_release);
+                }
+                else {
+                    return false;
+                }
+                return true;
+            }
+
+            // x = func(x, operand), performed without any lock. None is treated as @initial, @previous is left untouched then.
+            // Fails if the slot holds a number of another type
+            template<class T, class F>
+            bool fetch_modify(F&& func, const T& operand, const T& initial, T& previous) {
+                uint64_t cell = _cell.load(std::memory_order_relaxed);
+                T current;
+                do {
+                    current = initial;
+                    if (cell != tag_none && !decode(cell, current)) {
+                        return false;
+                    }
+                } while (!_cell.compare_exchange_weak(cell, encode(static_cast<T>(func(current, operand))),
+                    std::memory_order_acq_rel, std::memory_order_relaxed));
+
+                if (cell != tag_none) {
+                    previous = current;
+                }
+                return true;
+            }
+
+            template<class T>
+            bool compare_exchange(const T& desired, const T& expected, T& previous) {
+                uint64_t cell = encode(expected);
+                if (_cell.compare_exchange_strong(cell, encode(desired), std::memory_order_acq_rel)) {
+                    previous = expected;
+                    return true;
+                }
+                decode(cell, previous);
+                return false;
+            }
+        };
+
+        typedef std::shared_ptr<slot> slot_ref;
+        typedef std::string key_type;
+        typedef std::map<std::string, slot_ref, map_case_insensitive_comp> container_type;
+        typedef std::map<std::string, item, map_case_insensitive_comp> snapshot_type;
+        typedef container_type::value_type value_type;
+
+    private:
+        container_type cnt;
+
+    public:
+
+        container_type& u_container() {
+            return cnt;
+        }
+
+        const container_type& u_container() const {
+            return cnt;
+        }
+
+        snapshot_type u_snapshot() const {
+            snapshot_type values;
+            for (auto& pair : cnt) {
+                if (!pair.second->empty()) {
+                    values.emplace_hint(values.end(), pair.first, pair.second->load());
+                }
+            }
+            return values;
+        }
+
+        // unlike other containers returns values, not slots
+        snapshot_type container_copy() const {
+            object_shared_lock g(this);
+            return u_snapshot();
+        }
+
+        // the slots are shared, so the copy gets slots of its own
+        void u_copy_from(const counter_map& other) {
+            cnt.clear();
+            for (auto& pair : other.cnt) {
+                u_find_slot(pair.first, true)->store(pair.second->load());
+            }
+        }
+
+        // unlike other containers returns the value, not the item: the counters aren't stored as items.
+        // Safe to call under the shared lock
+        boost::optional<item> u_get(const std::string& key) const {
+            auto itr = cnt.find(key);
+            return itr != cnt.end() && !itr->second->empty() ? itr->second->load() : boost::optional<item>();
+        }
+
+        slot_ref u_find_slot(const std::string& key, bool createMissing) {
+            auto itr = cnt.find(key);
+            if (itr != cnt.end()) {
+                return itr->second;
+            }
+            return createMissing ? (cnt[key] = std::make_shared<slot>()) : nullptr;
+        }
+
+        // The lookup takes the shared lock, the exclusive one is taken only to insert a missing key.
+        // The slots change without the lock: the callers mark the map modified for the delta saves
+        slot_ref find_slot(const std::string& key, bool createMissing) {
+            {
+                object_shared_lock g(this);
+                auto itr = cnt.find(key);
+                if (itr != cnt.end()) {
+                    return itr->second;
+                }
+            }
+            if (!createMissing) {
+                return nullptr;
+            }
+            object_lock g(this);
+            return u_find_slot(key, true);
+        }
+
+        // accepts numbers only
+        template<class T>
+        bool u_set(const std::string& key, T&& value) {
+            const item asItem(std::forward<T>(value));
+            return asItem.isNumber() && u_find_slot(key, true)->store(asItem);
+        }
+
+        bool u_erase(const std::string& key) {
+            auto itr = cnt.find(key);
+            if (itr == cnt.end()) {
+                return false;
+            }
+            const bool existed = !itr->second->empty();
+            cnt.erase(itr);
+            return existed;
+        }
+
+        void u_clear() override {
+            cnt.clear();
+        }
+
+        SInt32 u_count() const override {
+            return std::count_if(cnt.begin(), cnt.end(), [](const value_type& pair) { return !pair.second->empty(); });
+        }
+
+        void u_nullifyObjects() override {}
+
+        //////////////////////////////////////////////////////////////////////////
+
+        friend class boost::serialization::access;
+        BOOST_SERIALIZATION_SPLIT_MEMBER();
+
+        template<class Archive>
+        void load(Archive & ar, const unsigned int version);
+        template<class Archive>
+        void save(Archive & ar, const unsigned int version) const;
+
+        void save_compact(compact_writer& ar) const;
+        void load_compact(compact_reader& ar);
+    };
+    // Iteration cursor over JMap, JFormMap or JIntMap. Keeps the position and the structure version of the map:
+    // once a key gets inserted or erased, the cursor becomes invalidated instead of silently skipping or repeating keys.
+    // Lock order: the cursor first, then its map
+    class map_cursor : public collection_base< map_cursor >
+    {
+    public:
+        enum  {
+            TypeId = CollectionType::MapCursor,
+        };
+
+        // the cursor has no items of its own, for the generic code (paths, copying) it is an empty collection
+        typedef int32_t key_type;
+
+        enum class state : uint32_t {
+            before_first,
+            positioned,
+            finished,
+            invalidated,
+        };
+
+    private:
+        using position_type = boost::variant<boost::blank, map::iterator, form_map::iterator, integer_map::iterator>;
+
+        internal_object_ref _target;
+        position_type _position;
+        uint32_t _version = 0;
+        state _state = state::finished;
+        // a loaded cursor looks its position up by the key at the first use, once all the maps are loaded
+        // and their expired keys are erased. The snapshot copies keep just the key
+        item _loaded_key;
+        bool _restore_pending = false;
+
+        template<class F>
+        static bool u_visit_target(object_base& target, F&& func) {
+            if (auto cnt = target.as<map>()) {
+                func(*cnt);
+            }
+            else if (auto cnt = target.as<form_map>()) {
+                func(*cnt);
+            }
+            else if (auto cnt = target.as<integer_map>()) {
+                func(*cnt);
+            }
+            else {
+                return false;
+            }
+            return true;
+        }
+
+        static void read_key(const item& key, std::string& out) { out = key.readAs<std::string>(); }
+        static void read_key(const item& key, form_ref& out) { out = key.readAs<form_ref>(); }
+        static void read_key(const item& key, int32_t& out) { out = key.readAs<SInt32>(); }
+
+        // the map lock must be held. The cursor becomes invalidated if its key is gone
+        template<class Container>
+        void u_restore_position(Container& container) {
+            _restore_pending = false;
+            _version = container.structure_version();
+            if (_state != state::positioned) {
+                return;
+            }
+
+            typename Container::key_type key;
+            read_key(_loaded_key, key);
+            auto itr = container.find(key);
+            if (itr != container.end()) {
+                _position = itr;
+            }
+            else {
+                _position = boost::blank();
+                _state = state::invalidated;
+            }
+            _loaded_key = item();
+        }
+
+        void u_restore_pending() {
+            if (_restore_pending && _target) {
+                u_visit_target(*_target, [this](auto& cnt) {
+                    object_shared_lock t(cnt);
+                    u_restore_position(cnt.u_container());
+                });
+            }
+        }
+
+    public:
+
+        static bool is_iterable(object_base& target) {
+            return u_visit_target(target, [](auto&) {});
+        }
+
+        // (re)starts the iteration over the @target
+        void reset(object_base& target) {
+            object_lock g(this);
+            _target = &target;
+            _position = boost::blank();
+            _state = state::before_first;
+            _restore_pending = false;
+            _loaded_key = item();
+            u_visit_target(target, [this](auto& cnt) {
+                object_shared_lock t(cnt);
+                _version = cnt.u_container().structure_version();
+            });
+        }
+
+        state get_state() {
+            object_lock g(this);
+            u_restore_pending();
+            return _state;
+        }
+
+        // returns false at the end or if the map has been modified
+        bool next() {
+            object_lock g(this);
+            if (!_target || (_state != state::before_first && _state != state::positioned)) {
+                return false;
+            }
+
+            u_visit_target(*_target, [this](auto& cnt) {
+                object_shared_lock t(cnt);
+                auto& container = cnt.u_container();
+                using iterator = typename std::decay_t<decltype(container)>::iterator;
+
+                if (_restore_pending) {
+                    u_restore_position(container);
+                    if (_state != state::positioned) {
+                        return;
+                    }
+                }
+
+                if (container.structure_version() != _version) {
+                    _state = state::invalidated;
+                    _position = boost::blank();
+                    return;
+                }
+
+                iterator itr = _state == state::before_first ? container.begin() : std::next(boost::get<iterator>(_position));
+                if (itr != container.end()) {
+                    _position = itr;
+                    _state = state::positioned;
+                }
+                else {
+                    _position = boost::blank();
+                    _state = state::finished;
+                }
+            });
+
+            return _state == state::positioned;
+        }
+
+        // calls func(key, value) if the cursor points to a pair of the unmodified map
+        template<class F>
+        bool visit_current(F&& func) {
+            object_lock g(this);
+            if (!_target || _state != state::positioned) {
+                return false;
+            }
+
+            bool visited = false;
+            u_visit_target(*_target, [&](auto& cnt) {
+                object_shared_lock t(cnt);
+                auto& container = cnt.u_container();
+                using iterator = typename std::decay_t<decltype(container)>::iterator;
+
+                if (_restore_pending) {
+                    u_restore_position(container);
+                    if (_state != state::positioned) {
+                        return;
+                    }
+                }
+
+                if (container.structure_version() != _version) {
+                    _state = state::invalidated;
+                    _position = boost::blank();
+                    return;
+                }
+
+                const auto& pair = *boost::get<iterator>(_position);
+                func(pair.first, static_cast<const item&>(pair.second));
+                visited = true;
+            });
+            return visited;
+        }
+
+        void u_copy_from(const map_cursor& other) {
+            _target = other._target;
+            _position = other._position;
+            _version = other._version;
+            _state = other._state;
+            _loaded_key = other._loaded_key;
+            _restore_pending = other._restore_pending;
+        }
+
+        // the key of the pair the cursor points to - iterators can't be stored
+        item u_position_key() const {
+            item key = _loaded_key; // not restored yet or a snapshot copy - there is no position, just the key
+            if (_target && _state == state::positioned && _position.which() != 0) {
+                u_visit_target(*_target, [&](auto& cnt) {
+                    object_shared_lock t(cnt);
+                    using iterator = typename std::decay_t<decltype(cnt.u_container())>::iterator;
+                    key = item(boost::get<iterator>(_position)->first);
+                });
+            }
+            return key;
+        }
+
+        // a copy to be saved while the original keeps iterating. The position of the copy
+        // is never dereferenced, only its key is kept
+        void u_snapshot_from(const map_cursor& other) {
+            _target = other._target;
+            _state = other._state;
+            _loaded_key = other.u_position_key();
+        }
+
+        const item* u_get(int32_t) const { return nullptr; }
+        item* u_get(int32_t) { return nullptr; }
+
+        template<class T>
+        item* u_set(int32_t, T&&) { return nullptr; }
+
+        bool u_erase(int32_t) { return false; }
+
+        // detaches the cursor from its map
+        void u_clear() override {
+            _target = nullptr;
+            _position = boost::blank();
+            _state = state::finished;
+        }
+
+        SInt32 u_count() const override {
+            return 0;
+        }
+
+        void u_onLoaded() override;
+
+        void u_nullifyObjects() override {
+            _target.jc_nullify();
+            _position = boost::blank();
+            _state = state::invalidated;
+        }
+
+        void u_visit_referenced_objects(const std::function<void(object_base&)>& visitor) override {
+            if (_target) {
+                visitor(*_target);
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        friend class boost::serialization::access;
+        BOOST_SERIALIZATION_SPLIT_MEMBER();
+
+        template<class Archive>
+        void load(Archive & ar, const unsigned int version);
+        template<class Archive>
+        void save(Archive & ar, const unsigned int version) const;
+
+        void save_compact(compact_writer& ar) const;
+        void load_compact(compact_reader& ar);
+    };
+
+    // Hash of an item, consistent with the item equality: strings are hashed case-insensitively, -0.0 and 0.0 hash the same
+    struct item_hash {
+        static uint32_t mix(uint64_t value) {
+            value ^= value >> 33;
+            value *= 0xff51afd7ed558ccdull;
+            value ^= value >> 33;
+            value *= 0xc4ceb9fe1a85ec53ull;
+            value ^= value >> 33;
+            return uint32_t(value);
+        }
+
+        uint32_t operator () (const item& itm) const {
+            const uint64_t type = uint64_t(itm.type()) << 56;
+            switch (itm.type()) {
+            case item_type::integer:
+                return mix(type | uint32_t(*itm.get<SInt32>()));
+            case item_type::real: {
+                item::Real value = *itm.get<item::Real>();
+                if (value == 0) {
+                    value = 0;
+                }
+                uint32_t bits;
+                memcpy(&bits, &value, sizeof bits);
+                return mix(type | bits);
+            }
+            case item_type::form: // an expired form equals None, the set gets rebuilt once its forms expire (see item_set::u_onLoaded)
+                return mix(type | uint32_t(itm.get<form_ref>()->get()));
+            case item_type::object:
+                return mix(type ^ reinterpret_cast<uintptr_t>(itm.peek_object()));
+            case item_type::string: {
+                uint64_t hash = 0xcbf29ce484222325ull; // FNV-1a of the lowercase string
+                for (const char *c = itm.get<std::string>()->c_str(); *c; ++c) {
+                    const unsigned char ch = *c;
+                    hash = (hash ^ ((ch >= 'A' && ch <= 'Z') ? ch + ('a' - 'A') : ch)) * 0x100000001b3ull;
+                }
+                return mix(type ^ hash);
+            }
+            default:
+                return mix(type);
+            }
+        }
+    };
+
+    // Unordered collection of unique items (in the item::operator== sense), backed by an open addressing hash table.
+    // For the generic code (paths, JSON references) the items are addressable by their index, read-only:
+    // modifying an item in place would break the table
+    class item_set : public collection_base< item_set >
+    {
+    public:
+        enum  {
+            TypeId = CollectionType::Set,
+        };
+
+        typedef int32_t key_type;
+        typedef util::open_hash_set<item, item_hash> container_type;
+
+    private:
+        container_type _set;
+
+    public:
+
+        container_type& u_container() {
+            return _set;
+        }
+
+        const container_type& u_container() const {
+            return _set;
+        }
+
+        std::vector<item> container_copy() const {
+            object_shared_lock g(this);
+            return _set.values();
+        }
+
+        bool u_contains(const item& value) const {
+            return _set.contains(value);
+        }
+
+        // returns false if the set already has the value
+        template<class T>
+        bool u_add(T&& value) {
+            return _set.insert(std::forward<T>(value)).second;
+        }
+
+        bool u_remove(const item& value) {
+            return _set.erase(value);
+        }
+
+        boost::optional<int32_t> u_convertIndex(int32_t pyIndex) const {
+            int32_t count = (int32_t)_set.size();
+            int32_t index = (pyIndex >= 0 ? pyIndex : (count + pyIndex));
+            return{ index >= 0 && index < count, index };
+        }
+
+        const item* u_get(int32_t index) const {
+            auto idx = u_convertIndex(index);
+            return idx ? &_set[*idx] : nullptr;
+        }
+
+        item* u_get(int32_t) { return nullptr; }
+
+        template<class T>
+        item* u_set(int32_t, T&&) { return nullptr; }
+
+        bool u_erase(int32_t index) {
+            auto idx = u_convertIndex(index);
+            if (idx) {
+                _set.erase_at(*idx);
+                return true;
+            }
+            return false;
+        }
+
+        void u_clear() override {
+            _set.clear();
+        }
+
+        SInt32 u_count() const override {
+            return _set.size();
+        }
+
+        void u_nullifyObjects() override {
+            _set.modify_values([](item& itm) { itm.u_nullifyObject(); });
+        }
+
+        void u_onLoaded() override;
+
+        void u_visit_referenced_objects(const std::function<void(object_base&)>& visitor) override {
+            for (auto& item : _set) {
+                if (auto obj = item.peek_object()) {
+                    visitor(*obj);
+                }
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        friend class boost::serialization::access;
+        BOOST_SERIALIZATION_SPLIT_MEMBER();
+
+        template<class Archive>
+        void load(Archive & ar, const unsigned int version);
+        template<class Archive>
+        void save(Archive & ar, const unsigned int version) const;
+
+        void save_compact(compact_writer& ar) const;
+        void load_compact(compact_reader& ar);
+    };
+
+    // Fixed-capacity circular buffer: pushing the newest item overwrites the oldest one once the buffer is full.
+    // The items are indexed from the newest: 0 is the newest item, 1 the one pushed before it and so on,
+    // a negative index counts from the oldest one (-1 is the oldest)
+    class ring_buffer : public collection_base< ring_buffer >
+    {
+    public:
+        enum  {
+            TypeId = CollectionType::RingBuffer,
+        };
+
+        enum { max_capacity = 1 << 20 };
+
+        typedef int32_t key_type;
+        typedef std::vector<item> container_type;
+
+    private:
+        container_type _storage; // sized to the capacity upfront, unused slots are None
+        uint32_t _next = 0; // the slot the next item goes to
+        uint32_t _count = 0;
+
+        uint32_t physical_index(uint32_t index) const {
+            const uint32_t capacity = (uint32_t)_storage.size();
+            return (_next + capacity - 1 - index) % capacity;
+        }
+
+    public:
+
+        // drops the items
+        void u_reset(uint32_t capacity) {
+            assert(capacity <= max_capacity);
+            container_type(capacity).swap(_storage);
+            _next = 0;
+            _count = 0;
+        }
+
+        uint32_t u_capacity() const {
+            return (uint32_t)_storage.size();
+        }
+
+        // changes the capacity, the oldest items that don't fit get dropped
+        void u_trim(uint32_t capacity) {
+            container_type items = u_items();
+            items.resize((std::min)(items.size(), size_t(capacity)));
+            u_reset(capacity);
+            for (auto itr = items.rbegin(); itr != items.rend(); ++itr) {
+                u_push(std::move(*itr));
+            }
+        }
+
+        template<class T>
+        void u_push(T&& value) {
+            if (_storage.empty()) {
+                return;
+            }
+            _storage[_next] = std::forward<T>(value);
+            _next = (_next + 1) % _storage.size();
+            _count = (std::min)(_count + 1, (uint32_t)_storage.size());
+        }
+
+        // the items from the newest to the oldest
+        container_type u_items() const {
+            container_type items;
+            items.reserve(_count);
+            for (uint32_t i = 0; i < _count; ++i) {
+                items.push_back(_storage[physical_index(i)]);
+            }
+            return items;
+        }
+
+        container_type container_copy() const {
+            object_shared_lock g(this);
+            return u_items();
+        }
+
+        void u_copy_from(const ring_buffer& other) {
+            _storage = other._storage;
+            _next = other._next;
+            _count = other._count;
+        }
+
+        // calls func(item&) for each item, in no particular order
+        template<class F>
+        void u_for_each(F&& func) {
+            for (uint32_t i = 0; i < _count; ++i) {
+                func(_storage[physical_index(i)]);
+            }
+        }
+
+        boost::optional<int32_t> u_convertIndex(int32_t pyIndex) const {
+            int32_t count = (int32_t)_count;
+            int32_t index = (pyIndex >= 0 ? pyIndex : (count + pyIndex));
+            return{ index >= 0 && index < count, index };
+        }
+
+        const item* u_get(int32_t index) const {
+            auto idx = u_convertIndex(index);
+            return idx ? &_storage[physical_index(*idx)] : nullptr;
+        }
+
+        item* u_get(int32_t index) {
+            return const_cast<item*>(const_cast<const ring_buffer*>(this)->u_get(index));
+        }
+
+        template<class T>
+        item* u_set(int32_t index, T&& itm) {
+            auto idx = u_convertIndex(index);
+            if (idx) {
+                return &(_storage[physical_index(*idx)] = std::forward<T>(itm));
+            }
+            return nullptr;
+        }
+
+        // the older items move one position closer to the newest. O(count)
+        bool u_erase(int32_t index) {
+            auto idx = u_convertIndex(index);
+            if (!idx) {
+                return false;
+            }
+            for (uint32_t i = *idx; i + 1 < _count; ++i) {
+                _storage[physical_index(i)] = std::move(_storage[physical_index(i + 1)]);
+            }
+            _storage[physical_index(_count - 1)] = item();
+            --_count;
+            return true;
+        }
+
+        void u_clear() override {
+            u_reset(u_capacity());
+        }
+
+        SInt32 u_count() const override {
+            return _count;
+        }
+
+        void u_nullifyObjects() override {
+            for (auto& item : _storage) {
+                item.u_nullifyObject();
+            }
+        }
+
+        void u_visit_referenced_objects(const std::function<void(object_base&)>& visitor) override {
+            for (auto& item : _storage) {
+                if (auto obj = item.peek_object()) {
+                    visitor(*obj);
+                }
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        friend class boost::serialization::access;
+        BOOST_SERIALIZATION_SPLIT_MEMBER();
+
+        template<class Archive>
+        void load(Archive & ar, const unsigned int version);
+        template<class Archive>
+        void save(Archive & ar, const unsigned int version) const;
+
+        void save_compact(compact_writer& ar) const;
+        void load_compact(compact_reader& ar);
+    };
+
+    // Priority queue: 4-ary heap of (priority, item) entries, the top entry has the lowest (or the highest) priority.
+    // Entries of equal priority leave the queue in the order they were pushed.
+    // Each entry gets a handle which stays valid while the entry is in the queue (its position doesn't).
+    // For the generic code (paths, JSON references) the items are indexed by their heap positions, 0 is the top
+    class priority_heap : public collection_base< priority_heap >
+    {
+    public:
+        enum  {
+            TypeId = CollectionType::PriorityQueue,
+        };
+
+        enum { arity = 4 };
+
+        typedef int32_t key_type;
+
+        struct entry {
+            Float32 priority = 0;
+            uint32_t handle = 0;
+            item value;
+
+            template<class Archive>
+            void serialize(Archive & ar, const unsigned int version) {
+                ar & priority;
+                ar & handle;
+                ar & value;
+            }
+        };
+
+        typedef std::vector<entry> container_type;
+
+    private:
+        container_type _heap;
+        std::unordered_map<uint32_t, uint32_t> _positions; // handle -> heap position
+        uint32_t _next_handle = 1;
+        bool _max_first = false;
+
+        bool before(const entry& left, const entry& right) const {
+            if (left.priority != right.priority) {
+                return _max_first ? left.priority > right.priority : left.priority < right.priority;
+            }
+            return left.handle < right.handle;
+        }
+
+        void place(entry&& e, size_t position) {
+            _positions[e.handle] = (uint32_t)position;
+            _heap[position] = std::move(e);
+        }
+
+        void sift_up(size_t position) {
+            entry e = std::move(_heap[position]);
+            while (position > 0) {
+                const size_t parent = (position - 1) / arity;
+                if (!before(e, _heap[parent])) {
+                    break;
+                }
+                place(std::move(_heap[parent]), position);
+                position = parent;
+            }
+            place(std::move(e), position);
+        }
+
+        void sift_down(size_t position) {
+            entry e = std::move(_heap[position]);
+            const size_t count = _heap.size();
+            for (;;) {
+                const size_t first = position * arity + 1;
+                if (first >= count) {
+                    break;
+                }
+                size_t best = first;
+                for (size_t child = first + 1; child < (std::min)(first + arity, count); ++child) {
+                    if (before(_heap[child], _heap[best])) {
+                        best = child;
+                    }
+                }
+                if (!before(_heap[best], e)) {
+                    break;
+                }
+                place(std::move(_heap[best]), position);
+                position = best;
+            }
+            place(std::move(e), position);
+        }
+
+        void rebuild_positions() {
+            _positions.clear();
+            for (size_t i = 0; i < _heap.size(); ++i) {
+                _positions[_heap[i].handle] = (uint32_t)i;
+            }
+        }
+
+    public:
+
+        bool u_max_first() const { return _max_first; }
+        void u_set_max_first(bool maxFirst) {
+            assert(_heap.empty());
+            _max_first = maxFirst;
+        }
+
+        const container_type& u_container() const {
+            return _heap;
+        }
+
+        // the items in the heap order
+        std::vector<item> container_copy() const {
+            object_shared_lock g(this);
+            std::vector<item> items;
+            items.reserve(_heap.size());
+            for (auto& e : _heap) {
+                items.push_back(e.value);
+            }
+            return items;
+        }
+
+        void u_copy_from(const priority_heap& other) {
+            _heap = other._heap;
+            _positions = other._positions;
+            _next_handle = other._next_handle;
+            _max_first = other._max_first;
+        }
+
+        // returns the handle of the entry, 0 if the @priority is NaN
+        template<class T>
+        uint32_t u_push(T&& value, Float32 priority) {
+            if (priority != priority) {
+                return 0;
+            }
+            const uint32_t handle = _next_handle++;
+            if (_next_handle == 0) { // wrapped around, 0 stays invalid
+                _next_handle = 1;
+            }
+            _heap.push_back(entry{ priority, handle, item(std::forward<T>(value)) });
+            sift_up(_heap.size() - 1);
+            return handle;
+        }
+
+        // appends the entry as is, the caller ensures the heap order (the entries come from a heap). Used by the loaders.
+        // The @handle is kept unless it's 0 or taken: the handles order the entries of equal priority
+        template<class T>
+        void u_push_ordered(T&& value, Float32 priority, uint32_t handle) {
+            if (handle == 0 || u_has_handle(handle)) {
+                handle = _next_handle;
+            }
+            _next_handle = (std::max)(_next_handle, handle + 1);
+            _positions[handle] = (uint32_t)_heap.size();
+            _heap.push_back(entry{ priority, handle, item(std::forward<T>(value)) });
+        }
+
+        const entry* u_top() const {
+            return _heap.empty() ? nullptr : &_heap.front();
+        }
+
+        bool u_pop() {
+            return u_erase(0);
+        }
+
+        bool u_has_handle(uint32_t handle) const {
+            return _positions.find(handle) != _positions.end();
+        }
+
+        bool u_erase_handle(uint32_t handle) {
+            auto itr = _positions.find(handle);
+            return itr != _positions.end() && u_erase((int32_t)itr->second);
+        }
+
+        boost::optional<Float32> u_priority(uint32_t handle) const {
+            auto itr = _positions.find(handle);
+            return itr != _positions.end() ? _heap[itr->second].priority : boost::optional<Float32>();
+        }
+
+        bool u_change_priority(uint32_t handle, Float32 priority) {
+            auto itr = _positions.find(handle);
+            if (itr == _positions.end() || priority != priority) {
+                return false;
+            }
+            const size_t position = itr->second;
+            _heap[position].priority = priority;
+            sift_up(position);
+            if (_positions[handle] == position) {
+                sift_down(position);
+            }
+            return true;
+        }
+
+        boost::optional<int32_t> u_convertIndex(int32_t pyIndex) const {
+            int32_t count = (int32_t)_heap.size();
+            int32_t index = (pyIndex >= 0 ? pyIndex : (count + pyIndex));
+            return{ index >= 0 && index < count, index };
+        }
+
+        const item* u_get(int32_t index) const {
+            auto idx = u_convertIndex(index);
+            return idx ? &_heap[*idx].value : nullptr;
+        }
+
+        item* u_get(int32_t index) {
+            return const_cast<item*>(const_cast<const priority_heap*>(this)->u_get(index));
+        }
+
+        // replaces the item, the priority stays the same
+        template<class T>
+        item* u_set(int32_t index, T&& itm) {
+            auto idx = u_convertIndex(index);
+            if (idx) {
+                return &(_heap[*idx].value = std::forward<T>(itm));
+            }
+            return nullptr;
+        }
+
+        bool u_erase(int32_t index) {
+            auto idx = u_convertIndex(index);
+            if (!idx) {
+                return false;
+            }
+            const size_t position = *idx;
+            _positions.erase(_heap[position].handle);
+            if (position + 1 < _heap.size()) {
+                const uint32_t moved = _heap.back().handle;
+                place(std::move(_heap.back()), position);
+                _heap.pop_back();
+                sift_up(position);
+                if (_positions[moved] == position) {
+                    sift_down(position);
+                }
+            }
+            else {
+                _heap.pop_back();
+            }
+            return true;
+        }
+
+        void u_clear() override {
+            _heap.clear();
+            _positions.clear();
+        }
+
+        SInt32 u_count() const override {
+            return _heap.size();
+        }
+
+        void u_nullifyObjects() override {
+            for (auto& e : _heap) {
+                e.value.u_nullifyObject();
+            }
+        }
+
+        void u_visit_referenced_objects(const std::function<void(object_base&)>& visitor) override {
+            for (auto& e : _heap) {
+                if (auto obj = e.value.peek_object()) {
+                    visitor(*obj);
+                }
+            }
+        }
+
+        // calls func(item&) for each item
+        template<class F>
+        void u_for_each(F&& func) {
+            for (auto& e : _heap) {
+                func(e.value);
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        friend class boost::serialization::access;
+        BOOST_SERIALIZATION_SPLIT_MEMBER();
+
+        template<class Archive>
+        void load(Archive & ar, const unsigned int version);
+        template<class Archive>
+        void save(Archive & ar, const unsigned int version) const;
+
+        void save_compact(compact_writer& ar) const;
+        void load_compact(compact_reader& ar);
     };
 }
@@ -0,0 +1,920 @@
+#include "collections/compact_archive.h"
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+
+#include <boost/iostreams/stream.hpp>
+#include <boost/iostreams/device/array.hpp>
+
+#include "skse/skse.h"
+#include "collections/collections.h"
+
+namespace collections {
+
+    namespace {
+
+        enum {
+            type_bits = 3,
+            max_reserve = 1 << 16, // the counts come from the file - the containers may grow further as the data gets read
+        };
+
+        const item& as_item(const item& itm) { return itm; }
+
+        template<class Pair>
+        const item& pair_value(const Pair& pair) { return pair.second; }
+
+        // the encoded contents of an object, a part of the image data. Retains the objects the contents reference
+        class lazy_object_contents : public lazy_contents {
+        public:
+            lazy_object_contents(std::shared_ptr<lazy_image> image, size_t offset, size_t size, std::vector<internal_object_ref>&& references)
+                : _image(std::move(image))
+                , _offset(offset)
+                , _size(size)
+                , _references(std::move(references))
+            {
+            }
+
+            void u_decode_into(object_base& object) override {
+                compact_reader::decode_contents(*_image, _offset, _size, object);
+            }
+
+            void u_visit_referenced_objects(const std::function<void(object_base&)>& visitor) override {
+                for (auto& ref : _references) {
+                    if (ref) {
+                        visitor(*ref);
+                    }
+                }
+            }
+
+            void u_nullify_references() override {
+                for (auto& ref : _references) {
+                    ref.jc_nullify();
+                }
+            }
+
+        private:
+            std::shared_ptr<lazy_image> _image;
+            size_t _offset;
+            size_t _size;
+            std::vector<internal_object_ref> _references;
+        };
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    compact_writer::compact_writer(std::ostream& stream)
+        : _stream(stream)
+    {
+        _buffer.reserve(buffer_size);
+    }
+
+    compact_writer::compact_writer(compact_writer& frameOwner)
+        : _stream(frameOwner._stream)
+        , _frame_owner(&frameOwner)
+    {
+        _buffer.reserve(buffer_size);
+    }
+
+    compact_writer::~compact_writer() {
+        flush();
+    }
+
+    void compact_writer::flush() {
+        if (!_buffer.empty()) {
+            write_out(_buffer.data(), _buffer.size());
+            _buffer.clear();
+        }
+    }
+
+    void compact_writer::write_out(const char *data, size_t size) {
+        if (_frame_owner) {
+            _frame_owner->write_varint(size);
+            _frame_owner->write_bytes(data, size);
+        }
+        else {
+            _stream.write(data, size);
+        }
+        _written += size;
+    }
+
+    void compact_writer::write_bytes(const char *data, size_t size) {
+        if (_buffer.size() + size > buffer_size) {
+            flush();
+        }
+        if (size > buffer_size) {
+            write_out(data, size);
+        }
+        else {
+            _buffer.insert(_buffer.end(), data, data + size);
+        }
+    }
+
+    void compact_writer::write_varint(uint64_t value) {
+        while (value >= 0x80) {
+            put(char(value | 0x80));
+            value >>= 7;
+        }
+        put(char(value));
+    }
+
+    void compact_writer::write_float(float value) {
+        char bytes[sizeof value];
+        memcpy(bytes, &value, sizeof value);
+        write_bytes(bytes, sizeof bytes);
+    }
+
+    void compact_writer::write_string(const std::string& value) {
+        auto result = _strings.emplace(value, uint32_t(_strings.size()));
+        write_varint(result.first->second);
+        if (result.second) {
+            if (_string_table) {
+                _string_table->push_back(&result.first->first);
+            }
+            else {
+                write_varint(value.size());
+                write_bytes(value.data(), value.size());
+            }
+        }
+    }
+
+    // expired forms are written as None, as the boost archive did
+    void compact_writer::write_form(const form_ref& form) {
+        if (!form) {
+            write_varint(0);
+            return;
+        }
+
+        const uint32_t id = uint32_t(form.get());
+        auto result = _forms.emplace(id, uint32_t(_forms.size() + 1));
+        write_varint(result.first->second);
+        if (result.second) {
+            if (_form_table) {
+                _form_table->push_back(id);
+            }
+            else {
+                write_varint(id);
+            }
+        }
+    }
+
+    std::string compact_writer::with_tables(const std::function<void(compact_writer&)>& save) {
+        std::ostringstream data(std::ios::out | std::ios::binary);
+        std::ostringstream index(std::ios::out | std::ios::binary);
+        std::ostringstream result(std::ios::out | std::ios::binary);
+        {
+            std::vector<uint32_t> forms;
+            std::vector<const std::string *> strings; // the keys of the archive._strings
+            compact_writer indexArchive{ index };
+            compact_writer archive{ data };
+            archive._form_table = &forms;
+            archive._string_table = &strings;
+            archive._index = &indexArchive;
+            save(archive);
+            archive.flush();
+            indexArchive.flush();
+
+            compact_writer tables{ result };
+            write_tables(tables, forms, strings, index.str());
+        }
+        result << data.rdbuf();
+        return result.str();
+    }
+
+    // The index of the contents is the only part held in memory, it's a fraction of the data.
+    // The strings of the tables are the keys of the archive._strings - the archive outlives the tables frame
+    void compact_writer::write_framed_with_tables(const std::function<void(compact_writer&)>& save) {
+        std::vector<uint32_t> forms;
+        std::vector<const std::string *> strings;
+        std::ostringstream index(std::ios::out | std::ios::binary);
+        compact_writer indexArchive{ index };
+        compact_writer archive{ *this };
+        archive._form_table = &forms;
+        archive._string_table = &strings;
+        archive._index = &indexArchive;
+        save(archive);
+        archive.flush();
+        write_varint(0);
+
+        indexArchive.flush();
+        {
+            compact_writer tables{ *this };
+            write_tables(tables, forms, strings, index.str());
+        }
+        write_varint(0);
+    }
+
+    void compact_writer::write_tables(compact_writer& out, const std::vector<uint32_t>& forms,
+        const std::vector<const std::string *>& strings, const std::string& index)
+    {
+        out.write_varint(forms.size());
+        for (auto id : forms) {
+            out.write_varint(id);
+        }
+        out.write_varint(strings.size());
+        for (auto str : strings) {
+            out.write_varint(str->size());
+            out.write_bytes(str->data(), str->size());
+        }
+        out.write_section(index);
+    }
+
+    void compact_writer::write_object(const object_base *object) {
+        if (object && _references) {
+            _references->push_back(object->_serial_index);
+        }
+        if (_object_indices) {
+            auto found = object ? _object_indices->find(object) : _object_indices->end();
+            write_varint(found != _object_indices->end() ? found->second : 0);
+            return;
+        }
+        write_varint(object ? object->_serial_index : 0);
+    }
+
+    void compact_writer::write_section(const std::string& data) {
+        write_varint(data.size());
+        write_bytes(data.data(), data.size());
+    }
+
+    void compact_writer::write_payload(const item& itm) {
+        switch (itm.type()) {
+        case item_type::integer:
+            write_signed(*itm.get<SInt32>());
+            break;
+        case item_type::real:
+            write_float(*itm.get<Float32>());
+            break;
+        case item_type::form:
+            write_form(*itm.get<form_ref>());
+            break;
+        case item_type::object:
+            write_object(itm.get<internal_object_ref>()->get());
+            break;
+        case item_type::string:
+            write_string(*itm.get<std::string>());
+            break;
+        default:
+            break;
+        }
+    }
+
+    template<class It, class Proj>
+    void compact_writer::write_items(It first, It last, Proj proj) {
+        while (first != last) {
+            const item_type type = proj(*first).type();
+            uint64_t count = 0;
+            It runEnd = first;
+            for (; runEnd != last && proj(*runEnd).type() == type; ++runEnd) {
+                ++count;
+            }
+
+            write_varint(count << type_bits | uint64_t(type - item_type::none));
+            for (; first != runEnd; ++first) {
+                write_payload(proj(*first));
+            }
+        }
+    }
+
+    void compact_writer::write_contents(const object_base& object) {
+        if (!_index) {
+            perform_on_object(object, [this](auto& obj) {
+                obj.save_compact(*this);
+            });
+            return;
+        }
+
+        std::vector<uint32_t> references;
+        const uint64_t start = position();
+        _references = &references;
+        perform_on_object(object, [this](auto& obj) {
+            obj.save_compact(*this);
+        });
+        _references = nullptr;
+
+        _index->write_varint(position() - start);
+        _index->write_varint(references.size());
+        for (auto index : references) {
+            _index->write_varint(index);
+        }
+    }
+
+    std::string compact_writer::encode_contents(const object_base& object,
+        const std::unordered_map<const object_base*, uint32_t>& indices, std::vector<uint32_t>& forms)
+    {
+        std::ostringstream data(std::ios::out | std::ios::binary);
+        {
+            compact_writer archive{ data };
+            archive._form_table = &forms;
+            archive._object_indices = &indices;
+            archive.write_contents(object);
+        }
+        return data.str();
+    }
+
+    namespace {
+
+        template<class T>
+        void copy_container(T& copy, const T& original) {
+            copy.u_container() = original.u_container();
+        }
+
+        // the slots are shared, the copy has to get slots of its own
+        void copy_container(counter_map& copy, const counter_map& original) {
+            copy.u_copy_from(original);
+        }
+
+        void copy_container(ring_buffer& copy, const ring_buffer& original) {
+            copy.u_copy_from(original);
+        }
+
+        void copy_container(priority_heap& copy, const priority_heap& original) {
+            copy.u_copy_from(original);
+        }
+
+        void copy_container(map_cursor& copy, const map_cursor& original) {
+            copy.u_snapshot_from(original);
+        }
+    }
+
+    // the contents of a lazily loaded object get decoded into the copy, the object itself stays encoded
+    object_base* compact_writer::copy_contents(object_base& object, uint32_t& sequence) {
+        object_shared_lock g(object);
+        sequence = object.mutex().read_sequence_begin();
+        return u_copy_contents(object);
+    }
+
+    object_base* compact_writer::u_copy_contents(const object_base& object) {
+        return perform_on_object_and_return<object_base*>(object, [](auto& original) -> object_base* {
+            std::unique_ptr<std::decay_t<decltype(original)>> copy{ new std::decay_t<decltype(original)>() };
+            if (auto lazy = original._lazy.load(std::memory_order_acquire)) {
+                lazy->u_decode_into(*copy);
+                copy->u_onLoaded();
+            }
+            else {
+                copy_container(*copy, original);
+            }
+            return copy.release();
+        });
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    compact_reader::compact_reader(std::istream& stream, forms::form_observer& watcher)
+        : _buffer(*stream.rdbuf())
+        , _watcher(watcher)
+    {
+    }
+
+    void compact_reader::fail(const char *what) {
+        throw std::runtime_error(std::string("compact archive: ") + what);
+    }
+
+    char compact_reader::get() {
+        const auto c = _buffer.sbumpc();
+        if (c == std::streambuf::traits_type::eof()) {
+            fail("unexpected end of data");
+        }
+        return std::streambuf::traits_type::to_char_type(c);
+    }
+
+    uint64_t compact_reader::read_varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uint8_t byte = uint8_t(get());
+            value |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        fail("malformed varint");
+    }
+
+    uint32_t compact_reader::read_uint32() {
+        const uint64_t value = read_varint();
+        if (value > UINT32_MAX) {
+            fail("32-bit value expected");
+        }
+        return uint32_t(value);
+    }
+
+    size_t compact_reader::read_count() {
+        return read_uint32();
+    }
+
+    float compact_reader::read_float() {
+        char bytes[sizeof(float)];
+        if (_buffer.sgetn(bytes, sizeof bytes) != sizeof bytes) {
+            fail("unexpected end of data");
+        }
+        float value;
+        memcpy(&value, bytes, sizeof value);
+        return value;
+    }
+
+    bool compact_reader::read_bool() {
+        return get() != 0;
+    }
+
+    const std::string& compact_reader::read_string() {
+        const uint32_t index = read_uint32();
+        if (index < _strings.size()) {
+            return _strings[index];
+        }
+        if (_string_table || index != _strings.size()) {
+            fail("invalid string index");
+        }
+
+        std::string value;
+        read_bytes(value, read_count());
+
+        _strings.push_back(std::move(value));
+        return _strings.back();
+    }
+
+    std::string compact_reader::read_section() {
+        std::string data;
+        read_bytes(data, read_count());
+        return data;
+    }
+
+    std::string compact_reader::read_frame() {
+        std::string data;
+        for (size_t size = read_count(); size > 0; size = read_count()) {
+            read_bytes(data, size);
+        }
+        return data;
+    }
+
+    void compact_reader::read_bytes(std::string& value, size_t size) {
+        value.reserve((std::min)(size, size_t(max_reserve)));
+        char chunk[256];
+        for (size_t left = size; left > 0;) {
+            const auto part = (std::min)(left, sizeof chunk);
+            if (_buffer.sgetn(chunk, part) != std::streamsize(part)) {
+                fail("unexpected end of data");
+            }
+            value.append(chunk, part);
+            left -= part;
+        }
+    }
+
+    // the form gets resolved once, at its first occurrence. The forms of the plugins removed from the load order become None
+    form_ref compact_reader::read_form() {
+        const uint32_t index = read_uint32();
+        if (index == 0) {
+            return form_ref();
+        }
+        if (index <= _forms.size()) {
+            return _forms[index - 1];
+        }
+        if (_form_table || index != _forms.size() + 1) {
+            fail("invalid form index");
+        }
+
+        const auto id = skse::resolve_handle(util::to_enum<FormId>(read_uint32()));
+        _forms.push_back(id != FormId::Zero ? form_ref(id, _watcher) : form_ref());
+        return _forms.back();
+    }
+
+    // skse::resolve_handles groups the forms by plugin: the mod index remapping is looked up once per plugin
+    void compact_reader::read_tables() {
+        const size_t count = read_count();
+        std::vector<FormId> ids;
+        ids.reserve((std::min)(count, size_t(max_reserve)));
+        for (size_t i = 0; i < count; ++i) {
+            ids.push_back(util::to_enum<FormId>(read_uint32()));
+        }
+
+        skse::resolve_handles(ids.data(), ids.size());
+
+        _forms.clear();
+        _forms.reserve(ids.size());
+        for (auto id : ids) {
+            _forms.push_back(id != FormId::Zero ? form_ref(id, _watcher) : form_ref());
+        }
+        _form_table = true;
+
+        const size_t stringCount = read_count();
+        _strings.clear();
+        _strings.reserve((std::min)(stringCount, size_t(max_reserve)));
+        for (size_t i = 0; i < stringCount; ++i) {
+            std::string value;
+            read_bytes(value, read_count());
+            _strings.push_back(std::move(value));
+        }
+        _string_table = true;
+
+        _contents_index = read_section();
+    }
+
+    void compact_reader::read_tables(std::istream& tables) {
+        compact_reader source{ tables, _watcher };
+        source.read_tables();
+        _forms.swap(source._forms);
+        _strings.swap(source._strings);
+        _contents_index.swap(source._contents_index);
+        _form_table = true;
+        _string_table = true;
+    }
+
+    void compact_reader::read_lazily(std::shared_ptr<lazy_image> image) {
+        jc_assert(_string_table);
+        _image = std::move(image);
+    }
+
+    void compact_reader::read_contents_lazily(size_t count) {
+        namespace io = boost::iostreams;
+
+        auto& image = *_image;
+        image.strings = _strings;
+        image.forms = _forms;
+        image.objects = _objects;
+        image.watcher = &_watcher;
+
+        io::stream<io::array_source> indexStream(io::array_source(_contents_index.data(), _contents_index.size()));
+        compact_reader index{ indexStream, _watcher };
+
+        std::streamoff offset = _buffer.pubseekoff(0, std::ios::cur, std::ios::in);
+        if (offset < 0) {
+            fail("the image isn't seekable");
+        }
+
+        std::vector<object_base*> cursors;
+        for (size_t objectNumber = 0; objectNumber < count; ++objectNumber) {
+            object_base *obj = _objects[objectNumber];
+            const size_t size = index.read_count();
+            if (size > image.data.size() - size_t(offset)) {
+                fail("invalid contents size");
+            }
+
+            std::vector<internal_object_ref> references;
+            const size_t referenceCount = index.read_count();
+            references.reserve((std::min)(referenceCount, size_t(max_reserve)));
+            for (size_t i = 0; i < referenceCount; ++i) {
+                const uint32_t objectIndex = index.read_uint32();
+                if (objectIndex == 0 || objectIndex > _objects.size()) {
+                    fail("invalid object index");
+                }
+                references.emplace_back(_objects[objectIndex - 1]);
+            }
+
+            if (obj->as<map_cursor>()) {
+                read_contents(*obj);
+                cursors.push_back(obj);
+            }
+            else {
+                obj->_lazy.store(new lazy_object_contents(_image, size_t(offset), size, std::move(references)), std::memory_order_relaxed);
+            }
+
+            offset += size;
+            if (std::streamoff(_buffer.pubseekpos(offset, std::ios::in)) != offset) {
+                fail("unexpected end of data");
+            }
+        }
+
+        for (auto cursor : cursors) {
+            cursor->u_visit_referenced_objects([](object_base& target) {
+                target.u_materialize();
+            });
+        }
+    }
+
+    // The tables are swapped into the reader and back: the decoding of the objects of an image is serialized
+    void compact_reader::decode_contents(lazy_image& image, size_t offset, size_t size, object_base& object) {
+        namespace io = boost::iostreams;
+
+        io::stream<io::array_source> stream(io::array_source(image.data.data() + offset, size));
+        compact_reader reader{ stream, *image.watcher };
+        reader._form_table = true;
+        reader._string_table = true;
+
+        std::lock_guard<std::mutex> g(image.mutex);
+        auto swapTables = [&]() {
+            reader._strings.swap(image.strings);
+            reader._forms.swap(image.forms);
+            reader._objects.swap(image.objects);
+        };
+
+        swapTables();
+        try {
+            reader.read_contents(object);
+        }
+        catch (...) {
+            swapTables();
+            throw;
+        }
+        swapTables();
+    }
+
+    object_base* compact_reader::read_object() {
+        const uint32_t index = read_uint32();
+        if (index > _objects.size()) {
+            fail("invalid object index");
+        }
+        return index ? _objects[index - 1] : nullptr;
+    }
+
+    item compact_reader::read_payload(uint32_t type) {
+        switch (type + item_type::none) {
+        case item_type::integer:
+            return item(SInt32(read_signed()));
+        case item_type::real:
+            return item(read_float());
+        case item_type::form:
+            return item(read_form());
+        case item_type::object:
+            return item(read_object());
+        case item_type::string:
+            return item(read_string());
+        default:
+            return item();
+        }
+    }
+
+    template<class Sink>
+    void compact_reader::read_items(size_t count, Sink&& sink) {
+        while (count > 0) {
+            const uint64_t header = read_varint();
+            const uint64_t run = header >> type_bits;
+            const uint32_t type = uint32_t(header & ((1 << type_bits) - 1));
+            if (run == 0 || run > count || type > item_type::string - item_type::none) {
+                fail("malformed item run");
+            }
+
+            count -= size_t(run);
+            for (uint64_t i = 0; i < run; ++i) {
+                sink(read_payload(type));
+            }
+        }
+    }
+
+    object_base* compact_reader::make_object(CollectionType type) {
+        switch (type) {
+        case array::TypeId: return new array();
+        case map::TypeId: return new map();
+        case form_map::TypeId: return new form_map();
+        case integer_map::TypeId: return new integer_map();
+        case counter_map::TypeId: return new counter_map();
+        case map_cursor::TypeId: return new map_cursor();
+        case item_set::TypeId: return new item_set();
+        case ring_buffer::TypeId: return new ring_buffer();
+        case priority_heap::TypeId: return new priority_heap();
+        default:
+            fail("unknown object type");
+        }
+    }
+
+    void compact_reader::read_contents(object_base& object) {
+        perform_on_object(object, [this](auto& obj) {
+            obj.load_compact(*this);
+        });
+    }
+
+    void compact_reader::clone_contents(object_base& source, object_base& target, std::vector<object_base*>& created) {
+        std::unordered_set<const object_base*> path;
+        clone_contents(source, target, created, path);
+    }
+
+    // The references of the @source are the objects of the table of the reader that decodes the copy
+    void compact_reader::clone_contents(object_base& source, object_base& target, std::vector<object_base*>& created,
+        std::unordered_set<const object_base*>& path)
+    {
+        if (!path.insert(&source).second) {
+            fail("the copied subtree has a cycle");
+        }
+        source.u_materialize();
+
+        std::unordered_map<const object_base*, uint32_t> indices;
+        std::vector<object_base*> copies;
+        source.u_visit_referenced_objects([&](object_base& child) {
+            if (indices.emplace(&child, uint32_t(copies.size() + 1)).second) {
+                object_base *copy = make_object(child.type());
+                created.push_back(copy);
+                clone_contents(child, *copy, created, path);
+                copies.push_back(copy);
+            }
+        });
+
+        namespace io = boost::iostreams;
+        std::vector<uint32_t> forms;
+        const std::string data = compact_writer::encode_contents(source, indices, forms);
+        io::stream<io::array_source> stream(io::array_source(data.data(), data.size()));
+
+        // the forms are resolved already
+        compact_reader reader{ stream, _watcher };
+        reader._form_table = true;
+        reader._forms.reserve(forms.size());
+        for (auto id : forms) {
+            reader._forms.push_back(form_ref(util::to_enum<FormId>(id), _watcher));
+        }
+        reader._objects = std::move(copies);
+        reader.read_contents(target);
+
+        path.erase(&source);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    void array::save_compact(compact_writer& ar) const {
+        ar.write_varint(_array.size());
+        ar.write_items(_array.begin(), _array.end(), as_item);
+    }
+
+    void array::load_compact(compact_reader& ar) {
+        const size_t count = ar.read_count();
+        _array.clear();
+        _array.reserve((std::min)(count, size_t(max_reserve)));
+        ar.read_items(count, [this](item&& itm) {
+            _array.push_back(std::move(itm));
+        });
+    }
+
+    // the keys go first, then the values - as the runs of items
+    void map::save_compact(compact_writer& ar) const {
+        ar.write_varint(cnt.size());
+        for (auto& pair : cnt) {
+            ar.write_string(pair.first);
+        }
+        ar.write_items(cnt.begin(), cnt.end(), pair_value<value_type>);
+    }
+
+    void map::load_compact(compact_reader& ar) {
+        const size_t count = ar.read_count();
+        std::vector<std::string> keys;
+        keys.reserve((std::min)(count, size_t(max_reserve)));
+        for (size_t i = 0; i < count; ++i) {
+            keys.push_back(ar.read_string());
+        }
+
+        auto key = keys.begin();
+        ar.read_items(count, [&](item&& itm) {
+            cnt.try_emplace(std::move(*key++), std::move(itm));
+        });
+    }
+
+    // the pairs of the expired forms are dropped, as form_map::u_onLoaded would do
+    void form_map::save_compact(compact_writer& ar) const {
+        ar.write_varint(cnt.size());
+        for (auto& pair : cnt) {
+            ar.write_form(pair.first);
+        }
+        ar.write_items(cnt.begin(), cnt.end(), pair_value<value_type>);
+    }
+
+    void form_map::load_compact(compact_reader& ar) {
+        const size_t count = ar.read_count();
+        std::vector<form_ref> keys;
+        keys.reserve((std::min)(count, size_t(max_reserve)));
+        for (size_t i = 0; i < count; ++i) {
+            keys.push_back(ar.read_form());
+        }
+
+        auto key = keys.begin();
+        ar.read_items(count, [&](item&& itm) {
+            if (*key) {
+                cnt.try_emplace(std::move(*key), std::move(itm));
+            }
+            ++key;
+        });
+    }
+
+    // the keys are ascending, so the differences between them are stored
+    void integer_map::save_compact(compact_writer& ar) const {
+        ar.write_varint(cnt.size());
+        uint32_t previous = 0;
+        for (auto& pair : cnt) {
+            ar.write_varint(uint32_t(pair.first) - previous);
+            previous = uint32_t(pair.first);
+        }
+        ar.write_items(cnt.begin(), cnt.end(), pair_value<value_type>);
+    }
+
+    void integer_map::load_compact(compact_reader& ar) {
+        const size_t count = ar.read_count();
+        std::vector<int32_t> keys;
+        keys.reserve((std::min)(count, size_t(max_reserve)));
+        uint32_t previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            previous += ar.read_uint32();
+            keys.push_back(int32_t(previous));
+        }
+
+        auto key = keys.begin();
+        ar.read_items(count, [&](item&& itm) {
+            cnt.try_emplace(*key++, std::move(itm));
+        });
+    }
+
+    void counter_map::save_compact(compact_writer& ar) const {
+        const snapshot_type values = u_snapshot();
+        ar.write_varint(values.size());
+        for (auto& pair : values) {
+            ar.write_string(pair.first);
+        }
+        ar.write_items(values.begin(), values.end(), pair_value<snapshot_type::value_type>);
+    }
+
+    void counter_map::load_compact(compact_reader& ar) {
+        const size_t count = ar.read_count();
+        std::vector<std::string> keys;
+        keys.reserve((std::min)(count, size_t(max_reserve)));
+        for (size_t i = 0; i < count; ++i) {
+            keys.push_back(ar.read_string());
+        }
+
+        auto key = keys.begin();
+        ar.read_items(count, [&](item&& itm) {
+            u_find_slot(*key++, true)->store(itm);
+        });
+    }
+
+    void map_cursor::save_compact(compact_writer& ar) const {
+        ar.write_object(_target.get());
+        ar.write_varint(uint32_t(_state));
+        const item key = u_position_key();
+        ar.write_items(&key, &key + 1, as_item);
+    }
+
+    void map_cursor::load_compact(compact_reader& ar) {
+        _target = ar.read_object();
+        const uint32_t stateValue = ar.read_uint32();
+        if (stateValue > uint32_t(state::invalidated)) {
+            compact_reader::fail("invalid cursor state");
+        }
+        _state = static_cast<state>(stateValue);
+        ar.read_items(1, [this](item&& key) { _loaded_key = std::move(key); });
+    }
+
+    void item_set::save_compact(compact_writer& ar) const {
+        ar.write_varint(_set.size());
+        ar.write_items(_set.begin(), _set.end(), as_item);
+    }
+
+    void item_set::load_compact(compact_reader& ar) {
+        const size_t count = ar.read_count();
+        std::vector<item> values;
+        values.reserve((std::min)(count, size_t(max_reserve)));
+        ar.read_items(count, [&](item&& itm) {
+            values.push_back(std::move(itm));
+        });
+        _set.assign(std::move(values));
+    }
+
+    // from the newest item to the oldest one
+    void ring_buffer::save_compact(compact_writer& ar) const {
+        const container_type items = u_items();
+        ar.write_varint(u_capacity());
+        ar.write_varint(items.size());
+        ar.write_items(items.begin(), items.end(), as_item);
+    }
+
+    void ring_buffer::load_compact(compact_reader& ar) {
+        const uint32_t capacity = ar.read_uint32();
+        const size_t count = ar.read_count();
+        container_type items;
+        items.reserve((std::min)(count, size_t(max_reserve)));
+        ar.read_items(count, [&](item&& itm) {
+            items.push_back(std::move(itm));
+        });
+
+        u_reset((std::min)(capacity, uint32_t(max_capacity)));
+        for (auto itr = items.rbegin(); itr != items.rend(); ++itr) {
+            u_push(std::move(*itr));
+        }
+    }
+
+    // in the heap order: the priorities and the handles, then the values
+    void priority_heap::save_compact(compact_writer& ar) const {
+        ar.write_bool(_max_first);
+        ar.write_varint(_next_handle);
+        ar.write_varint(_heap.size());
+        for (auto& e : _heap) {
+            ar.write_float(e.priority);
+            ar.write_varint(e.handle);
+        }
+        ar.write_items(_heap.begin(), _heap.end(), [](const entry& e) -> const item& { return e.value; });
+    }
+
+    void priority_heap::load_compact(compact_reader& ar) {
+        _max_first = ar.read_bool();
+        _next_handle = ar.read_uint32();
+        const size_t count = ar.read_count();
+        _heap.clear();
+        _heap.reserve((std::min)(count, size_t(max_reserve)));
+        for (size_t i = 0; i < count; ++i) {
+            entry e;
+            e.priority = ar.read_float();
+            e.handle = ar.read_uint32();
+            _heap.push_back(std::move(e));
+        }
+
+        auto e = _heap.begin();
+        ar.read_items(count, [&](item&& itm) {
+            (e++)->value = std::move(itm);
+        });
+        rebuild_positions();
+    }
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <iosfwd>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdint.h>
+
+#include "forms/form_observer.h"
+#include "object/object_base.h"
+
+namespace collections {
+
+    class item;
+
+    using forms::form_ref;
+
+    // The save format of the versions past serialization_version::pre_compact_format, replaces the boost binary archive.
+    // Written and read in a single pass, no pointer tracking:
+    // - integers are LEB128 varints, the signed ones are zigzag-encoded first
+    // - strings and forms are written in full once, at their first occurrence. Every occurrence starts with an index
+    //   into the table the reader builds along the way, the next unused index introduces a new entry.
+    //   Strings are 0-based, forms are 1-based: 0 is None
+    //   A save writes the forms and the strings of a domain as the tables instead, the reader resolves the forms at once.
+    //   The tables are followed by the index of the contents: any object may be decoded on its own (see with_tables)
+    // - objects are 1-based indices into the object table of the domain being written (object_base::_serial_index), 0 is null
+    // - sequences of items are written as runs of the items of the same type, the type is stored once per run
+    class compact_writer {
+    public:
+        explicit compact_writer(std::ostream& stream);
+        compact_writer(const compact_writer&) = delete;
+        ~compact_writer();
+
+        // the data the @save writes, preceded by its tables:
+        //   [form count] [form ids] [string count] [strings] [index section] [data]
+        // The data refers to the forms and the strings by their indices into the tables. The index has an entry per
+        // write_contents call: [size of the contents] [count of the object references] [object indices]
+        static std::string with_tables(const std::function<void(compact_writer&)>& save);
+        // The with_tables for the data too big to be held in memory: the data the @save writes goes out as a frame
+        // as it gets written, the tables follow as a frame of their own: [data frame] [tables frame].
+        // A frame is a sequence of the chunks, [size] [bytes], ended by an empty one. The tables frame is
+        // the header of the with_tables: [form count] [form ids] [string count] [strings] [index section]
+        void write_framed_with_tables(const std::function<void(compact_writer&)>& save);
+
+        void write_varint(uint64_t value);
+        void write_signed(int64_t value) { write_varint((uint64_t(value) << 1) ^ uint64_t(value >> 63)); }
+        void write_float(float value);
+        void write_bool(bool value) { put(value ? 1 : 0); }
+
+        void write_string(const std::string& value);
+        void write_form(const form_ref& form);
+        void write_object(const object_base *object);
+        // a length-prefixed block of bytes, usually written by a compact_writer of its own:
+        // the block has its own tables then, the reader can skip it or decode it separately
+        void write_section(const std::string& data);
+
+        // the count of the items isn't written, @proj maps the elements to the items.
+        // Defined in the compact_archive.cpp, along with the save_compact of the collections
+        template<class It, class Proj>
+        void write_items(It first, It last, Proj proj);
+
+        // the type-specific part of the object
+        void write_contents(const object_base& object);
+
+        // The contents of the @object on their own: the object references are the @indices of the objects (0 for
+        // the rest), the forms are the 1-based indices into the @forms the call appends to. The strings are inline.
+        // Hashing these tells whether the contents are identical (see object_context::objects_snapshot::deduplicate)
+        static std::string encode_contents(const object_base& object,
+            const std::unordered_map<const object_base*, uint32_t>& indices, std::vector<uint32_t>& forms);
+
+        // an unregistered copy of the type-specific part, taken under the object's lock: the write_contents of the copy
+        // writes the object's state at the moment of the copying while the object keeps changing.
+        // The @sequence is the write sequence of the copied state
+        static object_base* copy_contents(object_base& object, uint32_t& sequence);
+        // the copy_contents for the caller that holds the lock already
+        static object_base* u_copy_contents(const object_base& object);
+
+        void flush();
+
+        // the count of the bytes written so far
+        uint64_t position() const { return _written + _buffer.size(); }
+
+    private:
+        enum { buffer_size = 1 << 16 };
+
+        // writes the buffered data as the chunks of the frame of the @frameOwner
+        explicit compact_writer(compact_writer& frameOwner);
+
+        void put(char c) {
+            if (_buffer.size() == buffer_size) {
+                flush();
+            }
+            _buffer.push_back(c);
+        }
+
+        void write_bytes(const char *data, size_t size);
+        void write_out(const char *data, size_t size);
+        void write_payload(const item& itm);
+        static void write_tables(compact_writer& out, const std::vector<uint32_t>& forms,
+            const std::vector<const std::string *>& strings, const std::string& index);
+
+        std::ostream& _stream;
+        std::vector<char> _buffer;
+        std::unordered_map<std::string, uint32_t> _strings;
+        std::unordered_map<uint32_t, uint32_t> _forms; // FormId -> index
+        uint64_t _written = 0;
+        // the tables of the with_tables, the data has neither form ids nor strings then
+        std::vector<uint32_t> *_form_table = nullptr;
+        std::vector<const std::string *> *_string_table = nullptr;
+        compact_writer *_index = nullptr;
+        std::vector<uint32_t> *_references = nullptr; // of the contents being written
+        compact_writer *_frame_owner = nullptr;
+        const std::unordered_map<const object_base*, uint32_t> *_object_indices = nullptr; // replace the _serial_index
+    };
+
+    // The data of a domain read lazily along with its tables, shared by the objects whose contents aren't decoded yet
+    // (see compact_reader::read_lazily)
+    struct lazy_image {
+        std::string data;
+        std::vector<std::string> strings;
+        std::vector<form_ref> forms;
+        std::vector<object_base*> objects;
+        forms::form_observer *watcher = nullptr;
+        std::mutex mutex; // the tables are lent to one decoding reader at a time
+    };
+
+    // Throws std::runtime_error if the data is truncated or malformed
+    class compact_reader {
+    public:
+        compact_reader(std::istream& stream, forms::form_observer& watcher);
+
+        uint64_t read_varint();
+        uint32_t read_uint32();
+        int64_t read_signed() {
+            const uint64_t value = read_varint();
+            return int64_t(value >> 1) ^ -int64_t(value & 1);
+        }
+        float read_float();
+        bool read_bool();
+
+        // a count of the elements that follow. Never trust it enough to reserve that much memory
+        size_t read_count();
+
+        // the reference is valid until the next read
+        const std::string& read_string();
+        form_ref read_form();
+        object_base* read_object();
+        // the block the write_section has written
+        std::string read_section();
+        // the chunks of a frame the write_framed_with_tables has written, joined
+        std::string read_frame();
+
+        // reads the tables the compact_writer::with_tables writes ahead of the data. The forms get resolved
+        // as a batch (skse::resolve_handles), the read_form of the data that follows just indexes the table
+        void read_tables();
+        // reads the tables frame of the compact_writer::write_framed_with_tables, the @tables are its chunks joined
+        void read_tables(std::istream& tables);
+
+        // The contents of the objects get decoded on demand (object_base::materialize), the read_contents_lazily
+        // just skips them. The reader has to read the @image data. Requires the read_tables
+        void read_lazily(std::shared_ptr<lazy_image> image);
+        bool is_lazy() const { return _image != nullptr; }
+        // the contents of the first @count objects of the table. The cursors and their maps get decoded right away:
+        // a cursor accesses the contents of its map directly
+        void read_contents_lazily(size_t count);
+        static void decode_contents(lazy_image& image, size_t offset, size_t size, object_base& object);
+
+        // calls sink(item&&) @count times
+        template<class Sink>
+        void read_items(size_t count, Sink&& sink);
+
+        // creates a new object to be filled by the read_contents
+        object_base* make_object(CollectionType type);
+        void read_contents(object_base& object);
+
+        // Decodes the contents of the @source into the @target, the objects the @source references get copied as well,
+        // down to the leaves. The copies are appended to the @created. Each object of the @source subtree has to be
+        // referenced by its parent only, as the copies are
+        void clone_contents(object_base& source, object_base& target, std::vector<object_base*>& created);
+
+        // the object table of the domain being read, the read_object indexes it
+        std::vector<object_base*>& objects() { return _objects; }
+
+        [[noreturn]] static void fail(const char *what);
+
+    private:
+        char get();
+        void read_bytes(std::string& value, size_t size);
+        item read_payload(uint32_t type);
+        void clone_contents(object_base& source, object_base& target, std::vector<object_base*>& created,
+            std::unordered_set<const object_base*>& path);
+
+        std::streambuf& _buffer;
+        forms::form_observer& _watcher;
+        std::vector<std::string> _strings;
+        std::vector<form_ref> _forms;
+        bool _form_table = false;
+        bool _string_table = false;
+        std::string _contents_index;
+        std::vector<object_base*> _objects;
+        std::shared_ptr<lazy_image> _image;
+    };
+}
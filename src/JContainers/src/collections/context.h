@@ -73,6 +73,14 @@ namespace collections
 
         void read_from_stream(std::istream & stream);
         void write_to_stream(std::ostream& stream);
+        // same output, but the activity is stopped just for the time the snapshot is taken,
+        // the snapshot gets encoded on a separate thread
+        void write_to_stream_in_background(std::ostream& stream);
+
+        // the saves are compressed with util::lz_compressor, opt-in. The flag is stored in the header, so either kind loads
+        bool compress_saves = false;
+        // the full saves write the identical subtrees once (see objects_snapshot::deduplicate)
+        bool deduplicate_saves = false;
 
         void read_from_string(const std::string & data);
         std::string write_to_string();
@@ -81,6 +89,22 @@ namespace collections
         template<class Archive> void save(Archive & ar, unsigned int version) const;
         template<class Archive> void load_data_in_old_way(Archive& ar);
 
+        void save_compact(compact_writer& ar) const;
+        void load_compact(compact_reader& ar);
+
+        struct snapshot {
+            std::unique_ptr<objects_snapshot> objects;
+            Handle root = Handle::Null;
+        };
+
+        snapshot u_take_snapshot(bool copyOnWrite, snapshot_kind kind = snapshot_kind::full) const;
+        static void save_compact(compact_writer& ar, const snapshot& state);
+
+        // see object_context::save_compact_delta
+        static void save_compact_delta(compact_writer& ar, const snapshot& state);
+        static void read_base(compact_reader& ar, loaded_base& loaded);
+        void load_compact_delta(compact_reader& ar, loaded_base& loaded);
+
         void clearState();
         // complete shutdown, this context shouldn't be used for now
         void shutdown();
@@ -1,6 +1,9 @@
 #include <boost/iostreams/stream.hpp>
 #include <boost/iostreams/device/array.hpp>
 #include "util/singleton.h"
+#include "util/lz_codec.h"
+#include "util/background_writer.h"
+#include "collections/compact_archive.h"
 
 #include "jansson.h"
 
@@ -16,16 +19,19 @@ namespace collections {
     struct header {
 
         serialization_version commonVersion;
+        bool compressed; // the data following the header goes through util::lz_compressor
 
         static header imitate_old_header() {
-            return{ serialization_version::no_header };
+            return{ serialization_version::no_header, false };
         }
 
         static header make() {
-            return{ serialization_version::current };
+            return{ serialization_version::current, false };
         }
 
         static const char *common_version_key() { return "commonVersion"; }
+        static const char *compression_key() { return "compression"; }
+        static const char *lz_compression() { return "lz"; }
 
         static header read_from_stream(std::istream & stream) {
 
@@ -40,19 +46,26 @@ namespace collections {
                 return imitate_old_header();
             }
 
-            return{ (serialization_version)json_integer_value(json_object_get(js.get(), common_version_key())) };
+            const char *compression = json_string_value(json_object_get(js.get(), compression_key()));
+            return{
+                (serialization_version)json_integer_value(json_object_get(js.get(), common_version_key())),
+                compression && strcmp(compression, lz_compression()) == 0,
+            };
         }
 
-        static auto write_to_json() -> decltype(make_unique_ptr((json_t *)nullptr, &json_decref)) {
+        static auto write_to_json(bool compressed) -> decltype(make_unique_ptr((json_t *)nullptr, &json_decref)) {
             auto header = make_unique_ptr(json_object(), &json_decref);
 
             json_object_set(header.get(), common_version_key(), json_integer((json_int_t)serialization_version::current));
+            if (compressed) {
+                json_object_set_new(header.get(), compression_key(), json_string(lz_compression()));
+            }
 
             return header;
         }
 
-        static void write_to_stream(std::ostream & stream) {
-            auto header = write_to_json();
+        static void write_to_stream(std::ostream & stream, bool compressed) {
+            auto header = write_to_json(compressed);
             auto data = make_unique_ptr(json_dumps(header.get(), 0), free);
 
             uint32_t hdrSize = strlen(data.get());
@@ -97,7 +110,7 @@ namespace collections {
                         throw std::logic_error(error.str());
                     }
 
-                    {
+                    if (hdr.commonVersion <= serialization_version::pre_compact_format) {
                         hack::iarchive_with_blob real_archive(stream, *this, *this);
                         boost::archive::binary_iarchive& archive = real_archive;
 
@@ -107,6 +120,19 @@ namespace collections {
                             archive >> *this;
                         }
                     }
+                    else {
+                        auto load = [this, &hdr](std::istream& in) {
+                            compact_reader archive{ in, _form_watcher };
+                            archive.read_tables();
+                            load_compact(archive);
+                        };
+                        if (hdr.compressed) {
+                            util::lz_decompress_stream(stream, load);
+                        }
+                        else {
+                            load(stream);
+                        }
+                    }
 
                     u_postLoadInitializations();
                     u_applyUpdates(hdr.commonVersion);
@@ -133,6 +159,23 @@ namespace collections {
         }
     }
 
+    namespace {
+        void write_snapshot(std::ostream& stream, const tes_context::snapshot& state, bool compressed) {
+            auto save = [&state](std::ostream& out) {
+                const std::string data = compact_writer::with_tables([&state](compact_writer& archive) {
+                    tes_context::save_compact(archive, state);
+                });
+                out.write(data.data(), data.size());
+            };
+            if (compressed) {
+                util::lz_compress_stream(stream, save);
+            }
+            else {
+                save(stream);
+            }
+        }
+    }
+
     void tes_context::write_to_stream(std::ostream& stream) {
 
         stream.flags(stream.flags() | std::ios::binary);
@@ -144,11 +187,32 @@ namespace collections {
                 _form_watcher.u_remove_expired_forms();
             }
 
-            header::write_to_stream(stream);
-            boost::archive::binary_oarchive arch{ stream };
-            arch << *this;
+            const auto state = u_take_snapshot(false);
+            header::write_to_stream(stream, compress_saves);
+            write_snapshot(stream, state, compress_saves);
+            record_save_stats(*state.objects);
+            u_print_stats();
+        }
+    }
+
+    void tes_context::write_to_stream_in_background(std::ostream& stream) {
+
+        stream.flags(stream.flags() | std::ios::binary);
+
+        snapshot state;
+        {
+            activity_stopper s{ *this };
+            _form_watcher.u_remove_expired_forms();
+            state = u_take_snapshot(true);
             u_print_stats();
         }
+
+        const bool compressed = compress_saves;
+        util::write_in_background(stream, [&](std::ostream& out) {
+            header::write_to_stream(out, compressed);
+            write_snapshot(out, state, compressed);
+        });
+        record_save_stats(*state.objects);
     }
 
     void tes_context::u_print_stats() const {
@@ -188,6 +252,43 @@ namespace collections {
         //ar << _form_watcher;
     }
 
+    tes_context::snapshot tes_context::u_take_snapshot(bool copyOnWrite, snapshot_kind kind) const {
+        snapshot state;
+        state.root = _root_object_id.load(std::memory_order_relaxed);
+        state.objects = base::u_take_snapshot(copyOnWrite, kind);
+        state.objects->deduplicate = deduplicate_saves;
+        return state;
+    }
+
+    void tes_context::save_compact(compact_writer& ar, const snapshot& state) {
+        base::save_compact(ar, *state.objects);
+        ar.write_varint((HandleT)state.root);
+    }
+
+    void tes_context::save_compact(compact_writer& ar) const {
+        save_compact(ar, u_take_snapshot(false));
+    }
+
+    void tes_context::save_compact_delta(compact_writer& ar, const snapshot& state) {
+        base::save_compact_delta(ar, *state.objects);
+        ar.write_varint((HandleT)state.root);
+    }
+
+    void tes_context::read_base(compact_reader& ar, loaded_base& loaded) {
+        base::read_base(ar, loaded);
+        ar.read_uint32(); // the root of the delta replaces it
+    }
+
+    void tes_context::load_compact_delta(compact_reader& ar, loaded_base& loaded) {
+        base::load_compact_delta(ar, loaded);
+        _root_object_id.store((Handle)ar.read_uint32(), std::memory_order_relaxed);
+    }
+
+    void tes_context::load_compact(compact_reader& ar) {
+        base::load_compact(ar);
+        _root_object_id.store((Handle)ar.read_uint32(), std::memory_order_relaxed);
+    }
+
     ///////////////////////////
 
     void tes_context::u_applyUpdates(const serialization_version saveVersion) {
@@ -27,6 +27,34 @@ namespace collections {
                 },
                     *_context);
             }
+            object_base& operator () (const counter_map& origin) const {
+                return counter_map::objectWithInitializer([&](counter_map& self) {
+                    object_lock lock(origin);
+                    self.u_copy_from(origin);
+                },
+                    *_context);
+            }
+            object_base& operator () (const priority_heap& origin) const {
+                return priority_heap::objectWithInitializer([&](priority_heap& self) {
+                    object_lock lock(origin);
+                    self.u_copy_from(origin);
+                },
+                    *_context);
+            }
+            object_base& operator () (const ring_buffer& origin) const {
+                return ring_buffer::objectWithInitializer([&](ring_buffer& self) {
+                    object_lock lock(origin);
+                    self.u_copy_from(origin);
+                },
+                    *_context);
+            }
+            object_base& operator () (const map_cursor& origin) const {
+                return map_cursor::objectWithInitializer([&](map_cursor& self) {
+                    object_lock lock(origin);
+                    self.u_copy_from(origin);
+                },
+                    *_context);
+            }
         };
 
     public:
@@ -79,6 +107,20 @@ namespace collections {
                     copy_child(itm);
                 }
             }
+            void operator () (counter_map&) {} // holds numbers only
+            void operator () (map_cursor&) {} // the copy iterates over the same map
+            void operator () (priority_heap& queue) {
+                object_lock lock(queue);
+                queue.u_for_each([this](item& itm) { copy_child(itm); });
+            }
+            void operator () (ring_buffer& buffer) {
+                object_lock lock(buffer);
+                buffer.u_for_each([this](item& itm) { copy_child(itm); });
+            }
+            void operator () (item_set& set) {
+                object_lock lock(set);
+                set.u_container().modify_values([this](item& itm) { copy_child(itm); });
+            }
             template<class T> void operator () (T& map) {
                 object_lock lock(map);
                 for (auto& pair : map.u_container()) {
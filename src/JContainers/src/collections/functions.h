@@ -52,13 +52,14 @@ namespace collections {
             return indexes;
         }
 
+        // the @operation must not modify the array: many readers may run it at once
         template<class Op>
         static void doReadOp(array * obj, index pyIndex, Op& operation) {
             if (!obj) {
                 return;
             }
 
-            object_lock g(obj);
+            object_shared_lock g(obj);
             auto idx = convertReadIndex(obj, pyIndex);
             if (idx) {
                 operation(*idx);
@@ -71,6 +72,33 @@ namespace collections {
                 return;
             }
 
+            object_shared_lock g(obj);
+            auto idx = convertReadIndex(obj, pyIndex);
+            if (idx) {
+                operation(*idx);
+            }
+        }
+
+        // same as doReadOp, but for the operations that modify existing items
+        template<class Op>
+        static void doModifyOp(array * obj, index pyIndex, Op& operation) {
+            if (!obj) {
+                return;
+            }
+
+            object_lock g(obj);
+            auto idx = convertReadIndex(obj, pyIndex);
+            if (idx) {
+                operation(*idx);
+            }
+        }
+
+        template<class Op, class Index, size_t N>
+        static void doModifyOp(array * obj, const Index(&pyIndex)[N], Op& operation) {
+            if (!obj) {
+                return;
+            }
+
             object_lock g(obj);
             auto idx = convertReadIndex(obj, pyIndex);
             if (idx) {
@@ -109,10 +137,11 @@ namespace collections {
         using key_checker = map_key_checker/*<T>*/;
         ///typedef typename T::key_type key_type;
 
+        // read operations take the shared lock - the @operation must not modify the item
         template<class Op, class R,/* class RAlter, */class key_type>
         static R doReadOpR(T * obj, const key_type& key, R default, Op& operation) {
             if (obj && key_checker::check(key)) {
-                object_lock g(obj);
+                object_shared_lock g(obj);
                 item *itm = obj->u_get(key);
                 return itm ? operation(*itm) : default;
             }
@@ -124,7 +153,7 @@ namespace collections {
         template<class Op, class key_type>
         static void doReadOp(T * obj, const key_type& key, Op& operation) {
             if (obj && key_checker::check(key)) {
-                object_lock g(obj);
+                object_shared_lock g(obj);
                 item *itm = obj->u_get(key);
                 if (itm) {
                     operation(*itm);
@@ -145,7 +174,7 @@ namespace collections {
         template<class KeyFunc, class KeyTypeIn>
         static void nextKey(const T *obj, const KeyTypeIn& lastKey, KeyFunc keyFunc) {
             if (obj) {
-                object_lock g(obj);
+                object_shared_lock g(obj);
                 auto& container = obj->u_container();
                 if (key_checker::check(lastKey)) {
                     auto itr = container.find(lastKey);
@@ -172,7 +201,7 @@ namespace collections {
             const KeyTypeIn& endKey, const KeyComparer key_equality = equal_to{})
         {
             if (obj) {
-                object_lock g(obj);
+                object_shared_lock g(obj);
                 auto& container = obj->u_container();
 
                 if (container.empty()) {
@@ -209,23 +238,56 @@ namespace collections {
             return endKey;
         }
 
+        // O(log n) - finds the first key not less than the @key (greater than the @key if @strict),
+        // skipping the keys the @keyFunc rejects
+        template<class KeyTypeIn, class KeyFunc>
+        static void boundKey(const T *obj, const KeyTypeIn& key, bool strict, KeyFunc keyFunc) {
+            if (obj) {
+                object_shared_lock g(obj);
+                auto& container = obj->u_container();
+                auto itr = strict ? container.upper_bound(key) : container.lower_bound(key);
+                for (const auto end = container.end(); itr != end && !keyFunc(itr->first); ++itr) {
+                }
+            }
+        }
+
+        // O(log n + k) - visits the pairs of the [@lowKey, @highKey] key range in the key order
+        template<class LowKey, class HighKey, class PairFunc>
+        static void forEachInRange(const T *obj, const LowKey& lowKey, const HighKey& highKey, PairFunc pairFunc) {
+            if (obj) {
+                object_shared_lock g(obj);
+                auto& container = obj->u_container();
+                if (container.key_comp()(highKey, lowKey)) {
+                    return;
+                }
+                const auto end = container.upper_bound(highKey);
+                for (auto itr = container.lower_bound(lowKey); itr != end; ++itr) {
+                    pairFunc(*itr);
+                }
+            }
+        }
+
+        // O(log n) - the containers are order statistic trees
         template<class KeyFunc>
         static void getNthKey(const T *obj, int32_t keyIdx, KeyFunc keyFunc) {
             if (obj) {
-                object_lock g(obj);
+                object_shared_lock g(obj);
                 auto idx = array_functions::convertReadIndex(obj, keyIdx);
-                if (idx) {
-                    int32_t count = obj->u_count();
-                    if (*idx < count / 2) {
-                        auto itr = obj->u_container().begin();
-                        for (int32_t i = 0, dest = *idx; i != dest; ++i, ++itr) {}
-                        keyFunc(itr->first);
-                    }
-                    else {
-                        auto itr = obj->u_container().rbegin();
-                        for (int32_t i = (count - 1), dest = *idx; i != dest; --i, ++itr) {}
-                        keyFunc(itr->first);
-                    }
+                auto itr = idx ? obj->u_container().nth(*idx) : obj->u_container().end();
+                if (itr != obj->u_container().end()) { // nth fails for too small negative indices
+                    keyFunc(itr->first);
+                }
+            }
+        }
+
+        template<class ValueFunc>
+        static void getNthValue(const T *obj, int32_t keyIdx, ValueFunc valueFunc) {
+            if (obj) {
+                object_shared_lock g(obj);
+                auto idx = array_functions::convertReadIndex(obj, keyIdx);
+                auto itr = idx ? obj->u_container().nth(*idx) : obj->u_container().end();
+                if (itr != obj->u_container().end()) { // nth fails for too small negative indices
+                    valueFunc(itr->second);
                 }
             }
         }
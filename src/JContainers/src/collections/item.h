@@ -92,9 +92,10 @@ namespace collections {
         item(const item& other) = default;
         item& operator = (const item& other) = default;
 
-        item(item&& other) : _var(std::move(other._var)) {}
+        // noexcept lets the containers move the items instead of copying them on reallocation
+        item(item&& other) noexcept : _var(std::move(other._var)) {}
 
-        item& operator = (item&& other) {
+        item& operator = (item&& other) noexcept {
             if (this != &other) {
                 _var = std::move(other._var);
             }
@@ -202,7 +203,18 @@ namespace collections {
             return _assignPtr(val);
         }
 
+        // the contents of a lazily loaded object get decoded, as the caller is going to access them
         object_base *object() const {
+            object_base *obj = peek_object();
+            if (obj) {
+                obj->materialize();
+            }
+            return obj;
+        }
+
+        // the object as it is, for the code that doesn't access its contents - the visitors of the references
+        // must not decode them
+        object_base *peek_object() const {
             if (auto ref = boost::get<internal_object_ref>(&_var)) {
                 return ref->get();
             }
@@ -0,0 +1,316 @@
+#include "collections/item_sort.h"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <future>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <string.h>
+#include <assert.h>
+
+#include "gtest.h"
+
+namespace collections {
+
+    namespace {
+
+        enum {
+            small_count = 64, // std::stable_sort is just as good below
+            parallel_min_count = 1 << 15, // per thread
+        };
+
+        using iterator = item*;
+
+        // The chunks get stable-sorted concurrently, then the neighbours are merged, also concurrently
+        template<class It, class Compare>
+        void parallel_stable_sort(It first, It last, Compare comp) {
+            const size_t count = last - first;
+            const size_t threads = (std::min<size_t>)((std::max)(std::thread::hardware_concurrency(), 1u), count / parallel_min_count);
+            if (threads < 2) {
+                std::stable_sort(first, last, comp);
+                return;
+            }
+
+            std::vector<It> bounds;
+            for (size_t i = 0; i <= threads; ++i) {
+                bounds.push_back(first + count * i / threads);
+            }
+
+            std::vector<std::future<void>> jobs;
+            for (size_t i = 0; i < threads; ++i) {
+                jobs.push_back(std::async(std::launch::async, [=]() { std::stable_sort(bounds[i], bounds[i + 1], comp); }));
+            }
+            for (auto& job : jobs) {
+                job.get();
+            }
+
+            for (size_t width = 1; width < threads; width *= 2) {
+                jobs.clear();
+                for (size_t i = 0; i + width < threads; i += 2 * width) {
+                    auto lo = bounds[i], mid = bounds[i + width], hi = bounds[(std::min)(i + 2 * width, threads)];
+                    jobs.push_back(std::async(std::launch::async, [=]() { std::inplace_merge(lo, mid, hi, comp); }));
+                }
+                for (auto& job : jobs) {
+                    job.get();
+                }
+            }
+        }
+
+        // The i-th item becomes the order[i]-th item of the original range
+        void apply_order(iterator first, const std::vector<uint32_t>& order) {
+            std::vector<item> sorted;
+            sorted.reserve(order.size());
+            for (uint32_t index : order) {
+                sorted.emplace_back(std::move(first[index]));
+            }
+            std::move(sorted.begin(), sorted.end(), first);
+        }
+
+        // Stable LSD radix sort of the (key << 32 | position) pairs by their keys
+        void radix_sort_keys(std::vector<uint64_t>& pairs) {
+            const int digit_bits = 11;
+            const size_t buckets = 1 << digit_bits;
+
+            std::vector<uint64_t> buffer(pairs.size());
+            std::vector<size_t> offsets(buckets);
+
+            for (int shift = 32; shift < 64; shift += digit_bits) {
+                std::fill(offsets.begin(), offsets.end(), 0);
+                for (uint64_t pair : pairs) {
+                    ++offsets[(pair >> shift) & (buckets - 1)];
+                }
+                if (std::find(offsets.begin(), offsets.end(), pairs.size()) != offsets.end()) {
+                    continue; // all the keys have the same digit
+                }
+
+                size_t offset = 0;
+                for (auto& bucket : offsets) {
+                    offset += bucket;
+                    bucket = offset - bucket;
+                }
+                for (uint64_t pair : pairs) {
+                    buffer[offsets[(pair >> shift) & (buckets - 1)]++] = pair;
+                }
+                pairs.swap(buffer);
+            }
+        }
+
+        // Unsigned keys ordered the same way as the numbers
+        uint32_t integer_key(SInt32 value) {
+            return uint32_t(value) ^ 0x80000000u;
+        }
+
+        uint32_t real_key(Float32 value) {
+            if (value == 0) {
+                value = 0; // -0.0 and 0.0 are equivalent
+            }
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof bits);
+            return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+        }
+
+        template<class T, class KeyOf>
+        void sort_numbers(iterator first, iterator last, KeyOf key_of) {
+            const size_t count = last - first;
+            if (count < small_count) {
+                std::stable_sort(first, last);
+                return;
+            }
+
+            std::vector<uint64_t> pairs;
+            pairs.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                pairs.push_back(uint64_t(key_of(*first[i].get<T>())) << 32 | i);
+            }
+
+            radix_sort_keys(pairs);
+
+            std::vector<uint32_t> order;
+            order.reserve(count);
+            for (uint64_t pair : pairs) {
+                order.push_back(uint32_t(pair));
+            }
+            apply_order(first, order);
+        }
+
+        // First 8 characters in lowercase, big-endian: the prefixes compare the same way as the _stricmp does
+        uint64_t string_prefix(const char *str) {
+            uint64_t prefix = 0;
+            for (int i = 0; i < 8; ++i) {
+                unsigned char c = *str;
+                if (c >= 'A' && c <= 'Z') {
+                    c += 'a' - 'A';
+                }
+                prefix = (prefix << 8) | c;
+                if (*str) {
+                    ++str;
+                }
+            }
+            return prefix;
+        }
+
+        void sort_strings(iterator first, iterator last) {
+            const size_t count = last - first;
+            if (count < small_count) {
+                std::stable_sort(first, last);
+                return;
+            }
+
+            struct key {
+                uint64_t prefix;
+                const char *string;
+                uint32_t position;
+            };
+
+            std::vector<key> keys;
+            keys.reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                const char *string = first[i].get<std::string>()->c_str();
+                keys.push_back(key{ string_prefix(string), string, uint32_t(i) });
+            }
+
+            parallel_stable_sort(keys.begin(), keys.end(), [](const key& left, const key& right) {
+                return left.prefix != right.prefix ? left.prefix < right.prefix : _stricmp(left.string, right.string) < 0;
+            });
+
+            std::vector<uint32_t> order;
+            order.reserve(count);
+            for (const key& k : keys) {
+                order.push_back(k.position);
+            }
+            apply_order(first, order);
+        }
+    }
+
+    void sort_items(item *first, item *last) {
+        const size_t count = last - first;
+        if (count < 2) {
+            return;
+        }
+
+        // stable counting sort by the type. bounds[type] .. bounds[type + 1] is the range of the type
+        std::array<size_t, item_type::string + 2> bounds = {};
+        for (const item *itm = first; itm != last; ++itm) {
+            ++bounds[itm->type() + 1];
+        }
+        const bool single_type = std::find(bounds.begin(), bounds.end(), count) != bounds.end();
+        std::partial_sum(bounds.begin(), bounds.end(), bounds.begin());
+
+        if (!single_type) {
+            auto offsets = bounds;
+            std::vector<item> partitioned(count);
+            for (item *itm = first; itm != last; ++itm) {
+                partitioned[offsets[itm->type()]++] = std::move(*itm);
+            }
+            std::move(partitioned.begin(), partitioned.end(), first);
+        }
+
+        auto begin = [&](item_type type) { return first + bounds[type]; };
+        auto end = [&](item_type type) { return first + bounds[type + 1]; };
+
+        const std::function<void()> tasks[] = {
+            [&]() { sort_numbers<SInt32>(begin(item_type::integer), end(item_type::integer), integer_key); },
+            [&]() { sort_numbers<Float32>(begin(item_type::real), end(item_type::real), real_key); },
+            [&]() { parallel_stable_sort(begin(item_type::form), end(item_type::form), std::less<item>()); },
+            [&]() { parallel_stable_sort(begin(item_type::object), end(item_type::object), std::less<item>()); },
+            [&]() { sort_strings(begin(item_type::string), end(item_type::string)); },
+        };
+
+        if (count >= parallel_min_count) {
+            std::vector<std::future<void>> jobs;
+            for (auto& task : tasks) {
+                jobs.push_back(std::async(std::launch::async, task));
+            }
+            for (auto& job : jobs) {
+                job.get();
+            }
+        }
+        else {
+            for (auto& task : tasks) {
+                task();
+            }
+        }
+    }
+
+    void sort_items_by_keys(item *first, item *last, const std::vector<item>& keys, size_t key_count, bool descending) {
+        assert(keys.size() == size_t(last - first) * key_count);
+
+        std::vector<uint32_t> order(last - first);
+        std::iota(order.begin(), order.end(), 0);
+
+        parallel_stable_sort(order.begin(), order.end(), [&](uint32_t left, uint32_t right) {
+            const item *leftKeys = &keys[left * key_count], *rightKeys = &keys[right * key_count];
+            for (size_t i = 0; i < key_count; ++i) {
+                if (leftKeys[i] < rightKeys[i]) {
+                    return !descending;
+                }
+                if (rightKeys[i] < leftKeys[i]) {
+                    return descending;
+                }
+            }
+            return false;
+        });
+
+        apply_order(first, order);
+    }
+
+    void for_each_chunk(size_t count, const std::function<void(size_t begin, size_t end)>& func) {
+        const size_t threads = (std::min<size_t>)((std::max)(std::thread::hardware_concurrency(), 1u), count / parallel_min_count);
+        if (threads < 2) {
+            func(0, count);
+            return;
+        }
+
+        std::vector<std::future<void>> jobs;
+        for (size_t i = 0; i < threads; ++i) {
+            jobs.push_back(std::async(std::launch::async, func, count * i / threads, count * (i + 1) / threads));
+        }
+        for (auto& job : jobs) {
+            job.get();
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    TEST(item_sort, same_order_as_stable_sort)
+    {
+        std::mt19937 random(11);
+        const char *words[] = { "apple", "Apple", "APPLE", "applesauce", "apple_pie", "b", "", "Zebra", "zebra", "_", "10", "9", "averyverylongprefix-a", "AveryVeryLongPrefix-B" };
+        const Float32 reals[] = { 0.0f, -0.0f, 1.5f, -1.5f, 1e30f, -1e30f, std::numeric_limits<Float32>::infinity(), -std::numeric_limits<Float32>::infinity(), 1e-40f };
+
+        auto identical = [](const item& left, const item& right) {
+            if (left.type() != right.type()) {
+                return false;
+            }
+            if (auto string = left.get<std::string>()) {
+                return *string == *right.get<std::string>(); // case matters
+            }
+            if (auto real = left.get<Float32>()) {
+                return memcmp(real, right.get<Float32>(), sizeof(Float32)) == 0; // the sign of zero matters
+            }
+            return left == right;
+        };
+
+        for (size_t count : { 0, 1, 2, 10, 63, 64, 1000, 200000 }) {
+            std::vector<item> items;
+            for (size_t i = 0; i < count; ++i) {
+                switch (random() % 5) {
+                case 0: items.emplace_back(); break;
+                case 1: items.emplace_back(SInt32(random())); break;
+                case 2: items.emplace_back(SInt32(random() % 7) - 3); break;
+                case 3: items.emplace_back(random() % 2 ? reals[random() % _countof(reals)] : Float32(random() % 1000) / 8); break;
+                default: items.emplace_back(words[random() % _countof(words)]); break;
+                }
+            }
+
+            auto expected = items;
+            std::stable_sort(expected.begin(), expected.end());
+            sort_items(items.data(), items.data() + items.size());
+
+            EXPECT_TRUE(std::equal(items.begin(), items.end(), expected.begin(), expected.end(), identical));
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "collections/item.h"
+
+namespace collections {
+
+    // Sorts the items into the item::operator< order (none < int < float < form < object < string).
+    // Equivalent items keep their relative order, i.e. the result is the same as of std::stable_sort,
+    // but the items get partitioned by type first, the numbers are radix sorted, the strings are compared by
+    // their prefixes first, and the large arrays are sorted by several threads.
+    // The caller must own the items exclusively during the sort
+    void sort_items(item *first, item *last);
+
+    // Stable sort of the items by their precomputed keys, compared lexicographically with the item::operator<.
+    // The i-th item has the keys[i * key_count] .. keys[(i + 1) * key_count - 1] keys
+    void sort_items_by_keys(item *first, item *last, const std::vector<item>& keys, size_t key_count, bool descending);
+
+    // Calls the @func for the chunks of the [0, count) range, concurrently if the range is large
+    void for_each_chunk(size_t count, const std::function<void(size_t begin, size_t end)>& func);
+}
@@ -62,6 +62,16 @@ namespace collections {
 
         template<> inline const char* type2name<form_map>() { return "JFormMap"; }
         template<> inline const char* type2name<integer_map>() { return "JIntMap"; }
+        template<> inline const char* type2name<counter_map>() { return "JCounterMap"; }
+        template<> inline const char* type2name<map_cursor>() { return "JMapIterator"; }
+        template<> inline const char* type2name<item_set>() { return "JSet"; }
+        template<> inline const char* type2name<ring_buffer>() { return "JRingBuffer"; }
+        template<> inline const char* type2name<priority_heap>() { return "JPriorityQueue"; }
+
+        // JSet, JRingBuffer and JPriorityQueue are written as {"__metaInfo": {"typeName": ...}, "items": [...]}
+        static const char * kItems = "items";
+        static const char * kCapacity = "capacity";
+        static const char * kMaxFirst = "maxFirst"; // the items of JPriorityQueue are [priority, value, handle] triples
 
         template<class T> inline void put_metainfo(json_t* object) {
             auto metaInfo = json_object();
@@ -80,6 +90,9 @@ namespace collections {
         tes_context& _context;
         objects_to_fill _toFill;
         key_info_map _toResolve;
+        // the buffers listing more items than their capacity: the references use the indices of the listed items,
+        // so the buffers keep all of them until the references get resolved
+        std::vector<std::pair<ring_buffer*, uint32_t> > _toTrim;
 
         explicit json_deserializer(tes_context& context) : _context(context) {}
 
@@ -150,6 +163,11 @@ namespace collections {
 
             resolve_references(*root);
 
+            for (auto& pair : _toTrim) {
+                object_lock l(pair.first);
+                pair.first->u_trim(pair.second);
+            }
+
             return root;
         }
 
@@ -160,9 +178,8 @@ namespace collections {
                 object_base *resolvedObject = nullptr;
 
                 if (path.empty() == false) {
-                    ca::visit_value(root, path.c_str(), ca::constant, [&resolvedObject](item& itm) {
-                        resolvedObject = itm.object();
-                    });
+                    auto itm = ca::get(root, path.c_str()); // read-only, the items of JSet aren't writable via path
+                    resolvedObject = itm ? itm->object() : nullptr;
                 }
                 else { // special case "__reference|"
                     resolvedObject = &root;
@@ -174,7 +191,12 @@ namespace collections {
 
                 for (auto& obj2Key : pair.second) {
                     object_lock l(obj2Key.first);
-                    ca::u_assign_value(*obj2Key.first, obj2Key.second, resolvedObject);
+                    if (auto set = obj2Key.first->as<item_set>()) { // has no slot to assign to, see the set filler
+                        set->u_add(item(resolvedObject));
+                    }
+                    else {
+                        ca::u_assign_value(*obj2Key.first, obj2Key.second, resolvedObject);
+                    }
                 }
             }
 
@@ -224,6 +246,62 @@ namespace collections {
                         catch (const std::out_of_range&) {}
                     }
                 }
+                void operator()(counter_map& cnt) {
+                    const char *key;
+                    json_t *value;
+                    json_object_foreach(val, key, value) {
+                        if (json_is_number(value)) {
+                            cnt.u_set(key, self->make_item(value, cnt, key));
+                        }
+                    }
+                }
+                void operator()(map_cursor&) {} // the position isn't stored, the cursor stays finished
+                void operator()(priority_heap& cnt) {
+                    namespace jsc = json_object_serialization_consts;
+                    cnt.u_set_max_first(json_is_true(json_object_get(val, jsc::kMaxFirst)));
+
+                    // the entries come in the heap order
+                    size_t index = 0;
+                    json_t *entry = nullptr;
+                    json_array_foreach(json_object_get(val, jsc::kItems), index, entry) {
+                        json_t *priority = json_array_get(entry, 0);
+                        if (json_is_number(priority)) {
+                            cnt.u_push_ordered(self->make_item(json_array_get(entry, 1), cnt, int32_t(cnt.u_count())),
+                                (Float32)json_number_value(priority), (uint32_t)json_integer_value(json_array_get(entry, 2)));
+                        }
+                    }
+                }
+                void operator()(ring_buffer& cnt) {
+                    namespace jsc = json_object_serialization_consts;
+                    const json_int_t capacity = json_integer_value(json_object_get(val, jsc::kCapacity));
+                    const uint32_t keptCount = (uint32_t)(std::min)((std::max)(capacity, json_int_t(0)), json_int_t(ring_buffer::max_capacity));
+
+                    json_ref items = json_object_get(val, jsc::kItems);
+                    const uint32_t listedCount = (uint32_t)(std::min)(json_array_size(items), size_t(ring_buffer::max_capacity));
+                    if (listedCount > keptCount) {
+                        self->_toTrim.emplace_back(&cnt, keptCount);
+                    }
+                    cnt.u_reset((std::max)(keptCount, listedCount));
+
+                    // the newest item goes first
+                    for (size_t index = listedCount; index-- > 0; ) {
+                        cnt.u_push(self->make_item(json_array_get(items, index), cnt, int32_t(index)));
+                    }
+                }
+                void operator()(item_set& cnt) {
+                    size_t index = 0;
+                    json_t *value = nullptr;
+                    json_array_foreach(json_object_get(val, json_object_serialization_consts::kItems), index, value) {
+                        // the referenced objects get added once resolved, after the other items - the serializer
+                        // puts the references last, so the indices of the other items stay the same
+                        if (json_is_string(value) && reference_serialization::is_reference(json_string_value(value))) {
+                            self->schedule_ref_resolving(json_string_value(value), cnt, int32_t(index));
+                        }
+                        else {
+                            cnt.u_add(self->make_item(value, cnt, int32_t(cnt.u_count())));
+                        }
+                    }
+                }
             };
 
             object_lock lock(object);
@@ -256,6 +334,21 @@ namespace collections {
                     else if (strcmp(jsc::type2name<integer_map>(), typeName) == 0) {
                         object = &integer_map::object(_context);
                     }
+                    else if (strcmp(jsc::type2name<counter_map>(), typeName) == 0) {
+                        object = &counter_map::object(_context);
+                    }
+                    else if (strcmp(jsc::type2name<map_cursor>(), typeName) == 0) {
+                        object = &map_cursor::object(_context);
+                    }
+                    else if (strcmp(jsc::type2name<item_set>(), typeName) == 0) {
+                        object = &item_set::object(_context);
+                    }
+                    else if (strcmp(jsc::type2name<ring_buffer>(), typeName) == 0) {
+                        object = &ring_buffer::object(_context);
+                    }
+                    else if (strcmp(jsc::type2name<priority_heap>(), typeName) == 0) {
+                        object = &priority_heap::object(_context);
+                    }
                 }
                 else {
                     object = &map::object(_context);
@@ -457,6 +550,67 @@ namespace collections {
                         json_object_set_new(object, key_string, self->create_value(pair.second));
                     }
                 }
+                void operator () (const counter_map& cnt) {
+                    json_object_serialization_consts::put_metainfo<counter_map>(object);
+
+                    for (auto& pair : cnt.u_snapshot()) {
+                        json_object_set_new(object, pair.first.c_str(), self->create_value(pair.second));
+                    }
+                }
+                void operator () (const map_cursor&) {
+                    json_object_serialization_consts::put_metainfo<map_cursor>(object);
+                }
+                void operator () (const priority_heap& cnt) {
+                    namespace jsc = json_object_serialization_consts;
+                    jsc::put_metainfo<priority_heap>(object);
+                    json_object_set_new(object, jsc::kMaxFirst, json_boolean(cnt.u_max_first()));
+
+                    json_ref items = json_array();
+                    int32_t index = 0;
+                    for (auto& e : cnt.u_container()) {
+                        self->fill_key_info(e.value, cnt, index++);
+                        json_ref triple = json_array();
+                        json_array_append_new(triple, json_real(e.priority));
+                        json_array_append_new(triple, self->create_value(e.value));
+                        json_array_append_new(triple, json_integer(e.handle));
+                        json_array_append_new(items, triple);
+                    }
+                    json_object_set_new(object, jsc::kItems, items);
+                }
+                void operator () (const ring_buffer& cnt) {
+                    namespace jsc = json_object_serialization_consts;
+                    jsc::put_metainfo<ring_buffer>(object);
+                    json_object_set_new(object, jsc::kCapacity, json_integer(cnt.u_capacity()));
+
+                    json_ref items = json_array();
+                    for (int32_t index = 0; index < cnt.u_count(); ++index) {
+                        const item& itm = *cnt.u_get(index);
+                        self->fill_key_info(itm, cnt, index);
+                        json_array_append_new(items, self->create_value(itm));
+                    }
+                    json_object_set_new(object, jsc::kItems, items);
+                }
+                void operator () (const item_set& cnt) {
+                    json_object_serialization_consts::put_metainfo<item_set>(object);
+
+                    // items that become references go last: the deserializer adds them after the others
+                    std::vector<const item*> references;
+                    json_ref items = json_array();
+                    int32_t index = 0;
+                    for (auto& itm : cnt.u_container()) {
+                        auto obj = itm.object();
+                        if (obj && self->_serializedObjects.count(std::cref(*obj))) {
+                            references.push_back(&itm);
+                            continue;
+                        }
+                        self->fill_key_info(itm, cnt, index++);
+                        json_array_append_new(items, self->create_value(itm));
+                    }
+                    for (auto itm : references) {
+                        json_array_append_new(items, self->create_value(*itm));
+                    }
+                    json_object_set_new(object, json_object_serialization_consts::kItems, items);
+                }
             };
 
             object_lock lock(cnt);
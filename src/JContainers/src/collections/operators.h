@@ -1,6 +1,7 @@
 #pragma once
 
 #include "collections/collections.h"
+#include "collections/packed_kernels.h"
 
 #include <thread>
 #include "meta.h"
@@ -105,6 +106,68 @@ namespace collections {
         }
         COLLECTION_OPERATOR(minInt, "returns minimum int number in collection");
 
+        void sumInt(const item& val, item& state) {
+            if (val.is_type<SInt32>()) {
+                // wraps around on overflow, like the Papyrus integers
+                state = item(static_cast<SInt32>(static_cast<UInt32>(state.intValue()) + static_cast<UInt32>(val.intValue())));
+            }
+        }
+        COLLECTION_OPERATOR(sumInt, "returns sum of int numbers in collection");
+
+        void sumFlt(const item& val, item& state) {
+            if (val.is_type<item::Real>()) {
+                state = item(state.fltValue() + val.fltValue());
+            }
+        }
+        COLLECTION_OPERATOR(sumFlt, "returns sum of float numbers in collection");
+
+
+        // The same as applying the @opr to every number of the @numbers, but with the SIMD kernels.
+        // Returns false if the @opr has no packed version
+        static bool apply_packed(const coll_operator& opr, const array::packed_numbers& numbers, item& state) {
+            const bool integers = numbers.type == item_type::integer;
+            const bool reals = numbers.type == item_type::real;
+            const SInt32 *ints = numbers.integers.data();
+            const Float32 *flts = numbers.reals.data();
+            const size_t count = integers ? numbers.integers.size() : numbers.reals.size();
+
+            // maxNum & minNum turn the result into a float once there are two numbers - there are at least min_count of them
+            if (opr.func == &maxNum || opr.func == &minNum) {
+                const bool max = opr.func == &maxNum;
+                if (integers) {
+                    state = item((Float32)(max ? packed_kernels::max(ints, count) : packed_kernels::min(ints, count)));
+                }
+                else if (reals) {
+                    state = item(max ? packed_kernels::max(flts, count) : packed_kernels::min(flts, count));
+                }
+            }
+            else if (opr.func == &maxInt || opr.func == &minInt) {
+                if (integers) {
+                    state = item(opr.func == &maxInt ? packed_kernels::max(ints, count) : packed_kernels::min(ints, count));
+                }
+            }
+            else if (opr.func == &maxFlt || opr.func == &minFlt) {
+                if (reals) {
+                    state = item(opr.func == &maxFlt ? packed_kernels::max(flts, count) : packed_kernels::min(flts, count));
+                }
+            }
+            else if (opr.func == &sumInt) {
+                if (integers) {
+                    state = item(static_cast<SInt32>(static_cast<UInt32>(state.intValue()) + static_cast<UInt32>(packed_kernels::sum(ints, count))));
+                }
+            }
+            else if (opr.func == &sumFlt) {
+                // summed in double, may differ from the item by item sum in the last bits
+                if (reals) {
+                    state = item(static_cast<Float32>(state.fltValue() + packed_kernels::sum(flts, count)));
+                }
+            }
+            else {
+                return false;
+            }
+
+            return true;
+        }
 
 #undef COLLECTION_OPERATOR
     };
@@ -0,0 +1,440 @@
+#include "collections/packed_kernels.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <numeric>
+#include <random>
+#include <vector>
+#include <intrin.h>
+#include <immintrin.h>
+
+#include "gtest.h"
+
+namespace collections {
+namespace packed_kernels {
+
+    namespace {
+
+        bool cpu_has_avx2() {
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) {
+                return false;
+            }
+
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) { // the OS must save the YMM registers
+                return false;
+            }
+
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+        }
+
+        std::atomic<isa> g_isa_limit{ isa::avx2 };
+
+        inline uint32_t lowest_bit(uint32_t mask) {
+            unsigned long index;
+            _BitScanForward(&index, mask);
+            return index;
+        }
+
+        inline uint32_t highest_bit(uint32_t mask) {
+            unsigned long index;
+            _BitScanReverse(&index, mask);
+            return index;
+        }
+
+        inline uint32_t bits_set(uint32_t mask) {
+            static const uint8_t nibble_bits[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+            return nibble_bits[mask & 0xf] + nibble_bits[(mask >> 4) & 0xf];
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+        // Per instruction set & element type operations the generic kernels are built of
+
+        struct sse2_scope {};
+
+        struct avx_scope {
+            // avoids the AVX-SSE transition penalty in the legacy SSE code that follows
+            ~avx_scope() { _mm256_zeroupper(); }
+        };
+
+        struct sse2_int32 {
+            using value_type = int32_t;
+            using reg = __m128i;
+            using wide_reg = __m128i; // two int64 lanes
+            using scope = sse2_scope;
+            static const size_t width = 4;
+
+            static reg load(const int32_t *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+            static void store(int32_t *p, reg r) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), r); }
+            static reg splat(int32_t v) { return _mm_set1_epi32(v); }
+            static uint32_t equal_mask(reg a, reg b) { return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))); }
+            // no pminsd/pmaxsd in SSE2
+            static reg min(reg a, reg b) {
+                const reg greater = _mm_cmpgt_epi32(a, b);
+                return _mm_or_si128(_mm_and_si128(greater, b), _mm_andnot_si128(greater, a));
+            }
+            static reg max(reg a, reg b) {
+                const reg greater = _mm_cmpgt_epi32(a, b);
+                return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+            }
+            static wide_reg wide_zero() { return _mm_setzero_si128(); }
+            // no pmovsxdq in SSE2 - interleaves the lanes with their sign masks
+            static wide_reg wide_add(wide_reg sum, reg r) {
+                const reg sign = _mm_cmpgt_epi32(_mm_setzero_si128(), r);
+                return _mm_add_epi64(sum, _mm_add_epi64(_mm_unpacklo_epi32(r, sign), _mm_unpackhi_epi32(r, sign)));
+            }
+            static int64_t wide_total(wide_reg sum) {
+                int64_t lanes[2];
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sum);
+                return lanes[0] + lanes[1];
+            }
+        };
+
+        struct sse2_float {
+            using value_type = float;
+            using reg = __m128;
+            using wide_reg = __m128d;
+            using scope = sse2_scope;
+            static const size_t width = 4;
+
+            static reg load(const float *p) { return _mm_loadu_ps(p); }
+            static void store(float *p, reg r) { _mm_storeu_ps(p, r); }
+            static reg splat(float v) { return _mm_set1_ps(v); }
+            static uint32_t equal_mask(reg a, reg b) { return _mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+            static reg min(reg a, reg b) { return _mm_min_ps(a, b); }
+            static reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+            static wide_reg wide_zero() { return _mm_setzero_pd(); }
+            static wide_reg wide_add(wide_reg sum, reg r) {
+                return _mm_add_pd(sum, _mm_add_pd(_mm_cvtps_pd(r), _mm_cvtps_pd(_mm_movehl_ps(r, r))));
+            }
+            static double wide_total(wide_reg sum) {
+                double lanes[2];
+                _mm_storeu_pd(lanes, sum);
+                return lanes[0] + lanes[1];
+            }
+        };
+
+        struct avx2_int32 {
+            using value_type = int32_t;
+            using reg = __m256i;
+            using wide_reg = __m256i; // four int64 lanes
+            using scope = avx_scope;
+            static const size_t width = 8;
+
+            static reg load(const int32_t *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+            static void store(int32_t *p, reg r) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), r); }
+            static reg splat(int32_t v) { return _mm256_set1_epi32(v); }
+            static uint32_t equal_mask(reg a, reg b) { return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))); }
+            static reg min(reg a, reg b) { return _mm256_min_epi32(a, b); }
+            static reg max(reg a, reg b) { return _mm256_max_epi32(a, b); }
+            static wide_reg wide_zero() { return _mm256_setzero_si256(); }
+            static wide_reg wide_add(wide_reg sum, reg r) {
+                const wide_reg low = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(r));
+                const wide_reg high = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(r, 1));
+                return _mm256_add_epi64(sum, _mm256_add_epi64(low, high));
+            }
+            static int64_t wide_total(wide_reg sum) {
+                int64_t lanes[4];
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), sum);
+                return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            }
+        };
+
+        struct avx2_float {
+            using value_type = float;
+            using reg = __m256;
+            using wide_reg = __m256d;
+            using scope = avx_scope;
+            static const size_t width = 8;
+
+            static reg load(const float *p) { return _mm256_loadu_ps(p); }
+            static void store(float *p, reg r) { _mm256_storeu_ps(p, r); }
+            static reg splat(float v) { return _mm256_set1_ps(v); }
+            static uint32_t equal_mask(reg a, reg b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+            static reg min(reg a, reg b) { return _mm256_min_ps(a, b); }
+            static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+            static wide_reg wide_zero() { return _mm256_setzero_pd(); }
+            static wide_reg wide_add(wide_reg sum, reg r) {
+                const wide_reg low = _mm256_cvtps_pd(_mm256_castps256_ps128(r));
+                const wide_reg high = _mm256_cvtps_pd(_mm256_extractf128_ps(r, 1));
+                return _mm256_add_pd(sum, _mm256_add_pd(low, high));
+            }
+            static double wide_total(wide_reg sum) {
+                double lanes[4];
+                _mm256_storeu_pd(lanes, sum);
+                return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            }
+        };
+
+        //////////////////////////////////////////////////////////////////////////
+        // Scalar versions, also process the tails of the vector ones
+
+        template<class T>
+        size_t scalar_find(const T *data, size_t begin, size_t end, T value) {
+            for (size_t i = begin; i < end; ++i) {
+                if (data[i] == value) {
+                    return i;
+                }
+            }
+            return npos;
+        }
+
+        template<class T>
+        size_t scalar_find_last(const T *data, size_t end, T value) {
+            for (size_t i = end; i-- > 0; ) {
+                if (data[i] == value) {
+                    return i;
+                }
+            }
+            return npos;
+        }
+
+        template<class T>
+        size_t scalar_count(const T *data, size_t begin, size_t end, T value) {
+            size_t result = 0;
+            for (size_t i = begin; i < end; ++i) {
+                result += (data[i] == value);
+            }
+            return result;
+        }
+
+        struct min_of {
+            template<class T> T operator()(T a, T b) const { return b < a ? b : a; }
+            template<class Ops, class R> R operator()(Ops, R a, R b) const { return Ops::min(a, b); }
+        };
+
+        struct max_of {
+            template<class T> T operator()(T a, T b) const { return a < b ? b : a; }
+            template<class Ops, class R> R operator()(Ops, R a, R b) const { return Ops::max(a, b); }
+        };
+
+        template<class T> struct wide_of;
+        template<> struct wide_of<int32_t> { using type = int64_t; };
+        template<> struct wide_of<float> { using type = double; };
+
+        template<class T, class Wide = typename wide_of<T>::type>
+        Wide scalar_sum(const T *data, size_t begin, size_t end, Wide initial) {
+            for (size_t i = begin; i < end; ++i) {
+                initial += data[i];
+            }
+            return initial;
+        }
+
+        template<class T, class Select>
+        T scalar_reduce(const T *data, size_t begin, size_t end, T initial, Select select) {
+            for (size_t i = begin; i < end; ++i) {
+                initial = select(initial, data[i]);
+            }
+            return initial;
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        template<class Ops, class T = typename Ops::value_type>
+        size_t vector_find(const T *data, size_t count, T value) {
+            typename Ops::scope scope;
+            const auto needle = Ops::splat(value);
+            size_t i = 0;
+            for (; i + Ops::width <= count; i += Ops::width) {
+                if (uint32_t mask = Ops::equal_mask(Ops::load(data + i), needle)) {
+                    return i + lowest_bit(mask);
+                }
+            }
+            return scalar_find(data, i, count, value);
+        }
+
+        template<class Ops, class T = typename Ops::value_type>
+        size_t vector_find_last(const T *data, size_t count, T value) {
+            typename Ops::scope scope;
+            const auto needle = Ops::splat(value);
+            size_t end = count;
+            for (; end >= Ops::width; end -= Ops::width) {
+                if (uint32_t mask = Ops::equal_mask(Ops::load(data + end - Ops::width), needle)) {
+                    return end - Ops::width + highest_bit(mask);
+                }
+            }
+            return scalar_find_last(data, end, value);
+        }
+
+        template<class Ops, class T = typename Ops::value_type>
+        size_t vector_count(const T *data, size_t count, T value) {
+            typename Ops::scope scope;
+            const auto needle = Ops::splat(value);
+            size_t result = 0;
+            size_t i = 0;
+            for (; i + Ops::width <= count; i += Ops::width) {
+                result += bits_set(Ops::equal_mask(Ops::load(data + i), needle));
+            }
+            return result + scalar_count(data, i, count, value);
+        }
+
+        template<class Ops, class Select, class T = typename Ops::value_type>
+        T vector_reduce(const T *data, size_t count, Select select) {
+            if (count < Ops::width) {
+                return scalar_reduce(data, 1, count, data[0], select);
+            }
+
+            T result;
+            {
+                typename Ops::scope scope;
+                auto accumulator = Ops::load(data);
+                size_t i = Ops::width;
+                for (; i + Ops::width <= count; i += Ops::width) {
+                    accumulator = select(Ops{}, accumulator, Ops::load(data + i));
+                }
+                // the tail overlaps with the elements processed already, that's fine for min & max
+                accumulator = select(Ops{}, accumulator, Ops::load(data + count - Ops::width));
+
+                T lanes[Ops::width];
+                Ops::store(lanes, accumulator);
+                result = scalar_reduce(lanes, 1, Ops::width, lanes[0], select);
+            }
+            return result;
+        }
+
+        template<class Ops, class T = typename Ops::value_type>
+        typename wide_of<T>::type vector_sum(const T *data, size_t count) {
+            typename wide_of<T>::type result;
+            {
+                typename Ops::scope scope;
+                auto accumulator = Ops::wide_zero();
+                size_t i = 0;
+                for (; i + Ops::width <= count; i += Ops::width) {
+                    accumulator = Ops::wide_add(accumulator, Ops::load(data + i));
+                }
+                result = scalar_sum(data, i, count, Ops::wide_total(accumulator));
+            }
+            return result;
+        }
+
+        // the Kernel is called with the Ops of the active instruction set or without any for the scalar version
+        template<class IntOrFloat> struct ops_of;
+        template<> struct ops_of<int32_t> { using sse2 = sse2_int32; using avx2 = avx2_int32; };
+        template<> struct ops_of<float> { using sse2 = sse2_float; using avx2 = avx2_float; };
+    }
+
+    isa active_isa() {
+        static const isa available = cpu_has_avx2() ? isa::avx2 : isa::sse2; // SSE2 is the x64 baseline
+        return (std::min)(available, g_isa_limit.load(std::memory_order_relaxed));
+    }
+
+    void set_isa_limit(isa limit) {
+        g_isa_limit.store(limit, std::memory_order_relaxed);
+    }
+
+#   define JC_DISPATCH(vector_call, scalar_call) \
+        switch (active_isa()) { \
+        case isa::avx2: return vector_call(typename ops_of<T>::avx2); \
+        case isa::sse2: return vector_call(typename ops_of<T>::sse2); \
+        default: return scalar_call; \
+        }
+
+    namespace {
+        template<class T>
+        size_t dispatch_find(const T *data, size_t count, T value) {
+#           define JC_CALL(Ops) vector_find<Ops>(data, count, value)
+            JC_DISPATCH(JC_CALL, scalar_find(data, 0, count, value));
+#           undef JC_CALL
+        }
+
+        template<class T>
+        size_t dispatch_find_last(const T *data, size_t count, T value) {
+#           define JC_CALL(Ops) vector_find_last<Ops>(data, count, value)
+            JC_DISPATCH(JC_CALL, scalar_find_last(data, count, value));
+#           undef JC_CALL
+        }
+
+        template<class T>
+        size_t dispatch_count(const T *data, size_t count, T value) {
+#           define JC_CALL(Ops) vector_count<Ops>(data, count, value)
+            JC_DISPATCH(JC_CALL, scalar_count(data, 0, count, value));
+#           undef JC_CALL
+        }
+
+        template<class T>
+        typename wide_of<T>::type dispatch_sum(const T *data, size_t count) {
+#           define JC_CALL(Ops) vector_sum<Ops>(data, count)
+            JC_DISPATCH(JC_CALL, scalar_sum(data, 0, count, typename wide_of<T>::type(0)));
+#           undef JC_CALL
+        }
+
+        template<class T, class Select>
+        T dispatch_reduce(const T *data, size_t count, Select select) {
+            assert(count > 0);
+#           define JC_CALL(Ops) vector_reduce<Ops>(data, count, select)
+            JC_DISPATCH(JC_CALL, scalar_reduce(data, 1, count, data[0], select));
+#           undef JC_CALL
+        }
+    }
+
+#   undef JC_DISPATCH
+
+    size_t find(const int32_t *data, size_t count, int32_t value) { return dispatch_find(data, count, value); }
+    size_t find(const float *data, size_t count, float value) { return dispatch_find(data, count, value); }
+    size_t find_last(const int32_t *data, size_t count, int32_t value) { return dispatch_find_last(data, count, value); }
+    size_t find_last(const float *data, size_t count, float value) { return dispatch_find_last(data, count, value); }
+
+    size_t count(const int32_t *data, size_t count, int32_t value) { return dispatch_count(data, count, value); }
+    size_t count(const float *data, size_t count, float value) { return dispatch_count(data, count, value); }
+
+    int32_t min(const int32_t *data, size_t count) { return dispatch_reduce(data, count, min_of{}); }
+    float min(const float *data, size_t count) { return dispatch_reduce(data, count, min_of{}); }
+    int32_t max(const int32_t *data, size_t count) { return dispatch_reduce(data, count, max_of{}); }
+    float max(const float *data, size_t count) { return dispatch_reduce(data, count, max_of{}); }
+
+    int64_t sum(const int32_t *data, size_t count) { return dispatch_sum(data, count); }
+    double sum(const float *data, size_t count) { return dispatch_sum(data, count); }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    TEST(packed_kernels, match_scalar_versions)
+    {
+        std::mt19937 random(7);
+        const isa limits[] = { isa::scalar, isa::sse2, isa::avx2 };
+
+        for (size_t size : { 1, 3, 4, 7, 8, 9, 31, 100, 1001 }) {
+            std::vector<int32_t> ints(size);
+            std::vector<float> reals(size);
+            for (size_t i = 0; i < size; ++i) {
+                ints[i] = int32_t(random() % 50) - 25;
+                reals[i] = float(ints[i]) * 0.5f;
+            }
+            ints[size / 2] = INT32_MAX; // the int32 sum would overflow
+            ints[size - 1] = INT32_MAX;
+
+            for (isa limit : limits) {
+                set_isa_limit(limit);
+
+                for (int32_t value : { -25, 0, 7, 100 }) {
+                    auto first = std::find(ints.begin(), ints.end(), value);
+                    EXPECT_EQ(first != ints.end() ? size_t(first - ints.begin()) : npos, find(ints.data(), size, value));
+                    auto last = std::find(ints.rbegin(), ints.rend(), value);
+                    EXPECT_EQ(last != ints.rend() ? size_t(ints.rend() - last - 1) : npos, find_last(ints.data(), size, value));
+                    EXPECT_EQ(size_t(std::count(ints.begin(), ints.end(), value)), count(ints.data(), size, value));
+
+                    const float real = value * 0.5f;
+                    EXPECT_EQ(size_t(std::count(reals.begin(), reals.end(), real)), count(reals.data(), size, real));
+                    auto firstReal = std::find(reals.begin(), reals.end(), real);
+                    EXPECT_EQ(firstReal != reals.end() ? size_t(firstReal - reals.begin()) : npos, find(reals.data(), size, real));
+                }
+
+                EXPECT_EQ(*std::min_element(ints.begin(), ints.end()), min(ints.data(), size));
+                EXPECT_EQ(*std::max_element(ints.begin(), ints.end()), max(ints.data(), size));
+                EXPECT_EQ(*std::min_element(reals.begin(), reals.end()), min(reals.data(), size));
+                EXPECT_EQ(*std::max_element(reals.begin(), reals.end()), max(reals.data(), size));
+
+                EXPECT_EQ(std::accumulate(ints.begin(), ints.end(), int64_t(0)), sum(ints.data(), size));
+                EXPECT_NEAR(std::accumulate(reals.begin(), reals.end(), 0.0), sum(reals.data(), size), 1e-9);
+            }
+        }
+
+        set_isa_limit(isa::avx2);
+    }
+}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace collections {
+
+    // Search and aggregate kernels over packed int32/float arrays (see array::u_packed_numbers).
+    // AVX2 or SSE2 versions are chosen at runtime, the scalar ones are the fallback
+    namespace packed_kernels {
+
+        static const size_t npos = size_t(-1);
+
+        enum class isa {
+            scalar,
+            sse2,
+            avx2,
+        };
+
+        // the best instruction set available, limited by the set_isa_limit
+        isa active_isa();
+        // to test and benchmark the slower kernels
+        void set_isa_limit(isa limit);
+
+        // index of the first/last element equal to the @value or npos
+        size_t find(const int32_t *data, size_t count, int32_t value);
+        size_t find(const float *data, size_t count, float value);
+        size_t find_last(const int32_t *data, size_t count, int32_t value);
+        size_t find_last(const float *data, size_t count, float value);
+
+        size_t count(const int32_t *data, size_t count, int32_t value);
+        size_t count(const float *data, size_t count, float value);
+
+        // the @count must be non-zero
+        int32_t min(const int32_t *data, size_t count);
+        float min(const float *data, size_t count);
+        int32_t max(const int32_t *data, size_t count);
+        float max(const float *data, size_t count);
+
+        // accumulated in the wider type: the integers don't overflow, the floats lose less precision.
+        // The order of the float additions depends on the instruction set, so do the last bits of the result
+        int64_t sum(const int32_t *data, size_t count);
+        double sum(const float *data, size_t count);
+    }
+}
@@ -0,0 +1,179 @@
+#include <vector>
+#include <string>
+#include <random>
+
+#include "gtest.h"
+
+#include "util/stl_ext.h"
+#include "collections/collections.h"
+#include "collections/context.h"
+#include "collections/synthetic_db.h"
+
+namespace collections {
+
+    namespace {
+
+        class synthetic_db_builder {
+        public:
+            synthetic_db_builder(tes_context& context, const synthetic_db_options& options)
+                : _context(context)
+                , _options(options)
+                , _random(options.seed)
+                , _types({ (double)options.arrays, (double)options.maps, (double)options.form_maps,
+                    (double)options.integer_maps, (double)options.sets })
+                , _string_length(1.0 / (options.mean_string_length + 1.0))
+            {
+                // the strings are the slices of a single random text, it's faster than the characters one by one
+                std::uniform_int_distribution<int> letter('a', 'z');
+                _text.resize(1 << 16);
+                for (auto& c : _text) {
+                    c = (char)letter(_random);
+                }
+            }
+
+            synthetic_db_stats build() {
+                if (_options.objects == 0) {
+                    return _stats;
+                }
+
+                std::vector<object_base *> objects;
+                objects.reserve(_options.objects);
+
+                auto& root = map::object(_context);
+                _context.set_root(&root);
+                objects.push_back(&root);
+
+                const size_t fanOut = (std::max)(_options.fan_out, 1u);
+                std::bernoulli_distribution hasCycle(_options.cycle_share);
+
+                for (size_t i = 1; i < _options.objects; ++i) {
+                    object_base& obj = make_container();
+                    objects.push_back(&obj);
+
+                    const size_t parent = (i - 1) / fanOut;
+                    add(*objects[parent], item(&obj));
+
+                    if (parent > 0 && hasCycle(_random)) {
+                        add(obj, item(objects[(parent - 1) / fanOut]));
+                        ++_stats.cycles;
+                    }
+                }
+
+                for (auto obj : objects) {
+                    for (uint32_t v = 0; v < _options.values; ++v) {
+                        add(*obj, make_value());
+                    }
+                }
+
+                _stats.root = root.uid();
+                _stats.objects = objects.size();
+                return _stats;
+            }
+
+        private:
+            object_base& make_container() {
+                switch (_types(_random)) {
+                case 0: return array::object(_context);
+                case 1: return map::object(_context);
+                case 2: return form_map::object(_context);
+                case 3: return integer_map::object(_context);
+                default: return item_set::object(_context);
+                }
+            }
+
+            form_ref make_form(uint32_t index) {
+                ++_stats.forms;
+                std::uniform_int_distribution<int> plugin('A', 'Z');
+                return make_weak_form_id(util::to_enum<FormId>(uint32_t(plugin(_random)) << 24 | (0x800 + (index & 0xffff))), _context);
+            }
+
+            item make_value() {
+                std::uniform_real_distribution<double> kind(0, 1);
+                const double k = kind(_random);
+
+                if (k < _options.string_share) {
+                    const size_t length = (std::min)(_string_length(_random), _text.size() / 2);
+                    const size_t offset = std::uniform_int_distribution<size_t>(0, _text.size() - length)(_random);
+                    ++_stats.strings;
+                    _stats.string_bytes += length;
+                    return item(_text.substr(offset, length));
+                }
+                if (k < _options.string_share + _options.form_share) {
+                    return item(make_form(_next_key++));
+                }
+                if (k < (1 + _options.string_share + _options.form_share) / 2) {
+                    return item(std::uniform_int_distribution<int32_t>()(_random));
+                }
+                return item((float)kind(_random));
+            }
+
+            // the keys are unique within the container
+            void add(object_base& container, item&& value) {
+                const uint32_t key = _next_key++;
+                switch (container.type()) {
+                case CollectionType::Array:
+                    container.as_link<array>().u_push(std::move(value));
+                    break;
+                case CollectionType::Map:
+                    container.as_link<map>().u_set("key" + std::to_string(key), std::move(value));
+                    break;
+                case CollectionType::FormMap:
+                    container.as_link<form_map>().u_set(make_form(key), std::move(value));
+                    break;
+                case CollectionType::IntegerMap:
+                    container.as_link<integer_map>().u_set((int32_t)key, std::move(value));
+                    break;
+                default:
+                    if (!container.as_link<item_set>().u_add(std::move(value))) {
+                        return;
+                    }
+                    break;
+                }
+                ++_stats.items;
+            }
+
+            tes_context& _context;
+            const synthetic_db_options& _options;
+            std::mt19937 _random;
+            std::discrete_distribution<int> _types;
+            std::geometric_distribution<size_t> _string_length;
+            std::string _text;
+            uint32_t _next_key = 0;
+            synthetic_db_stats _stats;
+        };
+    }
+
+    synthetic_db_stats generate_synthetic_db(tes_context& context, const synthetic_db_options& options) {
+        return synthetic_db_builder(context, options).build();
+    }
+
+    TEST(synthetic_db, generate)
+    {
+        synthetic_db_options options;
+        options.objects = 2000;
+        options.cycle_share = 0.1;
+
+        tes_context_standalone ctx;
+        const auto stats = generate_synthetic_db(ctx, options);
+
+        EXPECT_EQ(2000u, stats.objects);
+        EXPECT_EQ(2000u, ctx.object_count());
+        EXPECT_GT(stats.cycles, 0u);
+        EXPECT_GT(stats.strings, 0u);
+        EXPECT_GT(stats.forms, 0u);
+        EXPECT_EQ(stats.root, ctx.root().uid());
+
+        // the same seed - the same graph
+        tes_context_standalone other;
+        const auto otherStats = generate_synthetic_db(other, options);
+        EXPECT_EQ(stats.items, otherStats.items);
+        EXPECT_EQ(stats.string_bytes, otherStats.string_bytes);
+        EXPECT_EQ(stats.cycles, otherStats.cycles);
+
+        // nothing is garbage, the cycles included
+        ctx.read_from_string(ctx.write_to_string());
+        EXPECT_EQ(2000u, ctx.object_count());
+        ctx.collect_garbage();
+        EXPECT_EQ(2000u, ctx.object_count());
+    }
+}
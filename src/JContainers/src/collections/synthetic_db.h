@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "object/object_base.h"
+
+namespace collections {
+
+    class tes_context;
+
+    // The parameters of a synthetic object graph, for the load/save/GC benchmarks. The same seed builds the same graph.
+    // The containers form a tree of the given fan-out under the root map, each holds the scalar values as well
+    struct synthetic_db_options {
+        size_t objects = 10000;
+        uint32_t seed = 1;
+
+        // the type mix, the relative weights
+        uint32_t arrays = 4;
+        uint32_t maps = 3;
+        uint32_t form_maps = 1; // keyed by the forms
+        uint32_t integer_maps = 1;
+        uint32_t sets = 1;
+
+        uint32_t fan_out = 4; // the child containers per container
+        uint32_t values = 4; // the scalar values per container
+        double string_share = 0.3; // of the scalar values
+        double mean_string_length = 16; // the lengths are geometrically distributed
+        double form_share = 0.1; // of the scalar values
+        double cycle_share = 0.01; // of the containers, these reference their grandparent as well
+    };
+
+    struct synthetic_db_stats {
+        Handle root = Handle::Null;
+        size_t objects = 0;
+        size_t items = 0;
+        size_t strings = 0;
+        size_t string_bytes = 0;
+        size_t forms = 0; // the form values and the form keys
+        size_t cycles = 0;
+    };
+
+    // Builds the graph into the @context, the root map becomes the root of the context
+    synthetic_db_stats generate_synthetic_db(tes_context& context, const synthetic_db_options& options);
+}
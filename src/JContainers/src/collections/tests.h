@@ -627,6 +627,297 @@ namespace collections { namespace {
         EXPECT_TRUE((1 + rcDiff2) == rcDiff);
     }
 
+    JC_TEST(tes_context, compact_format_round_trip)
+    {
+        auto& root = map::object(context);
+        context.set_root(&root);
+
+        auto& values = array::object(context);
+        auto& shared = map::object(context);
+        shared.u_set("name", "shared");
+        shared.u_set("self", &shared); // a cycle
+        for (int i = 0; i < 100; ++i) {
+            values.u_push(item(i * 1000 - 50000));
+            values.u_push(item(i % 3 ? "repeated" : "unique"));
+            values.u_push(item(i * 0.5f));
+            values.u_push(item());
+            values.u_push(item(&shared));
+        }
+        root.u_set("values", &values);
+
+        auto& ints = integer_map::object(context);
+        for (int32_t key : { -100000, -1, 0, 7, 100000, INT32_MAX }) {
+            ints.u_set(key, item(std::to_string(key)));
+        }
+        root.u_set("ints", &ints);
+
+        auto& counters = counter_map::object(context);
+        counters.u_set("a", item(5));
+        counters.u_set("b", item(2.5f));
+        root.u_set("counters", &counters);
+
+        auto& set = item_set::object(context);
+        set.u_add(item("x"));
+        set.u_add(item(&shared));
+        root.u_set("set", &set);
+
+        auto& history = ring_buffer::objectWithInitializer([](ring_buffer& me) { me.u_reset(3); }, context);
+        for (int i = 0; i < 5; ++i) {
+            history.u_push(item(i));
+        }
+        root.u_set("history", &history);
+
+        auto& queue = priority_heap::object(context);
+        queue.u_push(item("late"), 10.f);
+        queue.u_push(item(&values), 1.f);
+        root.u_set("queue", &queue);
+
+        root.set_tag("tagged");
+        const Handle rootId = root.uid();
+        const Handle sharedId = shared.uid();
+
+        auto jsonBefore = json_serializer::create_json_value(root);
+        const size_t objectCount = context.object_count();
+
+        context.read_from_string(context.write_to_string());
+
+        EXPECT_EQ(objectCount, context.object_count());
+        auto loaded = context.getObjectOfType<map>(rootId);
+        EXPECT_NOT_NIL(loaded);
+        EXPECT_TRUE(&context.root() == loaded);
+        EXPECT_TRUE(loaded->has_equal_tag("tagged"));
+        EXPECT_TRUE(context.getObject(sharedId) == loaded->u_get("values")->object()->as<array>()->u_get(4)->object());
+
+        auto jsonAfter = json_serializer::create_json_value(*loaded);
+        EXPECT_TRUE(json_equal(jsonBefore.get(), jsonAfter.get()) == 1);
+
+        // the ids handed out after the load don't collide with the loaded ones
+        auto& fresh = map::object(context);
+        EXPECT_TRUE(fresh.uid() != rootId && fresh.uid() != sharedId);
+    }
+
+    JC_TEST(tes_context, compressed_saves)
+    {
+        auto& root = map::object(context);
+        context.set_root(&root);
+        for (int i = 0; i < 20000; ++i) {
+            auto& entry = map::object(context);
+            entry.u_set("name", item("actor " + std::to_string(i % 500)));
+            entry.u_set("description", item("a string-heavy value, " + std::to_string(i) + " of many similar ones"));
+            entry.u_set("level", item(i % 80));
+            root.u_set("key" + std::to_string(i), item(&entry));
+        }
+        const Handle rootId = root.uid();
+        auto jsonBefore = json_serializer::create_json_value(root);
+
+        namespace chr = std::chrono;
+        auto roundTrip = [&](bool compressed) {
+            context.compress_saves = compressed;
+
+            auto started = chr::steady_clock::now();
+            const std::string state = context.write_to_string();
+            auto written = chr::steady_clock::now();
+            context.read_from_string(state);
+            auto read = chr::steady_clock::now();
+
+            JC_log("%s save: %lu bytes, written in %lld ms, read in %lld ms", compressed ? "compressed" : "uncompressed",
+                state.size(),
+                chr::duration_cast<chr::milliseconds>(written - started).count(),
+                chr::duration_cast<chr::milliseconds>(read - written).count());
+
+            auto loaded = context.getObjectOfType<map>(rootId);
+            EXPECT_NOT_NIL(loaded);
+            auto jsonAfter = json_serializer::create_json_value(*loaded);
+            EXPECT_TRUE(json_equal(jsonBefore.get(), jsonAfter.get()) == 1);
+            return state.size();
+        };
+
+        const size_t uncompressedSize = roundTrip(false);
+        const size_t compressedSize = roundTrip(true);
+        EXPECT_TRUE(compressedSize < uncompressedSize / 2);
+
+        // a truncated save fails to load instead of loading the garbage
+        const std::string state = context.write_to_string();
+        context.read_from_string(state.substr(0, state.size() / 2));
+        EXPECT_EQ(0, context.object_count());
+    }
+
+    JC_TEST(tes_context, form_table_round_trip)
+    {
+        auto& root = map::object(context);
+        context.set_root(&root);
+        auto& forms = array::object(context);
+        auto& byForm = form_map::object(context);
+        for (uint32_t i = 0; i < 50; ++i) {
+            // five plugins, every form occurs three times - a single entry of the table
+            const auto form = make_lightweight_form_ref(util::to_enum<FormId>(('A' + i % 5) << 24 | (0x100 + i)), context).to_form_ref();
+            forms.u_push(item(form));
+            forms.u_push(item(form));
+            byForm.u_set(form, item(int(i)));
+        }
+        root.u_set("forms", &forms);
+        root.u_set("byForm", &byForm);
+        const Handle rootId = root.uid();
+        auto jsonBefore = json_serializer::create_json_value(root);
+
+        context.read_from_string(context.write_to_string());
+
+        auto loaded = context.getObjectOfType<map>(rootId);
+        EXPECT_NOT_NIL(loaded);
+        auto jsonAfter = json_serializer::create_json_value(*loaded);
+        EXPECT_TRUE(json_equal(jsonBefore.get(), jsonAfter.get()) == 1);
+
+        auto loadedMap = loaded->u_get("byForm")->object()->as<form_map>();
+        EXPECT_NOT_NIL(loadedMap);
+        EXPECT_EQ(50, loadedMap->u_count());
+        auto value = loadedMap->u_get(make_lightweight_form_ref(util::to_enum<FormId>(('C' << 24) | 0x107), context));
+        EXPECT_NOT_NIL(value);
+        EXPECT_EQ(7, value->intValue());
+    }
+
+    JC_TEST(tes_context, deduplicated_save)
+    {
+        // the per-actor copies of a default config
+        auto makeConfig = [&]() -> map& {
+            auto& config = map::object(context);
+            config.u_set("name", item("default config"));
+            config.u_set("threshold", item(0.5f));
+            auto& weights = array::object(context);
+            for (int i = 0; i < 10; ++i) {
+                weights.u_push(item(i));
+            }
+            config.u_set("weights", &weights);
+            return config;
+        };
+
+        auto& root = map::object(context);
+        context.set_root(&root);
+        auto& configs = array::object(context);
+        for (int i = 0; i < 20; ++i) {
+            configs.u_push(item(&makeConfig()));
+        }
+        root.u_set("configs", &configs);
+        // keeps its handle, whether it gets written as a copy or not
+        auto& shared = makeConfig();
+        root.u_set("shared", &shared);
+        const Handle sharedId = shared.uid();
+        const Handle rootId = root.uid();
+        auto jsonBefore = json_serializer::create_json_value(root);
+        const size_t objectCount = context.object_count();
+
+        context.compress_saves = false;
+        const std::string plain = context.write_to_string();
+        context.deduplicate_saves = true;
+        EXPECT_EQ(0u, context.last_dedup_stats().hashed);
+        const std::string deduplicated = context.write_to_string();
+        EXPECT_TRUE(deduplicated.size() < plain.size() / 2);
+        EXPECT_GT(context.last_dedup_stats().hashed, 0u); // the u_print_stats logs them
+
+        // the stats are the ones of the snapshot, once written
+        {
+            const auto state = context.u_take_snapshot(false);
+            EXPECT_EQ(0u, state.objects->stats.hashed);
+            std::ostringstream stream;
+            {
+                compact_writer archive{ stream };
+                tes_context::save_compact(archive, state);
+            }
+            EXPECT_GT(state.objects->stats.hashed, 0u);
+            EXPECT_GT(state.objects->stats.copies, 0u);
+        }
+
+        context.read_from_string(deduplicated);
+        EXPECT_EQ(objectCount, context.object_count());
+        auto loaded = context.getObjectOfType<map>(rootId);
+        EXPECT_NOT_NIL(loaded);
+        auto jsonAfter = json_serializer::create_json_value(*loaded);
+        EXPECT_TRUE(json_equal(jsonBefore.get(), jsonAfter.get()) == 1);
+        EXPECT_TRUE(context.getObjectOfType<map>(sharedId) == loaded->u_get("shared")->object());
+
+        // the copies are distinct objects
+        auto loadedConfigs = loaded->u_get("configs")->object()->as<array>();
+        EXPECT_NOT_NIL(loadedConfigs);
+        auto first = loadedConfigs->u_get(0)->object()->as<map>();
+        auto second = loadedConfigs->u_get(1)->object()->as<map>();
+        EXPECT_TRUE(first != second);
+        auto firstWeights = first->u_get("weights")->object()->as<array>();
+        auto secondWeights = second->u_get("weights")->object()->as<array>();
+        EXPECT_TRUE(firstWeights != secondWeights);
+        firstWeights->u_push(item(10));
+        EXPECT_EQ(10, secondWeights->u_count());
+    }
+
+    JC_TEST(tes_context, snapshot_ignores_later_changes)
+    {
+        auto& root = map::object(context);
+        context.set_root(&root);
+        auto& values = array::object(context);
+        for (int i = 0; i < 10; ++i) {
+            values.u_push(item(i));
+        }
+        root.u_set("values", &values);
+        root.u_set("removed", &map::object(context));
+        root.u_set("name", "before");
+        auto& cursor = map_cursor::object(context);
+        root.u_set("cursor", &cursor);
+
+        cursor.reset(root);
+        cursor.next();
+        cursor.next(); // "name" - the keys are ordered
+        const Handle rootId = root.uid();
+        const Handle cursorId = cursor.uid();
+        auto jsonBefore = json_serializer::create_json_value(root);
+
+        auto state = context.u_take_snapshot(true);
+
+        // nothing is copied upfront but the cursor: its position changes without its lock
+        for (auto& e : state.objects->objects) {
+            EXPECT_EQ(e.object->type() != CollectionType::MapCursor, e.contents == e.object.get());
+        }
+
+        // the objects keep changing as the snapshot gets written, the writers keep the captured contents
+        {
+            object_lock g(values);
+            values.u_push(item(10));
+            values.u_erase(0);
+        }
+        {
+            object_lock g(root);
+            root.u_erase("removed");
+            root.u_set("name", "after");
+            root.u_set("added", &array::object(context));
+        }
+        cursor.next();
+        EXPECT_TRUE(values._save_copy != nullptr);
+        EXPECT_TRUE(root._save_copy != nullptr);
+
+        std::stringstream stream;
+        {
+            compact_writer archive{ stream };
+            tes_context::save_compact(archive, state);
+        }
+        state = tes_context::snapshot{};
+        EXPECT_TRUE(values._save_copy == nullptr);
+
+        context.clearState();
+        forms::form_observer observer;
+        compact_reader archive{ stream, observer };
+        context.load_compact(archive);
+        context.u_postLoadInitializations();
+
+        auto loaded = context.getObjectOfType<map>(rootId);
+        EXPECT_NOT_NIL(loaded);
+        auto jsonAfter = json_serializer::create_json_value(*loaded);
+        EXPECT_TRUE(json_equal(jsonBefore.get(), jsonAfter.get()) == 1);
+
+        // the cursor is restored at the pair it pointed to when the snapshot was taken
+        auto loadedCursor = context.getObjectOfType<map_cursor>(cursorId);
+        EXPECT_NOT_NIL(loadedCursor);
+        std::string key;
+        EXPECT_TRUE(loadedCursor->visit_current([&](const auto& k, const item&) { key = k.c_str(); }));
+        EXPECT_EQ("name", key);
+    }
+
     JC_TEST(autorelease_queue, over_release)
     {
         std::vector<Handle> identifiers;
@@ -713,5 +1004,200 @@ namespace collections { namespace {
         obj.u_set("lol", obj);
     }
 
+    JC_TEST(object_base, lock_contention_report)
+    {
+        const bool wasTracking = util::adaptive_lock::is_contention_tracking_enabled();
+        util::adaptive_lock::enable_contention_tracking(true);
+
+        auto& hot = map::object(context);
+        auto& cold = map::object(context);
+        hot.tes_retain();
+        cold.tes_retain();
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([&hot]() {
+                for (int j = 0; j < 10000; ++j) {
+                    hot.set("key", item(j));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        cold.set("key", item(0));
+
+        util::adaptive_lock::enable_contention_tracking(wasTracking);
+
+        auto report = context.most_contended_objects(10);
+        if (!report.empty()) { // contention isn't guaranteed on a single-core machine
+            EXPECT_EQ(&hot, report.front().first.get());
+            EXPECT_EQ(1u, report.size());
+        }
+
+        hot.tes_release();
+        cold.tes_release();
+    }
+
+    TEST(order_statistic_map, matches_std_map)
+    {
+        util::order_statistic_map<int32_t, int32_t> tree;
+        std::map<int32_t, int32_t> reference;
+
+        std::mt19937 random(42);
+        for (int32_t i = 0; i < 20000; ++i) {
+            const int32_t key = random() % 1000;
+            switch (random() % 3) {
+            case 0:
+                tree[key] = i;
+                reference[key] = i;
+                break;
+            case 1:
+                EXPECT_EQ(reference.erase(key), tree.erase(key));
+                break;
+            default:
+                if (!reference.empty()) {
+                    const size_t index = random() % reference.size();
+                    auto expected = std::next(reference.begin(), index);
+                    auto itr = tree.nth(index);
+                    EXPECT_EQ(expected->first, itr->first);
+                    EXPECT_EQ(index, tree.index_of(itr));
+                }
+                break;
+            }
+        }
+
+        EXPECT_EQ(reference.size(), tree.size());
+        EXPECT_TRUE(std::equal(tree.begin(), tree.end(), reference.begin(), reference.end()));
+        EXPECT_TRUE(std::equal(tree.rbegin(), tree.rend(), reference.rbegin(), reference.rend()));
+        EXPECT_TRUE(tree.nth(tree.size()) == tree.end());
+
+        auto copy = tree;
+        EXPECT_TRUE(std::equal(copy.begin(), copy.end(), reference.begin(), reference.end()));
+    }
+
+    TEST(devector, matches_std_vector)
+    {
+        util::devector<item> items;
+        std::vector<item> reference;
+
+        std::mt19937 random(42);
+        for (int32_t i = 0; i < 20000; ++i) {
+            const size_t index = reference.empty() ? 0 : random() % (reference.size() + 1);
+            switch (random() % 5) {
+            case 0:
+                items.emplace_back(i);
+                reference.emplace_back(i);
+                break;
+            case 1:
+                items.insert(items.begin(), item(std::to_string(i)));
+                reference.insert(reference.begin(), item(std::to_string(i)));
+                break;
+            case 2:
+                items.insert(items.begin() + index, item(i));
+                reference.insert(reference.begin() + index, item(i));
+                break;
+            case 3:
+                if (index < reference.size()) {
+                    items.erase(items.begin() + index);
+                    reference.erase(reference.begin() + index);
+                }
+                break;
+            default:
+                if (!reference.empty()) {
+                    items.pop_back();
+                    reference.pop_back();
+                }
+                break;
+            }
+        }
+
+        EXPECT_EQ(reference.size(), items.size());
+        EXPECT_TRUE(std::equal(items.begin(), items.end(), reference.begin(), reference.end()));
+
+        items.insert(items.begin() + items.size() / 3, items.begin(), items.end()); // a range of its own
+        const auto inserted = reference;
+        reference.insert(reference.begin() + reference.size() / 3, inserted.begin(), inserted.end());
+        EXPECT_TRUE(std::equal(items.rbegin(), items.rend(), reference.rbegin(), reference.rend()));
+
+        auto copy = items;
+        EXPECT_TRUE(copy == items);
+    }
+
+    TEST(open_hash_set, matches_linear_search)
+    {
+        item_set::container_type set;
+        std::vector<item> reference;
+
+        std::mt19937 random(7);
+        for (int32_t i = 0; i < 20000; ++i) {
+            const int32_t value = random() % 300;
+            const item itm = (value % 3 == 0) ? item(value % 2 ? "Key" + std::to_string(value) : "KEY" + std::to_string(value)) : item(value);
+            auto found = std::find(reference.begin(), reference.end(), itm);
+
+            if (random() % 3) {
+                EXPECT_EQ(found == reference.end(), set.insert(itm).second);
+                if (found == reference.end()) {
+                    reference.push_back(itm);
+                }
+            }
+            else {
+                EXPECT_EQ(found != reference.end(), set.erase(itm));
+                if (found != reference.end()) {
+                    reference.erase(found);
+                }
+            }
+            EXPECT_EQ(reference.size(), set.size());
+        }
+
+        for (int32_t value = 0; value < 300; ++value) {
+            const item lower = value % 3 == 0 ? item("key" + std::to_string(value)) : item(value);
+            EXPECT_EQ(std::find(reference.begin(), reference.end(), lower) != reference.end(), set.contains(lower));
+        }
+        EXPECT_TRUE(std::is_permutation(set.begin(), set.end(), reference.begin(), reference.end()));
+
+        item_set::container_type copy = set;
+        EXPECT_TRUE(copy == set);
+        copy.erase_at(0);
+        EXPECT_FALSE(copy == set);
+    }
+
+    JC_TEST(object_base, readers_dont_contend)
+    {
+        auto& obj = map::object(context);
+        obj.tes_retain();
+        for (int i = 0; i < 64; ++i) {
+            obj.set(std::to_string(i), item(i));
+        }
+
+        const bool wasTracking = util::adaptive_lock::is_contention_tracking_enabled();
+        util::adaptive_lock::enable_contention_tracking(true);
+
+        // the readers share the lock: none of them may take the contended path
+        const int readsPerThread = 100000;
+        std::vector<std::thread> threads;
+        std::atomic<int> mismatches = 0;
+        for (int i = 0; i < 8; ++i) {
+            threads.emplace_back([&obj, &mismatches]() {
+                for (int j = 0; j < readsPerThread; ++j) {
+                    auto value = obj.get_item(std::to_string(j % 64));
+                    if (!value || value->intValue() != j % 64) {
+                        ++mismatches;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        util::adaptive_lock::enable_contention_tracking(wasTracking);
+
+        EXPECT_EQ(0, mismatches.load());
+        EXPECT_EQ(0u, obj.mutex().contentions());
+
+        obj.tes_release();
+    }
+
 }
 }
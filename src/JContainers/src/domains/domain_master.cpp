@@ -1,12 +1,20 @@
 #include <vector>
+#include <deque>
 #include <map>
+#include <memory>
 #include <functional>
 #include <exception>
 #include <type_traits>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <chrono>
 
 #include "boost/filesystem/path.hpp"
 #include "boost/filesystem/operations.hpp"
 #include "boost/archive/binary_oarchive.hpp"
+#include "boost/iostreams/stream.hpp"
+#include "boost/iostreams/device/array.hpp"
 
 #include "jansson.h"
 #include "gtest/gtest.h"
@@ -16,9 +24,12 @@
 #include "util/singleton.h"
 #include "util/util.h"
 #include "util/istring.h"
+#include "util/lz_codec.h"
+#include "util/background_writer.h"
 #include "iarchive_with_blob.h"
 
 #include "object/object_context.h"
+#include "collections/compact_archive.h"
 #include "domains/domain_master.h"
 
 
@@ -90,6 +101,7 @@ namespace domain_master {
         auto u_clearState(master& ths) -> void {
             ths.get_form_observer().u_clearState();
             invoke_for_all(ths, std::mem_fn(&context::u_clearState));
+            ths.current_base = master::base_image{};
         }
 
         auto u_print_stats(master& self) -> void {
@@ -125,16 +137,22 @@ namespace domain_master {
         struct header {
 
             serialization_version commonVersion;
+            bool compressed; // the data following the header goes through util::lz_compressor
+            master::base_image base; // the data is a delta to this base image if its file isn't empty
 
             static header imitate_old_header() {
-                return{ serialization_version::no_header };
+                return{ serialization_version::no_header, false };
             }
 
             static header make() {
-                return{ serialization_version::current };
+                return{ serialization_version::current, false };
             }
 
             static const char *common_version_key() { return "commonVersion"; }
+            static const char *compression_key() { return "compression"; }
+            static const char *lz_compression() { return "lz"; }
+            static const char *base_file_key() { return "baseImage"; }
+            static const char *base_id_key() { return "baseId"; }
 
             static header read_from_stream(std::istream & stream) {
 
@@ -149,19 +167,38 @@ namespace domain_master {
                     return imitate_old_header();
                 }
 
-                return{ (serialization_version)json_integer_value(json_object_get(js.get(), common_version_key())) };
+                const char *compression = json_string_value(json_object_get(js.get(), compression_key()));
+                const char *baseFile = json_string_value(json_object_get(js.get(), base_file_key()));
+                return{
+                    (serialization_version)json_integer_value(json_object_get(js.get(), common_version_key())),
+                    compression && strcmp(compression, lz_compression()) == 0,
+                    {
+                        baseFile ? baseFile : "",
+                        (uint64_t)json_integer_value(json_object_get(js.get(), base_id_key())),
+                    },
+                };
             }
 
-            static auto write_to_json() -> decltype(make_unique_ptr((json_t *)nullptr, &json_decref)) {
+            // the base image file itself has the id only
+            static auto write_to_json(bool compressed, const master::base_image& base) -> decltype(make_unique_ptr((json_t *)nullptr, &json_decref)) {
                 auto header = make_unique_ptr(json_object(), &json_decref);
 
                 json_object_set(header.get(), common_version_key(), json_integer((json_int_t)serialization_version::current));
+                if (compressed) {
+                    json_object_set_new(header.get(), compression_key(), json_string(lz_compression()));
+                }
+                if (!base.file.empty()) {
+                    json_object_set_new(header.get(), base_file_key(), json_string(base.file.c_str()));
+                }
+                if (base.id != 0) {
+                    json_object_set_new(header.get(), base_id_key(), json_integer((json_int_t)base.id));
+                }
 
                 return header;
             }
 
-            static void write_to_stream(std::ostream & stream) {
-                auto header = write_to_json();
+            static void write_to_stream(std::ostream & stream, bool compressed, const master::base_image& base = {}) {
+                auto header = write_to_json(compressed, base);
                 auto data = make_unique_ptr(json_dumps(header.get(), 0), free);
 
                 uint32_t hdrSize = strlen(data.get());
@@ -170,6 +207,484 @@ namespace domain_master {
             }
         };
 
+        // [(name, domain)] -> stream. Unlike the boost archive, the form observer isn't stored:
+        // its entries get recreated as the forms are read
+        struct master_snapshot {
+            using snapshot_kind = context::snapshot_kind;
+
+            snapshot_kind kind = snapshot_kind::full;
+            context::snapshot default_domain;
+            std::vector<std::pair<std::string, context::snapshot>> domains;
+
+            template<class F>
+            void for_each(F&& func) const {
+                func(default_domain);
+                for (auto& pair : domains) {
+                    func(pair.second);
+                }
+            }
+        };
+
+        // The activity resumes before the snapshot gets written, either way: the snapshots are copy-on-write
+        auto take_snapshot(const master& self, master_snapshot::snapshot_kind kind) -> master_snapshot {
+            auto take = [&](const context& dom) {
+                auto snapshot = dom.u_take_snapshot(true, kind);
+                snapshot.objects->deduplicate = self.deduplicate_saves;
+                return snapshot;
+            };
+
+            master_snapshot state;
+            state.kind = kind;
+            state.default_domain = take(self.get_default_domain());
+            for (auto& pair : self.active_domains_map()) {
+                state.domains.emplace_back(*reinterpret_cast<std::string const*> (&pair.first), take(*pair.second));
+            }
+            return state;
+        }
+
+        // Each domain is a section of its own: [default] [count] ([name] [section])... The section is the data of the domain
+        // and its tables, the frames the compact_writer::write_framed_with_tables streams out - the encoded domain
+        // is never held in memory
+        using save_domain = void(*)(collections::compact_writer&, const context::snapshot&);
+
+        auto save_domains(const master_snapshot& state, collections::compact_writer& archive, save_domain save) -> void {
+            auto writeSection = [&](const context::snapshot& dom) {
+                archive.write_framed_with_tables([&](collections::compact_writer& ar) {
+                    save(ar, dom);
+                });
+            };
+
+            writeSection(state.default_domain);
+
+            archive.write_varint(state.domains.size());
+            for (auto& pair : state.domains) {
+                archive.write_string(pair.first);
+                writeSection(pair.second);
+            }
+        }
+
+        auto save_compact(const master_snapshot& state, collections::compact_writer& archive) -> void {
+            save_domains(state, archive, &context::save_compact);
+        }
+
+        auto save_compact_delta(const master_snapshot& state, collections::compact_writer& archive) -> void {
+            save_domains(state, archive, &context::save_compact_delta);
+        }
+
+        template<class Save>
+        auto write_compact(std::ostream& stream, bool compressed, Save&& save) -> void {
+            auto write = [&save](std::ostream& out) {
+                collections::compact_writer archive{ out };
+                save(archive);
+            };
+            if (compressed) {
+                util::lz_compress_stream(stream, write);
+            }
+            else {
+                write(stream);
+            }
+        }
+
+        // Calls func(index) for every index of [0, count): the first call is made on this thread, the rest on threads
+        // of their own. Rethrows the exception of the lowest index once all the calls are done
+        template<class F>
+        auto for_each_in_parallel(size_t count, F&& func) -> void {
+            std::vector<std::exception_ptr> failures(count);
+            auto call = [&](size_t i) {
+                try {
+                    func(i);
+                }
+                catch (...) {
+                    failures[i] = std::current_exception();
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < count; ++i) {
+                try {
+                    threads.emplace_back(call, i);
+                }
+                catch (const std::system_error&) { // out of threads
+                    call(i);
+                }
+            }
+            if (count > 0) {
+                call(0);
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            for (auto& failure : failures) {
+                if (failure) {
+                    std::rethrow_exception(failure);
+                }
+            }
+        }
+
+        auto milliseconds_since(std::chrono::steady_clock::time_point started) -> long long {
+            namespace chr = std::chrono;
+            return chr::duration_cast<chr::milliseconds>(chr::steady_clock::now() - started).count();
+        }
+
+        auto domain_name_for_log(const std::string& name) -> const char * {
+            return name.empty() ? "(default)" : name.c_str();
+        }
+
+        // Reads the domains the save_domains has written. resolve(name) maps the name (empty for the default domain)
+        // to the target to load, it's called on this thread in the order of the domains.
+        // Then load(target, archive) reads the domain: a framed section gets decoded on a thread of its own, with
+        // an archive of its own, while this thread reads the next one. The last one gets decoded on this thread.
+        // The encoded section is released once decoded.
+        // With @lazily, the sections become the images the objects get decoded from on demand
+        template<class Resolve, class Load>
+        auto load_domains(master& self, collections::compact_reader& archive, bool lazily,
+            Resolve&& resolve, Load&& load) -> void
+        {
+            using target = decltype(resolve(std::string()));
+            struct section {
+                std::string name;
+                target domain;
+                std::string data;
+                std::string tables;
+                long long elapsed;
+                size_t size;
+                std::exception_ptr failure;
+            };
+
+            auto decode = [&self, &load, lazily](section& sec) {
+                namespace io = boost::iostreams;
+                try {
+                    const auto started = std::chrono::steady_clock::now();
+                    sec.size = sec.data.size() + sec.tables.size();
+
+                    std::shared_ptr<collections::lazy_image> image;
+                    if (lazily) {
+                        image = std::make_shared<collections::lazy_image>();
+                        image->data = std::move(sec.data);
+                    }
+                    const std::string& data = image ? image->data : sec.data;
+
+                    io::stream<io::array_source> stream(io::array_source(data.data(), data.size()));
+                    collections::compact_reader sectionArchive{ stream, self.get_form_observer() };
+                    io::stream<io::array_source> tables(io::array_source(sec.tables.data(), sec.tables.size()));
+                    sectionArchive.read_tables(tables);
+                    if (image) {
+                        sectionArchive.read_lazily(image);
+                    }
+                    load(sec.domain, sectionArchive);
+
+                    sec.elapsed = milliseconds_since(started);
+                }
+                catch (...) {
+                    sec.failure = std::current_exception();
+                }
+                std::string().swap(sec.data);
+                std::string().swap(sec.tables);
+            };
+
+            std::deque<section> sections; // the decoding threads refer to the sections
+            std::vector<std::thread> threads;
+            struct joiner {
+                std::vector<std::thread>& threads;
+                ~joiner() {
+                    for (auto& thread : threads) {
+                        thread.join();
+                    }
+                    threads.clear();
+                }
+            };
+
+            auto readSection = [&](std::string name, bool last) {
+                auto domain = resolve(name);
+                sections.push_back({ std::move(name), domain, std::string(), std::string(), 0, 0 });
+                auto& sec = sections.back();
+                sec.data = archive.read_frame();
+                sec.tables = archive.read_frame();
+
+                if (!last) {
+                    try {
+                        threads.emplace_back(decode, std::ref(sec));
+                        return;
+                    }
+                    catch (const std::system_error&) { // out of threads
+                    }
+                }
+                decode(sec);
+            };
+
+            {
+                joiner joinThreads{ threads };
+
+                readSection(std::string(), false);
+                const size_t domainCount = archive.read_count();
+                for (size_t i = 0; i < domainCount; ++i) {
+                    readSection(archive.read_string(), i + 1 == domainCount);
+                }
+            }
+
+            for (auto& sec : sections) {
+                if (sec.failure) {
+                    std::rethrow_exception(sec.failure);
+                }
+            }
+
+            for (auto& sec : sections) {
+                JC_log("Domain %s: %u bytes %s in %lld ms", domain_name_for_log(sec.name), (uint32_t)sec.size,
+                    lazily ? "indexed" : "decoded", sec.elapsed);
+            }
+        }
+
+        auto load_compact(master& self, collections::compact_reader& archive) -> void {
+            load_domains(self, archive, self.lazy_load,
+                [&self](const std::string& name) -> context* {
+                    return name.empty() ? &self.get_default_domain() : &self.get_or_create_domain_with_name(name.c_str());
+                },
+                [](context* domain, collections::compact_reader& ar) {
+                    domain->load_compact(ar);
+                });
+        }
+
+        // The post-load passes of a domain don't touch the other domains - each domain gets a thread of its own.
+        // Nothing gets logged from these threads: the timings and the outcome of the garbage collection get logged
+        // once all the domains are done, in the order of the domains
+        auto u_post_load(master& self, serialization_version version) -> void {
+            struct timing {
+                std::string name;
+                context *domain;
+                long long initialization, maintenance;
+                context::maintenance_stats collected;
+            };
+
+            std::vector<timing> domains;
+            domains.push_back({ std::string(), &self.get_default_domain(), 0, 0 });
+            for (auto& pair : self.active_domains_map()) {
+                domains.push_back({ pair.first.c_str(), pair.second.get(), 0, 0 });
+            }
+
+            for_each_in_parallel(domains.size(), [&](size_t i) {
+                auto& dom = domains[i];
+
+                auto started = std::chrono::steady_clock::now();
+                dom.domain->u_postLoadInitializations();
+                dom.domain->u_applyUpdates(version);
+                dom.initialization = milliseconds_since(started);
+
+                started = std::chrono::steady_clock::now();
+                dom.domain->u_postLoadMaintenance(version, &dom.collected);
+                dom.maintenance = milliseconds_since(started);
+            });
+
+            for (auto& dom : domains) {
+                JC_log("Domain %s: initialized in %lld ms, maintenance took %lld ms. %u garbage objects collected, "
+                    "%u objects are parts of cyclic graphs", domain_name_for_log(dom.name), dom.initialization, dom.maintenance,
+                    (uint32_t)dom.collected.garbage, (uint32_t)dom.collected.part_of_graphs);
+            }
+        }
+
+        // The deduplication gets planned as the snapshot gets written, on the writer thread of the background saves.
+        // Its stats get recorded once the snapshot is written, the u_print_stats of the domains logs them
+        auto record_save_stats(master& self, const master_snapshot& state) -> void {
+            self.get_default_domain().record_save_stats(*state.default_domain.objects);
+            for (auto& pair : state.domains) {
+                self.get_or_create_domain_with_name(pair.first.c_str()).record_save_stats(*pair.second.objects);
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        // a new base image gets written once the delta changes more than this share of the base objects
+        const size_t max_delta_share = 4; // one fourth
+
+        auto is_delta_too_big(const master_snapshot& state) -> bool {
+            size_t baseCount = 0, changedCount = 0;
+            state.for_each([&](const context::snapshot& dom) {
+                baseCount += dom.objects->base_object_count;
+                changedCount += dom.objects->changed_count();
+            });
+            return changedCount > baseCount / max_delta_share;
+        }
+
+        const char base_image_extension[] = ".jcbase";
+        const char base_reference_extension[] = ".jcref";
+
+        // the files of the base_directory are named after the saves. The name is a part of the JSON header as well - ASCII only
+        auto file_name_for_save(const std::string& saveName) -> std::string {
+            std::string name = saveName.empty() ? "jcontainers" : saveName;
+            std::replace_if(name.begin(), name.end(), [](char c) {
+                return (unsigned char)c < ' ' || (unsigned char)c > '~' || strchr("<>:\"/\\|?*", c) != nullptr;
+            }, '_');
+            return name;
+        }
+
+        auto make_base_image(const std::string& saveName) -> master::base_image {
+            std::random_device random;
+            uint64_t id = 0;
+            while (id == 0) {
+                id = uint64_t(random()) << 32 | random();
+            }
+
+            char suffix[32];
+            sprintf_s(suffix, ".%016llx%s", (unsigned long long)id, base_image_extension);
+            return{ file_name_for_save(saveName) + suffix, id };
+        }
+
+        // Each save written as a delta has a reference file of the base_directory: "<save>.jcref" with the name
+        // of the base image. Once the @saveName references the @baseFile (none if empty), the base images
+        // no reference file names get deleted - unless the state is incomplete, the next update deletes them then
+        auto update_base_references(const master& self, const std::string& saveName, const std::string& baseFile) -> void {
+            namespace fs = boost::filesystem;
+            try {
+                const fs::path directory{ self.base_directory };
+                if (self.base_directory.empty() || !fs::is_directory(directory)) {
+                    return;
+                }
+
+                const fs::path reference = directory / (file_name_for_save(saveName) + base_reference_extension);
+                if (baseFile.empty()) {
+                    fs::remove(reference);
+                }
+                else {
+                    std::ofstream file(reference.generic_string(), std::ios::out | std::ios::trunc);
+                    file << baseFile;
+                    file.close();
+                    if (!file) {
+                        throw std::runtime_error("unable to write " + reference.filename().generic_string());
+                    }
+                }
+                if (self.incomplete_state) {
+                    return;
+                }
+
+                std::set<std::string> referenced;
+                std::vector<fs::path> images;
+                for (fs::directory_iterator it(directory), end; it != end; ++it) {
+                    const auto extension = it->path().extension().generic_string();
+                    if (extension == base_reference_extension) {
+                        std::ifstream file(it->path().generic_string());
+                        std::string name;
+                        if (!std::getline(file, name)) {
+                            throw std::runtime_error("unable to read " + it->path().filename().generic_string());
+                        }
+                        referenced.insert(name);
+                    }
+                    else if (extension == base_image_extension) {
+                        images.push_back(it->path());
+                    }
+                }
+
+                for (auto& path : images) {
+                    const auto name = path.filename().generic_string();
+                    if (referenced.find(name) == referenced.end()) {
+                        JC_log("deleting the base image %s, no save references it anymore", name.c_str());
+                        fs::remove(path);
+                    }
+                }
+            }
+            catch (const std::exception& exc) {
+                JC_log("unable to update the base image references: %s", exc.what());
+            }
+        }
+
+        // the base image file: the header with the id only, then the snapshot in full
+        auto write_base_image(const master& self, const master::base_image& base, const master_snapshot& state, bool compressed) -> bool {
+            namespace fs = boost::filesystem;
+            try {
+                const fs::path directory{ self.base_directory };
+                fs::create_directories(directory);
+
+                std::ofstream file((directory / base.file).generic_string(), std::ios::binary | std::ios::out | std::ios::trunc);
+                if (!file) {
+                    throw std::runtime_error("unable to create the file");
+                }
+                header::write_to_stream(file, compressed, master::base_image{ std::string(), base.id });
+                write_compact(file, compressed, [&state](collections::compact_writer& archive) {
+                    save_compact(state, archive);
+                });
+                file.close();
+                if (!file) {
+                    throw std::runtime_error("unable to write the file");
+                }
+                return true;
+            }
+            catch (const std::exception& exc) {
+                JC_log("unable to write the base image %s: %s. The save is written in full", base.file.c_str(), exc.what());
+                return false;
+            }
+        }
+
+        // Reads the base image the @hdr refers to, then applies the delta read from the @stream.
+        // The delta is useless without its base image: a missing or mismatched one fails the load
+        auto load_base_and_delta(master& self, const header& hdr, std::istream& stream) -> void {
+            namespace fs = boost::filesystem;
+            const fs::path path = fs::path(self.base_directory) / hdr.base.file;
+
+            std::ifstream file;
+            if (!self.base_directory.empty()) {
+                file.open(path.generic_string(), std::ios::binary | std::ios::in);
+            }
+            if (!file) {
+                throw std::runtime_error("unable to open the base image " + hdr.base.file);
+            }
+            const header baseHdr = header::read_from_stream(file);
+            if (baseHdr.commonVersion != hdr.commonVersion || baseHdr.base.id != hdr.base.id) {
+                throw std::runtime_error("the base image " + hdr.base.file + " doesn't match the save");
+            }
+
+            using loaded_base = context::loaded_base;
+            loaded_base defaultBase;
+            std::map<std::string, std::unique_ptr<loaded_base>> domainBases;
+
+            auto readBase = [&](std::istream& in) {
+                collections::compact_reader archive{ in, self.get_form_observer() };
+                load_domains(self, archive, false,
+                    [&](const std::string& name) -> loaded_base* {
+                        if (name.empty()) {
+                            return &defaultBase;
+                        }
+                        auto& base = domainBases[name];
+                        base.reset(new loaded_base());
+                        return base.get();
+                    },
+                    [](loaded_base* base, collections::compact_reader& ar) {
+                        context::read_base(ar, *base);
+                    });
+            };
+            auto readDelta = [&](std::istream& in) {
+                collections::compact_reader archive{ in, self.get_form_observer() };
+                load_domains(self, archive, false,
+                    [&](const std::string& name) -> std::pair<context*, loaded_base*> {
+                        if (name.empty()) {
+                            return{ &self.get_default_domain(), &defaultBase };
+                        }
+                        auto& base = domainBases[name];
+                        if (!base) { // the domain is newer than the base image
+                            base.reset(new loaded_base());
+                        }
+                        return{ &self.get_or_create_domain_with_name(name.c_str()), base.get() };
+                    },
+                    [](std::pair<context*, loaded_base*> target, collections::compact_reader& ar) {
+                        target.first->load_compact_delta(ar, *target.second);
+                    });
+            };
+
+            if (baseHdr.compressed) {
+                util::lz_decompress_stream(file, readBase);
+            }
+            else {
+                readBase(file);
+            }
+
+            if (hdr.compressed) {
+                util::lz_decompress_stream(stream, readDelta);
+            }
+            else {
+                readDelta(stream);
+            }
+
+            self.current_base = hdr.base;
+        }
+
         auto read_from_stream(master& self, std::istream& stream) -> void {
             //_context.read_from_stream(s);
 
@@ -191,6 +706,7 @@ namespace domain_master {
                 //write_lock g(_mutex);
 
                 u_clearState(self);
+                self.incomplete_state = false;
 
                 if (stream.peek() != std::istream::traits_type::eof()) {
 
@@ -207,7 +723,7 @@ namespace domain_master {
                             throw std::logic_error(error.str());
                         }
 
-                        {
+                        if (hdr.commonVersion <= serialization_version::pre_compact_format) {
                             hack::iarchive_with_blob real_archive(stream, self.get_default_domain(), self.get_default_domain());
                             boost::archive::binary_iarchive& archive = real_archive;
 
@@ -220,17 +736,28 @@ namespace domain_master {
                                 archive >> self;
                             }
                         }
+                        else if (!hdr.base.file.empty()) {
+                            load_base_and_delta(self, hdr, stream);
+                        }
+                        else if (hdr.compressed) {
+                            util::lz_decompress_stream(stream, [&self](std::istream& decompressed) {
+                                collections::compact_reader archive{ decompressed, self.get_form_observer() };
+                                load_compact(self, archive);
+                            });
+                        }
+                        else {
+                            collections::compact_reader archive{ stream, self.get_form_observer() };
+                            load_compact(self, archive);
+                        }
 
                         u_delete_inactive_domains(self);
-
-                        invoke_for_all(self, std::mem_fn(&context::u_postLoadInitializations));
-                        invoke_for_all(self, std::mem_fn(&context::u_applyUpdates), hdr.commonVersion);
-                        invoke_for_all(self, std::mem_fn(&context::u_postLoadMaintenance), hdr.commonVersion);
+                        u_post_load(self, hdr.commonVersion);
                     }
                     catch (const std::exception& exc) {
                         _FATALERROR("caught exception (%s) during archive load - '%s'",
                             typeid(exc).name(), exc.what());
                         u_clearState(self);
+                        self.incomplete_state = true;
 
                         // force whole app to crash
                         // jc_assert(false);
@@ -238,6 +765,7 @@ namespace domain_master {
                     catch (...) {
                         _FATALERROR("caught unknown (non std::*) exception");
                         u_clearState(self);
+                        self.incomplete_state = true;
 
                         // force whole app to crash
                         //jc_assert(false);
@@ -249,28 +777,98 @@ namespace domain_master {
 
         }
 
-        auto write_to_stream(master& self, std::ostream& stream) -> void {
+        // With the @inBackground, the scripts are stopped only while the snapshot is taken. The snapshot gets encoded
+        // (and compressed) on a separate thread, while this one passes the encoded data to the @stream.
+        // With the incremental_saves, the @stream receives a delta to the base image, a new base image gets written
+        // if there is none yet, its file is gone or the delta grows too big
+        auto write_to_stream(master& self, std::ostream& stream, bool inBackground) -> void {
+            using snapshot_kind = master_snapshot::snapshot_kind;
+
             stream.flags(stream.flags() | std::ios::binary);
 
-            activity_stopper s{ self };
+            namespace fs = boost::filesystem;
+
+            const bool incremental = self.incremental_saves && !self.base_directory.empty() && !self.incomplete_state;
+            master_snapshot state;
             {
+                activity_stopper s{ self };
                 // we can also cleanup objects here
-                {
-                    self.get_form_observer().u_remove_expired_forms();
+                self.get_form_observer().u_remove_expired_forms();
+
+                if (!incremental) {
+                    state = take_snapshot(self, snapshot_kind::full);
+                }
+                else {
+                    boost::system::error_code error;
+                    if (!self.current_base.file.empty() && !fs::exists(fs::path(self.base_directory) / self.current_base.file, error)) {
+                        _ERROR("the base image %s is gone. The save is written with a new one", self.current_base.file.c_str());
+                        self.current_base = master::base_image{};
+                    }
+                    if (!self.current_base.file.empty()) {
+                        state = take_snapshot(self, snapshot_kind::delta);
+                    }
+                    if (state.kind != snapshot_kind::delta || is_delta_too_big(state)) {
+                        state = master_snapshot{}; // releases the delta first
+                        state = take_snapshot(self, snapshot_kind::base);
+                    }
                 }
 
-                header::write_to_stream(stream);
-                boost::archive::binary_oarchive arch{ stream };
+                u_print_stats(self);
+            }
 
-                // [(name, domain)] -> stream
+            const bool compressed = self.compress_saves;
+            const bool newBase = state.kind == snapshot_kind::base;
+            const master::base_image base = newBase ? make_base_image(self.save_name) : self.current_base;
+            bool baseWritten = false;
+            bool deltaWritten = false;
 
-                arch << self;
+            auto write = [&](std::ostream& out) {
+                if (newBase) {
+                    baseWritten = write_base_image(self, base, state, compressed);
+                }
+                deltaWritten = incremental && (!newBase || baseWritten);
+                if (deltaWritten) {
+                    header::write_to_stream(out, compressed, base);
+                    write_compact(out, compressed, [&state](collections::compact_writer& archive) {
+                        save_compact_delta(state, archive);
+                    });
+                }
+                else {
+                    header::write_to_stream(out, compressed);
+                    write_compact(out, compressed, [&state](collections::compact_writer& archive) {
+                        save_compact(state, archive);
+                    });
+                }
+            };
 
-                u_print_stats(self);
+            try {
+                if (inBackground) {
+                    util::write_in_background(stream, write);
+                }
+                else {
+                    write(stream);
+                }
+            }
+            catch (...) {
+                // the base snapshot has marked the objects unmodified - the next delta can't rely on that
+                self.current_base = master::base_image{};
+                throw;
             }
-        }
 
+            if (baseWritten) {
+                self.get_default_domain().u_adopt_base(*state.default_domain.objects);
+                for (auto& pair : state.domains) {
+                    self.get_or_create_domain_with_name(pair.first.c_str()).u_adopt_base(*pair.second.objects);
+                }
+                self.current_base = base;
+            }
+            else if (newBase) {
+                self.current_base = master::base_image{};
+            }
 
+            update_base_references(self, self.save_name, deltaWritten ? base.file : std::string());
+            record_save_stats(self, state);
+        }
     }
 
     context& master::get_or_create_domain_with_name(const util::istring& name)
@@ -325,6 +923,7 @@ namespace domain_master {
     void master::clear_state() {
         activity_stopper s{ *this };
         u_clearState(*this);
+        incomplete_state = false;
         u_delete_inactive_domains(*this);
     }
 
@@ -333,7 +932,15 @@ namespace domain_master {
     }
 
     void master::write_to_stream(std::ostream& s) {
-        domain_master::write_to_stream(*this, s);
+        domain_master::write_to_stream(*this, s, false);
+    }
+
+    void master::write_to_stream_in_background(std::ostream& s) {
+        domain_master::write_to_stream(*this, s, true);
+    }
+
+    void master::on_save_deleted(const std::string& saveName) {
+        update_base_references(*this, saveName, std::string());
     }
 
     namespace testing {
@@ -357,6 +964,331 @@ namespace domain_master {
             EXPECT_TRUE(m.active_domains_map().empty());
         }
 
+        TEST(master, incremental_saves)
+        {
+            namespace fs = boost::filesystem;
+            using namespace collections;
+
+            const fs::path directory = fs::temp_directory_path() / fs::unique_path("jc-save-bases-%%%%-%%%%");
+
+            ::domain_master::master m;
+            m.incremental_saves = true;
+            m.base_directory = directory.generic_string();
+            m.save_name = "Save 1";
+
+            auto& dom = m.get_default_domain();
+            auto& root = map::object(dom);
+            dom.set_root(&root);
+            for (int i = 0; i < 1000; ++i) {
+                auto& entry = array::object(dom);
+                entry.u_push(item(i));
+                root.u_set("key" + std::to_string(i), item(&entry));
+            }
+            const Handle rootId = root.uid();
+
+            // no base image yet
+            std::ostringstream first;
+            m.write_to_stream(first);
+            const auto firstBase = m.current_base;
+            EXPECT_FALSE(firstBase.file.empty());
+            const uintmax_t baseSize = fs::file_size(directory / firstBase.file);
+
+            // the scripts change the objects under their locks
+            {
+                object_lock g(root);
+                root.u_set("key0", item("changed"));
+                root.u_set("added", item(&map::object(dom)));
+            }
+            m.save_name = "Save 2";
+            std::ostringstream second;
+            m.write_to_stream(second);
+            EXPECT_TRUE(m.current_base.id == firstBase.id);
+            EXPECT_TRUE(second.str().size() * 10 < baseSize);
+
+            ::domain_master::master loaded;
+            loaded.base_directory = m.base_directory;
+            {
+                std::istringstream stream(second.str());
+                loaded.read_from_stream(stream);
+            }
+            auto loadedRoot = loaded.get_default_domain().getObjectOfType<map>(rootId);
+            EXPECT_TRUE(loadedRoot != nullptr);
+            EXPECT_TRUE(loadedRoot->u_get("key0")->strValue() == std::string("changed"));
+            EXPECT_TRUE(loadedRoot->u_get("added")->object()->as<map>() != nullptr);
+            EXPECT_TRUE(loadedRoot->u_get("key5")->object()->as<array>()->u_get(0)->intValue() == 5);
+            EXPECT_TRUE(loaded.current_base.id == firstBase.id);
+
+            // most of the objects change - a new base image
+            {
+                object_lock g(root);
+                for (int i = 1; i < 1000; ++i) {
+                    root.u_set("key" + std::to_string(i), item(i));
+                }
+            }
+            m.save_name = "Save 3";
+            std::ostringstream third;
+            m.write_to_stream(third);
+            const auto thirdBase = m.current_base;
+            EXPECT_TRUE(thirdBase.id != firstBase.id);
+            EXPECT_TRUE(fs::exists(directory / firstBase.file)); // the older saves still need it
+
+            // the base images no save references get deleted
+            m.on_save_deleted("Save 1");
+            EXPECT_TRUE(fs::exists(directory / firstBase.file));
+            m.on_save_deleted("Save 2");
+            EXPECT_FALSE(fs::exists(directory / firstBase.file));
+            EXPECT_TRUE(fs::exists(directory / thirdBase.file));
+
+            // the base image is gone: the load fails, nothing gets loaded
+            {
+                object_lock g(root);
+                root.u_set("key2", item("fourth"));
+            }
+            m.save_name = "Save 4";
+            std::ostringstream fourth;
+            m.write_to_stream(fourth);
+            EXPECT_TRUE(m.current_base.id == thirdBase.id);
+            fs::remove(directory / thirdBase.file);
+            {
+                std::istringstream stream(fourth.str());
+                loaded.read_from_stream(stream);
+            }
+            EXPECT_TRUE(loaded.get_default_domain().getObjectOfType<map>(rootId) == nullptr);
+            EXPECT_EQ(0u, loaded.get_default_domain().object_count());
+            EXPECT_TRUE(loaded.current_base.file.empty());
+            EXPECT_TRUE(loaded.incomplete_state);
+
+            // the next save doesn't rely on the missing image either
+            m.save_name = "Save 5";
+            std::ostringstream fifth;
+            m.write_to_stream(fifth);
+            const auto fifthBase = m.current_base;
+            EXPECT_TRUE(fifthBase.id != thirdBase.id);
+            EXPECT_TRUE(fs::exists(directory / fifthBase.file));
+
+            // an image of another id fails the load as well
+            fs::copy_file(directory / fifthBase.file, directory / thirdBase.file);
+            {
+                std::istringstream stream(fourth.str());
+                loaded.read_from_stream(stream);
+            }
+            EXPECT_EQ(0u, loaded.get_default_domain().object_count());
+            EXPECT_TRUE(loaded.incomplete_state);
+            fs::remove(directory / thirdBase.file);
+
+            // the state is incomplete: the saves are written in full, no base image gets written or deleted
+            auto imageCount = [&directory]() {
+                return std::count_if(fs::directory_iterator(directory), fs::directory_iterator(), [](const fs::directory_entry& e) {
+                    return e.path().extension().generic_string() == base_image_extension;
+                });
+            };
+            const auto imagesBefore = imageCount();
+            loaded.incremental_saves = true;
+            loaded.save_name = "Save 6";
+            std::ostringstream incomplete;
+            loaded.write_to_stream(incomplete);
+            EXPECT_TRUE(loaded.current_base.file.empty());
+            loaded.on_save_deleted("Save 5");
+            EXPECT_EQ(imagesBefore, imageCount());
+            EXPECT_TRUE(fs::exists(directory / fifthBase.file));
+
+            // a complete load lifts the restriction
+            {
+                std::istringstream stream(fifth.str());
+                loaded.read_from_stream(stream);
+            }
+            EXPECT_FALSE(loaded.incomplete_state);
+            EXPECT_TRUE(loaded.current_base.id == fifthBase.id);
+            loadedRoot = loaded.get_default_domain().getObjectOfType<map>(rootId);
+            ASSERT_TRUE(loadedRoot != nullptr);
+            EXPECT_TRUE(loadedRoot->u_get("key2")->strValue() == std::string("fourth"));
+
+            fs::remove_all(directory);
+        }
+
+        TEST(master, incremental_saves_are_opt_in)
+        {
+            namespace fs = boost::filesystem;
+            using namespace collections;
+
+            const fs::path directory = fs::temp_directory_path() / fs::unique_path("jc-save-bases-%%%%-%%%%");
+
+            ::domain_master::master m;
+            m.base_directory = directory.generic_string();
+
+            auto& dom = m.get_default_domain();
+            dom.set_root(&map::object(dom));
+
+            std::ostringstream saved;
+            m.write_to_stream(saved);
+            EXPECT_TRUE(m.current_base.file.empty());
+            EXPECT_FALSE(fs::exists(directory));
+        }
+
+        TEST(master, domains_load_in_parallel)
+        {
+            using namespace collections;
+
+            auto fill = [](context& dom, int value) {
+                auto& root = map::object(dom);
+                dom.set_root(&root);
+                for (int i = 0; i < 100; ++i) {
+                    auto& entry = array::object(dom);
+                    entry.u_push(item(i * value));
+                    entry.u_push(item("shared string"));
+                    root.u_set("key" + std::to_string(i), item(&entry));
+                }
+                return root.uid();
+            };
+            auto check = [](context& dom, Handle rootId, int value) {
+                auto root = dom.getObjectOfType<map>(rootId);
+                ASSERT_TRUE(root != nullptr);
+                EXPECT_EQ(100, root->u_count());
+                auto entry = root->u_get("key7")->object()->as<array>();
+                ASSERT_TRUE(entry != nullptr);
+                EXPECT_EQ(7 * value, entry->u_get(0)->intValue());
+                EXPECT_TRUE(entry->u_get(1)->strValue() == std::string("shared string"));
+            };
+
+            const char *names[] = { "first", "second", "third" };
+
+            ::domain_master::master m;
+            std::vector<Handle> roots{ fill(m.get_default_domain(), 1) };
+            for (int i = 0; i < 3; ++i) {
+                roots.push_back(fill(m.get_or_create_domain_with_name(names[i]), i + 2));
+            }
+
+            ::domain_master::master loaded;
+            loaded.active_domain_names = { "first", "second", "third" };
+            auto checkLoaded = [&]() {
+                check(loaded.get_default_domain(), roots[0], 1);
+                for (int i = 0; i < 3; ++i) {
+                    check(loaded.get_or_create_domain_with_name(names[i]), roots[i + 1], i + 2);
+                }
+            };
+
+            for (bool compressed : { false, true }) {
+                m.compress_saves = compressed;
+                std::stringstream stream;
+                m.write_to_stream(stream);
+                loaded.read_from_stream(stream);
+                checkLoaded();
+            }
+        }
+
+        // the sections span many chunks
+        TEST(master, large_domain_sections)
+        {
+            using namespace collections;
+
+            ::domain_master::master m;
+            auto& dom = m.get_default_domain();
+            auto& root = array::object(dom);
+            dom.set_root(&root);
+            for (int i = 0; i < 2000; ++i) {
+                root.u_push(item(std::to_string(i) + std::string(100, 'x')));
+            }
+            const Handle rootId = root.uid();
+
+            for (bool lazily : { false, true }) {
+                std::stringstream stream;
+                m.write_to_stream(stream);
+                EXPECT_GT(stream.str().size(), 0u);
+
+                ::domain_master::master loaded;
+                loaded.lazy_load = lazily;
+                loaded.read_from_stream(stream);
+                auto loadedRoot = loaded.get_default_domain().getObjectOfType<array>(rootId);
+                ASSERT_TRUE(loadedRoot != nullptr);
+                EXPECT_EQ(2000, loadedRoot->s_count());
+                EXPECT_TRUE(loadedRoot->get_item(1999)->strValue() == "1999" + std::string(100, 'x'));
+            }
+        }
+
+        TEST(master, lazy_load)
+        {
+            using namespace collections;
+
+            ::domain_master::master m;
+            auto& dom = m.get_default_domain();
+            auto& root = map::object(dom);
+            dom.set_root(&root);
+            std::vector<Handle> entries;
+            for (int i = 0; i < 50; ++i) {
+                auto& entry = array::object(dom);
+                entry.u_push(item(i));
+                entry.u_push(item("value " + std::to_string(i)));
+                root.u_set("key" + std::to_string(i), item(&entry));
+                entries.push_back(entry.uid());
+            }
+            auto& cursor = map_cursor::object(dom);
+            cursor.tes_retain();
+            cursor.reset(root);
+            cursor.next();
+
+            const Handle rootId = root.uid();
+            const Handle cursorId = cursor.uid();
+            const size_t objectCount = dom.object_count();
+
+            auto check = [&](context& d) {
+                auto loadedRoot = d.getObjectOfType<map>(rootId);
+                ASSERT_TRUE(loadedRoot != nullptr);
+                EXPECT_EQ(50, loadedRoot->u_count());
+                for (int i = 0; i < 50; ++i) {
+                    auto entry = loadedRoot->u_get("key" + std::to_string(i))->object()->as<array>();
+                    ASSERT_TRUE(entry != nullptr);
+                    EXPECT_EQ(i, entry->u_get(0)->intValue());
+                    EXPECT_TRUE(entry->u_get(1)->strValue() == "value " + std::to_string(i));
+                }
+            };
+
+            std::stringstream stream;
+            m.write_to_stream(stream);
+
+            ::domain_master::master loaded;
+            loaded.lazy_load = true;
+            loaded.read_from_stream(stream);
+            auto& loadedDom = loaded.get_default_domain();
+
+            // the references of the encoded contents keep the objects alive
+            EXPECT_EQ(objectCount, loadedDom.object_count());
+            EXPECT_EQ(0, loadedDom.collect_garbage());
+
+            // the cursor and its map get decoded along with the save, the rest waits for an access
+            EXPECT_TRUE(loadedDom.u_getObject(rootId)->is_materialized());
+            for (auto id : entries) {
+                EXPECT_FALSE(loadedDom.u_getObject(id)->is_materialized());
+            }
+            auto loadedCursor = loadedDom.getObjectOfType<map_cursor>(cursorId);
+            ASSERT_TRUE(loadedCursor != nullptr);
+            EXPECT_EQ(map_cursor::state::positioned, loadedCursor->get_state());
+
+            // by the handle
+            auto first = loadedDom.getObjectOfType<array>(entries[0]);
+            ASSERT_TRUE(first != nullptr);
+            EXPECT_TRUE(first->is_materialized());
+            EXPECT_EQ(2, first->s_count());
+
+            // by the reference
+            auto loadedRoot = loadedDom.getObjectOfType<map>(rootId);
+            auto seventh = loadedRoot->u_get("key7")->object();
+            EXPECT_TRUE(seventh == loadedDom.u_getObject(entries[7]));
+            EXPECT_TRUE(seventh->is_materialized());
+            EXPECT_FALSE(loadedDom.u_getObject(entries[8])->is_materialized());
+
+            // the save decodes the encoded objects into the copies
+            std::stringstream resaved;
+            loaded.write_to_stream(resaved);
+            EXPECT_FALSE(loadedDom.u_getObject(entries[8])->is_materialized());
+
+            ::domain_master::master reloaded;
+            reloaded.read_from_stream(resaved);
+            EXPECT_EQ(objectCount, reloaded.get_default_domain().object_count());
+            check(reloaded.get_default_domain());
+
+            check(loadedDom);
+        }
+
         /*
         TEST(master, backward_compatibility)
         {
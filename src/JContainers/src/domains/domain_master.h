@@ -24,6 +24,37 @@ namespace domain_master {
 
         std::set<util::istring> active_domain_names;
 
+        // The saves are compressed with util::lz_compressor, opt-in: the older plugin versions can't read them back.
+        // The flag is stored in the header, so either kind loads
+        bool compress_saves = false;
+
+        // The objects of the full saves are loaded lazily: the contents of an object get decoded on the first access
+        // (see collections::object_base::materialize). The saves written with the base images load in full
+        bool lazy_load = false;
+
+        // The full saves write the identical subtrees of a domain once (see objects_snapshot::deduplicate).
+        // With the incremental_saves, neither the base images nor the deltas get deduplicated: the deltas refer
+        // to the objects of the base image by their positions, the copies would shift these
+        bool deduplicate_saves = false;
+
+        // The incremental saves, opt-in: the save receives just the delta to the base image, a file of the base_directory.
+        // A new base image gets written once the delta grows too big. The saves written either way load
+        // as long as the base_directory is set
+        bool incremental_saves = false;
+        std::string base_directory;
+        // the name of the game save being written, the base image file is named after it
+        std::string save_name;
+
+        struct base_image {
+            std::string file; // relative to the base_directory
+            uint64_t id = 0;
+        };
+        // the image the next delta is relative to, none if the file is empty
+        base_image current_base;
+        // The last load has failed and left the state incomplete. Until a save loads or the state gets cleared,
+        // no base image is written or deleted: the saves are written in full
+        bool incomplete_state = false;
+
         context& get_or_create_domain_with_name(const util::istring& name);// or create if none
         context* get_domain_if_active(const util::istring& name);
         context& get_default_domain();
@@ -40,6 +71,10 @@ namespace domain_master {
         void clear_state();
         void read_from_stream(std::istream&);
         void write_to_stream(std::ostream&);
+        // the same data as the write_to_stream writes, but the activity isn't stopped while it's encoded
+        void write_to_stream_in_background(std::ostream&);
+        // the game save is gone: the base images no other save references get deleted
+        void on_save_deleted(const std::string& saveName);
 
         // save from stream / load from stream
         // drop (or not save?) loaded contexts if no appropriate config files found?
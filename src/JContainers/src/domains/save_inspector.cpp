@@ -0,0 +1,767 @@
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "boost/iostreams/stream.hpp"
+#include "boost/iostreams/device/array.hpp"
+
+#include "jansson.h"
+#include "gtest/gtest.h"
+
+#include "skse/skse.h"
+#include "collections/collections.h"
+#include "collections/context.h"
+#include "domains/domain_master.h"
+#include "domains/save_inspector.h"
+
+namespace domain_master {
+
+    namespace {
+
+        using namespace collections;
+
+        template<class T, class D>
+        inline std::unique_ptr<T, D> make_unique_ptr(T* data, D destr) {
+            return std::unique_ptr<T, D>(data, destr);
+        }
+
+        auto milliseconds_since(std::chrono::steady_clock::time_point started) -> double {
+            namespace chr = std::chrono;
+            return chr::duration<double, std::milli>(chr::steady_clock::now() - started).count();
+        }
+
+        auto domain_name_for_report(const std::string& name) -> const char * {
+            return name.empty() ? "(default)" : name.c_str();
+        }
+
+        auto type_name(CollectionType type) -> const char * {
+            static const char * const names[] = {
+                "None", "JArray", "JMap", "JFormMap", "JIntMap", "JCounterMap",
+                "JMapIterator", "JSet", "JRingBuffer", "JPriorityQueue",
+            };
+            return (size_t)type < _countof(names) ? names[type] : "Unknown";
+        }
+
+        auto configure(master& m, const inspection_options& options) -> void {
+            m.active_domain_names = options.domains;
+            m.lazy_load = options.lazy_load;
+            m.deduplicate_saves = options.deduplicate_saves;
+            m.compress_saves = options.compress_saves;
+        }
+
+        auto load(master& m, const std::string& dump) -> void {
+            namespace io = boost::iostreams;
+            io::stream<io::array_source> stream(io::array_source(dump.data(), dump.size()));
+            m.read_from_stream(stream);
+        }
+
+        template<class Func>
+        auto for_each_domain(master& m, Func&& f) -> void {
+            f(std::string(), m.get_default_domain());
+            for (auto& pair : m.active_domains_map()) {
+                f(std::string(pair.first.c_str()), *pair.second);
+            }
+        }
+
+        // the values and the string keys of a container
+        struct contents_counter {
+            save_inspection::domain_stats *stats;
+
+            void add_string(const std::string& str) {
+                ++stats->strings;
+                stats->string_bytes += str.size();
+            }
+
+            void add(const item& itm) {
+                ++stats->items;
+                if (auto str = boost::get<std::string>(&itm.var())) {
+                    add_string(*str);
+                }
+            }
+
+            // form_map, integer_map
+            template<class T> void operator () (const T& obj) {
+                for (auto& pair : obj.u_container()) {
+                    add(pair.second);
+                }
+            }
+
+            void operator () (const array& obj) {
+                for (auto& itm : obj.u_container()) {
+                    add(itm);
+                }
+            }
+
+            void operator () (const map& obj) {
+                for (auto& pair : obj.u_container()) {
+                    add_string(pair.first);
+                    add(pair.second);
+                }
+            }
+
+            void operator () (const counter_map& obj) {
+                for (auto& pair : obj.u_snapshot()) {
+                    add_string(pair.first);
+                    add(pair.second);
+                }
+            }
+
+            void operator () (const map_cursor&) {}
+
+            void operator () (const item_set& obj) {
+                for (auto& itm : obj.u_container()) {
+                    add(itm);
+                }
+            }
+
+            void operator () (const ring_buffer& obj) {
+                for (auto& itm : obj.u_items()) {
+                    add(itm);
+                }
+            }
+
+            void operator () (const priority_heap& obj) {
+                for (auto& e : obj.u_container()) {
+                    add(e.value);
+                }
+            }
+        };
+
+        // Breadth-first, from the objects no other object references. The objects of the unreachable cycles
+        // start the walks of their own
+        auto max_depth(const std::vector<object_stack_ref>& objects) -> size_t {
+            std::unordered_map<object_base *, uint32_t> incoming;
+            for (auto& obj : objects) {
+                incoming.emplace(obj.get(), 0);
+            }
+            for (auto& obj : objects) {
+                obj->u_visit_all_referenced_objects([&incoming](object_base& ref) { ++incoming[&ref]; });
+            }
+
+            std::unordered_set<object_base *> visited;
+            size_t deepest = 0;
+            auto walk = [&](std::vector<object_base *> level) {
+                std::vector<object_base *> next;
+                for (size_t depth = 1; !level.empty(); ++depth) {
+                    deepest = (std::max)(deepest, depth);
+                    next.clear();
+                    for (auto obj : level) {
+                        obj->u_visit_all_referenced_objects([&](object_base& ref) {
+                            if (visited.insert(&ref).second) {
+                                next.push_back(&ref);
+                            }
+                        });
+                    }
+                    level.swap(next);
+                }
+            };
+
+            std::vector<object_base *> roots;
+            for (auto& obj : objects) {
+                if (incoming[obj.get()] == 0 && visited.insert(obj.get()).second) {
+                    roots.push_back(obj.get());
+                }
+            }
+            walk(std::move(roots));
+
+            for (auto& obj : objects) {
+                if (visited.insert(obj.get()).second) {
+                    walk({ obj.get() });
+                }
+            }
+            return deepest;
+        }
+
+        auto collect_domain_stats(const std::string& name, context& domain) -> save_inspection::domain_stats {
+            save_inspection::domain_stats stats;
+            stats.name = name;
+
+            const auto objects = domain.filter_objects([](object_base&) { return true; });
+            stats.objects = objects.size();
+            for (auto& obj : objects) {
+                obj->materialize();
+                if (obj->is_public()) {
+                    ++stats.public_objects;
+                }
+                ++stats.types[type_name(obj->type())];
+
+                object_shared_lock g(obj.get());
+                perform_on_object(static_cast<const object_base&>(*obj), contents_counter{ &stats });
+            }
+            stats.max_depth = max_depth(objects);
+            return stats;
+        }
+
+        struct phase_summary {
+            double min = 0, mean = 0, max = 0;
+        };
+
+        template<class T>
+        auto summarize(const std::vector<T>& iterations, double T::*field) -> phase_summary {
+            phase_summary s;
+            if (iterations.empty()) {
+                return s;
+            }
+            s.min = s.max = iterations.front().*field;
+            for (auto& it : iterations) {
+                s.min = (std::min)(s.min, it.*field);
+                s.max = (std::max)(s.max, it.*field);
+                s.mean += it.*field;
+            }
+            s.mean /= iterations.size();
+            return s;
+        }
+    }
+
+    save_inspection inspect_save(const std::string& dump, const inspection_options& options) {
+        save_inspection result;
+        result.dump_size = dump.size();
+
+        {
+            master m;
+            configure(m, options);
+            load(m, dump);
+            for_each_domain(m, [&result](const std::string& name, context& domain) {
+                result.domains.push_back(collect_domain_stats(name, domain));
+            });
+        }
+
+        for (size_t i = 0; i < options.iterations; ++i) {
+            save_inspection::iteration it;
+            master m;
+            configure(m, options);
+
+            auto started = std::chrono::steady_clock::now();
+            load(m, dump);
+            it.load = milliseconds_since(started);
+
+            started = std::chrono::steady_clock::now();
+            for_each_domain(m, [&it](const std::string&, context& domain) {
+                it.garbage += domain.collect_garbage();
+            });
+            it.collect = milliseconds_since(started);
+
+            std::ostringstream saved;
+            started = std::chrono::steady_clock::now();
+            m.write_to_stream(saved);
+            it.save = milliseconds_since(started);
+            it.save_size = (size_t)saved.tellp();
+
+            result.iterations.push_back(it);
+        }
+
+        return result;
+    }
+
+    std::string save_inspection::to_json(const std::string& dumpName) const {
+        auto root = make_unique_ptr(json_object(), &json_decref);
+        json_object_set_new(root.get(), "dump", json_string(dumpName.c_str()));
+        json_object_set_new(root.get(), "dumpSize", json_integer((json_int_t)dump_size));
+
+        json_t *jdomains = json_array();
+        for (auto& dom : domains) {
+            json_t *jdom = json_object();
+            json_object_set_new(jdom, "name", json_string(dom.name.c_str()));
+            json_object_set_new(jdom, "objects", json_integer((json_int_t)dom.objects));
+            json_object_set_new(jdom, "publicObjects", json_integer((json_int_t)dom.public_objects));
+            json_object_set_new(jdom, "items", json_integer((json_int_t)dom.items));
+            json_object_set_new(jdom, "strings", json_integer((json_int_t)dom.strings));
+            json_object_set_new(jdom, "stringBytes", json_integer((json_int_t)dom.string_bytes));
+            json_object_set_new(jdom, "maxDepth", json_integer((json_int_t)dom.max_depth));
+
+            json_t *jtypes = json_object();
+            for (auto& pair : dom.types) {
+                json_object_set_new(jtypes, pair.first.c_str(), json_integer((json_int_t)pair.second));
+            }
+            json_object_set_new(jdom, "types", jtypes);
+            json_array_append_new(jdomains, jdom);
+        }
+        json_object_set_new(root.get(), "domains", jdomains);
+
+        json_t *jiterations = json_array();
+        for (auto& it : iterations) {
+            json_t *jit = json_object();
+            json_object_set_new(jit, "load", json_real(it.load));
+            json_object_set_new(jit, "collect", json_real(it.collect));
+            json_object_set_new(jit, "save", json_real(it.save));
+            json_object_set_new(jit, "garbage", json_integer((json_int_t)it.garbage));
+            json_object_set_new(jit, "saveSize", json_integer((json_int_t)it.save_size));
+            json_array_append_new(jiterations, jit);
+        }
+        json_object_set_new(root.get(), "iterations", jiterations);
+
+        auto summary = [](phase_summary s) {
+            json_t *js = json_object();
+            json_object_set_new(js, "min", json_real(s.min));
+            json_object_set_new(js, "mean", json_real(s.mean));
+            json_object_set_new(js, "max", json_real(s.max));
+            return js;
+        };
+        json_t *jsummary = json_object();
+        json_object_set_new(jsummary, "load", summary(summarize(iterations, &iteration::load)));
+        json_object_set_new(jsummary, "collect", summary(summarize(iterations, &iteration::collect)));
+        json_object_set_new(jsummary, "save", summary(summarize(iterations, &iteration::save)));
+        json_object_set_new(root.get(), "summary", jsummary);
+
+        auto text = make_unique_ptr(json_dumps(root.get(), JSON_INDENT(2)), free);
+        return text ? std::string(text.get()) : std::string();
+    }
+
+    namespace {
+
+        auto print_report(const std::string& dumpName, const save_inspection& result) -> void {
+            printf("%s: %lu bytes, %lu domain(s)\n", dumpName.c_str(), (unsigned long)result.dump_size,
+                (unsigned long)result.domains.size());
+
+            for (auto& dom : result.domains) {
+                printf("\nDomain %s: %lu objects (%lu public), %lu items, depth %lu\n", domain_name_for_report(dom.name),
+                    (unsigned long)dom.objects, (unsigned long)dom.public_objects, (unsigned long)dom.items,
+                    (unsigned long)dom.max_depth);
+                printf("    %lu strings, %lu bytes\n", (unsigned long)dom.strings, (unsigned long)dom.string_bytes);
+                for (auto& pair : dom.types) {
+                    printf("    %-16s %lu\n", pair.first.c_str(), (unsigned long)pair.second);
+                }
+            }
+
+            if (result.iterations.empty()) {
+                return;
+            }
+
+            printf("\n%lu iteration(s), ms      min      mean       max\n", (unsigned long)result.iterations.size());
+            auto row = [](const char *phase, phase_summary s) {
+                printf("    %-16s %9.2f %9.2f %9.2f\n", phase, s.min, s.mean, s.max);
+            };
+            row("load", summarize(result.iterations, &save_inspection::iteration::load));
+            row("collect", summarize(result.iterations, &save_inspection::iteration::collect));
+            row("save", summarize(result.iterations, &save_inspection::iteration::save));
+
+            auto& last = result.iterations.back();
+            printf("    %lu objects collected, %lu bytes saved\n", (unsigned long)last.garbage, (unsigned long)last.save_size);
+        }
+
+        auto print_usage() -> void {
+            printf("usage: save_inspector <JContainers dll> <dump file> [--iterations N] [--domain name]... [--lazy] [--dedup]"
+                " [--compressed] [--json file]\n");
+            printf("       save_inspector <JContainers dll> --synthetic [--sizes N,N...] [--iterations N] [--seed N] [--fan-out N]"
+                " [--values N] [--strings share] [--string-length mean] [--forms share] [--cycles share] [--compressed]"
+                " [--baseline file] [--threshold share] [--json file]\n");
+        }
+
+        auto write_text_file(const std::string& path, const std::string& text) -> bool {
+            std::ofstream out(path, std::ios::out | std::ios::trunc);
+            out << text;
+            if (!out) {
+                fprintf(stderr, "unable to write %s\n", path.c_str());
+                return false;
+            }
+            return true;
+        }
+    }
+
+    scaling_benchmark run_scaling_benchmark(const scaling_options& options) {
+        scaling_benchmark result;
+
+        for (size_t objects : options.sizes) {
+            scaling_benchmark::size_result size;
+            collections::synthetic_db_options graph = options.graph;
+            graph.objects = objects;
+
+            for (size_t i = 0; i < options.iterations; ++i) {
+                scaling_benchmark::iteration it;
+                collections::tes_context_standalone ctx;
+                ctx.compress_saves = options.compress_saves;
+
+                auto started = std::chrono::steady_clock::now();
+                size.graph = collections::generate_synthetic_db(ctx, graph);
+                it.generate = milliseconds_since(started);
+
+                started = std::chrono::steady_clock::now();
+                const std::string saved = ctx.write_to_string();
+                it.save = milliseconds_since(started);
+                it.save_size = saved.size();
+
+                started = std::chrono::steady_clock::now();
+                {
+                    std::ostringstream stream;
+                    ctx.write_to_stream_in_background(stream);
+                }
+                it.background_save = milliseconds_since(started);
+
+                started = std::chrono::steady_clock::now();
+                ctx.read_from_string(saved);
+                it.load = milliseconds_since(started);
+
+                started = std::chrono::steady_clock::now();
+                ctx.collect_garbage();
+                it.collect = milliseconds_since(started);
+
+                started = std::chrono::steady_clock::now();
+                ctx.clearState();
+                it.clear = milliseconds_since(started);
+
+                size.iterations.push_back(it);
+            }
+
+            result.sizes.push_back(std::move(size));
+        }
+
+        return result;
+    }
+
+    namespace {
+
+        struct scaling_phase {
+            const char *name;
+            double scaling_benchmark::iteration::*field;
+        };
+
+        const scaling_phase scaling_phases[] = {
+            { "generate", &scaling_benchmark::iteration::generate },
+            { "save", &scaling_benchmark::iteration::save },
+            { "bg_save", &scaling_benchmark::iteration::background_save },
+            { "load", &scaling_benchmark::iteration::load },
+            { "collect", &scaling_benchmark::iteration::collect },
+            { "clear", &scaling_benchmark::iteration::clear },
+        };
+
+        // the mean time of the @phase at the @objects size the @baseline run has measured, negative if it has not
+        auto baseline_mean(json_t *baseline, size_t objects, const char *phase) -> double {
+            size_t index = 0;
+            json_t *size = nullptr;
+            json_array_foreach(json_object_get(baseline, "sizes"), index, size) {
+                if ((size_t)json_integer_value(json_object_get(size, "objects")) == objects) {
+                    json_t *mean = json_object_get(json_object_get(json_object_get(size, "phases"), phase), "mean");
+                    return json_is_number(mean) ? json_number_value(mean) : -1;
+                }
+            }
+            return -1;
+        }
+
+        // Prints the table and builds the JSON of the @result. The phases slower than the @baseline ones by more than
+        // the threshold are marked and counted in @regressions
+        auto report_scaling(const scaling_benchmark& result, const scaling_options& options, json_t *baseline,
+            size_t& regressions) -> json_t *
+        {
+            json_t *root = json_object();
+            json_object_set_new(root, "threshold", json_real(options.threshold));
+            json_object_set_new(root, "iterations", json_integer((json_int_t)options.iterations));
+
+            const auto& graph = options.graph;
+            json_t *jgraph = json_object();
+            json_object_set_new(jgraph, "seed", json_integer(graph.seed));
+            json_object_set_new(jgraph, "fanOut", json_integer(graph.fan_out));
+            json_object_set_new(jgraph, "values", json_integer(graph.values));
+            json_object_set_new(jgraph, "stringShare", json_real(graph.string_share));
+            json_object_set_new(jgraph, "meanStringLength", json_real(graph.mean_string_length));
+            json_object_set_new(jgraph, "formShare", json_real(graph.form_share));
+            json_object_set_new(jgraph, "cycleShare", json_real(graph.cycle_share));
+            json_object_set_new(root, "graph", jgraph);
+
+            printf("%lu iteration(s), ms\n", (unsigned long)options.iterations);
+            printf("    %9s %-9s %9s %9s %9s %11s %9s\n", "objects", "phase", "min", "mean", "max", "ns/object", "limit");
+
+            regressions = 0;
+            json_t *jsizes = json_array();
+            for (auto& size : result.sizes) {
+                const size_t objects = size.graph.objects;
+
+                json_t *jsize = json_object();
+                json_object_set_new(jsize, "objects", json_integer((json_int_t)objects));
+                json_object_set_new(jsize, "items", json_integer((json_int_t)size.graph.items));
+                json_object_set_new(jsize, "strings", json_integer((json_int_t)size.graph.strings));
+                json_object_set_new(jsize, "stringBytes", json_integer((json_int_t)size.graph.string_bytes));
+                json_object_set_new(jsize, "forms", json_integer((json_int_t)size.graph.forms));
+                json_object_set_new(jsize, "cycles", json_integer((json_int_t)size.graph.cycles));
+                if (!size.iterations.empty()) {
+                    json_object_set_new(jsize, "saveSize", json_integer((json_int_t)size.iterations.back().save_size));
+                }
+
+                json_t *jphases = json_object();
+                for (auto& phase : scaling_phases) {
+                    const phase_summary s = summarize(size.iterations, phase.field);
+                    const double perObject = objects ? s.mean * 1e6 / objects : 0;
+
+                    json_t *jphase = json_object();
+                    json_object_set_new(jphase, "min", json_real(s.min));
+                    json_object_set_new(jphase, "mean", json_real(s.mean));
+                    json_object_set_new(jphase, "max", json_real(s.max));
+                    json_object_set_new(jphase, "nsPerObject", json_real(perObject));
+                    printf("    %9lu %-9s %9.2f %9.2f %9.2f %11.1f", (unsigned long)objects, phase.name, s.min, s.mean, s.max, perObject);
+
+                    const double base = baseline ? baseline_mean(baseline, objects, phase.name) : -1;
+                    if (base >= 0) {
+                        const double limit = base * (1 + options.threshold);
+                        const bool regressed = s.mean > limit;
+                        regressions += regressed;
+                        json_object_set_new(jphase, "baseline", json_real(base));
+                        json_object_set_new(jphase, "limit", json_real(limit));
+                        json_object_set_new(jphase, "regressed", json_boolean(regressed));
+                        printf(" %9.2f%s", limit, regressed ? " REGRESSED" : "");
+                    }
+                    printf("\n");
+                    json_object_set_new(jphases, phase.name, jphase);
+                }
+                json_object_set_new(jsize, "phases", jphases);
+                json_array_append_new(jsizes, jsize);
+            }
+            json_object_set_new(root, "sizes", jsizes);
+            json_object_set_new(root, "regressions", json_integer((json_int_t)regressions));
+
+            if (baseline) {
+                printf("%lu phase(s) regressed by more than %.0f%%\n", (unsigned long)regressions, options.threshold * 100);
+            }
+            return root;
+        }
+
+        auto parse_sizes(const std::string& list) -> std::vector<size_t> {
+            std::vector<size_t> sizes;
+            std::istringstream stream(list);
+            std::string size;
+            while (std::getline(stream, size, ',')) {
+                if (auto objects = strtoul(size.c_str(), nullptr, 10)) {
+                    sizes.push_back(objects);
+                }
+            }
+            return sizes;
+        }
+
+        auto run_scaling_command(const std::vector<std::string>& args) -> int {
+            scaling_options options;
+            auto& graph = options.graph;
+            std::string jsonPath;
+
+            for (size_t i = 0; i < args.size(); ++i) {
+                const std::string& arg = args[i];
+                if (arg == "--compressed") {
+                    options.compress_saves = true;
+                    continue;
+                }
+                if (i + 1 == args.size()) {
+                    print_usage();
+                    return 1;
+                }
+
+                const char *value = args[++i].c_str();
+                if (arg == "--sizes") {
+                    options.sizes = parse_sizes(value);
+                }
+                else if (arg == "--iterations") {
+                    options.iterations = strtoul(value, nullptr, 10);
+                }
+                else if (arg == "--seed") {
+                    graph.seed = strtoul(value, nullptr, 10);
+                }
+                else if (arg == "--fan-out") {
+                    graph.fan_out = strtoul(value, nullptr, 10);
+                }
+                else if (arg == "--values") {
+                    graph.values = strtoul(value, nullptr, 10);
+                }
+                else if (arg == "--strings") {
+                    graph.string_share = atof(value);
+                }
+                else if (arg == "--string-length") {
+                    graph.mean_string_length = atof(value);
+                }
+                else if (arg == "--forms") {
+                    graph.form_share = atof(value);
+                }
+                else if (arg == "--cycles") {
+                    graph.cycle_share = atof(value);
+                }
+                else if (arg == "--baseline") {
+                    options.baseline = value;
+                }
+                else if (arg == "--threshold") {
+                    options.threshold = atof(value);
+                }
+                else if (arg == "--json") {
+                    jsonPath = value;
+                }
+                else {
+                    print_usage();
+                    return 1;
+                }
+            }
+
+            auto baseline = make_unique_ptr((json_t *)nullptr, &json_decref);
+            if (!options.baseline.empty()) {
+                json_error_t error;
+                baseline.reset(json_load_file(options.baseline.c_str(), 0, &error));
+                if (!baseline) {
+                    fprintf(stderr, "unable to read the baseline %s: %s\n", options.baseline.c_str(), error.text);
+                    return 2;
+                }
+            }
+
+            const scaling_benchmark result = run_scaling_benchmark(options);
+
+            size_t regressions = 0;
+            auto report = make_unique_ptr(report_scaling(result, options, baseline.get(), regressions), &json_decref);
+            if (!jsonPath.empty()) {
+                auto text = make_unique_ptr(json_dumps(report.get(), JSON_INDENT(2)), free);
+                if (!text || !write_text_file(jsonPath, text.get())) {
+                    return 2;
+                }
+            }
+
+            return regressions > 0 ? 4 : 0;
+        }
+    }
+
+    int run_save_inspector(const std::vector<std::string>& args) {
+        if (!args.empty() && args.front() == "--synthetic") {
+            skse::set_fake_api();
+            return run_scaling_command(std::vector<std::string>(args.begin() + 1, args.end()));
+        }
+
+        inspection_options options;
+        std::string dumpPath;
+        std::string jsonPath;
+
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            const bool hasValue = i + 1 < args.size();
+
+            if (arg == "--iterations" && hasValue) {
+                options.iterations = strtoul(args[++i].c_str(), nullptr, 10);
+            }
+            else if (arg == "--domain" && hasValue) {
+                options.domains.insert(args[++i].c_str());
+            }
+            else if (arg == "--json" && hasValue) {
+                jsonPath = args[++i];
+            }
+            else if (arg == "--lazy") {
+                options.lazy_load = true;
+            }
+            else if (arg == "--dedup") {
+                options.deduplicate_saves = true;
+            }
+            else if (arg == "--compressed") {
+                options.compress_saves = true;
+            }
+            else if (dumpPath.empty() && arg.compare(0, 2, "--") != 0) {
+                dumpPath = arg;
+            }
+            else {
+                print_usage();
+                return 1;
+            }
+        }
+
+        if (dumpPath.empty()) {
+            print_usage();
+            return 1;
+        }
+
+        std::ifstream file(dumpPath, std::ios::in | std::ios::binary);
+        if (!file) {
+            fprintf(stderr, "unable to open %s\n", dumpPath.c_str());
+            return 2;
+        }
+        const std::string dump{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+        skse::set_fake_api(); // the forms are kept as they are, no game to resolve them
+
+        const save_inspection result = inspect_save(dump, options);
+        print_report(dumpPath, result);
+
+        if (!jsonPath.empty() && !write_text_file(jsonPath, result.to_json(dumpPath))) {
+            return 2;
+        }
+
+        return 0;
+    }
+
+    namespace testing {
+
+        TEST(save_inspector, figures)
+        {
+            using namespace collections;
+
+            master m;
+            m.compress_saves = false;
+            auto& dom = m.get_default_domain();
+            auto& root = map::object(dom);
+            dom.set_root(&root);
+            auto& list = array::object(dom);
+            list.u_push(item("abc"));
+            list.u_push(item(1));
+            root.u_set("key", item(&list));
+
+            std::ostringstream saved;
+            m.write_to_stream(saved);
+
+            inspection_options options;
+            options.iterations = 2;
+            const auto result = inspect_save(saved.str(), options);
+
+            ASSERT_EQ(1u, result.domains.size());
+            auto& stats = result.domains.front();
+            EXPECT_EQ(2u, stats.objects);
+            EXPECT_EQ(1u, stats.types.at("JMap"));
+            EXPECT_EQ(1u, stats.types.at("JArray"));
+            EXPECT_EQ(3u, stats.items);
+            EXPECT_EQ(2u, stats.strings);
+            EXPECT_EQ(6u, stats.string_bytes); // "key" and "abc"
+            EXPECT_EQ(2u, stats.max_depth);
+
+            ASSERT_EQ(2u, result.iterations.size());
+            EXPECT_EQ(0u, result.iterations.front().garbage);
+            EXPECT_GT(result.iterations.front().save_size, 0u);
+
+            auto js = make_unique_ptr(json_loads(result.to_json("figures").c_str(), 0, nullptr), &json_decref);
+            ASSERT_TRUE(js != nullptr);
+            EXPECT_EQ(2u, json_array_size(json_object_get(js.get(), "iterations")));
+        }
+
+        TEST(save_inspector, scaling_thresholds)
+        {
+            scaling_options options;
+            options.sizes = { 500 };
+            options.iterations = 1;
+            const auto result = run_scaling_benchmark(options);
+
+            ASSERT_EQ(1u, result.sizes.size());
+            EXPECT_EQ(500u, result.sizes.front().graph.objects);
+            ASSERT_EQ(1u, result.sizes.front().iterations.size());
+            EXPECT_GT(result.sizes.front().iterations.front().save_size, 0u);
+
+            auto makeBaseline = [](double mean) {
+                json_t *phases = json_object();
+                for (auto& phase : scaling_phases) {
+                    json_t *jphase = json_object();
+                    json_object_set_new(jphase, "mean", json_real(mean));
+                    json_object_set_new(phases, phase.name, jphase);
+                }
+                json_t *size = json_object();
+                json_object_set_new(size, "objects", json_integer(500));
+                json_object_set_new(size, "phases", phases);
+                json_t *sizes = json_array();
+                json_array_append_new(sizes, size);
+
+                auto baseline = make_unique_ptr(json_object(), &json_decref);
+                json_object_set_new(baseline.get(), "sizes", sizes);
+                return baseline;
+            };
+
+            size_t regressions = 0;
+            auto report = make_unique_ptr(report_scaling(result, options, makeBaseline(1e9).get(), regressions), &json_decref);
+            EXPECT_EQ(0u, regressions);
+            auto save = json_object_get(json_object_get(json_array_get(json_object_get(report.get(), "sizes"), 0), "phases"), "save");
+            EXPECT_TRUE(json_is_number(json_object_get(save, "limit")));
+
+            // nothing is done in no time
+            report = make_unique_ptr(report_scaling(result, options, makeBaseline(0).get(), regressions), &json_decref);
+            EXPECT_GT(regressions, 0u);
+            EXPECT_EQ((json_int_t)regressions, json_integer_value(json_object_get(report.get(), "regressions")));
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+#include "util/istring.h"
+#include "collections/synthetic_db.h"
+
+namespace domain_master {
+
+    // Loads a co-save record dump outside of the game, the forms are resolved by the fake skse api.
+    // The figures of the domains come from a separate load, the timed iterations don't decode anything on their own
+    struct inspection_options {
+        size_t iterations = 1;
+        std::set<util::istring> domains; // the named domains to load, the others get dropped as the game would drop them
+        bool lazy_load = false;
+        bool deduplicate_saves = false;
+        bool compress_saves = false;
+    };
+
+    struct save_inspection {
+        struct domain_stats {
+            std::string name; // empty for the default domain
+            size_t objects = 0;
+            size_t public_objects = 0;
+            size_t items = 0; // the values of all the containers
+            size_t strings = 0; // the string values and the string keys
+            size_t string_bytes = 0;
+            size_t max_depth = 0; // the longest chain of references, from the objects no other object references
+            std::map<std::string, size_t> types; // the object count per script type name
+        };
+
+        // in milliseconds
+        struct iteration {
+            double load = 0;
+            double collect = 0;
+            double save = 0;
+            size_t garbage = 0; // the objects the collection has deleted
+            size_t save_size = 0;
+        };
+
+        size_t dump_size = 0;
+        std::vector<domain_stats> domains;
+        std::vector<iteration> iterations;
+
+        // the JSON the regression tracking compares
+        std::string to_json(const std::string& dumpName) const;
+    };
+
+    save_inspection inspect_save(const std::string& dump, const inspection_options& options);
+
+    // The save, load, collection and clearing of the synthetic graphs of growing sizes (see collections::generate_synthetic_db),
+    // each in a tes_context_standalone of its own. The means get compared with the ones of a baseline run
+    struct scaling_options {
+        std::vector<size_t> sizes = { 10000, 100000, 1000000 };
+        size_t iterations = 3;
+        collections::synthetic_db_options graph;
+        bool compress_saves = false;
+        std::string baseline; // the JSON of a previous run, the file path. Empty - none
+        double threshold = 0.1; // a phase regresses once its mean exceeds the baseline mean by this share
+    };
+
+    struct scaling_benchmark {
+        // in milliseconds
+        struct iteration {
+            double generate = 0;
+            double save = 0;
+            double background_save = 0; // the same save written by the write_to_stream_in_background
+            double load = 0;
+            double collect = 0;
+            double clear = 0;
+            size_t save_size = 0;
+        };
+
+        struct size_result {
+            collections::synthetic_db_stats graph;
+            std::vector<iteration> iterations;
+        };
+
+        std::vector<size_result> sizes;
+    };
+
+    scaling_benchmark run_scaling_benchmark(const scaling_options& options);
+
+    // The command line of the save_inspector tool: <dump file> [--iterations N] [--domain name]... [--lazy] [--dedup]
+    // [--compressed] [--json file]. With --synthetic in place of the dump file, runs the scaling benchmark instead.
+    // Returns the process exit code, 4 if the benchmark has regressed
+    int run_save_inspector(const std::vector<std::string>& args);
+}
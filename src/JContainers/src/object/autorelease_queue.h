@@ -94,6 +94,7 @@ namespace collections {
             _toRelease.clear();
         }
 
+        friend class object_context;
         friend class boost::serialization::access;
         BOOST_SERIALIZATION_SPLIT_MEMBER();
 
@@ -160,6 +161,7 @@ namespace collections {
 
             spinlock::guard g(_queue_mutex);
             object._aqueue_push_time = isPublic ? _tickCounter : time_subtract(_tickCounter, obj_lifeInTicks);
+            object.mark_modified();
             if (!object.is_in_aqueue()) {
                 _queue.push_back(&object);
             }
@@ -170,6 +172,7 @@ namespace collections {
                 //jc_debug("aqueue: removed id - %u", object._uid());
                 spinlock::guard g(_queue_mutex);
                 object._aqueue_push_time = time_subtract(_tickCounter, obj_lifeInTicks);
+                object.mark_modified();
             }
         }
 
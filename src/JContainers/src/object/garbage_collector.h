@@ -59,7 +59,7 @@ namespace collections
                     to_visit_temp.swap(objects_to_visit);
 
                     for (auto& obj : to_visit_temp) {
-                        obj->u_visit_referenced_objects(visitor);
+                        obj->u_visit_all_referenced_objects(visitor); // the lazily loaded objects stay encoded
                     }
                 }
 
@@ -107,6 +107,7 @@ namespace collections
                 for (auto& obj : garbage) {
                     if (obj->noOwners() == false) { // an object is part of a graph
                         // the object's ref. count in the unreachable graphs reaches zero -> all objects are moved into aqueue
+                        obj->u_drop_lazy_contents();
                         obj->u_clear();
                         ++part_of_graphs;
                     }
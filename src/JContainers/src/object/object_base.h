@@ -2,6 +2,7 @@
 
 #include <mutex>
 #include <atomic>
+#include <functional>
 #include <assert.h>
 #include <boost/optional/optional.hpp>
 #include "boost/noncopyable.hpp"
@@ -27,6 +28,11 @@ namespace collections {
         Map,
         FormMap,
         IntegerMap,
+        CounterMap,
+        MapCursor,
+        Set,
+        RingBuffer,
+        PriorityQueue,
     };
 
     struct object_base_stack_ref_policy {
@@ -38,6 +44,19 @@ namespace collections {
     using object_stack_ref_template = boost::intrusive_ptr_jc<T, object_base_stack_ref_policy>;
 	using object_stack_ref = object_stack_ref_template<object_base>;
 	using spinlock = util::spinlock;
+	using object_mutex = util::adaptive_lock;
+
+    // The contents of a lazily loaded object, still encoded - the object stays empty until they get decoded
+    // (see object_base::materialize). Holds the objects the contents reference, so that the reference counts are
+    // the same as if the contents were decoded
+    class lazy_contents {
+    public:
+        virtual ~lazy_contents() {}
+
+        virtual void u_decode_into(object_base& object) = 0;
+        virtual void u_visit_referenced_objects(const std::function<void(object_base&)>& visitor) = 0;
+        virtual void u_nullify_references() = 0;
+    };
 
     class object_base : public boost::noncopyable
     {
@@ -58,21 +77,40 @@ namespace collections {
         time_point _aqueue_push_time            = 0;
 
         CollectionType                          _type = CollectionType::None;
+        uint32_t _serial_index                  = 0; // 1-based index in the object table of the compact save being written
+
+        // The delta saves write only the objects changed since the base image was written. The contents change under
+        // the exclusive lock only, so the write sequence of the _mutex tells whether they have changed.
+        // The header fields (the refcount, the aqueue push time) changing without the lock raise the _modified flag
+        uint32_t _base_index                    = 0; // 1-based index in the object table of the base image, 0 - not there
+        uint32_t _base_sequence                 = 0; // the write sequence of the contents stored in the base image
+        std::atomic_bool _modified              = false;
         util::istring                           _tag;
+        std::atomic<lazy_contents*> _lazy       = nullptr; // the encoded contents, null once decoded
+
+        // A background save writes the object as it was when the snapshot got taken (see object_context::objects_snapshot):
+        // the first writer since keeps a copy of the contents for the save. Change under the exclusive lock,
+        // or under the shared one by the save itself
+        mutable bool _save_pending              = false;
+        mutable object_base *_save_copy         = nullptr;
     private:
         object_context *_context                = nullptr;
 
         void release_counter(std::atomic_int32_t& counter);
         bool is_completely_initialized() const { return _context != nullptr; }
         void try_prolong_lifetime();
+        void materialize_slow();
+        void keep_contents_for_save() const;
 
     public:
 
-        virtual ~object_base() {}
+        virtual ~object_base() {
+            delete _lazy.load(std::memory_order_relaxed);
+        }
 
     public:
-        using lock = std::lock_guard<spinlock>;
-        mutable spinlock _mutex;
+        using lock = std::lock_guard<object_mutex>;
+        mutable object_mutex _mutex;
 
         explicit object_base(CollectionType type)
             : _type(type)
@@ -92,7 +130,45 @@ namespace collections {
             return _uid() != Handle::Null;
         }
 
-        spinlock& mutex() const { return _mutex; }
+        void mark_modified() {
+            _modified.store(true, std::memory_order_relaxed);
+        }
+
+        // the writers call it once they hold the exclusive lock, before they change the contents
+        void u_before_write() const {
+            if (_save_pending) {
+                keep_contents_for_save();
+            }
+        }
+
+        bool u_is_modified_since_base() const {
+            return _base_index == 0
+                || _modified.load(std::memory_order_relaxed)
+                || _mutex.read_sequence_begin() != _base_sequence;
+        }
+
+        object_mutex& mutex() const { return _mutex; }
+
+        bool is_materialized() const {
+            return _lazy.load(std::memory_order_acquire) == nullptr;
+        }
+
+        // Decodes the contents of a lazily loaded object, once. Anything reading the contents has to call it first:
+        // the registry lookups and item::object do
+        void materialize() {
+            if (!is_materialized()) {
+                materialize_slow();
+            }
+        }
+
+        // the unlocked counterparts, for the loading and the collection of the objects.
+        // u_materialize doesn't call u_onLoaded, the u_drop_lazy_contents releases the references as u_clear would
+        void u_materialize();
+        void u_drop_lazy_contents();
+        void u_nullify_lazy_contents();
+
+        // visits the references of the contents, whether they are decoded or not
+        void u_visit_all_referenced_objects(const std::function<void(object_base&)>& visitor);
 
         template<class T> T* as() {
             return const_cast<T*>(const_cast<const object_base*>(this)->as<T>());
@@ -177,12 +253,13 @@ namespace collections {
         virtual void u_nullifyObjects() = 0;
 
         SInt32 s_count() const {
-            lock g(_mutex);
+            object_mutex::shared_guard g(_mutex);
             return u_count();
         }
 
         void s_clear() {
             lock g(_mutex);
+            u_before_write();
             u_clear();
         }
 
@@ -230,10 +307,23 @@ namespace collections {
     class object_lock {
         object_base::lock _lock;
     public:
-        explicit object_lock(const object_base *obj) : _lock(obj->_mutex) {}
-        explicit object_lock(const object_base &obj) : _lock(obj._mutex) {}
+        explicit object_lock(const object_base *obj) : _lock(obj->_mutex) { obj->u_before_write(); }
+        explicit object_lock(const object_base &obj) : _lock(obj._mutex) { obj.u_before_write(); }
+
+        template<class T, class P>
+        explicit object_lock(const boost::intrusive_ptr_jc<T, P>& ref) : _lock(static_cast<const object_base&>(*ref)._mutex) {
+            static_cast<const object_base&>(*ref).u_before_write();
+        }
+    };
+
+    // for the read-only access: there can be many readers at once
+    class object_shared_lock {
+        object_mutex::shared_guard _lock;
+    public:
+        explicit object_shared_lock(const object_base *obj) : _lock(obj->_mutex) {}
+        explicit object_shared_lock(const object_base &obj) : _lock(obj._mutex) {}
 
         template<class T, class P>
-        explicit object_lock(const boost::intrusive_ptr_jc<T, P>& ref) : _lock(static_cast<const object_base&>(*ref)._mutex) {}
+        explicit object_shared_lock(const boost::intrusive_ptr_jc<T, P>& ref) : _lock(static_cast<const object_base&>(*ref)._mutex) {}
     };
 }
@@ -86,6 +86,7 @@ namespace collections
 
     object_base* object_base::tes_retain() {
         ++_tes_refCount;
+        mark_modified();
         context().aqueue->not_prolong_lifetime(*this);
         return this;
     }
@@ -93,6 +94,7 @@ namespace collections
     void object_base::tes_release() {
         if (_tes_refCount > 0) {
             --_tes_refCount;
+            mark_modified();
             if (noOwners()) {
                 // a user releases the object, no owners - I may even delete it immediately
                 context().aqueue->prolong_lifetime(*this, true);
@@ -147,4 +149,67 @@ namespace collections
         context().aqueue->not_prolong_lifetime(*this);
         return this;
     }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    // The exclusive lock keeps the readers of the contents waiting while the contents get decoded.
+    // No other object gets locked meanwhile: the decoding only retains the referenced objects
+    void object_base::materialize_slow() {
+        object_lock g(this);
+        lazy_contents *lazy = _lazy.load(std::memory_order_relaxed);
+        if (!lazy) {
+            return; // decoded by another thread
+        }
+
+        // the locking has made the write sequence odd and the unlocking makes it even again. The contents stay
+        // the same as in the base image, the delta saves shouldn't treat them as modified
+        const uint32_t sequence = _mutex.read_sequence_begin();
+        if (_base_sequence == sequence - 1) {
+            _base_sequence = sequence + 1;
+        }
+
+        try {
+            lazy->u_decode_into(*this);
+            u_onLoaded();
+        }
+        catch (const std::exception& exc) {
+            JC_log("unable to decode the contents of the object %u - '%s'", (uint32_t)_uid(), exc.what());
+            u_clear();
+        }
+
+        _lazy.store(nullptr, std::memory_order_release);
+        delete lazy; // the decoded contents hold the references now
+    }
+
+    // Called under the exclusive lock: the contents are still the ones the snapshot has captured
+    void object_base::keep_contents_for_save() const {
+        _save_copy = compact_writer::u_copy_contents(*this);
+        _save_pending = false;
+    }
+
+    void object_base::u_materialize() {
+        std::unique_ptr<lazy_contents> lazy{ _lazy.exchange(nullptr, std::memory_order_acq_rel) };
+        if (lazy) {
+            lazy->u_decode_into(*this);
+        }
+    }
+
+    void object_base::u_drop_lazy_contents() {
+        delete _lazy.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+    void object_base::u_nullify_lazy_contents() {
+        if (auto lazy = _lazy.load(std::memory_order_relaxed)) {
+            lazy->u_nullify_references();
+        }
+    }
+
+    void object_base::u_visit_all_referenced_objects(const std::function<void(object_base&)>& visitor) {
+        if (auto lazy = _lazy.load(std::memory_order_acquire)) {
+            lazy->u_visit_referenced_objects(visitor);
+        }
+        else {
+            u_visit_referenced_objects(visitor);
+        }
+    }
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include <atomic>
 #include <functional>
 #include <deque>
+#include <memory>
+#include <string>
+#include <vector>
 #include <boost/serialization/split_member.hpp>
 
 #include "object_base.h"
@@ -18,6 +21,8 @@ namespace collections {
 
     class object_registry;
     class autorelease_queue;
+    class compact_writer;
+    class compact_reader;
 
 
     class dependent_context {
@@ -32,7 +37,8 @@ namespace collections {
         no_header = 3, // no JSON header in the beginning of a stream
         pre_gc = 4, // next version implements GC
         pre_dyn_form_watcher = 5, // next version implements dynamic-form-watcher
-        current = 6,
+        pre_compact_format = 6, // next version replaces the boost archive with the compact one (see compact_writer)
+        current = 7,
     };
 
     /*
@@ -49,9 +55,20 @@ namespace collections {
 
     public:
         void u_postLoadInitializations();
-        void u_postLoadMaintenance(const serialization_version saveVersion);
+
+        // the outcome of the garbage collection of the u_postLoadMaintenance
+        struct maintenance_stats {
+            size_t garbage = 0;
+            size_t part_of_graphs = 0; // the objects of the cyclic graphs
+        };
+        // Logs the outcome unless the @stats receive it: the domains run it in parallel and get logged in order
+        void u_postLoadMaintenance(const serialization_version saveVersion, maintenance_stats *stats = nullptr);
         void u_print_stats() const;
 
+        // objects with the highest lock contention counts (collected while util::adaptive_lock tracking is enabled)
+        std::vector<std::pair<object_stack_ref, uint32_t>> most_contended_objects(size_t count) const;
+        void print_lock_contention(size_t count) const;
+
     public:
         std::unique_ptr<object_registry> registry;
         std::unique_ptr<autorelease_queue> aqueue;
@@ -103,10 +120,106 @@ namespace collections {
 
         template<class Archive> void load_data_in_old_way(Archive& ar);
 
+        // the versions past serialization_version::pre_compact_format
+        void save_compact(compact_writer& ar) const;
+        void load_compact(compact_reader& ar);
+
+        enum class snapshot_kind {
+            full, // all the objects, for the save_compact
+            base, // all the objects, for the save_compact of a new base image. The objects are marked unmodified
+            delta, // the objects modified since the base image, for the save_compact_delta
+        };
+
+        // the cost and the outcome of the deduplication of a save
+        struct dedup_stats {
+            uint32_t hashed = 0; // the objects whose contents got hashed
+            uint32_t copies = 0; // the subtrees written as the copies of the identical ones
+            uint32_t elided = 0; // the objects of these subtrees that weren't written at all
+            double hashing_ms = 0;
+        };
+
+        // The state the save_compact writes. Keeps the objects alive until destroyed.
+        // With the copy_on_write, the objects may keep changing while the snapshot gets written
+        struct objects_snapshot : boost::noncopyable {
+            struct entry {
+                object_stack_ref object;
+                object_base *contents = nullptr; // the object itself or its copy, null if the delta doesn't include it
+                uint32_t sequence = 0; // the write sequence of the contents
+                uint32_t base_index = 0;
+                Handle id = Handle::Null;
+                int32_t tes_refCount = 0;
+                object_base::time_point push_time = 0;
+                std::string tag;
+            };
+
+            std::vector<entry> objects;
+            std::vector<std::pair<HandleT, HandleT>> free_id_ranges;
+            size_t current_id_range = 0;
+            object_base::time_point tick_counter = 0;
+            std::vector<object_base *> queue;
+            snapshot_kind kind = snapshot_kind::full;
+            // the objects keep changing: their contents are read under their shared locks,
+            // unless the first writer has kept a copy of the captured ones (see object_base::_save_copy)
+            bool copy_on_write = false;
+
+            // The full saves may write the identical subtrees once: the contents of the containers get hashed bottom-up,
+            // a subtree of the private objects referenced by a single container each is written as a copy of the first
+            // identical one. The copies get re-expanded into distinct objects on load
+            bool deduplicate = false;
+            mutable dedup_stats stats; // filled by the save_compact, it plans the deduplication as it writes
+
+            // the delta part
+            uint32_t base_object_count = 0;
+            std::vector<uint32_t> deleted; // the base indices of the objects gone since
+
+            // the number of the objects the delta writes
+            size_t changed_count() const;
+
+            ~objects_snapshot();
+        };
+
+        // Taken while the activity is stopped. With @copyOnWrite, the objects may change once the activity resumes
+        // and the snapshot gets written meanwhile: nothing is copied upfront, the first writer of an object keeps a copy
+        // of the captured contents for the save. The contents of the counter maps and the cursors change without
+        // their locks, they get copied right away, as do the contents of the lazily loaded objects - decoded
+        std::unique_ptr<objects_snapshot> u_take_snapshot(bool copyOnWrite, snapshot_kind kind = snapshot_kind::full) const;
+        static void save_compact(compact_writer& ar, const objects_snapshot& state);
+        // the @state has been written: the u_print_stats logs its deduplication from now on, if it has deduplicated
+        void record_save_stats(const objects_snapshot& state);
+        const dedup_stats& last_dedup_stats() const { return _last_dedup; }
+
+        // The delta to the base image: the deleted objects, the modified and the new ones, then the id generator
+        // and the aqueue state (these two are small enough to be written in full).
+        // The base snapshot turns into the delta with no changes
+        static void save_compact_delta(compact_writer& ar, const objects_snapshot& state);
+        // the base snapshot has been written successfully: the delta saves are relative to it from now on
+        void u_adopt_base(const objects_snapshot& state);
+
+        // The objects of a base image, read but not registered yet. Destroys them unless load_compact_delta takes them
+        struct loaded_base : boost::noncopyable {
+            std::vector<object_base *> objects;
+            ~loaded_base();
+        };
+
+        // reads the save_compact of the base snapshot
+        static void read_base(compact_reader& ar, loaded_base& base);
+        // the context is empty: loads the @base with the delta applied
+        void load_compact_delta(compact_reader& ar, loaded_base& base);
+
+        uint32_t base_object_count() const { return _base_object_count; }
+
         friend class boost::serialization::access;
         BOOST_SERIALIZATION_SPLIT_MEMBER();
 
     private:
+        static void read_header(compact_reader& ar, object_base& obj);
+        static void read_objects(compact_reader& ar, loaded_base& owner);
+        void u_register_loaded(loaded_base& loaded);
+        void u_read_id_generator_and_aqueue(compact_reader& ar);
+
+        uint32_t _base_object_count = 0;
+        dedup_stats _last_dedup; // of the last save that has deduplicated
+
         spinlock _dependent_contexts_mutex;
         std::vector<dependent_context*> _dependent_contexts;
 
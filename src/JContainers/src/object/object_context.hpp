@@ -51,6 +51,7 @@ namespace collections
             aqueue->u_nullify();
 
             for (auto& obj : registry->u_all_objects()) {
+                obj->u_nullify_lazy_contents();
                 obj->u_nullifyObjects();
             }
             for (auto& obj : registry->u_all_objects()) {
@@ -59,6 +60,7 @@ namespace collections
 
             registry->u_clear();
             aqueue->u_clear();
+            _base_object_count = 0;
         }
     }
 
@@ -109,10 +111,709 @@ namespace collections
         ar >> *registry >> *aqueue;
     }
 
+    object_context::objects_snapshot::~objects_snapshot() {
+        for (auto& e : objects) {
+            e.object->_serial_index = 0;
+            if (e.contents != e.object.get()) {
+                delete e.contents;
+            }
+            else if (copy_on_write) {
+                object_base *copy = nullptr;
+                {
+                    object_shared_lock g(e.object);
+                    std::swap(copy, e.object->_save_copy);
+                    e.object->_save_pending = false;
+                }
+                delete copy;
+            }
+        }
+    }
+
+    size_t object_context::objects_snapshot::changed_count() const {
+        if (kind != snapshot_kind::delta) {
+            return 0;
+        }
+        return deleted.size() + std::count_if(objects.begin(), objects.end(), [](const entry& e) { return e.contents != nullptr; });
+    }
+
+    std::unique_ptr<object_context::objects_snapshot> object_context::u_take_snapshot(bool copyOnWrite, snapshot_kind kind) const {
+        std::unique_ptr<objects_snapshot> state{ new objects_snapshot() };
+        state->kind = kind;
+        state->copy_on_write = copyOnWrite;
+        auto& objects = state->objects;
+
+        // the object indices are assigned along the way: an object with zero index isn't captured yet
+        auto capture = [&objects](object_base& obj) {
+            if (obj._serial_index == 0) {
+                objects_snapshot::entry e;
+                e.object = object_stack_ref{ obj };
+                objects.push_back(std::move(e));
+                obj._serial_index = (uint32_t)objects.size();
+            }
+        };
+
+        {
+            read_lock g(registry->_mutex);
+            objects.reserve(registry->_all_objects.size());
+            for (auto obj : registry->_all_objects) {
+                capture(*obj);
+            }
+        }
+        {
+            spinlock::guard g(aqueue->_queue_mutex);
+            state->tick_counter = aqueue->_tickCounter;
+            state->queue.reserve(aqueue->_queue.size());
+            for (auto& ref : aqueue->_queue) {
+                capture(*ref);
+                state->queue.push_back(ref.get());
+            }
+        }
+
+        // the objects created after the registry was read are captured once a copy references them.
+        // The delta skips the unmodified objects: whatever they reference is captured already
+        for (size_t i = 0; i < objects.size(); ++i) {
+            object_base& obj = *objects[i].object;
+            const bool inBase = obj._base_index != 0 && obj._base_index <= _base_object_count;
+            if (kind == snapshot_kind::delta && inBase && !obj.u_is_modified_since_base()) {
+                continue;
+            }
+            if (kind == snapshot_kind::base) {
+                obj._modified.store(false, std::memory_order_relaxed); // any change from now on raises it again
+            }
+
+            const bool changesUnlocked = obj.type() == CollectionType::CounterMap || obj.type() == CollectionType::MapCursor;
+            if (!obj.is_materialized() || (copyOnWrite && changesUnlocked)) {
+                objects[i].contents = compact_writer::copy_contents(obj, objects[i].sequence);
+                objects[i].contents->u_visit_referenced_objects(capture);
+            }
+            else {
+                objects[i].contents = &obj;
+                objects[i].sequence = obj.mutex().read_sequence_begin();
+                obj._save_pending = copyOnWrite;
+            }
+        }
+
+        for (auto& e : objects) {
+            e.id = e.object->_uid();
+            e.tes_refCount = e.object->_tes_refCount.load(std::memory_order_relaxed);
+            e.push_time = e.object->_aqueue_push_time;
+            const auto& tag = e.object->_tag;
+            e.tag = std::string(tag.data(), tag.size());
+        }
+
+        if (kind == snapshot_kind::base) {
+            for (size_t i = 0; i < objects.size(); ++i) {
+                objects[i].base_index = uint32_t(i + 1);
+            }
+            state->base_object_count = (uint32_t)objects.size();
+        }
+        else if (kind == snapshot_kind::delta) {
+            // the base objects keep their indices, the new ones follow them
+            const uint32_t baseCount = _base_object_count;
+            std::vector<bool> present(baseCount);
+            uint32_t nextIndex = baseCount;
+            for (auto& e : objects) {
+                const uint32_t index = e.object->_base_index;
+                if (index != 0 && index <= baseCount) {
+                    e.base_index = index;
+                    present[index - 1] = true;
+                }
+            }
+            for (auto& e : objects) {
+                e.object->_serial_index = e.base_index ? e.base_index : ++nextIndex;
+            }
+
+            state->base_object_count = baseCount;
+            for (uint32_t i = 0; i < baseCount; ++i) {
+                if (!present[i]) {
+                    state->deleted.push_back(i + 1);
+                }
+            }
+        }
+
+        // read last: the ids of the captured objects are taken
+        {
+            read_lock g(registry->_mutex);
+            auto& idGen = registry->_idGen;
+            for (auto& range : idGen._empty_ranges) {
+                state->free_id_ranges.emplace_back(range.first, range.last);
+            }
+            state->current_id_range = idGen._current_range - idGen._empty_ranges.begin();
+        }
+
+        return state;
+    }
+
+    namespace {
+        // Calls func(contents) with the contents of the entry as the snapshot has captured them. The object
+        // of the copy_on_write snapshot stays locked meanwhile, unless its first writer has kept a copy
+        template<class F>
+        void read_contents(const object_context::objects_snapshot& state, const object_context::objects_snapshot::entry& e, F&& func) {
+            if (!state.copy_on_write || e.contents != e.object.get()) {
+                func(*e.contents);
+                return;
+            }
+
+            object_base *copy = nullptr;
+            {
+                object_shared_lock g(e.object);
+                copy = e.object->_save_copy;
+                if (!copy) {
+                    func(*e.contents);
+                    return;
+                }
+            }
+            func(*copy); // never changes, it's destroyed along with the snapshot
+        }
+
+        void write_header(compact_writer& ar, const object_context::objects_snapshot::entry& e) {
+            ar.write_varint((HandleT)e.id);
+            ar.write_signed(e.tes_refCount);
+            ar.write_varint(e.push_time);
+            ar.write_string(e.tag);
+        }
+
+        void write_id_generator_and_aqueue(compact_writer& ar, const object_context::objects_snapshot& state) {
+            ar.write_varint(state.free_id_ranges.size());
+            for (auto& range : state.free_id_ranges) {
+                ar.write_varint(range.first);
+                ar.write_varint(range.second);
+            }
+            ar.write_varint(state.current_id_range);
+
+            ar.write_varint(state.tick_counter);
+            ar.write_varint(state.queue.size());
+            for (auto obj : state.queue) {
+                ar.write_object(obj);
+            }
+        }
+    }
+
+    namespace {
+        // the type of a copy of a deduplicated subtree has this bit set, the index of the copied object follows its header
+        enum : uint32_t { copy_type_flag = 1 << 8 };
+
+        struct deduplication {
+            std::vector<uint32_t> written; // the snapshot indices of the objects to write, the copies go last
+            std::vector<uint32_t> sources; // the snapshot index of the object each copy copies
+            size_t elided = 0;
+        };
+
+        // Merkle-style: the contents of an object are encoded with the references replaced by the classes of the
+        // referenced objects, the identical encodings share a class. The objects of the cycles, the cursors
+        // and whatever references them get no class.
+        // Then the pre-order walk from the objects referenced elsewhere finds the subtrees identical to the ones
+        // met earlier. A copy is possible if all of its descendants are private and have no other owners
+        deduplication plan_deduplication(const object_context::objects_snapshot& state, object_context::dedup_stats& stats) {
+            const auto started = std::chrono::steady_clock::now();
+            const auto& objects = state.objects;
+            const uint32_t count = (uint32_t)objects.size();
+
+            enum : uint32_t { no_class = 0, unvisited = ~0u, visiting = ~0u - 1 };
+            enum { min_weight = 4 }; // the bytes a copy has to save at least
+
+            std::vector<std::vector<uint32_t>> children(count);
+            std::vector<uint32_t> incoming(count);
+            std::vector<bool> opaque(count); // references an object out of the snapshot
+            for (uint32_t i = 0; i < count; ++i) {
+                read_contents(state, objects[i], [&](object_base& contents) {
+                    contents.u_visit_referenced_objects([&](object_base& child) {
+                        if (child._serial_index == 0) {
+                            opaque[i] = true;
+                            return;
+                        }
+                        children[i].push_back(child._serial_index - 1);
+                        ++incoming[child._serial_index - 1];
+                    });
+                });
+            }
+
+            std::vector<bool> queued(count);
+            for (auto obj : state.queue) {
+                queued[obj->_serial_index - 1] = true;
+            }
+            auto isInterior = [&](uint32_t i) {
+                const auto& e = objects[i];
+                return incoming[i] == 1 && e.id == Handle::Null && e.tes_refCount == 0 && e.tag.empty() && !queued[i];
+            };
+
+            std::vector<uint32_t> classes(count, unvisited);
+            std::vector<bool> contained(count); // all the descendants are interior ones
+            std::vector<size_t> weights(count); // the encoded size of the subtree
+            std::unordered_map<std::string, uint32_t> known;
+
+            auto classify = [&](uint32_t i) -> uint32_t {
+                const auto& e = objects[i];
+                if (opaque[i] || e.contents->type() == CollectionType::MapCursor) {
+                    return no_class;
+                }
+
+                std::unordered_map<const object_base*, uint32_t> childClasses;
+                bool allInterior = true;
+                size_t weight = 0;
+                for (auto c : children[i]) {
+                    if (classes[c] == no_class || classes[c] == visiting) {
+                        return no_class;
+                    }
+                    childClasses[objects[c].object.get()] = classes[c];
+                    allInterior = allInterior && isInterior(c) && contained[c];
+                    weight += weights[c];
+                }
+
+                std::vector<uint32_t> forms;
+                std::string data;
+                read_contents(state, e, [&](const object_base& contents) {
+                    data = compact_writer::encode_contents(contents, childClasses, forms);
+                });
+                contained[i] = allInterior;
+                weights[i] = weight + data.size();
+
+                std::ostringstream key(std::ios::out | std::ios::binary);
+                {
+                    compact_writer keyArchive{ key };
+                    keyArchive.write_varint(e.contents->type());
+                    keyArchive.write_section(data);
+                    for (auto id : forms) {
+                        keyArchive.write_varint(id);
+                    }
+                }
+                return known.emplace(key.str(), uint32_t(known.size() + 1)).first->second;
+            };
+
+            // post-order, the classes of the referenced objects are known by the time their container gets its one
+            std::vector<uint32_t> stack;
+            for (uint32_t root = 0; root < count; ++root) {
+                if (classes[root] != unvisited) {
+                    continue;
+                }
+                stack.push_back(root);
+                while (!stack.empty()) {
+                    const uint32_t i = stack.back();
+                    if (classes[i] == unvisited) {
+                        classes[i] = visiting;
+                        for (auto c : children[i]) {
+                            if (classes[c] == unvisited) {
+                                stack.push_back(c);
+                            }
+                        }
+                        continue;
+                    }
+                    stack.pop_back();
+                    if (classes[i] == visiting) { // not a repeated entry of a finished object
+                        classes[i] = classify(i);
+                    }
+                }
+            }
+
+            deduplication plan;
+            std::vector<bool> elided(count), copied(count);
+            std::unordered_map<uint32_t, uint32_t> firstOfClass;
+            std::vector<uint32_t> copies;
+
+            for (uint32_t root = 0; root < count; ++root) {
+                if (isInterior(root)) {
+                    continue;
+                }
+                stack.push_back(root);
+                while (!stack.empty()) {
+                    const uint32_t i = stack.back();
+                    stack.pop_back();
+
+                    if (classes[i] != no_class && contained[i] && weights[i] >= min_weight) {
+                        auto found = firstOfClass.emplace(classes[i], i);
+                        if (!found.second) {
+                            copied[i] = true;
+                            copies.push_back(i);
+                            plan.sources.push_back(found.first->second);
+
+                            std::vector<uint32_t> descendants(children[i]);
+                            while (!descendants.empty()) {
+                                const uint32_t d = descendants.back();
+                                descendants.pop_back();
+                                elided[d] = true;
+                                ++plan.elided;
+                                descendants.insert(descendants.end(), children[d].begin(), children[d].end());
+                            }
+                            continue;
+                        }
+                    }
+
+                    for (auto c = children[i].rbegin(); c != children[i].rend(); ++c) {
+                        if (isInterior(*c)) {
+                            stack.push_back(*c);
+                        }
+                    }
+                }
+            }
+
+            for (uint32_t i = 0; i < count; ++i) {
+                if (!elided[i] && !copied[i]) {
+                    plan.written.push_back(i);
+                }
+            }
+            plan.written.insert(plan.written.end(), copies.begin(), copies.end());
+
+            stats.hashed = count;
+            stats.copies = (uint32_t)copies.size();
+            stats.elided = (uint32_t)plan.elided;
+            stats.hashing_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+            return plan;
+        }
+    }
+
+    // The object headers go first, so that the contents may reference any object by its index.
+    // With the deduplication the copies are the last objects, their contents aren't written
+    void object_context::save_compact(compact_writer& ar, const objects_snapshot& state) {
+        jc_assert(state.kind != snapshot_kind::delta);
+
+        deduplication plan;
+        if (state.deduplicate && state.kind == snapshot_kind::full) {
+            plan = plan_deduplication(state, state.stats);
+
+            // the objects get renumbered, the elided ones are referenced by the copies only
+            for (auto& e : state.objects) {
+                e.object->_serial_index = 0;
+            }
+            for (size_t i = 0; i < plan.written.size(); ++i) {
+                state.objects[plan.written[i]].object->_serial_index = uint32_t(i + 1);
+            }
+        }
+        else {
+            plan.written.resize(state.objects.size());
+            std::iota(plan.written.begin(), plan.written.end(), 0);
+        }
+
+        const size_t copyStart = plan.written.size() - plan.sources.size();
+        ar.write_varint(plan.written.size());
+        for (size_t i = 0; i < plan.written.size(); ++i) {
+            auto& e = state.objects[plan.written[i]];
+            if (i < copyStart) {
+                ar.write_varint(e.contents->type());
+                write_header(ar, e);
+            }
+            else {
+                ar.write_varint(e.contents->type() | copy_type_flag);
+                write_header(ar, e);
+                ar.write_varint(state.objects[plan.sources[i - copyStart]].object->_serial_index);
+            }
+        }
+        for (size_t i = 0; i < copyStart; ++i) {
+            read_contents(state, state.objects[plan.written[i]], [&ar](const object_base& contents) {
+                ar.write_contents(contents);
+            });
+        }
+
+        write_id_generator_and_aqueue(ar, state);
+    }
+
+    void object_context::save_compact(compact_writer& ar) const {
+        save_compact(ar, *u_take_snapshot(false));
+    }
+
+    void object_context::save_compact_delta(compact_writer& ar, const objects_snapshot& state) {
+        jc_assert(state.kind != snapshot_kind::full);
+
+        std::vector<const objects_snapshot::entry *> modified, added;
+        if (state.kind == snapshot_kind::delta) {
+            for (auto& e : state.objects) {
+                if (e.contents) {
+                    (e.base_index ? modified : added).push_back(&e);
+                }
+            }
+        }
+
+        ar.write_varint(state.base_object_count);
+        ar.write_varint(state.deleted.size());
+        for (auto index : state.deleted) {
+            ar.write_varint(index);
+        }
+
+        ar.write_varint(modified.size());
+        for (auto e : modified) {
+            ar.write_varint(e->base_index);
+            ar.write_varint(e->contents->type()); // checked against the type of the base object
+            write_header(ar, *e);
+        }
+        ar.write_varint(added.size());
+        for (auto e : added) {
+            ar.write_varint(e->contents->type());
+            write_header(ar, *e);
+        }
+        auto writeContents = [&](const objects_snapshot::entry& e) {
+            read_contents(state, e, [&ar](const object_base& contents) {
+                ar.write_contents(contents);
+            });
+        };
+        for (auto e : modified) {
+            writeContents(*e);
+        }
+        for (auto e : added) {
+            writeContents(*e);
+        }
+
+        write_id_generator_and_aqueue(ar, state);
+    }
+
+    void object_context::u_adopt_base(const objects_snapshot& state) {
+        jc_assert(state.kind == snapshot_kind::base);
+        for (auto& e : state.objects) {
+            e.object->_base_index = e.base_index;
+            e.object->_base_sequence = e.sequence;
+        }
+        _base_object_count = state.base_object_count;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    object_context::loaded_base::~loaded_base() {
+        for (auto obj : objects) {
+            if (obj) {
+                obj->u_nullify_lazy_contents();
+                obj->u_nullifyObjects();
+            }
+        }
+        for (auto obj : objects) {
+            delete obj;
+        }
+    }
+
+    void object_context::read_header(compact_reader& ar, object_base& obj) {
+        obj._id = (Handle)ar.read_uint32();
+        obj._tes_refCount = (int32_t)ar.read_signed();
+        obj._aqueue_push_time = ar.read_uint32();
+        const std::string& tag = ar.read_string();
+        obj._tag = util::istring(tag.data(), tag.size());
+    }
+
+    // the objects of the full save into the ar.objects(), unregistered. The @owner destroys them if the reading fails.
+    // The copies of the deduplicated subtrees get expanded in the order they were written: the subtree a copy copies
+    // may contain the copies listed earlier
+    void object_context::read_objects(compact_reader& ar, loaded_base& owner) {
+        ar.objects().clear(); // the object indices are local to the domain
+        std::vector<uint32_t> sources;
+        const size_t count = ar.read_count();
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t type = ar.read_uint32();
+            if (!(type & copy_type_flag) && !sources.empty()) {
+                compact_reader::fail("the copies have to be the last objects");
+            }
+            object_base *obj = ar.make_object((CollectionType)(type & ~copy_type_flag));
+            owner.objects.push_back(obj);
+            read_header(ar, *obj);
+            ar.objects().push_back(obj);
+            if (type & copy_type_flag) {
+                sources.push_back(ar.read_uint32());
+            }
+        }
+
+        const size_t copyStart = count - sources.size();
+        if (ar.is_lazy()) {
+            ar.read_contents_lazily(copyStart);
+        }
+        else {
+            for (size_t i = 0; i < copyStart; ++i) {
+                ar.read_contents(*ar.objects()[i]);
+            }
+        }
+
+        for (size_t i = 0; i < sources.size(); ++i) {
+            if (sources[i] == 0 || sources[i] > copyStart) {
+                compact_reader::fail("invalid copied object index");
+            }
+            ar.clone_contents(*ar.objects()[sources[i] - 1], *ar.objects()[copyStart + i], owner.objects);
+        }
+    }
+
+    void object_context::u_register_loaded(loaded_base& loaded) {
+        for (auto obj : loaded.objects) {
+            if (obj) {
+                registry->_all_objects.insert(obj);
+                if (obj->is_public()) {
+                    registry->_map.emplace(obj->_uid(), obj);
+                }
+            }
+        }
+        loaded.objects.clear();
+    }
+
+    void object_context::u_read_id_generator_and_aqueue(compact_reader& ar) {
+        auto& idGen = registry->_idGen;
+        const size_t rangeCount = ar.read_count();
+        idGen._empty_ranges.clear();
+        for (size_t i = 0; i < rangeCount; ++i) {
+            const HandleT first = ar.read_uint32();
+            idGen._empty_ranges.push_back(id_generator_type::range::with_first_last(first, ar.read_uint32()));
+        }
+        const size_t currentRange = ar.read_count();
+        if (currentRange >= idGen._empty_ranges.size()) {
+            compact_reader::fail("invalid id generator state");
+        }
+        idGen._current_range = idGen._empty_ranges.begin() + currentRange;
+
+        aqueue->_tickCounter = ar.read_uint32();
+        const size_t queueCount = ar.read_count();
+        for (size_t i = 0; i < queueCount; ++i) {
+            if (object_base *obj = ar.read_object()) {
+                aqueue->_queue.push_back(obj);
+            }
+        }
+    }
+
+    void object_context::load_compact(compact_reader& ar) {
+        loaded_base loaded;
+        read_objects(ar, loaded);
+        u_register_loaded(loaded);
+        u_read_id_generator_and_aqueue(ar);
+    }
+
+    // the id generator and the aqueue of the base get replaced by the ones of the delta
+    void object_context::read_base(compact_reader& ar, loaded_base& base) {
+        read_objects(ar, base);
+
+        const size_t rangeCount = ar.read_count();
+        for (size_t i = 0; i < rangeCount; ++i) {
+            ar.read_uint32();
+            ar.read_uint32();
+        }
+        ar.read_count(); // the current range
+        ar.read_uint32(); // the tick counter
+        const size_t queueCount = ar.read_count();
+        for (size_t i = 0; i < queueCount; ++i) {
+            ar.read_object();
+        }
+    }
+
+    void object_context::load_compact_delta(compact_reader& ar, loaded_base& base) {
+        auto& table = ar.objects();
+
+        const uint32_t baseCount = ar.read_uint32();
+        if (baseCount != base.objects.size()) {
+            compact_reader::fail("the delta doesn't match the base image");
+        }
+        table = base.objects;
+
+        auto readBaseIndex = [&]() -> uint32_t {
+            const uint32_t index = ar.read_uint32();
+            if (index == 0 || index > baseCount || !table[index - 1]) {
+                compact_reader::fail("invalid base object index");
+            }
+            return index - 1;
+        };
+
+        // the deleted objects are unreachable from the rest of the base. The @base owns them until they're deleted
+        std::vector<uint32_t> deleted;
+        const size_t deletedCount = ar.read_count();
+        for (size_t i = 0; i < deletedCount; ++i) {
+            const uint32_t index = readBaseIndex();
+            if (table[index]) {
+                deleted.push_back(index);
+                table[index] = nullptr;
+            }
+        }
+
+        std::vector<object_base *> modified;
+        const size_t modifiedCount = ar.read_count();
+        for (size_t i = 0; i < modifiedCount; ++i) {
+            const uint32_t index = readBaseIndex();
+            const auto type = (CollectionType)ar.read_uint32();
+            object_base *obj = table[index];
+            if (obj->type() != type) {
+                compact_reader::fail("the delta doesn't match the base image");
+            }
+            read_header(ar, *obj);
+            obj->mark_modified(); // the next delta has to include it as well
+            modified.push_back(obj);
+        }
+
+        const size_t addedCount = ar.read_count();
+        for (size_t i = 0; i < addedCount; ++i) {
+            object_base *obj = ar.make_object((CollectionType)ar.read_uint32());
+            base.objects.push_back(obj);
+            read_header(ar, *obj);
+            table.push_back(obj);
+        }
+
+        for (auto obj : modified) {
+            obj->u_clear();
+            ar.read_contents(*obj);
+        }
+        for (size_t i = baseCount; i < table.size(); ++i) {
+            ar.read_contents(*table[i]);
+        }
+
+        // nothing is registered yet, so the releases don't reach the aqueue
+        for (auto index : deleted) {
+            base.objects[index]->u_clear();
+        }
+        for (auto index : deleted) {
+            delete base.objects[index];
+            base.objects[index] = nullptr;
+        }
+
+        for (uint32_t i = 0; i < baseCount; ++i) {
+            if (table[i]) {
+                table[i]->_base_index = i + 1;
+            }
+        }
+        _base_object_count = baseCount;
+
+        u_register_loaded(base);
+        u_read_id_generator_and_aqueue(ar);
+    }
+
     void object_context::u_print_stats() const {
         JC_log("%lu objects total", registry->u_all_objects().size());
         JC_log("%lu public objects", registry->u_public_object_count());
         JC_log("%lu objects in aqueue", aqueue->u_count());
+
+        const auto& objects = registry->u_all_objects();
+        const size_t encoded = std::count_if(objects.begin(), objects.end(), [](object_base *obj) { return !obj->is_materialized(); });
+        if (encoded > 0) {
+            JC_log("%lu objects not decoded yet", encoded);
+        }
+
+        const auto& dedup = _last_dedup;
+        if (dedup.hashed > 0) {
+            const uint32_t skipped = dedup.elided + dedup.copies;
+            JC_log("the last deduplicated save: %u subtrees written as copies, the contents of %u of %u objects (%.1f%%) skipped, hashing took %.1f ms",
+                dedup.copies, skipped, dedup.hashed, 100.0 * skipped / dedup.hashed, dedup.hashing_ms);
+        }
+    }
+
+    void object_context::record_save_stats(const objects_snapshot& state) {
+        if (state.stats.hashed > 0) {
+            _last_dedup = state.stats;
+        }
+    }
+
+    std::vector<std::pair<object_stack_ref, uint32_t>> object_context::most_contended_objects(size_t count) const {
+        auto contended = filter_objects([](object_base& obj) { return obj.mutex().contentions() > 0; });
+
+        std::vector<std::pair<object_stack_ref, uint32_t>> result;
+        result.reserve(contended.size());
+        for (auto& obj : contended) {
+            result.emplace_back(obj, obj->mutex().contentions());
+        }
+
+        auto middle = result.begin() + (std::min)(count, result.size());
+        std::partial_sort(result.begin(), middle, result.end(), [](const auto& l, const auto& r) {
+            return l.second > r.second;
+        });
+        result.erase(middle, result.end());
+        return result;
+    }
+
+    void object_context::print_lock_contention(size_t count) const {
+        if (!util::adaptive_lock::is_contention_tracking_enabled()) {
+            return;
+        }
+
+        auto contended = most_contended_objects(count);
+        JC_log("%lu most contended objects:", contended.size());
+        for (auto& pair : contended) {
+            JC_log("  object %u (type %u) - %u contended locks",
+                (uint32_t)pair.first->_uid(), (uint32_t)pair.first->type(), pair.second);
+        }
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -122,12 +823,24 @@ namespace collections
             obj->set_context(*this);
         }
         for (auto& obj : registry->u_all_objects()) {
-            obj->u_onLoaded();
+            if (obj->is_materialized()) { // the lazily loaded ones call it once decoded
+                obj->u_onLoaded();
+            }
+        }
+        for (auto& obj : registry->u_all_objects()) {
+            obj->_base_sequence = obj->mutex().read_sequence_begin();
         }
     }
 
-    void object_context::u_postLoadMaintenance(const serialization_version saveVersion)
+    void object_context::u_postLoadMaintenance(const serialization_version saveVersion, maintenance_stats *stats)
     {
+        if (stats) {
+            auto res = garbage_collector::u_collect(*registry, *aqueue);
+            stats->garbage = res.garbage_total;
+            stats->part_of_graphs = res.part_of_graphs;
+            return;
+        }
+
         util::do_with_timing("Garbage collection", [&]() {
             auto res = garbage_collector::u_collect(*registry, *aqueue);
             JC_log("%u garbage objects collected. %u objects are parts of cyclic graphs", res.garbage_total, res.part_of_graphs);
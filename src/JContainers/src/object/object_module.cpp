@@ -3,6 +3,9 @@
 #include <mutex>
 #include <chrono>
 #include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <unordered_map>
 #include <vector>
 #include <atomic>
 #include <memory>
@@ -44,6 +47,7 @@
 #include "object_registry.h"
 #include "autorelease_queue.h"
 #include "garbage_collector.h"
+#include "collections/compact_archive.h"
 
 #include "object_base.hpp"
 #include "object_context.hpp"
@@ -63,13 +63,21 @@ namespace collections
             _all_objects.erase(itr);
         }
 
+        // the contents of a lazily loaded object get decoded once the lock is released
         object_base *getObject(Handle hdl) const {
             if (hdl == Handle::Null) {
                 return nullptr;
             }
             
-            read_lock g(_mutex);
-            return u_getObject(hdl);
+            object_base *obj = nullptr;
+            {
+                read_lock g(_mutex);
+                obj = u_getObject(hdl);
+            }
+            if (obj) {
+                obj->materialize();
+            }
+            return obj;
         }
 
         std::vector<object_stack_ref> filter_objects(std::function<bool(object_base& obj)>& predicate) const {
@@ -91,8 +99,15 @@ namespace collections
             if (hdl == Handle::Null) {
                 return nullptr;
             }
-            read_lock g(_mutex);
-            return u_getObject(hdl);
+            object_stack_ref ref;
+            {
+                read_lock g(_mutex);
+                ref = u_getObject(hdl);
+            }
+            if (ref) {
+                ref->materialize();
+            }
+            return ref;
         }
 
         object_base *u_getObject(Handle hdl) const {
@@ -13,6 +13,9 @@
 #include "gtest.h"
 
 #include <algorithm>
+#include <numeric>
+#include <vector>
+#include <map>
 
 extern SKSESerializationInterface* g_serialization;
 
@@ -212,6 +215,24 @@ real_api g_real_api;
 silent_api g_silent_api;
 skse_api* g_current_api = &g_fake_api;
 
+/// Stub remapping the mod indices, as the load order change does. Counts the calls
+struct remapping_api : public fake_api
+{
+    std::map<FormIdUnredlying, FormIdUnredlying> plugins; ///< old plugin part -> new one, none - the plugin is gone
+    int resolve_calls = 0;
+
+    FormId resolve_handle (FormId handle) override
+    {
+        ++resolve_calls;
+        if (!forms::is_static (handle))
+            return handle;
+        auto const raw = static_cast<FormIdUnredlying> (handle);
+        auto const local = forms::local_id (handle);
+        auto const it = plugins.find (raw & ~local);
+        return it != plugins.end () ? FormId (it->second | local) : FormId::Zero;
+    }
+};
+
 } // anonymous namespace
 
 //--------------------------------------------------------------------------------------------------
@@ -269,6 +290,41 @@ void console_print (const char* fmt, ...)
     va_end (args);
 }
 
+/// The plugin part of the form id: the mod index, plus the light mod index for the *.esl ones
+static FormIdUnredlying plugin_of (FormId handle)
+{
+    return static_cast<FormIdUnredlying> (handle) & ~forms::local_id (handle);
+}
+
+void resolve_handles (FormId* handles, std::size_t count)
+{
+    std::vector<std::size_t> order (count);
+    std::iota (order.begin (), order.end (), std::size_t (0));
+    std::stable_sort (order.begin (), order.end (), [handles] (std::size_t a, std::size_t b) {
+        return plugin_of (handles[a]) < plugin_of (handles[b]);
+    });
+
+    // The remapping changes the plugin part only: one handle of the plugin gets resolved,
+    // the plugin part of the result applies to the rest of them
+    for (auto first = order.begin (); first != order.end ();)
+    {
+        auto const plugin = plugin_of (handles[*first]);
+        auto const last = std::find_if (first, order.end (), [handles, plugin] (std::size_t i) {
+            return plugin_of (handles[i]) != plugin;
+        });
+
+        auto const resolved = g_current_api->resolve_handle (handles[*first]);
+        auto const resolved_plugin = plugin_of (resolved);
+        for (auto it = first; it != last; ++it)
+        {
+            handles[*it] = resolved == FormId::Zero ? FormId::Zero
+                : FormId (resolved_plugin | forms::local_id (handles[*it]));
+        }
+
+        first = last;
+    }
+}
+
 bool try_retain_handle (FormId handle)
 {
     return g_current_api->try_retain_handle (handle);
@@ -281,5 +337,33 @@ void release_handle (FormId handle)
 
 //--------------------------------------------------------------------------------------------------
 
-} // namespace skse
+TEST (skseAPI, resolve_handles_once_per_plugin)
+{
+    remapping_api stub;
+    stub.plugins = {
+        { 0x00000000u, 0x00000000u },   // Skyrim.esm stays
+        { 0x05000000u, 0x07000000u },   // moved down the load order
+        { 0xfe003000u, 0xfe001000u },   // a light one, moved as well
+    };                                  // 0x06 is gone
+
+    std::vector<FormId> handles = {
+        FormId (0x05000d62), FormId (0x00000014), FormId (0xfe003801), FormId (0x06000800),
+        FormId (0x05000001), FormId (0xff000c00), FormId (0x00000007), FormId (0xfe003002),
+    };
+
+    auto* const previous = g_current_api;
+    g_current_api = &stub;
+    resolve_handles (handles.data (), handles.size ());
+    g_current_api = previous;
+
+    std::vector<FormId> const expected = {
+        FormId (0x07000d62), FormId (0x00000014), FormId (0xfe001801), FormId::Zero,
+        FormId (0x07000001), FormId (0xff000c00), FormId (0x00000007), FormId (0xfe001002),
+    };
+    EXPECT_TRUE (handles == expected);
+    EXPECT_EQ (stub.resolve_calls, 5); // 0x00, 0x05, 0x06, 0xfe003, 0xff
+}
 
+//--------------------------------------------------------------------------------------------------
+
+} // namespace skse
@@ -45,6 +45,14 @@ std::optional<std::string_view> loaded_light_mod_name (std::uint16_t idx);
 
 forms::FormId resolve_handle (forms::FormId handle);
 
+/**
+ * Batched #resolve_handle: resolves the @handles in place, FormId#Zero on error.
+ * The handles are grouped by their plugin, the mod index remapping is looked up once per plugin.
+ * Reentrant - separate batches may be resolved on separate threads.
+ */
+
+void resolve_handles (forms::FormId* handles, std::size_t count);
+
 /**
  * Valid handles are forwarded to `LookupByFormID`
  * @returns the looked up handle, nullptr if silent API, random blob if test API
@@ -1,4 +1,5 @@
 #include <boost/iostreams/stream.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <ShlObj.h>
 
 #include "skse64/PluginAPI.h"
@@ -64,7 +65,7 @@ namespace {
         util::do_with_timing("Save", [intfc]() {
             if (intfc->OpenRecord((UInt32)consts::storage_chunk, (UInt32)serialization_version::current)) {
                 io::stream<skse_data_sink> stream(skse_data_sink{ intfc });
-                domain_master::master::instance().write_to_stream(stream);
+                domain_master::master::instance().write_to_stream_in_background(stream);
                 //_DMESSAGE("%lu bytes saved", stream.tellp());
             }
             else {
@@ -242,11 +243,36 @@ namespace {
 
             g_papyrus->Register(registerAllFunctions);
 
+            {
+                char path[MAX_PATH];
+                if (SUCCEEDED(SHGetFolderPath(NULL, CSIDL_MYDOCUMENTS, NULL, SHGFP_TYPE_CURRENT, path))) {
+                    const std::string userFiles = std::string(path) + "/" JC_USER_FILES;
+                    auto& master = domain_master::master::instance();
+
+                    // the delta saves load either way, the new saves are written as the deltas once the user has created the folder
+                    master.base_directory = userFiles + "SaveBases/";
+                    master.incremental_saves = boost::filesystem::is_directory(master.base_directory);
+                    JC_log("incremental saves: %s", master.incremental_saves ? "on" : "off");
+
+                    // the compressed saves load either way, but not by the older plugin versions: the user opts in
+                    // by creating the CompressSaves file or folder
+                    master.compress_saves = boost::filesystem::exists(userFiles + "CompressSaves");
+                    JC_log("compressed saves: %s", master.compress_saves ? "on" : "off");
+                }
+            }
+
             if (g_messaging) {
                 g_messaging->RegisterListener(g_pluginHandle, "SKSE", [](SKSEMessagingInterface::Message* msg) {
                     if (msg && msg->type == SKSEMessagingInterface::kMessage_PostPostLoad) {
                         g_messaging->Dispatch(g_pluginHandle, jc::message_root_interface, (void *)&jc::root, sizeof(void*), nullptr);
                     }
+                    else if (msg && msg->type == SKSEMessagingInterface::kMessage_SaveGame && msg->data) {
+                        // precedes the save callback. The base images are named after the saves
+                        domain_master::master::instance().save_name = static_cast<const char *>(msg->data);
+                    }
+                    else if (msg && msg->type == SKSEMessagingInterface::kMessage_DeleteGame && msg->data) {
+                        domain_master::master::instance().on_save_deleted(static_cast<const char *>(msg->data));
+                    }
                 });
             }
 
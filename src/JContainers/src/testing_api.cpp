@@ -1,6 +1,7 @@
 #include "jcontainers_constants.h"
 #include "reflection/reflection.h"
 #include "gtest.h"
+#include "domains/save_inspector.h"
 
 // C API for python scripts as a part of bundling and testing functionality
 extern "C" {
@@ -29,4 +30,9 @@ extern "C" {
         ::testing::InitGoogleTest(&argc, &char_ptr_args.front());
         return static_cast<bool> (RUN_ALL_TESTS ());
     }
+
+    // the entry of the save_inspector tool, @argv are the arguments following the path of the dll
+    __declspec(dllexport) int JC_inspectSave(int argc, const char** argv) {
+        return domain_master::run_save_inspector(std::vector<std::string>(argv, argv + argc));
+    }
 }
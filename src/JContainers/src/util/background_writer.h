@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <boost/iostreams/concepts.hpp>
+#include <boost/iostreams/stream.hpp>
+
+namespace util {
+
+    // A bounded queue of the data chunks passed from the producing thread to the consuming one
+    class chunk_pipe {
+    public:
+        enum : size_t {
+            max_chunks = 16, // the producer waits once it gets this far ahead
+        };
+
+        void push(std::string&& chunk) {
+            std::unique_lock<std::mutex> g(_mutex);
+            _not_full.wait(g, [this]() { return _chunks.size() < max_chunks; });
+            _chunks.push_back(std::move(chunk));
+            _not_empty.notify_one();
+        }
+
+        // false once the pipe is closed and empty
+        bool pop(std::string& chunk) {
+            std::unique_lock<std::mutex> g(_mutex);
+            _not_empty.wait(g, [this]() { return !_chunks.empty() || _closed; });
+            if (_chunks.empty()) {
+                return false;
+            }
+            chunk = std::move(_chunks.front());
+            _chunks.pop_front();
+            _not_full.notify_one();
+            return true;
+        }
+
+        void close() {
+            std::lock_guard<std::mutex> g(_mutex);
+            _closed = true;
+            _not_empty.notify_one();
+        }
+
+    private:
+        std::mutex _mutex;
+        std::condition_variable _not_empty;
+        std::condition_variable _not_full;
+        std::deque<std::string> _chunks;
+        bool _closed = false;
+    };
+
+    class chunk_pipe_sink : public boost::iostreams::sink {
+    public:
+        explicit chunk_pipe_sink(chunk_pipe& pipe) : _pipe(&pipe) {}
+
+        std::streamsize write(const char *s, std::streamsize n) {
+            _pipe->push(std::string(s, size_t(n)));
+            return n;
+        }
+
+    private:
+        chunk_pipe *_pipe;
+    };
+
+    // Calls func(std::ostream&) on a separate thread. The data it writes is handed to the @stream
+    // on the calling thread - the @stream doesn't have to be thread-safe. Rethrows the exception func throws
+    template<class F>
+    void write_in_background(std::ostream& stream, F&& func) {
+        chunk_pipe pipe;
+        std::exception_ptr failure;
+
+        std::thread writer([&]() {
+            try {
+                boost::iostreams::stream<chunk_pipe_sink> out(chunk_pipe_sink{ pipe }, 1 << 16);
+                func(static_cast<std::ostream&>(out));
+                out.flush();
+            }
+            catch (...) {
+                failure = std::current_exception();
+            }
+            pipe.close();
+        });
+
+        std::string chunk;
+        while (pipe.pop(chunk)) {
+            stream.write(chunk.data(), std::streamsize(chunk.size()));
+        }
+        writer.join();
+
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+}
@@ -0,0 +1,362 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <assert.h>
+
+namespace util {
+
+    // std::vector replacement (the part of its interface JContainers uses) with the spare capacity at both ends.
+    // The elements are contiguous, references and iterators get invalidated like in std::vector, but
+    // - insertion at the front and removal from the front are amortized O(1), just like at the back
+    // - insertion and removal in the middle move the shorter side, i.e. min(index, size - index) elements
+    // The spare capacity is split between the ends in proportion to the insertions observed at each end,
+    // so queue-like scripts (insert at 0, pop at the end) get the room at the front.
+    // The insertion and removal in the middle remain O(n) - a gap buffer or a rope would make them O(sqrt(n)),
+    // but the storage has to stay contiguous: the item sort works on pointer ranges, and the array callers use
+    // iterator arithmetic and item references all over the tree.
+    // The T must be default constructible and nothrow movable
+    template<class T>
+    class devector
+    {
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = T*;
+        using const_iterator = const T*;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    private:
+
+        static_assert(std::is_nothrow_move_constructible<T>::value, "the elements get moved on reallocation");
+
+        T *_storage = nullptr;
+        size_type _capacity = 0;
+        T *_begin = nullptr;
+        T *_end = nullptr;
+
+        // observed insertions, steer the spare capacity
+        size_type _front_inserts = 0;
+        size_type _back_inserts = 0;
+
+        enum { min_capacity = 8 };
+
+        static T* allocate(size_type count) {
+            return count ? static_cast<T*>(::operator new(count * sizeof(T))) : nullptr;
+        }
+
+        static void destroy(T *first, T *last) {
+            for (; first != last; ++first) {
+                first->~T();
+            }
+        }
+
+        size_type front_room() const { return _begin - _storage; }
+        size_type back_room() const { return (_storage + _capacity) - _end; }
+
+        // share of the @spare capacity to put at the front
+        size_type front_share(size_type spare) const {
+            return size_type(spare * (double(_front_inserts + 1) / double(_front_inserts + _back_inserts + 2)));
+        }
+
+        // moves the elements to the new storage (or to another position of the same storage)
+        void relocate(size_type capacity, size_type front) {
+            const size_type count = size();
+            assert(front + count <= capacity);
+
+            if (capacity == _capacity) {
+                T *first = _storage + front;
+                if (first < _begin) {
+                    for (T *from = _begin, *to = first; from != _end; ++from, ++to) {
+                        new (to) T(std::move(*from));
+                        from->~T();
+                    }
+                }
+                else if (first > _begin) {
+                    for (T *from = _end, *to = first + count; from != _begin; ) {
+                        new (--to) T(std::move(*--from));
+                        from->~T();
+                    }
+                }
+                _begin = first;
+                _end = first + count;
+                return;
+            }
+
+            T *storage = allocate(capacity);
+            T *to = storage + front;
+            for (T *from = _begin; from != _end; ++from, ++to) {
+                new (to) T(std::move(*from));
+            }
+            destroy(_begin, _end);
+            ::operator delete(_storage);
+
+            _storage = storage;
+            _capacity = capacity;
+            _begin = storage + front;
+            _end = _begin + count;
+        }
+
+        // guarantees @count free slots at the front (or at the back)
+        void make_room(size_type count, bool at_front) {
+            if ((at_front ? front_room() : back_room()) >= count) {
+                return;
+            }
+
+            const size_type needed = size() + count;
+            // recentering in place pays off only if at least a half of the storage stays free
+            const size_type capacity = (_capacity >= 2 * needed) ? _capacity : (std::max)(size_type(min_capacity), 2 * needed);
+            const size_type spare = capacity - needed;
+            const size_type front = at_front ? count + front_share(spare) : front_share(spare);
+            relocate(capacity, front);
+        }
+
+        // opens a gap of @count moved-from (default constructed) elements at the @index, shifting the shorter side
+        T* open_gap(size_type index, size_type count) {
+            assert(index <= size());
+            const bool at_front = index < size() / 2;
+            (at_front ? _front_inserts : _back_inserts) += count;
+            make_room(count, at_front);
+
+            if (at_front) {
+                T *old_begin = _begin;
+                for (size_type i = 0; i < count; ++i) {
+                    new (--_begin) T();
+                }
+                std::move(old_begin, old_begin + index, _begin);
+            }
+            else {
+                T *old_end = _end;
+                for (size_type i = 0; i < count; ++i) {
+                    new (_end++) T();
+                }
+                std::move_backward(_begin + index, old_end, _end);
+            }
+            return _begin + index;
+        }
+
+        bool owns(const T *p) const { return p >= _begin && p < _end; }
+
+    public:
+
+        devector() = default;
+
+        explicit devector(size_type count) {
+            resize(count);
+        }
+
+        template<class It, class = typename std::iterator_traits<It>::iterator_category>
+        devector(It first, It last) {
+            insert(end(), first, last);
+        }
+
+        devector(const devector& other) {
+            relocate(other.size(), 0);
+            for (const T& value : other) {
+                new (_end++) T(value);
+            }
+        }
+
+        devector(devector&& other) noexcept {
+            swap(other);
+        }
+
+        ~devector() {
+            destroy(_begin, _end);
+            ::operator delete(_storage);
+        }
+
+        devector& operator = (const devector& other) {
+            if (this != &other) {
+                devector(other).swap(*this);
+            }
+            return *this;
+        }
+
+        devector& operator = (devector&& other) noexcept {
+            devector(std::move(other)).swap(*this);
+            return *this;
+        }
+
+        void swap(devector& other) noexcept {
+            std::swap(_storage, other._storage);
+            std::swap(_capacity, other._capacity);
+            std::swap(_begin, other._begin);
+            std::swap(_end, other._end);
+            std::swap(_front_inserts, other._front_inserts);
+            std::swap(_back_inserts, other._back_inserts);
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        size_type size() const { return _end - _begin; }
+        bool empty() const { return _begin == _end; }
+        size_type capacity() const { return _capacity; }
+
+        T* data() { return _begin; }
+        const T* data() const { return _begin; }
+
+        T& operator [] (size_type index) { assert(index < size()); return _begin[index]; }
+        const T& operator [] (size_type index) const { assert(index < size()); return _begin[index]; }
+
+        T& front() { assert(!empty()); return *_begin; }
+        const T& front() const { assert(!empty()); return *_begin; }
+        T& back() { assert(!empty()); return _end[-1]; }
+        const T& back() const { assert(!empty()); return _end[-1]; }
+
+        iterator begin() { return _begin; }
+        iterator end() { return _end; }
+        const_iterator begin() const { return _begin; }
+        const_iterator end() const { return _end; }
+        const_iterator cbegin() const { return _begin; }
+        const_iterator cend() const { return _end; }
+
+        reverse_iterator rbegin() { return reverse_iterator(_end); }
+        reverse_iterator rend() { return reverse_iterator(_begin); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(_end); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(_begin); }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        // like std::vector::reserve, guarantees the room for the count - size() elements at the back
+        void reserve(size_type count) {
+            if (count > size() + back_room()) {
+                relocate(count + front_room(), front_room());
+            }
+        }
+
+        void clear() {
+            destroy(_begin, _end);
+            _begin = _end = _storage + front_share(_capacity);
+        }
+
+        void resize(size_type count) {
+            if (count < size()) {
+                erase(_begin + count, _end);
+            }
+            else if (count > size()) {
+                make_room(count - size(), false);
+                while (size() < count) {
+                    new (_end++) T();
+                }
+            }
+        }
+
+        template<class ...Args>
+        T& emplace_back(Args&&... args) {
+            ++_back_inserts;
+            if (back_room() == 0) {
+                T value(std::forward<Args>(args)...); // may refer to an element
+                make_room(1, false);
+                new (_end) T(std::move(value));
+            }
+            else {
+                new (_end) T(std::forward<Args>(args)...);
+            }
+            return *_end++;
+        }
+
+        void push_back(const T& value) { emplace_back(value); }
+        void push_back(T&& value) { emplace_back(std::move(value)); }
+
+        template<class ...Args>
+        T& emplace_front(Args&&... args) {
+            ++_front_inserts;
+            if (front_room() == 0) {
+                T value(std::forward<Args>(args)...);
+                make_room(1, true);
+                new (_begin - 1) T(std::move(value));
+            }
+            else {
+                new (_begin - 1) T(std::forward<Args>(args)...);
+            }
+            return *--_begin;
+        }
+
+        void pop_back() { assert(!empty()); (--_end)->~T(); }
+        void pop_front() { assert(!empty()); (_begin++)->~T(); }
+
+        template<class ...Args>
+        iterator emplace(const_iterator position, Args&&... args) {
+            const size_type index = position - _begin;
+            if (index == size()) {
+                emplace_back(std::forward<Args>(args)...);
+            }
+            else if (index == 0) {
+                emplace_front(std::forward<Args>(args)...);
+            }
+            else {
+                T value(std::forward<Args>(args)...); // may refer to an element
+                *open_gap(index, 1) = std::move(value);
+            }
+            return _begin + index;
+        }
+
+        iterator insert(const_iterator position, const T& value) { return emplace(position, value); }
+        iterator insert(const_iterator position, T&& value) { return emplace(position, std::move(value)); }
+
+        template<class It, class = typename std::iterator_traits<It>::iterator_category>
+        iterator insert(const_iterator position, It first, It last) {
+            const size_type index = position - _begin;
+            const size_type count = std::distance(first, last);
+            if (count == 0) {
+                return _begin + index;
+            }
+
+            if (std::is_pointer<It>::value && owns(&*first)) { // the gap would move the source
+                std::vector<T> copy(first, last);
+                std::move(copy.begin(), copy.end(), open_gap(index, count));
+            }
+            else {
+                std::copy(first, last, open_gap(index, count));
+            }
+            return _begin + index;
+        }
+
+        iterator erase(const_iterator position) {
+            return erase(position, position + 1);
+        }
+
+        // closes the gap by shifting the shorter side
+        iterator erase(const_iterator first, const_iterator last) {
+            const size_type index = first - _begin;
+            const size_type count = last - first;
+            if (count == 0) {
+                return _begin + index;
+            }
+
+            if (index < size_type(_end - last)) {
+                T *new_begin = std::move_backward(_begin, _begin + index, _begin + index + count);
+                destroy(_begin, new_begin);
+                _begin = new_begin;
+            }
+            else {
+                T *new_end = std::move(_begin + index + count, _end, _begin + index);
+                destroy(new_end, _end);
+                _end = new_end;
+            }
+            return _begin + index;
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        friend bool operator == (const devector& left, const devector& right) {
+            return std::equal(left.begin(), left.end(), right.begin(), right.end());
+        }
+
+        friend bool operator != (const devector& left, const devector& right) {
+            return !(left == right);
+        }
+    };
+}
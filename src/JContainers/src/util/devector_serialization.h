@@ -0,0 +1,51 @@
+#pragma once
+
+#include <boost/archive/basic_archive.hpp>
+#include <boost/serialization/collection_size_type.hpp>
+#include <boost/serialization/item_version_type.hpp>
+#include <boost/serialization/nvp.hpp>
+#include <boost/serialization/split_free.hpp>
+
+#include "util/devector.h"
+
+/**
+ * Writes exactly the same archive layout as boost/serialization/vector.hpp does for std::vector,
+ * so the saves made before the array storage was switched to util::devector load just fine.
+ */
+namespace boost { namespace serialization {
+
+    template<class Archive, class T>
+    inline void save(Archive & ar, const util::devector<T>& container, const unsigned int) {
+        collection_size_type count(container.size());
+        const item_version_type item_version(version<T>::value);
+        ar << BOOST_SERIALIZATION_NVP(count);
+        ar << BOOST_SERIALIZATION_NVP(item_version);
+
+        for (const T& value : container) {
+            ar << make_nvp("item", value);
+        }
+    }
+
+    template<class Archive, class T>
+    inline void load(Archive & ar, util::devector<T>& container, const unsigned int) {
+        collection_size_type count;
+        item_version_type item_version(0);
+        ar >> BOOST_SERIALIZATION_NVP(count);
+        if (boost::archive::library_version_type(3) < ar.get_library_version()) {
+            ar >> BOOST_SERIALIZATION_NVP(item_version);
+        }
+
+        // the elements are loaded in place, the tracked addresses stay valid
+        container.clear();
+        container.resize(count);
+        for (T& value : container) {
+            ar >> make_nvp("item", value);
+        }
+    }
+
+    template<class Archive, class T>
+    inline void serialize(Archive & ar, util::devector<T>& container, const unsigned int version) {
+        split_free(ar, container, version);
+    }
+
+}}
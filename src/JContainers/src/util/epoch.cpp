@@ -0,0 +1,183 @@
+#include "util/epoch.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "util/spinlock.h"
+#include "gtest.h"
+
+namespace util {
+namespace epoch {
+
+    namespace {
+
+        enum : size_t {
+            max_slots = 64, // the threads beyond that read under the locks
+            reclaim_count = 64, // the number of the retired blocks ...
+            reclaim_bytes = 1 << 20, // ... or their size that triggers the reclamation
+        };
+
+        std::atomic<uint64_t> g_epoch = 1;
+        slot g_slots[max_slots];
+
+        struct retired_block {
+            void *memory;
+            void (*deleter)(void *);
+            size_t bytes;
+            uint64_t epoch; // the epoch it has been retired in
+        };
+
+        spinlock g_retired_lock;
+        std::vector<retired_block> g_retired;
+        size_t g_retired_bytes = 0;
+
+        // a sentinel: the thread has tried to claim a slot and failed
+        slot * const g_no_slot = reinterpret_cast<slot *>(&g_epoch);
+        thread_local slot *t_slot = nullptr;
+
+        void WINAPI release_slot(void *data) {
+            if (data) {
+                static_cast<slot *>(data)->owned.store(false, std::memory_order_release);
+            }
+        }
+
+        // the fiber local storage callback releases the slot once the thread exits
+        DWORD slot_release_index() {
+            static const DWORD index = FlsAlloc(&release_slot);
+            return index;
+        }
+
+        slot* claim_slot() {
+            const DWORD index = slot_release_index();
+            if (index == FLS_OUT_OF_INDEXES) {
+                return nullptr;
+            }
+
+            for (slot& s : g_slots) {
+                bool owned = false;
+                if (!s.owned.load(std::memory_order_relaxed) &&
+                    s.owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+                {
+                    if (!FlsSetValue(index, &s)) {
+                        s.owned.store(false, std::memory_order_release);
+                        return nullptr;
+                    }
+                    return &s;
+                }
+            }
+            return nullptr;
+        }
+
+        size_t reclaim_locked() {
+            // The readers that enter from now on announce the new epoch, and they can't see the retired memory.
+            // The older ones have announced theirs by plain stores, possibly not visible yet: flushing the write buffers
+            // of all processors either makes the announcement visible, or its reader hasn't loaded anything yet
+            const uint64_t epoch = g_epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+            FlushProcessWriteBuffers();
+
+            uint64_t oldest = epoch;
+            for (slot& s : g_slots) {
+                const uint64_t announced = s.epoch.load(std::memory_order_acquire);
+                if (announced != 0) {
+                    oldest = (std::min)(oldest, announced);
+                }
+            }
+
+            // a block retired in the epoch E can still be seen by the readers that entered in E or earlier
+            auto last = std::partition(g_retired.begin(), g_retired.end(), [oldest](const retired_block& b) {
+                return b.epoch >= oldest;
+            });
+            for (auto itr = last; itr != g_retired.end(); ++itr) {
+                g_retired_bytes -= itr->bytes;
+                itr->deleter(itr->memory);
+            }
+            g_retired.erase(last, g_retired.end());
+            return g_retired.size();
+        }
+    }
+
+    slot* thread_slot() {
+        slot *s = t_slot;
+        if (!s) {
+            s = claim_slot();
+            t_slot = s ? s : g_no_slot;
+        }
+        return s != g_no_slot ? s : nullptr;
+    }
+
+    uint64_t current() {
+        return g_epoch.load(std::memory_order_acquire);
+    }
+
+    void retire(void *memory, void (*deleter)(void *), size_t bytes) {
+        spinlock::guard g(g_retired_lock);
+        g_retired.push_back(retired_block{ memory, deleter, bytes, g_epoch.load(std::memory_order_relaxed) });
+        g_retired_bytes += bytes;
+        if (g_retired.size() >= reclaim_count || g_retired_bytes >= reclaim_bytes) {
+            reclaim_locked();
+        }
+    }
+
+    size_t reclaim() {
+        spinlock::guard g(g_retired_lock);
+        return reclaim_locked();
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    namespace {
+        struct counted {
+            static std::atomic<int> alive;
+            counted() { ++alive; }
+            ~counted() { --alive; }
+        };
+        std::atomic<int> counted::alive = 0;
+    }
+
+    TEST(epoch, retired_memory_outlives_the_readers)
+    {
+        reclaim();
+        const int wasAlive = counted::alive.load();
+
+        std::atomic<bool> entered = false;
+        std::atomic<bool> leave = false;
+        std::thread reader([&]() {
+            guard g;
+            EXPECT_TRUE(g.active());
+            entered = true;
+            while (!leave.load()) {
+                std::this_thread::yield();
+            }
+        });
+        while (!entered.load()) {
+            std::this_thread::yield();
+        }
+
+        retire(new counted());
+        EXPECT_EQ(1u, reclaim()); // the reader might still see it
+        EXPECT_EQ(wasAlive + 1, counted::alive.load());
+
+        leave = true;
+        reader.join();
+
+        // the reader has left, the later ones can't see it
+        {
+            guard g;
+            EXPECT_EQ(0u, reclaim());
+        }
+        EXPECT_EQ(wasAlive, counted::alive.load());
+    }
+
+    TEST(epoch, slots_are_released_by_exiting_threads)
+    {
+        // more threads than there are slots, one after another
+        for (size_t i = 0; i < max_slots * 2; ++i) {
+            std::thread([]() {
+                guard g;
+                EXPECT_TRUE(g.active());
+            }).join();
+        }
+    }
+}
+}
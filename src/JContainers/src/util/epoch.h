@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace util {
+
+    // Epoch-based reclamation of the memory read without any lock (see array::optimistic_read_number).
+    // A reader announces the global epoch in the slot of its thread for the duration of the read; the memory retired
+    // meanwhile isn't freed until every reader that might have seen it has left.
+    // Entering and leaving costs plain stores only: instead of each reader fencing its announcement
+    // the reclaimer flushes the write buffers of all processors (FlushProcessWriteBuffers), which is rare
+    namespace epoch {
+
+        struct alignas(64) slot {
+            std::atomic<uint64_t> epoch = 0; // 0 if the thread isn't reading
+            std::atomic<bool> owned = false;
+        };
+
+        // the slot of the calling thread, claimed at its first read and released once the thread exits.
+        // Null if all of them are taken
+        slot* thread_slot();
+
+        uint64_t current();
+
+        // Protects the memory read while it's alive. Inactive if the thread has no slot - the reader has to take a lock then.
+        // Doesn't nest
+        class guard {
+            slot *_slot;
+
+        public:
+            guard() : _slot(thread_slot()) {
+                if (_slot) {
+                    _slot->epoch.store(current(), std::memory_order_relaxed);
+                    // only the compiler has to keep the announcement before the reads, see reclaim
+                    std::atomic_signal_fence(std::memory_order_seq_cst);
+                }
+            }
+
+            ~guard() {
+                if (_slot) {
+                    _slot->epoch.store(0, std::memory_order_release);
+                }
+            }
+
+            bool active() const {
+                return _slot != nullptr;
+            }
+
+            guard(const guard&) = delete;
+            guard& operator=(const guard&) = delete;
+        };
+
+        // Frees the memory once no reader can see it anymore. The memory must be unreachable for the new readers already.
+        // The @bytes decide when the retired memory is worth reclaiming
+        void retire(void *memory, void (*deleter)(void *), size_t bytes);
+
+        template<class T>
+        void retire(const T *object, size_t bytes = sizeof(T)) {
+            retire(const_cast<T *>(object), [](void *memory) { delete static_cast<T *>(memory); }, bytes);
+        }
+
+        // Frees the retired memory no reader can see. Returns the number of the memory blocks still retired
+        size_t reclaim();
+    }
+}
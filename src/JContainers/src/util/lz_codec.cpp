@@ -0,0 +1,218 @@
+#include "util/lz_codec.h"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "gtest.h"
+
+namespace util {
+
+    namespace {
+
+        enum : size_t {
+            min_match = 4,
+            last_literals = 5, // the block always ends with the literals
+            match_find_limit = 12, // no match starts closer to the end
+            max_offset = 0xFFFF,
+            hash_bits = 12,
+            skip_trigger = 6, // the step grows after 2^skip_trigger misses in a row - uncompressible data gets skipped fast
+        };
+
+        uint32_t read32(const char *p) {
+            uint32_t value;
+            memcpy(&value, p, sizeof value);
+            return value;
+        }
+
+        uint32_t hash(uint32_t sequence) {
+            return (sequence * 2654435761u) >> (32 - hash_bits);
+        }
+
+        // 15 in the nibble of the token means the length continues in the bytes of 255
+        char* write_length(char *out, size_t length) {
+            for (; length >= 255; length -= 255) {
+                *out++ = char(255);
+            }
+            *out++ = char(length);
+            return out;
+        }
+
+        char* write_sequence(char *out, const char *literals, size_t literalCount, size_t offset, size_t matchLength) {
+            char *token = out++;
+            const size_t matchCode = matchLength ? matchLength - min_match : 0;
+            *token = char(((literalCount < 15 ? literalCount : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+
+            if (literalCount >= 15) {
+                out = write_length(out, literalCount - 15);
+            }
+            memcpy(out, literals, literalCount);
+            out += literalCount;
+
+            if (matchLength) {
+                *out++ = char(offset);
+                *out++ = char(offset >> 8);
+                if (matchCode >= 15) {
+                    out = write_length(out, matchCode - 15);
+                }
+            }
+            return out;
+        }
+    }
+
+    size_t lz_compress(const char *source, size_t size, char *dest) {
+        char *out = dest;
+        size_t anchor = 0;
+
+        if (size > match_find_limit) {
+            uint32_t table[1 << hash_bits] = {}; // the positions + 1, 0 means none
+            const size_t limit = size - match_find_limit;
+            const size_t matchLimit = size - last_literals;
+
+            size_t ip = 0;
+            size_t misses = 0;
+            while (ip < limit) {
+                const uint32_t sequence = read32(source + ip);
+                uint32_t& slot = table[hash(sequence)];
+                const size_t ref = slot;
+                slot = uint32_t(ip + 1);
+
+                if (ref == 0 || ip - (ref - 1) > max_offset || read32(source + ref - 1) != sequence) {
+                    ip += 1 + (misses++ >> skip_trigger);
+                    continue;
+                }
+                misses = 0;
+
+                size_t match = ref - 1;
+                size_t start = ip;
+                while (start > anchor && match > 0 && source[start - 1] == source[match - 1]) {
+                    --start;
+                    --match;
+                }
+
+                size_t end = ip + min_match;
+                while (end < matchLimit && source[end] == source[match + (end - start)]) {
+                    ++end;
+                }
+
+                out = write_sequence(out, source + anchor, start - anchor, start - match, end - start);
+                anchor = ip = end;
+            }
+        }
+
+        return write_sequence(out, source + anchor, size - anchor, 0, 0) - dest;
+    }
+
+    namespace {
+        [[noreturn]] void fail_decompression(const char *what) {
+            throw std::runtime_error(std::string("lz_decompress: ") + what);
+        }
+    }
+
+    size_t lz_decompress(const char *source, size_t size, char *dest, size_t capacity) {
+        const unsigned char *ip = reinterpret_cast<const unsigned char *>(source);
+        const unsigned char *const end = ip + size;
+        size_t op = 0;
+
+        auto readLength = [&](size_t length) {
+            if (length == 15) {
+                unsigned char byte;
+                do {
+                    if (ip == end) {
+                        fail_decompression("truncated length");
+                    }
+                    byte = *ip++;
+                    length += byte;
+                } while (byte == 255);
+            }
+            return length;
+        };
+
+        while (ip < end) {
+            const unsigned char token = *ip++;
+
+            const size_t literalCount = readLength(token >> 4);
+            if (literalCount > size_t(end - ip) || literalCount > capacity - op) {
+                fail_decompression("literals out of bounds");
+            }
+            memcpy(dest + op, ip, literalCount);
+            ip += literalCount;
+            op += literalCount;
+
+            if (ip == end) { // the last sequence has no match
+                break;
+            }
+
+            if (end - ip < 2) {
+                fail_decompression("truncated offset");
+            }
+            const size_t offset = ip[0] | ip[1] << 8;
+            ip += 2;
+            if (offset == 0 || offset > op) {
+                fail_decompression("invalid offset");
+            }
+
+            const size_t matchLength = readLength(token & 15) + min_match;
+            if (matchLength > capacity - op) {
+                fail_decompression("match out of bounds");
+            }
+            // the match may overlap the bytes being written, so byte by byte
+            const char *match = dest + op - offset;
+            for (size_t i = 0; i < matchLength; ++i) {
+                dest[op + i] = match[i];
+            }
+            op += matchLength;
+        }
+
+        return op;
+    }
+
+    void lz_decompressor::fail(const char *what) {
+        throw std::runtime_error(std::string("lz stream: ") + what);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
+    TEST(lz_codec, block_round_trip)
+    {
+        std::mt19937 random(7);
+
+        auto check = [](const std::string& data) {
+            std::vector<char> packed(lz_compress_bound(data.size()));
+            const size_t packedSize = lz_compress(data.data(), data.size(), packed.data());
+            EXPECT_TRUE(packedSize <= packed.size());
+
+            std::string restored(data.size(), '\0');
+            EXPECT_EQ(data.size(), lz_decompress(packed.data(), packedSize, &restored[0], restored.size()));
+            EXPECT_TRUE(restored == data);
+            return packedSize;
+        };
+
+        check("");
+        check("a");
+        check("abcabcabcabc");
+
+        std::string runs(lz_block_size, 'x');
+        EXPECT_TRUE(check(runs) < runs.size() / 100);
+
+        std::string text;
+        while (text.size() < lz_block_size) {
+            text += "\"__formData|Skyrim.esm|0x" + std::to_string(random() % 50) + "\", ";
+        }
+        text.resize(lz_block_size);
+        EXPECT_TRUE(check(text) < text.size() / 3);
+
+        std::string noise(lz_block_size, '\0');
+        for (auto& c : noise) {
+            c = char(random());
+        }
+        EXPECT_TRUE(check(noise) <= lz_compress_bound(noise.size()));
+
+        // malformed data throws instead of reading or writing out of bounds
+        std::vector<char> packed(lz_compress_bound(text.size()));
+        const size_t packedSize = lz_compress(text.data(), text.size(), packed.data());
+        std::string restored(text.size(), '\0');
+        EXPECT_THROW(lz_decompress(packed.data(), packedSize, &restored[0], restored.size() / 2), std::runtime_error);
+        EXPECT_THROW(lz_decompress(packed.data(), packedSize / 2, &restored[0], restored.size()), std::runtime_error);
+    }
+}
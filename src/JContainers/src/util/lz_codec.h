@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <boost/iostreams/concepts.hpp>
+#include <boost/iostreams/operations.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+namespace util {
+
+    // LZ4-style block codec: byte-aligned LZ77 sequences (token, literals, 16-bit offset, match length),
+    // fast enough to be applied to a save without noticeable slowdown.
+    // The blocks are independent, no match crosses a block boundary
+    enum : size_t {
+        lz_block_size = 1 << 16, // the window size as well
+    };
+
+    // the max size of the compressed @size bytes
+    inline size_t lz_compress_bound(size_t size) {
+        return size + size / 255 + 16;
+    }
+
+    // returns the size of the compressed data written into the @dest, lz_compress_bound(size) bytes long
+    size_t lz_compress(const char *source, size_t size, char *dest);
+
+    // returns the size of the decompressed data. Throws std::runtime_error if the data is malformed or exceeds the @capacity
+    size_t lz_decompress(const char *source, size_t size, char *dest, size_t capacity);
+
+    // Stream framing: every block is preceded by its raw and packed sizes (uint32 little-endian each),
+    // a block which doesn't shrink is stored as is (the sizes are equal). A zero raw size ends the stream
+    class lz_compressor : public boost::iostreams::multichar_output_filter {
+    public:
+        template<class Sink>
+        std::streamsize write(Sink& sink, const char *s, std::streamsize n) {
+            for (std::streamsize left = n; left > 0;) {
+                const size_t part = (std::min)(size_t(left), lz_block_size - _block.size());
+                _block.insert(_block.end(), s, s + part);
+                s += part;
+                left -= part;
+                if (_block.size() == lz_block_size) {
+                    write_block(sink);
+                }
+            }
+            return n;
+        }
+
+        template<class Sink>
+        void close(Sink& sink) {
+            if (!_block.empty()) {
+                write_block(sink);
+            }
+            write_sizes(sink, 0, 0);
+        }
+
+    private:
+        template<class Sink>
+        void write_sizes(Sink& sink, uint32_t raw, uint32_t packed) {
+            const char sizes[8] = {
+                char(raw), char(raw >> 8), char(raw >> 16), char(raw >> 24),
+                char(packed), char(packed >> 8), char(packed >> 16), char(packed >> 24),
+            };
+            boost::iostreams::write(sink, sizes, sizeof sizes);
+        }
+
+        template<class Sink>
+        void write_block(Sink& sink) {
+            _packed.resize(lz_compress_bound(_block.size()));
+            const size_t packed = lz_compress(_block.data(), _block.size(), _packed.data());
+            const bool stored = packed >= _block.size();
+            const auto& data = stored ? _block : _packed;
+            const size_t size = stored ? _block.size() : packed;
+
+            write_sizes(sink, uint32_t(_block.size()), uint32_t(size));
+            boost::iostreams::write(sink, data.data(), std::streamsize(size));
+            _block.clear();
+        }
+
+        std::vector<char> _block;
+        std::vector<char> _packed;
+    };
+
+    class lz_decompressor : public boost::iostreams::multichar_input_filter {
+    public:
+        template<class Source>
+        std::streamsize read(Source& source, char *s, std::streamsize n) {
+            std::streamsize done = 0;
+            while (done < n) {
+                if (_position == _block.size() && !read_block(source)) {
+                    break;
+                }
+                const size_t part = (std::min)(size_t(n - done), _block.size() - _position);
+                memcpy(s + done, _block.data() + _position, part);
+                _position += part;
+                done += part;
+            }
+            return done > 0 ? done : -1;
+        }
+
+        template<class Source>
+        void close(Source&) {
+            _block.clear();
+            _position = 0;
+            _finished = false;
+        }
+
+    private:
+        [[noreturn]] static void fail(const char *what);
+
+        template<class Source>
+        void read_exactly(Source& source, char *s, size_t size) {
+            while (size > 0) {
+                const std::streamsize got = boost::iostreams::read(source, s, std::streamsize(size));
+                if (got <= 0) {
+                    fail("unexpected end of data");
+                }
+                s += got;
+                size -= size_t(got);
+            }
+        }
+
+        template<class Source>
+        bool read_block(Source& source) {
+            if (_finished) {
+                return false;
+            }
+
+            unsigned char sizes[8];
+            read_exactly(source, reinterpret_cast<char *>(sizes), sizeof sizes);
+            const uint32_t raw = sizes[0] | sizes[1] << 8 | sizes[2] << 16 | uint32_t(sizes[3]) << 24;
+            const uint32_t packed = sizes[4] | sizes[5] << 8 | sizes[6] << 16 | uint32_t(sizes[7]) << 24;
+            if (raw == 0) {
+                _finished = true;
+                return false;
+            }
+            if (raw > lz_block_size || packed > raw) {
+                fail("invalid block size");
+            }
+
+            _block.resize(raw);
+            _position = 0;
+            if (packed == raw) {
+                read_exactly(source, _block.data(), raw);
+            }
+            else {
+                _packed.resize(packed);
+                read_exactly(source, _packed.data(), packed);
+                if (lz_decompress(_packed.data(), packed, _block.data(), raw) != raw) {
+                    fail("block size mismatch");
+                }
+            }
+            return true;
+        }
+
+        std::vector<char> _block;
+        std::vector<char> _packed;
+        size_t _position = 0;
+        bool _finished = false;
+    };
+
+    // calls func(std::ostream&) with a stream which compresses the data written into it into the @stream
+    template<class F>
+    void lz_compress_stream(std::ostream& stream, F&& func) {
+        boost::iostreams::filtering_ostream compressed;
+        compressed.push(lz_compressor());
+        compressed.push(stream);
+        func(static_cast<std::ostream&>(compressed));
+        compressed.reset(); // writes the last block and the end of the stream
+    }
+
+    // calls func(std::istream&) with a stream which decompresses the data read from the @stream.
+    // Nothing past the end of the compressed data gets read from the @stream
+    template<class F>
+    void lz_decompress_stream(std::istream& stream, F&& func) {
+        boost::iostreams::filtering_istream decompressed;
+        decompressed.push(lz_decompressor());
+        decompressed.push(stream, 0);
+        func(static_cast<std::istream&>(decompressed));
+    }
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#include <assert.h>
+
+namespace util {
+
+    // Hash set with open addressing (linear probing, backward shift deletion - no tombstones).
+    // The values live in a dense vector in the insertion order, the table stores their indices and hashes only:
+    // - iteration is a plain vector walk, the values are addressable by their index
+    // - erasure moves the last value into the hole, so it's O(1) but the order of the values changes
+    // The Hash must agree with the Equal: Equal(a, b) implies Hash(a) == Hash(b)
+    template<class T, class Hash, class Equal = std::equal_to<T>>
+    class open_hash_set
+    {
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using const_iterator = typename std::vector<T>::const_iterator;
+
+        static const size_type npos = size_type(-1);
+
+    private:
+
+        struct slot {
+            uint32_t index_plus_one = 0; // 0 - the slot is empty
+            uint32_t hash = 0;
+
+            bool empty() const { return index_plus_one == 0; }
+        };
+
+        std::vector<T> _values;
+        std::vector<slot> _slots; // the size is zero or a power of two
+        Hash _hash;
+        Equal _equal;
+
+        enum { min_slots = 8 };
+
+        size_type mask() const { return _slots.size() - 1; }
+
+        // max load factor is 3/4
+        static size_type slots_for(size_type count) {
+            size_type slots = min_slots;
+            while (slots * 3 / 4 < count) {
+                slots *= 2;
+            }
+            return slots;
+        }
+
+        // the slot of the value or the empty slot the value would occupy
+        size_type probe(const T& value, uint32_t hash) const {
+            size_type pos = hash & mask();
+            while (!_slots[pos].empty()) {
+                const slot& s = _slots[pos];
+                if (s.hash == hash && _equal(_values[s.index_plus_one - 1], value)) {
+                    break;
+                }
+                pos = (pos + 1) & mask();
+            }
+            return pos;
+        }
+
+        size_type slot_of_index(size_type index) const {
+            size_type pos = uint32_t(_hash(_values[index])) & mask();
+            while (_slots[pos].index_plus_one != index + 1) {
+                assert(!_slots[pos].empty());
+                pos = (pos + 1) & mask();
+            }
+            return pos;
+        }
+
+        void rehash(size_type slots) {
+            _slots.assign(slots, slot());
+            for (size_type i = 0; i < _values.size(); ++i) {
+                const uint32_t hash = uint32_t(_hash(_values[i]));
+                size_type pos = hash & mask();
+                while (!_slots[pos].empty()) {
+                    pos = (pos + 1) & mask();
+                }
+                _slots[pos] = slot{ uint32_t(i + 1), hash };
+            }
+        }
+
+        // empties the slot, shifting back the entries of the probe chain that follows it
+        void erase_slot(size_type hole) {
+            size_type pos = hole;
+            for (;;) {
+                pos = (pos + 1) & mask();
+                if (_slots[pos].empty()) {
+                    break;
+                }
+                const size_type home = _slots[pos].hash & mask();
+                // can the entry at the pos be moved into the hole? Yes, if its home isn't in (hole, pos]
+                if (((pos - home) & mask()) >= ((pos - hole) & mask())) {
+                    _slots[hole] = _slots[pos];
+                    hole = pos;
+                }
+            }
+            _slots[hole] = slot();
+        }
+
+    public:
+
+        open_hash_set() = default;
+
+        size_type size() const { return _values.size(); }
+        bool empty() const { return _values.empty(); }
+
+        const_iterator begin() const { return _values.begin(); }
+        const_iterator end() const { return _values.end(); }
+
+        const T& operator [] (size_type index) const { return _values[index]; }
+
+        const std::vector<T>& values() const { return _values; }
+
+        void reserve(size_type count) {
+            _values.reserve(count);
+            if (slots_for(count) > _slots.size()) {
+                rehash(slots_for(count));
+            }
+        }
+
+        void clear() {
+            _values.clear();
+            _slots.clear();
+        }
+
+        void swap(open_hash_set& other) {
+            _values.swap(other._values);
+            _slots.swap(other._slots);
+        }
+
+        // index of the value or npos
+        size_type find(const T& value) const {
+            if (_slots.empty()) {
+                return npos;
+            }
+            const slot& s = _slots[probe(value, uint32_t(_hash(value)))];
+            return s.empty() ? npos : s.index_plus_one - 1;
+        }
+
+        bool contains(const T& value) const {
+            return find(value) != npos;
+        }
+
+        // returns the index of the value and true if it has been inserted
+        template<class V>
+        std::pair<size_type, bool> insert(V&& value) {
+            if (slots_for(_values.size() + 1) > _slots.size()) {
+                rehash(slots_for(_values.size() + 1));
+            }
+
+            const uint32_t hash = uint32_t(_hash(value));
+            const size_type pos = probe(value, hash);
+            if (!_slots[pos].empty()) {
+                return { _slots[pos].index_plus_one - 1, false };
+            }
+
+            _values.emplace_back(std::forward<V>(value));
+            _slots[pos] = slot{ uint32_t(_values.size()), hash };
+            return { _values.size() - 1, true };
+        }
+
+        bool erase(const T& value) {
+            const size_type index = find(value);
+            if (index == npos) {
+                return false;
+            }
+            erase_at(index);
+            return true;
+        }
+
+        // the last value takes the place of the erased one
+        void erase_at(size_type index) {
+            assert(index < _values.size());
+            erase_slot(slot_of_index(index));
+
+            const size_type last = _values.size() - 1;
+            if (index != last) {
+                _slots[slot_of_index(last)].index_plus_one = uint32_t(index + 1);
+                _values[index] = std::move(_values[last]);
+            }
+            _values.pop_back();
+        }
+
+        // replaces the contents, the duplicates get dropped
+        void assign(std::vector<T>&& values) {
+            clear();
+            reserve(values.size());
+            for (auto& value : values) {
+                insert(std::move(value));
+            }
+        }
+
+        // lets the @func modify the values in place (they may become equal), then rebuilds the table
+        template<class F>
+        void modify_values(F&& func) {
+            std::vector<T> values;
+            values.swap(_values);
+            std::for_each(values.begin(), values.end(), std::forward<F>(func));
+            assign(std::move(values));
+        }
+
+        friend bool operator == (const open_hash_set& left, const open_hash_set& right) {
+            return left.size() == right.size() && std::all_of(left.begin(), left.end(), [&](const T& value) {
+                return right.contains(value);
+            });
+        }
+    };
+}
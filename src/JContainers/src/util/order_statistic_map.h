@@ -0,0 +1,552 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <tuple>
+#include <utility>
+#include <stdint.h>
+#include <assert.h>
+
+namespace util {
+
+    // std::map replacement (the part of its interface JContainers uses) that also answers "N-th element"
+    // and "index of element" queries in O(log n).
+    // AVL tree where each node knows the size of its subtree. Iterators and element references are stable
+    // just like in std::map: only the erased element's iterators get invalidated.
+    // The structure version changes whenever an element gets inserted or erased - lets the cursors detect that
+    template<class Key, class T, class Compare = std::less<Key>>
+    class order_statistic_map
+    {
+    public:
+        using key_type = Key;
+        using mapped_type = T;
+        using value_type = std::pair<const Key, T>;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+        using key_compare = Compare;
+        using reference = value_type&;
+        using const_reference = const value_type&;
+
+    private:
+
+        struct node_base {
+            node_base *parent = nullptr;
+            node_base *left = nullptr;
+            node_base *right = nullptr;
+            size_type size = 0;
+            int height = 0;
+        };
+
+        struct node : node_base {
+            value_type value;
+
+            template<class ...Args>
+            explicit node(Args&&... args) : value(std::forward<Args>(args)...) {}
+        };
+
+        // the header's left child is the root. The header is the end() node and the only node without parent
+        node_base _header;
+        Compare _comp;
+        uint32_t _structure_version = 0;
+
+        static size_type size_of(const node_base *n) { return n ? n->size : 0; }
+        static int height_of(const node_base *n) { return n ? n->height : 0; }
+
+        static const value_type& value_of(const node_base *n) { return static_cast<const node*>(n)->value; }
+        const Key& key_of(const node_base *n) const { return value_of(n).first; }
+
+        static node_base* leftmost(node_base *n) {
+            while (n->left) {
+                n = n->left;
+            }
+            return n;
+        }
+
+        static node_base* rightmost(node_base *n) {
+            while (n->right) {
+                n = n->right;
+            }
+            return n;
+        }
+
+        static node_base* next_node(node_base *n) {
+            if (n->right) {
+                return leftmost(n->right);
+            }
+            node_base *p = n->parent;
+            while (n == p->right) {
+                n = p;
+                p = p->parent;
+            }
+            return p;
+        }
+
+        static node_base* prev_node(node_base *n) {
+            if (!n->parent) { // end()
+                return rightmost(n->left);
+            }
+            if (n->left) {
+                return rightmost(n->left);
+            }
+            node_base *p = n->parent;
+            while (n == p->left) {
+                n = p;
+                p = p->parent;
+            }
+            return p;
+        }
+
+        template<bool IsConst>
+        class iterator_t {
+            friend class order_statistic_map;
+            node_base *_node = nullptr;
+
+            explicit iterator_t(node_base *n) : _node(n) {}
+
+        public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = typename order_statistic_map::value_type;
+            using difference_type = ptrdiff_t;
+            using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+            using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+
+            iterator_t() = default;
+
+            // iterator -> const_iterator
+            template<bool WasConst, class = std::enable_if_t<IsConst && !WasConst>>
+            iterator_t(const iterator_t<WasConst>& other) : _node(other._node) {}
+
+            reference operator * () const { return static_cast<node*>(_node)->value; }
+            pointer operator -> () const { return &static_cast<node*>(_node)->value; }
+
+            iterator_t& operator ++ () { _node = next_node(_node); return *this; }
+            iterator_t& operator -- () { _node = prev_node(_node); return *this; }
+            iterator_t operator ++ (int) { auto copy = *this; ++*this; return copy; }
+            iterator_t operator -- (int) { auto copy = *this; --*this; return copy; }
+
+            template<bool OtherConst>
+            bool operator == (const iterator_t<OtherConst>& other) const { return _node == other._node; }
+            template<bool OtherConst>
+            bool operator != (const iterator_t<OtherConst>& other) const { return _node != other._node; }
+        };
+
+    public:
+        using iterator = iterator_t<false>;
+        using const_iterator = iterator_t<true>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        order_statistic_map() = default;
+        explicit order_statistic_map(const Compare& comp) : _comp(comp) {}
+
+        template<class InputIt>
+        order_statistic_map(InputIt first, InputIt last, const Compare& comp = Compare()) : _comp(comp) {
+            insert(first, last);
+        }
+
+        order_statistic_map(const order_statistic_map& other) : _comp(other._comp) {
+            set_root(copy_subtree(other.root(), &_header));
+        }
+
+        order_statistic_map(order_statistic_map&& other) : _comp(std::move(other._comp)) {
+            set_root(other.root());
+            other.set_root(nullptr);
+        }
+
+        order_statistic_map& operator = (const order_statistic_map& other) {
+            if (this != &other) {
+                order_statistic_map copy(other);
+                swap(copy);
+            }
+            return *this;
+        }
+
+        order_statistic_map& operator = (order_statistic_map&& other) {
+            if (this != &other) {
+                clear();
+                _comp = std::move(other._comp);
+                set_root(other.root());
+                other.set_root(nullptr);
+                ++other._structure_version;
+            }
+            return *this;
+        }
+
+        ~order_statistic_map() {
+            clear();
+        }
+
+        void swap(order_statistic_map& other) {
+            node_base *mine = root();
+            set_root(other.root());
+            other.set_root(mine);
+            std::swap(_comp, other._comp);
+            ++_structure_version;
+            ++other._structure_version;
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        iterator begin() { return iterator(root() ? leftmost(root()) : &_header); }
+        iterator end() { return iterator(&_header); }
+        const_iterator begin() const { return const_cast<order_statistic_map*>(this)->begin(); }
+        const_iterator end() const { return const_cast<order_statistic_map*>(this)->end(); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+
+        reverse_iterator rbegin() { return reverse_iterator(end()); }
+        reverse_iterator rend() { return reverse_iterator(begin()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+        size_type size() const { return size_of(root()); }
+        bool empty() const { return root() == nullptr; }
+        key_compare key_comp() const { return _comp; }
+        uint32_t structure_version() const { return _structure_version; }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        // the N-th element in the key order or end()
+        iterator nth(size_type index) {
+            node_base *n = root();
+            while (n) {
+                const size_type leftSize = size_of(n->left);
+                if (index < leftSize) {
+                    n = n->left;
+                }
+                else if (index == leftSize) {
+                    return iterator(n);
+                }
+                else {
+                    index -= leftSize + 1;
+                    n = n->right;
+                }
+            }
+            return end();
+        }
+
+        const_iterator nth(size_type index) const { return const_cast<order_statistic_map*>(this)->nth(index); }
+
+        // the number of elements preceding the @itr, size() for end()
+        size_type index_of(const_iterator itr) const {
+            const node_base *n = itr._node;
+            if (n == &_header) {
+                return size();
+            }
+            size_type index = size_of(n->left);
+            while (n->parent != &_header) {
+                const node_base *p = n->parent;
+                if (n == p->right) {
+                    index += size_of(p->left) + 1;
+                }
+                n = p;
+            }
+            return index;
+        }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        // The @key may be of any type the Compare accepts along with the Key
+
+        template<class K>
+        iterator lower_bound(const K& key) {
+            node_base *n = root(), *result = &_header;
+            while (n) {
+                if (!_comp(key_of(n), key)) {
+                    result = n;
+                    n = n->left;
+                }
+                else {
+                    n = n->right;
+                }
+            }
+            return iterator(result);
+        }
+
+        template<class K>
+        iterator upper_bound(const K& key) {
+            node_base *n = root(), *result = &_header;
+            while (n) {
+                if (_comp(key, key_of(n))) {
+                    result = n;
+                    n = n->left;
+                }
+                else {
+                    n = n->right;
+                }
+            }
+            return iterator(result);
+        }
+
+        iterator find(const Key& key) {
+            iterator itr = lower_bound(key);
+            return (itr == end() || _comp(key, itr->first)) ? end() : itr;
+        }
+
+        template<class K>
+        const_iterator lower_bound(const K& key) const { return const_cast<order_statistic_map*>(this)->lower_bound(key); }
+        template<class K>
+        const_iterator upper_bound(const K& key) const { return const_cast<order_statistic_map*>(this)->upper_bound(key); }
+        const_iterator find(const Key& key) const { return const_cast<order_statistic_map*>(this)->find(key); }
+
+        size_type count(const Key& key) const { return find(key) != end() ? 1 : 0; }
+
+        //////////////////////////////////////////////////////////////////////////
+
+        T& operator [] (const Key& key) {
+            return try_emplace(key).first->second;
+        }
+
+        T& operator [] (Key&& key) {
+            return try_emplace(std::move(key)).first->second;
+        }
+
+        template<class K, class ...Args>
+        std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+            auto place = find_insert_position(key);
+            if (place.existing) {
+                return{ iterator(place.existing), false };
+            }
+            node *z = new node(std::piecewise_construct,
+                std::forward_as_tuple(std::forward<K>(key)),
+                std::forward_as_tuple(std::forward<Args>(args)...));
+            link(z, place);
+            return{ iterator(z), true };
+        }
+
+        template<class ...Args>
+        std::pair<iterator, bool> emplace(Args&&... args) {
+            node *z = new node(std::forward<Args>(args)...);
+            auto place = find_insert_position(z->value.first);
+            if (place.existing) {
+                delete z;
+                return{ iterator(place.existing), false };
+            }
+            link(z, place);
+            return{ iterator(z), true };
+        }
+
+        // the hint is ignored: the lookup is O(log n) anyway
+        template<class ...Args>
+        iterator emplace_hint(const_iterator, Args&&... args) {
+            return emplace(std::forward<Args>(args)...).first;
+        }
+
+        std::pair<iterator, bool> insert(const value_type& value) {
+            return emplace(value);
+        }
+
+        std::pair<iterator, bool> insert(value_type&& value) {
+            return emplace(std::move(value));
+        }
+
+        template<class InputIt>
+        void insert(InputIt first, InputIt last) {
+            for (; first != last; ++first) {
+                emplace(*first);
+            }
+        }
+
+        iterator erase(const_iterator itr) {
+            assert(itr._node != &_header);
+            node_base *z = itr._node;
+            iterator following(next_node(z));
+            unlink(z);
+            delete static_cast<node*>(z);
+            return following;
+        }
+
+        size_type erase(const Key& key) {
+            auto itr = find(key);
+            if (itr == end()) {
+                return 0;
+            }
+            erase(itr);
+            return 1;
+        }
+
+        void clear() {
+            destroy_subtree(root());
+            set_root(nullptr);
+            ++_structure_version;
+        }
+
+    private:
+
+        node_base* root() const { return _header.left; }
+
+        void set_root(node_base *n) {
+            _header.left = n;
+            if (n) {
+                n->parent = &_header;
+            }
+        }
+
+        static void update(node_base *n) {
+            n->size = 1 + size_of(n->left) + size_of(n->right);
+            n->height = 1 + (std::max)(height_of(n->left), height_of(n->right));
+        }
+
+        static void replace_child(node_base *parent, node_base *oldChild, node_base *newChild) {
+            if (parent->left == oldChild) {
+                parent->left = newChild;
+            }
+            else {
+                parent->right = newChild;
+            }
+            if (newChild) {
+                newChild->parent = parent;
+            }
+        }
+
+        static node_base* rotate_left(node_base *x) {
+            node_base *y = x->right;
+            replace_child(x->parent, x, y);
+            x->right = y->left;
+            if (x->right) {
+                x->right->parent = x;
+            }
+            y->left = x;
+            x->parent = y;
+            update(x);
+            update(y);
+            return y;
+        }
+
+        static node_base* rotate_right(node_base *x) {
+            node_base *y = x->left;
+            replace_child(x->parent, x, y);
+            x->left = y->right;
+            if (x->left) {
+                x->left->parent = x;
+            }
+            y->right = x;
+            x->parent = y;
+            update(x);
+            update(y);
+            return y;
+        }
+
+        // restores the sizes and the balance on the way from @n to the root
+        void rebalance_up(node_base *n) {
+            while (n != &_header) {
+                update(n);
+                const int balance = height_of(n->left) - height_of(n->right);
+                if (balance > 1) {
+                    if (height_of(n->left->left) < height_of(n->left->right)) {
+                        rotate_left(n->left);
+                    }
+                    n = rotate_right(n);
+                }
+                else if (balance < -1) {
+                    if (height_of(n->right->right) < height_of(n->right->left)) {
+                        rotate_right(n->right);
+                    }
+                    n = rotate_left(n);
+                }
+                n = n->parent;
+            }
+        }
+
+        struct insert_position {
+            node_base *existing;
+            node_base *parent;
+            bool as_left;
+        };
+
+        template<class K>
+        insert_position find_insert_position(const K& key) const {
+            node_base *n = root();
+            insert_position place{ nullptr, const_cast<node_base*>(&_header), true };
+            while (n) {
+                place.parent = n;
+                if (_comp(key, key_of(n))) {
+                    place.as_left = true;
+                    n = n->left;
+                }
+                else if (_comp(key_of(n), key)) {
+                    place.as_left = false;
+                    n = n->right;
+                }
+                else {
+                    place.existing = n;
+                    return place;
+                }
+            }
+            return place;
+        }
+
+        void link(node_base *z, const insert_position& place) {
+            ++_structure_version;
+            z->parent = place.parent;
+            z->size = 1;
+            z->height = 1;
+            if (place.as_left) {
+                place.parent->left = z;
+            }
+            else {
+                place.parent->right = z;
+            }
+            rebalance_up(place.parent);
+        }
+
+        void unlink(node_base *z) {
+            ++_structure_version;
+            node_base *rebalanceFrom = nullptr;
+
+            if (z->left && z->right) {
+                // the successor takes the place of @z. Nodes are relinked, not the values swapped,
+                // so the iterators to the successor stay valid
+                node_base *y = leftmost(z->right);
+                if (y->parent == z) {
+                    rebalanceFrom = y;
+                }
+                else {
+                    rebalanceFrom = y->parent;
+                    replace_child(y->parent, y, y->right);
+                    y->right = z->right;
+                    y->right->parent = y;
+                }
+                y->left = z->left;
+                y->left->parent = y;
+                replace_child(z->parent, z, y);
+            }
+            else {
+                node_base *child = z->left ? z->left : z->right;
+                rebalanceFrom = z->parent;
+                replace_child(z->parent, z, child);
+            }
+
+            rebalance_up(rebalanceFrom);
+        }
+
+        static node_base* copy_subtree(const node_base *source, node_base *parent) {
+            if (!source) {
+                return nullptr;
+            }
+            node *n = new node(value_of(source));
+            n->parent = parent;
+            n->size = source->size;
+            n->height = source->height;
+            try {
+                n->left = copy_subtree(source->left, n);
+                n->right = copy_subtree(source->right, n);
+            }
+            catch (...) {
+                destroy_subtree(n);
+                throw;
+            }
+            return n;
+        }
+
+        static void destroy_subtree(node_base *n) {
+            while (n) { // the recursion for the left, the loop for the right
+                destroy_subtree(n->left);
+                node_base *right = n->right;
+                delete static_cast<node*>(n);
+                n = right;
+            }
+        }
+    };
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <boost/archive/basic_archive.hpp>
+#include <boost/serialization/collection_size_type.hpp>
+#include <boost/serialization/item_version_type.hpp>
+#include <boost/serialization/detail/stack_constructor.hpp>
+#include <boost/serialization/nvp.hpp>
+#include <boost/serialization/split_free.hpp>
+#include <boost/serialization/utility.hpp>
+
+#include "util/order_statistic_map.h"
+
+/**
+ * Writes exactly the same archive layout as boost/serialization/map.hpp does for std::map,
+ * so the saves made before the containers were switched to util::order_statistic_map load just fine.
+ */
+namespace boost { namespace serialization {
+
+    template<class Archive, class Key, class T, class Compare>
+    inline void save(Archive & ar, const util::order_statistic_map<Key, T, Compare>& container, const unsigned int) {
+        using value_type = typename util::order_statistic_map<Key, T, Compare>::value_type;
+
+        collection_size_type count(container.size());
+        const item_version_type item_version(version<value_type>::value);
+        ar << BOOST_SERIALIZATION_NVP(count);
+        ar << BOOST_SERIALIZATION_NVP(item_version);
+
+        for (const auto& pair : container) {
+            ar << make_nvp("item", pair);
+        }
+    }
+
+    template<class Archive, class Key, class T, class Compare>
+    inline void load(Archive & ar, util::order_statistic_map<Key, T, Compare>& container, const unsigned int) {
+        using value_type = typename util::order_statistic_map<Key, T, Compare>::value_type;
+
+        container.clear();
+
+        collection_size_type count;
+        item_version_type item_version(0);
+        ar >> BOOST_SERIALIZATION_NVP(count);
+        if (boost::archive::library_version_type(3) < ar.get_library_version()) {
+            ar >> BOOST_SERIALIZATION_NVP(item_version);
+        }
+
+        while (count-- > 0) {
+            detail::stack_construct<Archive, value_type> constructed(ar, item_version);
+            ar >> make_nvp("item", constructed.reference());
+            auto result = container.emplace(std::move(constructed.reference())).first;
+            ar.reset_object_address(&(result->second), &constructed.reference().second);
+        }
+    }
+
+    template<class Archive, class Key, class T, class Compare>
+    inline void serialize(Archive & ar, util::order_statistic_map<Key, T, Compare>& container, const unsigned int version) {
+        split_free(ar, container, version);
+    }
+
+}}
@@ -0,0 +1,270 @@
+#include "util/spinlock.h"
+
+#include <thread>
+#include <vector>
+
+#include "gtest.h"
+
+namespace util {
+
+    namespace {
+
+        std::atomic<bool> g_track_contention = false;
+
+        // WaitOnAddress family is Windows 8+ only, resolved at runtime to keep Windows 7 support
+        using WaitOnAddress_t = BOOL (WINAPI *)(volatile VOID *address, PVOID compareAddress, SIZE_T addressSize, DWORD milliseconds);
+        using WakeByAddressAll_t = VOID (WINAPI *)(PVOID address);
+
+        struct wait_on_address_api {
+            WaitOnAddress_t wait = nullptr;
+            WakeByAddressAll_t wake_all = nullptr;
+
+            wait_on_address_api() {
+                if (HMODULE module = LoadLibraryW(L"api-ms-win-core-synch-l1-2-0.dll")) {
+                    wait = reinterpret_cast<WaitOnAddress_t>(GetProcAddress(module, "WaitOnAddress"));
+                    wake_all = reinterpret_cast<WakeByAddressAll_t>(GetProcAddress(module, "WakeByAddressAll"));
+                    if (!wait || !wake_all) {
+                        wait = nullptr;
+                        wake_all = nullptr;
+                    }
+                }
+            }
+
+            static const wait_on_address_api& instance() {
+                static const wait_on_address_api api;
+                return api;
+            }
+        };
+
+        enum : uint32_t {
+            max_spin_pauses = 1 << 10,
+        };
+    }
+
+    void adaptive_lock::enable_contention_tracking(bool enable) {
+        g_track_contention.store(enable, std::memory_order_relaxed);
+    }
+
+    bool adaptive_lock::is_contention_tracking_enabled() {
+        return g_track_contention.load(std::memory_order_relaxed);
+    }
+
+    void adaptive_lock::lock_contended() {
+        if (g_track_contention.load(std::memory_order_relaxed)) {
+            _contentions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // the owner is likely to release the lock soon - spin, doubling the pause each time.
+        // The writer keeps the waiters flag on acquiring, so the parked threads get woken by its unlock.
+        // Before parking it raises the writer_waiting flag: the readers stop coming in, the current ones drain
+        // and the writer gets the lock, so a steady stream of readers can't starve it
+        uint32_t pauses = 1;
+        for (;;) {
+            uint32_t state = _state.load(std::memory_order_relaxed);
+            if ((state & ~(waiters | writer_waiting)) == 0) {
+                // drops the writer_waiting - another parked writer raises it again once woken by our unlock
+                if (_state.compare_exchange_weak(state, (state | writer) & ~writer_waiting, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return;
+                }
+                continue;
+            }
+
+            if (pauses <= max_spin_pauses) {
+                for (uint32_t i = 0; i < pauses; ++i) {
+                    _mm_pause();
+                }
+                pauses *= 2;
+            }
+            else if ((state & writer_waiting) == 0) {
+                _state.compare_exchange_weak(state, state | writer_waiting, std::memory_order_relaxed);
+            }
+            else {
+                park(state);
+            }
+        }
+    }
+
+    void adaptive_lock::lock_shared_contended() {
+        if (g_track_contention.load(std::memory_order_relaxed)) {
+            _contentions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // unlike the fast path, ignores the waiters flag: the reader is a waiter itself.
+        // Still stays out while a writer is waiting, otherwise the readers could starve it
+        uint32_t pauses = 1;
+        for (;;) {
+            uint32_t state = _state.load(std::memory_order_relaxed);
+            if ((state & (writer | writer_waiting)) == 0) {
+                if (_state.compare_exchange_weak(state, state + reader_unit, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return;
+                }
+                continue;
+            }
+
+            if (pauses <= max_spin_pauses) {
+                for (uint32_t i = 0; i < pauses; ++i) {
+                    _mm_pause();
+                }
+                pauses *= 2;
+            }
+            else {
+                park(state);
+            }
+        }
+    }
+
+    void adaptive_lock::park(uint32_t observedState) {
+        const auto& api = wait_on_address_api::instance();
+        if (!api.wait) {
+            std::this_thread::yield();
+            return;
+        }
+
+        const uint32_t parkedState = observedState | waiters;
+        if (observedState != parkedState &&
+            !_state.compare_exchange_strong(observedState, parkedState, std::memory_order_relaxed))
+        {
+            return; // the state has changed - retry to acquire
+        }
+
+        // returns immediately if the state differs from the parkedState
+        uint32_t waitingFor = parkedState;
+        api.wait(&_state, &waitingFor, sizeof waitingFor, INFINITE);
+    }
+
+    void adaptive_lock::wake_all() {
+        const auto& api = wait_on_address_api::instance();
+        if (api.wake_all) {
+            api.wake_all(&_state);
+        }
+    }
+
+    TEST(adaptive_lock, mutual_exclusion)
+    {
+        adaptive_lock lock;
+        const bool wasTracking = adaptive_lock::is_contention_tracking_enabled();
+        adaptive_lock::enable_contention_tracking(true);
+
+        // long critical sections force the threads to park
+        uint32_t counter = 0;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 8; ++i) {
+            threads.emplace_back([&]() {
+                for (int j = 0; j < 1000; ++j) {
+                    adaptive_lock::guard g(lock);
+                    uint32_t value = counter;
+                    if (j % 100 == 0) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    }
+                    counter = value + 1;
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        adaptive_lock::enable_contention_tracking(wasTracking);
+
+        EXPECT_EQ(8000u, counter);
+        EXPECT_TRUE(lock.contentions() > 0);
+        EXPECT_TRUE(lock.try_lock());
+        EXPECT_FALSE(lock.try_lock());
+        EXPECT_FALSE(lock.try_lock_shared());
+        lock.unlock();
+    }
+
+    TEST(adaptive_lock, readers_and_writers)
+    {
+        adaptive_lock lock;
+
+        lock.lock_shared();
+        EXPECT_TRUE(lock.try_lock_shared());
+        EXPECT_FALSE(lock.try_lock());
+        lock.unlock_shared();
+        lock.unlock_shared();
+        EXPECT_TRUE(lock.try_lock());
+        lock.unlock();
+
+        // writers keep the pair equal, readers must never observe them differ
+        uint32_t first = 0, second = 0;
+        std::atomic<bool> torn = false;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 8; ++i) {
+            threads.emplace_back([&, i]() {
+                for (int j = 0; j < 10000; ++j) {
+                    if (i % 4 == 0) {
+                        adaptive_lock::guard g(lock);
+                        ++first;
+                        ++second;
+                    }
+                    else {
+                        adaptive_lock::shared_guard g(lock);
+                        if (first != second) {
+                            torn = true;
+                        }
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        EXPECT_FALSE(torn.load());
+        EXPECT_EQ(20000u, first);
+    }
+
+    TEST(adaptive_lock, writer_not_starved)
+    {
+        adaptive_lock lock;
+
+        // the readers overlap, so without the writer_waiting the reader count would never drop to zero
+        std::atomic<bool> writerDone = false;
+        std::atomic<bool> timedOut = false;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([&]() {
+                while (!writerDone.load()) {
+                    if (std::chrono::steady_clock::now() > deadline) {
+                        timedOut = true;
+                        break;
+                    }
+                    adaptive_lock::shared_guard g(lock);
+                    std::this_thread::sleep_for(std::chrono::microseconds(500));
+                }
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        lock.lock();
+        writerDone = true;
+        lock.unlock();
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        EXPECT_FALSE(timedOut.load());
+    }
+
+    TEST(adaptive_lock, write_sequence)
+    {
+        adaptive_lock lock;
+
+        uint32_t sequence = lock.read_sequence_begin();
+        EXPECT_TRUE(lock.read_sequence_validate(sequence));
+
+        lock.lock_shared(); // readers don't invalidate each other
+        EXPECT_TRUE(lock.read_sequence_validate(sequence));
+        lock.unlock_shared();
+
+        lock.lock();
+        EXPECT_FALSE(lock.read_sequence_validate(sequence));
+        EXPECT_FALSE(lock.read_sequence_validate(lock.read_sequence_begin()));
+        lock.unlock();
+
+        EXPECT_FALSE(lock.read_sequence_validate(sequence));
+        EXPECT_TRUE(lock.read_sequence_validate(lock.read_sequence_begin()));
+    }
+}
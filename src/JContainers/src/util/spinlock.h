@@ -3,6 +3,7 @@
 #include <atomic>
 #include <mutex>
 #include <type_traits>
+#include <intrin.h>
 
 namespace util {
 
@@ -18,7 +19,11 @@ namespace util {
 
         void lock() {
             while(_lock.test_and_set(std::memory_order_acquire))  // acquire lock
-                ; // spin
+                _mm_pause(); // spin
+        }
+
+        bool try_lock() {
+            return !_lock.test_and_set(std::memory_order_acquire);
         }
 
         void unlock() {
@@ -27,4 +32,127 @@ namespace util {
 
         typedef std::lock_guard<spinlock> guard;
     };
+
+    // Reader-writer lock. Spins for a short while with exponential backoff, then parks the thread until the lock
+    // gets released (WaitOnAddress where available, otherwise yields the time slice).
+    // The uncontended lock/unlock costs one atomic operation each, just like the spinlock above.
+    // Meets both Lockable and SharedLockable requirements.
+    // Also counts the writes: the exclusive owner makes the write sequence odd for the duration of its ownership,
+    // so the sequence tells whether the object has been changed since it was read (see read_sequence_begin)
+    class adaptive_lock
+    {
+        enum : uint32_t {
+            writer = 1,
+            waiters = 2, // someone is parked, the thread releasing the lock has to wake them up
+            writer_waiting = 4, // a writer is about to park, new readers stay out until a writer acquires the lock
+            reader_unit = 8, // the rest of the bits is the number of readers
+        };
+
+        std::atomic<uint32_t> _state = 0;
+        // number of contended lock attempts, counted only while the tracking is enabled
+        std::atomic<uint32_t> _contentions = 0;
+        // incremented by the exclusive owner only, thus plain load & store instead of RMW
+        std::atomic<uint32_t> _write_sequence = 0;
+
+        void begin_write() {
+            _write_sequence.store(_write_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        void end_write() {
+            _write_sequence.store(_write_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        void lock_contended();
+        void lock_shared_contended();
+        void park(uint32_t observedState);
+        void wake_all();
+
+    public:
+
+        void lock() {
+            uint32_t expected = 0;
+            if (!_state.compare_exchange_strong(expected, writer, std::memory_order_acquire, std::memory_order_relaxed)) {
+                lock_contended();
+            }
+            begin_write();
+        }
+
+        bool try_lock() {
+            uint32_t expected = 0;
+            if (_state.compare_exchange_strong(expected, writer, std::memory_order_acquire, std::memory_order_relaxed)) {
+                begin_write();
+                return true;
+            }
+            return false;
+        }
+
+        void unlock() {
+            end_write();
+            if (_state.exchange(0, std::memory_order_release) & waiters) {
+                wake_all();
+            }
+        }
+
+        void lock_shared() {
+            if (!try_lock_shared()) {
+                lock_shared_contended();
+            }
+        }
+
+        // fails if there is a writer or someone is waiting. Racing with other readers is not a failure
+        bool try_lock_shared() {
+            uint32_t state = _state.load(std::memory_order_relaxed);
+            while ((state & (writer | waiters | writer_waiting)) == 0) {
+                if (_state.compare_exchange_weak(state, state + reader_unit, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void unlock_shared() {
+            const uint32_t state = _state.fetch_sub(reader_unit, std::memory_order_release) - reader_unit;
+            if (state < reader_unit && (state & waiters)) { // the last reader leaves, someone is parked
+                // the writer_waiting stays: the woken writer takes the lock before the readers get in
+                uint32_t expected = state;
+                if (_state.compare_exchange_strong(expected, state & ~waiters, std::memory_order_relaxed)) {
+                    wake_all();
+                }
+                // otherwise a new owner has inherited the waiters flag and will wake them up
+            }
+        }
+
+        // Change detection: read_sequence_begin, read the data under the shared lock and release it,
+        // later the read_sequence_validate tells whether the data is still the same.
+        // Also lets the lock-free readers check that an immutable copy of the data is current (see array::optimistic_read_number).
+        // An odd sequence means that there is a writer
+        uint32_t read_sequence_begin() const {
+            return _write_sequence.load(std::memory_order_acquire);
+        }
+
+        bool read_sequence_validate(uint32_t sequence) const {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return (sequence & 1) == 0 && _write_sequence.load(std::memory_order_relaxed) == sequence;
+        }
+
+        uint32_t contentions() const {
+            return _contentions.load(std::memory_order_relaxed);
+        }
+
+        static void enable_contention_tracking(bool enable);
+        static bool is_contention_tracking_enabled();
+
+        typedef std::lock_guard<adaptive_lock> guard;
+
+        class shared_guard {
+            adaptive_lock& _lock;
+        public:
+            explicit shared_guard(adaptive_lock& lock) : _lock(lock) { _lock.lock_shared(); }
+            ~shared_guard() { _lock.unlock_shared(); }
+
+            shared_guard(const shared_guard&) = delete;
+            shared_guard& operator=(const shared_guard&) = delete;
+        };
+    };
 }
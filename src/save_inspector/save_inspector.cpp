@@ -0,0 +1,39 @@
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#include <stdio.h>
+
+/// Loads a co-save record dump outside of the game and reports its figures and the load/collect/save timings.
+/// With --synthetic, benchmarks the synthetic object graphs of growing sizes instead.
+/// The work is done by the JContainers dll itself, see domain_master::run_save_inspector for the options
+int main (int argc, const char* argv[])
+{
+    if (argc < 3)
+    {
+        printf ("usage: save_inspector <JContainers dll> <dump file> [--iterations N] [--domain name]..."
+            " [--lazy] [--dedup] [--uncompressed] [--json file]\n"
+            "       save_inspector <JContainers dll> --synthetic [options], the scaling benchmark\n");
+        return 1;
+    }
+
+    auto h = LoadLibraryA (argv[1]);
+    if (!h)
+    {
+        fprintf (stderr, "unable to load %s\n", argv[1]);
+        return 2;
+    }
+
+    int rc = 3;
+    try
+    {
+        typedef int (__cdecl * entry_t) (int, const char**);
+        if (auto entry = (entry_t) GetProcAddress (h, "JC_inspectSave"))
+            rc = entry (argc - 2, argv + 2);
+    }
+    catch (...)
+    {
+        rc = 3;
+    }
+
+    FreeLibrary (h);
+    return rc;
+}